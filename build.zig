@@ -102,4 +102,68 @@ pub fn build(b: *std.Build) void {
 
     const collision_step = b.step("test-collisions", "Run tests with forced hash collisions");
     collision_step.dependOn(&run_collision_tests.step);
+
+    const stats_module = b.createModule(.{
+        .root_source_file = null,
+        .target = target,
+        .optimize = optimize,
+        .link_libc = true,
+    });
+    stats_module.addCSourceFiles(.{
+        .files = &.{"examples/tests.c", "src/parson.c"},
+        .flags = &.{
+            "-std=c23",
+            "-Wall",
+            "-Wextra",
+            "-Wpedantic",
+            "-Werror",
+            "-DTESTS_MAIN",
+            "-DPARSON_ENABLE_STATS",
+        },
+    });
+    stats_module.addIncludePath(b.path("include"));
+    stats_module.addIncludePath(b.path("include/parson"));
+
+    const stats_tests = b.addExecutable(.{
+        .name = "parson-tests-stats",
+        .root_module = stats_module,
+    });
+
+    const run_stats_tests = b.addRunArtifact(stats_tests);
+    run_stats_tests.setCwd(b.path("."));
+    if (b.args) |args| {
+        run_stats_tests.addArgs(args);
+    }
+
+    const stats_step = b.step("test-stats", "Run tests with PARSON_ENABLE_STATS counters");
+    stats_step.dependOn(&run_stats_tests.step);
+
+    // Benchmarks are meaningless in debug builds, so they default to ReleaseFast.
+    const bench_optimize: std.builtin.OptimizeMode = if (optimize == .Debug) .ReleaseFast else optimize;
+    const bench_module = b.createModule(.{
+        .root_source_file = null,
+        .target = target,
+        .optimize = bench_optimize,
+        .link_libc = true,
+    });
+    bench_module.addCSourceFiles(.{
+        .files = &.{"examples/bench.c", "src/parson.c"},
+        .flags = c_warnings,
+    });
+    bench_module.addIncludePath(b.path("include"));
+    bench_module.addIncludePath(b.path("include/parson"));
+
+    const bench = b.addExecutable(.{
+        .name = "parson-bench",
+        .root_module = bench_module,
+    });
+
+    const run_bench = b.addRunArtifact(bench);
+    run_bench.setCwd(b.path("."));
+    if (b.args) |args| {
+        run_bench.addArgs(args);
+    }
+
+    const bench_step = b.step("bench", "Run benchmarks (JSON lines on stdout)");
+    bench_step.dependOn(&run_bench.step);
 }
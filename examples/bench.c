@@ -0,0 +1,593 @@
+/*
+ SPDX-License-Identifier: MIT
+
+ Parson (https://github.com/kgabis/parson)
+ Copyright (c) 2012 - 2023 Krzysztof Gabis
+
+ Permission is hereby granted, free of charge, to any person obtaining a copy
+ of this software and associated documentation files (the "Software"), to deal
+ in the Software without restriction, including without limitation the rights
+ to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ copies of the Software, and to permit persons to whom the Software is
+ furnished to do so, subject to the following conditions:
+
+ The above copyright notice and this permission notice shall be included in
+ all copies or substantial portions of the Software.
+
+ THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ THE SOFTWARE.
+*/
+#ifdef _MSC_VER
+#define _CRT_SECURE_NO_WARNINGS
+#endif
+
+/* Throughput and allocation benchmarks, one JSON object per line on stdout:
+     bench [--min-time SECONDS] [FILE...]
+   Without files the documents are generated to resemble the usual corpora
+   (canada.json, twitter.json, citm_catalog.json and a numeric array); with
+   files every FILE is benchmarked instead and named after its base name. */
+
+#include "parson/parson.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static constexpr size_t bench_path_count = 64;
+static constexpr size_t bench_churn_keys = 1'000;
+
+typedef struct {
+  size_t mallocs;
+  size_t frees;
+  size_t bytes;
+} alloc_counts;
+
+static alloc_counts g_allocs;
+
+static void *bench_malloc(size_t size) {
+  g_allocs.mallocs++;
+  g_allocs.bytes += size;
+  return malloc(size);
+}
+
+static void bench_free(void *ptr) {
+  if (ptr != nullptr) {
+    g_allocs.frees++;
+  }
+  free(ptr);
+}
+
+static char *copy_string(const char *string) {
+  const size_t size = strlen(string) + 1;
+  char *copy = (char *)malloc(size);
+  if (copy != nullptr) {
+    memcpy(copy, string, size);
+  }
+  return copy;
+}
+
+static double now_seconds() {
+  struct timespec ts;
+#if defined(TIME_MONOTONIC)
+  timespec_get(&ts, TIME_MONOTONIC);
+#else
+  timespec_get(&ts, TIME_UTC);
+#endif
+  return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* xorshift64*, so that generated documents are the same on every run */
+static uint64_t g_rng_state = 0x9e37'79b9'7f4a'7c15;
+
+static uint64_t rng_next() {
+  g_rng_state ^= g_rng_state >> 12;
+  g_rng_state ^= g_rng_state << 25;
+  g_rng_state ^= g_rng_state >> 27;
+  return g_rng_state * 0x2545'f491'4f6c'dd1d;
+}
+
+static double rng_range(double min, double max) {
+  return min + (double)(rng_next() >> 11) / (double)(1ULL << 53) * (max - min);
+}
+
+static const char *rng_pick(const char *const *words, size_t count) {
+  return words[rng_next() % count];
+}
+
+/* A GeoJSON polygon of long coordinate pairs, like canada.json */
+static JSON_Value *generate_canada() {
+  JSON_Value *root = json_value_init_object();
+  JSON_Object *object = json_object(root);
+  json_object_set_string(object, "type", "FeatureCollection");
+  JSON_Value *feature = json_value_init_object();
+  json_object_set_string(json_object(feature), "type", "Feature");
+  json_object_dotset_string(json_object(feature), "properties.name", "Canada");
+  json_object_dotset_string(json_object(feature), "geometry.type", "Polygon");
+  JSON_Value *rings = json_value_init_array();
+  for (size_t i = 0; i < 480; i++) {
+    JSON_Value *ring = json_value_init_array();
+    for (size_t j = 0; j < 100; j++) {
+      JSON_Value *point = json_value_init_array();
+      json_array_append_number(json_array(point), rng_range(-141.0, -52.6));
+      json_array_append_number(json_array(point), rng_range(41.7, 83.1));
+      json_array_append_value(json_array(ring), point);
+    }
+    json_array_append_value(json_array(rings), ring);
+  }
+  json_object_dotset_value(json_object(feature), "geometry.coordinates",
+                           rings);
+  JSON_Value *features = json_value_init_array();
+  json_array_append_value(json_array(features), feature);
+  json_object_set_value(object, "features", features);
+  return root;
+}
+
+static const char *const g_words[] = {
+    "the",   "json",     "parser",  "release", "today",  "東京",
+    "名前",  "前田",     "あゆみ",  "café",    "naïve",  "🎉",
+    "https", "followers", "@parson", "#c23",   "quote\"", "line\nbreak"};
+static constexpr size_t g_word_count = sizeof(g_words) / sizeof(g_words[0]);
+
+static JSON_Value *generate_text(size_t words) {
+  char text[1'024] = {0};
+  size_t len = 0;
+  for (size_t i = 0; i < words; i++) {
+    const int written =
+        snprintf(text + len, sizeof(text) - len, "%s%s", i > 0 ? " " : "",
+                 rng_pick(g_words, g_word_count));
+    if (written < 0 || (size_t)written >= sizeof(text) - len) {
+      break;
+    }
+    len += (size_t)written;
+  }
+  return json_value_init_string(text);
+}
+
+/* Statuses with users, entities, nulls and non-ASCII text, like
+   twitter.json */
+static JSON_Value *generate_twitter() {
+  JSON_Value *root = json_value_init_object();
+  JSON_Value *statuses = json_value_init_array();
+  for (size_t i = 0; i < 500; i++) {
+    JSON_Value *status = json_value_init_object();
+    JSON_Object *s = json_object(status);
+    char id[32];
+    const uint64_t status_id = 505'874'924'095'815'681ULL + i * 7'919;
+    snprintf(id, sizeof(id), "%llu", (unsigned long long)status_id);
+    json_object_dotset_value(s, "metadata.result_type",
+                             json_value_init_string("recent"));
+    json_object_dotset_string(s, "metadata.iso_language_code", "ja");
+    json_object_set_string(s, "created_at", "Sun Aug 31 00:29:15 +0000 2014");
+    json_object_set_number(s, "id", (double)status_id);
+    json_object_set_string(s, "id_str", id);
+    json_object_set_value(s, "text", generate_text(14));
+    json_object_set_string(
+        s, "source",
+        "<a href=\"https://mobile.twitter.com\" rel=\"nofollow\">Mobile</a>");
+    json_object_set_boolean(s, "truncated", false);
+    json_object_set_null(s, "in_reply_to_status_id");
+    json_object_set_null(s, "in_reply_to_screen_name");
+    json_object_dotset_number(s, "user.id",
+                              (double)(rng_next() % 3'000'000'000));
+    json_object_dotset_value(s, "user.name", generate_text(2));
+    json_object_dotset_string(s, "user.screen_name", "ayuu0123");
+    json_object_dotset_value(s, "user.description", generate_text(12));
+    json_object_dotset_number(s, "user.followers_count",
+                              (double)(rng_next() % 10'000));
+    json_object_dotset_number(s, "user.friends_count",
+                              (double)(rng_next() % 10'000));
+    json_object_dotset_boolean(s, "user.verified", false);
+    json_object_dotset_value(s, "user.entities.description.urls",
+                             json_value_init_array());
+    json_object_dotset_value(s, "entities.hashtags", json_value_init_array());
+    JSON_Value *mention = json_value_init_object();
+    json_object_set_string(json_object(mention), "screen_name", "aym0566x");
+    json_object_set_value(json_object(mention), "indices",
+                          json_parse_string("[0, 9]"));
+    JSON_Value *mentions = json_value_init_array();
+    json_array_append_value(json_array(mentions), mention);
+    json_object_dotset_value(s, "entities.user_mentions", mentions);
+    json_object_set_number(s, "retweet_count", (double)(rng_next() % 100));
+    json_object_set_boolean(s, "favorited", false);
+    json_object_set_string(s, "lang", "ja");
+    json_array_append_value(json_array(statuses), status);
+  }
+  json_object_set_value(json_object(root), "statuses", statuses);
+  json_object_dotset_number(json_object(root), "search_metadata.count", 500);
+  json_object_dotset_string(json_object(root), "search_metadata.query",
+                            "%E4%B8%80");
+  return root;
+}
+
+/* Objects keyed by numeric ids and arrays of performances with many small
+   integers, like citm_catalog.json */
+static JSON_Value *generate_citm() {
+  JSON_Value *root = json_value_init_object();
+  JSON_Object *object = json_object(root);
+  char key[32];
+  for (size_t i = 0; i < 180; i++) {
+    snprintf(key, sizeof(key), "areaNames.%zu", 205'705'993 + i);
+    json_object_dotset_value(object, key, generate_text(3));
+  }
+  for (size_t i = 0; i < 2'000; i++) {
+    const size_t id = 138'586'341 + i * 10;
+    snprintf(key, sizeof(key), "%zu", id);
+    JSON_Value *event = json_value_init_object();
+    JSON_Object *e = json_object(event);
+    json_object_set_null(e, "description");
+    json_object_set_number(e, "id", (double)id);
+    json_object_set_null(e, "logo");
+    json_object_set_value(e, "name", generate_text(4));
+    json_object_set_value(e, "subTopicIds",
+                          json_parse_string("[337184269, 337184283]"));
+    json_object_set_null(e, "subjectCode");
+    json_object_set_null(e, "subtitle");
+    json_object_set_value(e, "topicIds",
+                          json_parse_string("[324846099, 107888604]"));
+    JSON_Value *events = json_object_get_value(object, "events");
+    if (events == nullptr) {
+      json_object_set_value(object, "events", json_value_init_object());
+      events = json_object_get_value(object, "events");
+    }
+    json_object_set_value(json_object(events), key, event);
+  }
+  JSON_Value *performances = json_value_init_array();
+  for (size_t i = 0; i < 2'400; i++) {
+    JSON_Value *performance = json_value_init_object();
+    JSON_Object *p = json_object(performance);
+    json_object_set_number(p, "eventId",
+                           (double)(138'586'341 + i % 2'000 * 10));
+    json_object_set_number(p, "id", (double)(339'887'544 + i));
+    json_object_set_null(p, "logo");
+    json_object_set_null(p, "name");
+    JSON_Value *prices = json_value_init_array();
+    for (size_t j = 0; j < 3; j++) {
+      JSON_Value *price = json_value_init_object();
+      json_object_set_number(json_object(price), "amount",
+                             (double)(rng_next() % 100'000));
+      json_object_set_number(json_object(price), "audienceSubCategoryId",
+                             337'100'890);
+      json_object_set_number(json_object(price), "seatCategoryId",
+                             (double)(338'937'295 + j));
+      json_array_append_value(json_array(prices), price);
+    }
+    json_object_set_value(p, "prices", prices);
+    json_object_set_value(
+        p, "seatCategories",
+        json_parse_string("[{\"areas\": [{\"areaId\": 205705999, \"blockIds\": "
+                          "[]}], \"seatCategoryId\": 338937295}]"));
+    json_object_set_null(p, "seatMapImage");
+    json_object_set_number(p, "start", 1'372'701'600'000.0 + (double)i * 1e5);
+    json_object_set_string(p, "venueCode", "PLEYEL_PLEYEL");
+    json_array_append_value(json_array(performances), performance);
+  }
+  json_object_set_value(object, "performances", performances);
+  return root;
+}
+
+/* Integers and doubles of every magnitude */
+static JSON_Value *generate_numbers() {
+  JSON_Value *root = json_value_init_array();
+  for (size_t i = 0; i < 100'000; i++) {
+    const double number = i % 2 == 0 ? (double)(rng_next() % 1'000'000)
+                                     : rng_range(-1e6, 1e6);
+    json_array_append_number(json_array(root), number);
+  }
+  return root;
+}
+
+typedef struct {
+  const char *name;
+  char *text;
+  size_t len;
+  JSON_Value *value;
+} bench_document;
+
+typedef struct {
+  const bench_document *document;
+  JSON_Value *copy;
+  char *cbor; /* document->value as CBOR for bench_parse_cbor */
+  size_t cbor_len;
+  JSON_Schema *schema; /* document->value compiled as its own schema */
+  JSON_Object *object;
+  char *paths[bench_path_count];
+  size_t path_count;
+  char *keys[bench_churn_keys];
+  size_t next;
+} bench_state;
+
+typedef bool (*bench_function)(bench_state *state);
+
+static bool bench_parse(bench_state *state) {
+  JSON_Value *value =
+      json_parse_buffer(state->document->text, state->document->len);
+  json_value_free(value);
+  return value != nullptr;
+}
+
+static bool bench_serialize(bench_state *state) {
+  char *text = json_serialize_to_string(state->document->value);
+  json_free_serialized_string(text);
+  return text != nullptr;
+}
+
+static bool bench_serialize_pretty(bench_state *state) {
+  char *text = json_serialize_to_string_pretty(state->document->value);
+  json_free_serialized_string(text);
+  return text != nullptr;
+}
+
+static bool bench_serialize_parallel(bench_state *state) {
+  char *text = json_serialize_to_string_parallel(state->document->value,
+                                                 JSONSerializeDefault, 0);
+  json_free_serialized_string(text);
+  return text != nullptr;
+}
+
+/* Publishing a long-lived document: one member changes between serializations
+   of a copy with cached serialization */
+static bool bench_serialize_cached(bench_state *state) {
+  JSON_Array *array = json_array(state->copy);
+  const size_t count = json_array_get_count(array);
+  if (count > 0) {
+    (void)json_array_replace_number(array, state->next % count,
+                                    (double)state->next);
+  } else if (state->path_count > 0) {
+    (void)json_object_dotset_number(
+        json_object(state->copy),
+        state->paths[state->next % state->path_count], (double)state->next);
+  }
+  state->next++;
+  char *text = json_serialize_to_string(state->copy);
+  json_free_serialized_string(text);
+  return text != nullptr;
+}
+
+static bool bench_serialize_cbor(bench_state *state) {
+  size_t len = 0;
+  char *cbor = json_serialize_to_cbor(state->document->value, &len);
+  json_free_serialized_string(cbor);
+  return cbor != nullptr;
+}
+
+static bool bench_parse_cbor(bench_state *state) {
+  JSON_Value *value = json_parse_cbor(state->cbor, state->cbor_len, nullptr);
+  json_value_free(value);
+  return value != nullptr;
+}
+
+static bool bench_deep_copy(bench_state *state) {
+  JSON_Value *copy = json_value_deep_copy(state->document->value);
+  json_value_free(copy);
+  return copy != nullptr;
+}
+
+static bool bench_equals(bench_state *state) {
+  return json_value_equals(state->document->value, state->copy);
+}
+
+static bool bench_validate(bench_state *state) {
+  return json_validate(state->document->value, state->document->value) ==
+         JSONSuccess;
+}
+
+static bool bench_validate_compiled(bench_state *state) {
+  return json_schema_validate(state->schema, state->document->value) ==
+         JSONSuccess;
+}
+
+static bool bench_validate_buffer(bench_state *state) {
+  return json_schema_validate_buffer(state->schema, state->document->text,
+                                     state->document->len) == JSONSuccess;
+}
+
+static bool bench_dotget(bench_state *state) {
+  const char *path = state->paths[state->next++ % state->path_count];
+  return json_object_dotget_value(state->object, path) != nullptr;
+}
+
+static bool bench_churn(bench_state *state) {
+  const char *key = state->keys[state->next++ % bench_churn_keys];
+  return json_object_remove(state->object, key) == JSONSuccess &&
+         json_object_set_number(state->object, key, 1) == JSONSuccess;
+}
+
+static double g_min_time = 0.2;
+
+/* Runs fun in batches of doubling size until a batch takes g_min_time and
+   prints the last batch. bytes is the input size for MB/s, 0 if there is
+   none. */
+static bool bench_run(const char *name, bench_state *state, size_t bytes,
+                      bench_function fun) {
+  if (!fun(state)) { /* warm-up */
+    fprintf(stderr, "%s on %s failed\n", name, state->document->name);
+    return false;
+  }
+  size_t iterations = 1;
+  double elapsed = 0;
+  alloc_counts counts = {0};
+  while (true) {
+    g_allocs = (alloc_counts){0};
+    const double start = now_seconds();
+    for (size_t i = 0; i < iterations; i++) {
+      (void)fun(state);
+    }
+    elapsed = now_seconds() - start;
+    counts = g_allocs;
+    if (elapsed >= g_min_time || iterations > SIZE_MAX / 2) {
+      break;
+    }
+    iterations *= 2;
+  }
+  const double per_op = elapsed / (double)iterations;
+  printf("{\"case\": \"%s\", \"document\": \"%s\", \"iterations\": %zu, "
+         "\"ns_per_op\": %.1f",
+         name, state->document->name, iterations, per_op * 1e9);
+  if (bytes > 0) {
+    printf(", \"bytes\": %zu, \"mb_per_s\": %.1f", bytes,
+           (double)bytes / per_op / 1e6);
+  }
+  printf(", \"allocs_per_op\": %.2f, \"frees_per_op\": %.2f, "
+         "\"alloc_bytes_per_op\": %.1f}\n",
+         (double)counts.mallocs / (double)iterations,
+         (double)counts.frees / (double)iterations,
+         (double)counts.bytes / (double)iterations);
+  return true;
+}
+
+/* Collects dot paths to the members of nested objects for bench_dotget */
+static void collect_paths(bench_state *state, const JSON_Object *object,
+                          const char *prefix, size_t depth) {
+  const size_t count = json_object_get_count(object);
+  for (size_t i = 0; i < count && state->path_count < bench_path_count; i++) {
+    const char *name = json_object_get_name(object, i);
+    if (strchr(name, '.') != nullptr) {
+      continue;
+    }
+    char path[256];
+    const int len = snprintf(path, sizeof(path), "%s%s%s", prefix,
+                             prefix[0] != '\0' ? "." : "", name);
+    if (len < 0 || (size_t)len >= sizeof(path)) {
+      continue;
+    }
+    const JSON_Object *child = json_object_get_object(object, name);
+    if (child != nullptr && depth < 4) {
+      collect_paths(state, child, path, depth + 1);
+    } else if (depth > 0) {
+      state->paths[state->path_count] = copy_string(path);
+      state->path_count += state->paths[state->path_count] != nullptr;
+    }
+  }
+}
+
+static bool bench_document_run(const bench_document *document) {
+  bench_state state = {.document = document};
+  bool ok = bench_run("parse", &state, document->len, bench_parse);
+  ok = bench_run("serialize", &state, document->len, bench_serialize) && ok;
+  ok = bench_run("serialize_pretty", &state, document->len,
+                 bench_serialize_pretty) &&
+       ok;
+  ok = bench_run("serialize_parallel", &state, document->len,
+                 bench_serialize_parallel) &&
+       ok;
+  ok = bench_run("serialize_cbor", &state, document->len,
+                 bench_serialize_cbor) &&
+       ok;
+  state.cbor = json_serialize_to_cbor(document->value, &state.cbor_len);
+  ok = bench_run("parse_cbor", &state, document->len, bench_parse_cbor) && ok;
+  json_free_serialized_string(state.cbor);
+  ok = bench_run("deep_copy", &state, document->len, bench_deep_copy) && ok;
+  state.copy = json_value_deep_copy(document->value);
+  ok = bench_run("equals", &state, document->len, bench_equals) && ok;
+  ok = bench_run("validate", &state, document->len, bench_validate) && ok;
+  state.schema = json_schema_compile(document->value);
+  ok = bench_run("validate_compiled", &state, document->len,
+                 bench_validate_compiled) &&
+       ok;
+  ok = bench_run("validate_buffer", &state, document->len,
+                 bench_validate_buffer) &&
+       ok;
+  json_schema_free(state.schema);
+  state.object = json_object(document->value);
+  if (state.object != nullptr) {
+    collect_paths(&state, state.object, "", 0);
+  }
+  if (state.path_count > 0) {
+    ok = bench_run("dotget", &state, 0, bench_dotget) && ok;
+  }
+  (void)json_value_cache_serialization(state.copy, true);
+  ok = bench_run("serialize_cached", &state, document->len,
+                 bench_serialize_cached) &&
+       ok;
+  json_value_free(state.copy);
+  for (size_t i = 0; i < state.path_count; i++) {
+    free(state.paths[i]);
+  }
+  return ok;
+}
+
+/* Removes and re-inserts the members of a 1000 member object */
+static bool bench_churn_run() {
+  bench_document document = {.name = "churn",
+                             .value = json_value_init_object()};
+  bench_state state = {.document = &document,
+                       .object = json_object(document.value)};
+  char key[32];
+  for (size_t i = 0; i < bench_churn_keys; i++) {
+    snprintf(key, sizeof(key), "member_%zu", i);
+    state.keys[i] = copy_string(key);
+    json_object_set_number(state.object, key, (double)i);
+  }
+  const bool ok = bench_run("insert_remove", &state, 0, bench_churn);
+  for (size_t i = 0; i < bench_churn_keys; i++) {
+    free(state.keys[i]);
+  }
+  json_value_free(document.value);
+  return ok;
+}
+
+static bool load_document(bench_document *document) {
+  if (document->value == nullptr) {
+    return false;
+  }
+  document->text = json_serialize_to_string(document->value);
+  document->len = document->text != nullptr ? strlen(document->text) : 0;
+  return document->text != nullptr;
+}
+
+int main(int argc, char *argv[]) {
+  bench_document documents[16] = {0};
+  size_t document_count = 0;
+  json_set_allocation_functions(bench_malloc, bench_free);
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--min-time") == 0 && i + 1 < argc) {
+      g_min_time = atof(argv[++i]);
+      continue;
+    }
+    if (document_count == sizeof(documents) / sizeof(documents[0])) {
+      fprintf(stderr, "too many files\n");
+      return 1;
+    }
+    const char *name = strrchr(argv[i], '/');
+    documents[document_count] = (bench_document){
+        .name = name != nullptr ? name + 1 : argv[i],
+        .value = json_parse_file(argv[i])};
+    if (!load_document(&documents[document_count])) {
+      fprintf(stderr, "can't parse %s\n", argv[i]);
+      return 1;
+    }
+    document_count++;
+  }
+  if (document_count == 0) {
+    documents[0] = (bench_document){.name = "canada",
+                                    .value = generate_canada()};
+    documents[1] = (bench_document){.name = "twitter",
+                                    .value = generate_twitter()};
+    documents[2] = (bench_document){.name = "citm_catalog",
+                                    .value = generate_citm()};
+    documents[3] = (bench_document){.name = "numbers",
+                                    .value = generate_numbers()};
+    document_count = 4;
+    for (size_t i = 0; i < document_count; i++) {
+      if (!load_document(&documents[i])) {
+        fprintf(stderr, "can't generate %s\n", documents[i].name);
+        return 1;
+      }
+    }
+  }
+  bool ok = true;
+  for (size_t i = 0; i < document_count; i++) {
+    ok = bench_document_run(&documents[i]) && ok;
+    json_free_serialized_string(documents[i].text);
+    json_value_free(documents[i].value);
+  }
+  ok = bench_churn_run() && ok;
+  return ok ? 0 : 1;
+}
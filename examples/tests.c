@@ -73,6 +73,35 @@ void test_custom_number_format();
 void test_custom_number_serialization_function();
 void test_object_clear();
 void test_allocation_functions_switch();
+void test_arena();
+void test_string_allocations();
+void test_string_scanning();
+void test_structural_index();
+void test_number_parsing();
+void test_number_format_mode();
+void test_serializer();
+void test_serialize_to_writer();
+void test_push_parser();
+void test_parse_buffer();
+void test_parse_insitu();
+void test_object_layout();
+void test_object_key_lengths();
+void test_paths();
+void test_key_table();
+void test_context();
+void test_parse_events();
+void test_parse_lazy();
+void test_stream();
+void test_parse_parallel();
+void test_stats();
+void test_binary_encoding();
+void test_compact_values();
+void test_reserve_and_bulk();
+void test_compiled_schema();
+void test_structure_hash();
+void test_frozen_values();
+void test_parallel_serialization();
+void test_serialization_cache();
 
 void print_commits_info(const char *username, const char *repo);
 void persistence_example();
@@ -146,6 +175,35 @@ int tests_main(int argc, char *argv[]) {
   test_custom_number_serialization_function();
   test_object_clear();
   test_allocation_functions_switch();
+  test_arena();
+  test_string_allocations();
+  test_string_scanning();
+  test_structural_index();
+  test_number_parsing();
+  test_number_format_mode();
+  test_serializer();
+  test_serialize_to_writer();
+  test_push_parser();
+  test_parse_buffer();
+  test_parse_insitu();
+  test_object_layout();
+  test_object_key_lengths();
+  test_paths();
+  test_key_table();
+  test_context();
+  test_parse_events();
+  test_parse_lazy();
+  test_stream();
+  test_parse_parallel();
+  test_stats();
+  test_binary_encoding();
+  test_compact_values();
+  test_reserve_and_bulk();
+  test_compiled_schema();
+  test_structure_hash();
+  test_frozen_values();
+  test_parallel_serialization();
+  test_serialization_cache();
 
   printf("Tests failed: %d\n", g_tests_failed);
   printf("Tests passed: %d\n", g_tests_passed);
@@ -872,6 +930,2541 @@ void test_allocation_functions_switch() {
   TEST(g_malloc_count == 0);
 }
 
+void test_arena() {
+  g_malloc_count = 0;
+  {
+    char key_buf[32];
+    char *file_contents = read_file(get_file_path("test_2.txt"));
+    JSON_Value *heap_value = json_parse_string(file_contents);
+    JSON_Arena *arena = json_arena_new();
+    JSON_Value *arena_value = json_parse_string_arena(file_contents, arena);
+    JSON_Object *obj = json_object(arena_value);
+    JSON_Array *arr = json_object_get_array(obj, "string array");
+    TEST(arena != nullptr);
+    TEST(arena_value != nullptr);
+    TEST(json_value_equals(heap_value, arena_value));
+
+    TEST(json_object_set_string(obj, "string", "arena") == JSONSuccess);
+    TEST(STREQ(json_object_get_string(obj, "string"), "arena"));
+    TEST(json_object_dotset_number(obj, "arena.nested.number", 42) ==
+         JSONSuccess);
+    TEST(json_object_dotget_number(obj, "arena.nested.number") == 42);
+    for (int i = 0; i < 64; i++) {
+      snprintf(key_buf, sizeof key_buf, "key %d", i);
+      TEST(json_object_set_number(obj, key_buf, i) == JSONSuccess);
+    }
+    TEST(json_object_get_number(obj, "key 63") == 63);
+    TEST(json_array_append_number(arr, 1337) == JSONSuccess);
+    TEST(json_array_append_value(arr, json_value_init_string("heap")) ==
+         JSONSuccess);
+    TEST(STREQ(json_array_get_string(arr, json_array_get_count(arr) - 1),
+               "heap"));
+    TEST(json_object_set_value(obj, "heap object",
+                               json_parse_string("{\"a\":[1,2,3]}")) ==
+         JSONSuccess);
+    TEST(json_array_get_count(json_object_dotget_array(obj, "heap object.a")) ==
+         3);
+    TEST(json_object_set_value(obj, "heap object 2",
+                               json_parse_string("{\"a\":[1,2,3]}")) ==
+         JSONSuccess);
+    TEST(json_object_remove(obj, "heap object 2") == JSONSuccess);
+    TEST(json_array_replace_value(arr, 0, json_value_init_null()) ==
+         JSONSuccess);
+    TEST(json_array_remove(arr, 0) == JSONSuccess);
+    json_value_free(arena_value); /* no-op for arena documents */
+
+    json_arena_reset(arena);
+    arena_value = json_parse_string_arena("[1,2,{\"a\":null}]", arena);
+    TEST(json_array_get_count(json_array(arena_value)) == 3);
+    TEST(json_parse_string_arena("[1,2,", arena) == nullptr);
+    TEST(json_parse_string_arena("{\"a\":\"\\uDF67\"}", arena) == nullptr);
+    arena_value = json_parse_string_arena("\"heap\"", nullptr);
+    TEST(STREQ(json_string(arena_value), "heap"));
+    json_value_free(arena_value);
+
+    json_arena_free(arena);
+    json_value_free(heap_value);
+    free(file_contents);
+  }
+  TEST(g_malloc_count == 0);
+}
+
+void test_string_allocations() {
+  JSON_Value *val = nullptr;
+  json_set_allocation_functions(failing_malloc, failing_free);
+  g_failing_alloc.should_fail = false;
+  g_failing_alloc.alloc_count = 0;
+
+  /* one allocation for the value and one for its characters */
+  g_failing_alloc.total_count = 0;
+  val = json_parse_string("\"longer plain string\"");
+  TEST(val != nullptr);
+  TEST(g_failing_alloc.total_count == 2);
+  TEST(STREQ(json_value_get_string(val), "longer plain string"));
+  json_value_free(val);
+
+  /* up to 14 bytes without escapes are kept inside the value */
+  g_failing_alloc.total_count = 0;
+  val = json_parse_string("\"plain string\"");
+  TEST(val != nullptr);
+  TEST(g_failing_alloc.total_count == 1);
+  TEST(STREQ(json_value_get_string(val), "plain string"));
+  json_value_free(val);
+
+  g_failing_alloc.total_count = 0;
+  val = json_parse_string("\"esc\\u0061ped\\n\\\"\\ud83d\\ude00\"");
+  TEST(val != nullptr);
+  TEST(g_failing_alloc.total_count == 2);
+  TEST(STREQ(json_value_get_string(val), "escaped\n\"\xf0\x9f\x98\x80"));
+  TEST(json_value_get_string_len(val) == 13);
+  json_value_free(val);
+
+  g_failing_alloc.total_count = 0;
+  val = json_parse_string("\"\"");
+  TEST(val != nullptr);
+  TEST(g_failing_alloc.total_count == 1);
+  TEST(json_value_get_string_len(val) == 0);
+  json_value_free(val);
+
+  TEST(json_parse_string("\"tab\tinside\"") == nullptr);
+  TEST(json_parse_string("\"unterminated") == nullptr);
+  TEST(json_parse_string("\"bad escape \\x\"") == nullptr);
+  TEST(g_failing_alloc.alloc_count == 0);
+
+  json_set_allocation_functions(counted_malloc, counted_free);
+}
+
+void test_string_scanning() {
+  /* special characters at every offset of strings long enough to go through
+     all scanning kernels */
+  static const struct {
+    char raw;
+    const char *escaped;
+  } specials[] = {
+      {'\"', "\\\""}, {'\\', "\\\\"},     {'/', "\\/"},
+      {'\n', "\\n"},  {'\x01', "\\u0001"}, {'\x1f', "\\u001f"},
+  };
+  constexpr size_t string_len = 150;
+  char raw[string_len + 1];
+  char json[string_len + 16];
+  char *serialized = nullptr;
+  JSON_Value *val = nullptr;
+  size_t i = 0, pos = 0;
+  bool ok = true;
+  for (i = 0; i < sizeof(specials) / sizeof(specials[0]); i++) {
+    for (pos = 0; pos < string_len && ok; pos++) {
+      memset(raw, 'x', string_len);
+      raw[string_len] = '\0';
+      raw[pos] = specials[i].raw;
+      snprintf(json, sizeof(json), "\"%.*s%s%s\"", (int)pos, raw,
+               specials[i].escaped, raw + pos + 1);
+      val = json_parse_string(json);
+      ok = val != nullptr && json_value_get_string_len(val) == string_len &&
+           memcmp(json_value_get_string(val), raw, string_len) == 0;
+      serialized = json_serialize_to_string(val);
+      ok = ok && serialized != nullptr && strcmp(serialized, json) == 0;
+      json_free_serialized_string(serialized);
+      json_value_free(val);
+      /* unescaped control characters are rejected */
+      if ((unsigned char)specials[i].raw < 0x20) {
+        json[pos + 1] = specials[i].raw;
+        memcpy(json + pos + 2, raw + pos + 1, string_len - pos - 1);
+        json[string_len + 1] = '\"';
+        json[string_len + 2] = '\0';
+        ok = ok && json_parse_string(json) == nullptr;
+      }
+    }
+  }
+  TEST(ok);
+
+  json_set_escape_slashes(0);
+  val = json_parse_string("\"http://example.com/a/b/c/d/e/f/g/h/i/j/k/l/m\"");
+  serialized = json_serialize_to_string(val);
+  TEST(STREQ(serialized, "\"http://example.com/a/b/c/d/e/f/g/h/i/j/k/l/m\""));
+  json_free_serialized_string(serialized);
+  json_value_free(val);
+  json_set_escape_slashes(1);
+}
+
+static bool parses_same_with_index(const char *string) {
+  JSON_Value *expected = json_parse_string(string);
+  JSON_Value *indexed =
+      json_parse_string_with_options(string, nullptr, JSONParseStructuralIndex);
+  const bool same = (expected == nullptr && indexed == nullptr) ||
+                    json_value_equals(expected, indexed);
+  json_value_free(expected);
+  json_value_free(indexed);
+  return same;
+}
+
+void test_structural_index() {
+  static const char *inputs[] = {
+      "{\"lorem\":\"ipsum\"}",
+      " \t\r\n [ 1 , 2.5e3 , -0 , true , false , null , \"x\" ] \n",
+      "{ \"a\" : { \"b\" : [ [ ] , { } , [ { \"c\" : \"\\\\\" } ] ] } }",
+      "[\"\\\"\", \"\\\\\\\"\", \"\\\\\", \"a\\\\\\\\\"]",
+      "[\"lorem\",]",
+      "\xEF\xBB\xBF  [1]",
+      "[1 2]",
+      "[12abc]",
+      "[12 abc]",
+      "[\"a\"x]",
+      "[\"a\" x]",
+      "[true false]",
+      "[truex]",
+      "{\"a\" \"b\"}",
+      "{\"a\":1 , , }",
+      "[\"unterminated",
+      "[\"\\\"]",
+      "   ",
+      "",
+  };
+  size_t i = 0, pad = 0;
+  char buf[256];
+  bool ok = true;
+  for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+    ok = ok && parses_same_with_index(inputs[i]);
+  }
+  TEST(ok);
+
+  /* escapes and whitespace runs crossing 64-byte block boundaries */
+  for (pad = 0; pad < 130 && ok; pad++) {
+    snprintf(buf, sizeof(buf),
+             "%*s{\"k\\\\\\\\\" :\n"
+             "%*s\"v\\\\\\\"\\\\\" , \"n\" : [ 1 ,%*s2 ] }",
+             (int)pad, "", (int)(pad % 70), "", (int)(pad % 9), "");
+    ok = parses_same_with_index(buf);
+  }
+  TEST(ok);
+
+  JSON_Value *value = json_parse_file(get_file_path("test_2.txt"));
+  char *pretty = json_serialize_to_string_pretty(value);
+  JSON_Value *indexed =
+      json_parse_string_with_options(pretty, nullptr, JSONParseStructuralIndex);
+  TEST(json_value_equals(value, indexed));
+  json_value_free(indexed);
+  json_free_serialized_string(pretty);
+  json_value_free(value);
+}
+
+static bool parses_to_number(const char *string, double expected) {
+  JSON_Value *value = json_parse_string(string);
+  const bool result = value != nullptr &&
+                      json_value_get_type(value) == JSONNumber &&
+                      memcmp(&(double){json_value_get_number(value)},
+                             &expected, sizeof(double)) == 0;
+  json_value_free(value);
+  return result;
+}
+
+void test_number_parsing() {
+  TEST(parses_to_number("0", 0.0));
+  TEST(parses_to_number("-0", -0.0));
+  TEST(parses_to_number("0e5", 0.0));
+  TEST(parses_to_number("-0.0E-7", -0.0));
+  TEST(parses_to_number("123456", 123456.0));
+  TEST(parses_to_number("0.1", 0.1));
+  TEST(parses_to_number("1e22", 1e22));
+  TEST(parses_to_number("1e23", 1e23));
+  TEST(parses_to_number("9007199254740993", 9007199254740992.0));
+  TEST(parses_to_number("2.2250738585072011e-308", 2.2250738585072011e-308));
+  TEST(parses_to_number("4.9406564584124654e-324", 4.9406564584124654e-324));
+  TEST(parses_to_number("1.7976931348623157e308", 1.7976931348623157e308));
+  TEST(parses_to_number("1e-400", 0.0));
+  TEST(parses_to_number("123456789012345678901234567890",
+                        1.2345678901234568e29));
+  /* halfway between 1 and the next double, then just above it */
+  TEST(parses_to_number(
+      "1.00000000000000011102230246251565404236316680908203125", 1.0));
+  TEST(parses_to_number(
+      "1.00000000000000011102230246251565404236316680908203126",
+      1.0000000000000002));
+  TEST(parses_to_number("0.0000000000000000000000000000012345678901234567",
+                        1.2345678901234567e-30));
+
+  TEST(json_parse_string("[1.]") == nullptr);
+  TEST(json_parse_string("[.5]") == nullptr);
+  TEST(json_parse_string("[1e]") == nullptr);
+  TEST(json_parse_string("[1e+]") == nullptr);
+  TEST(json_parse_string("[+1]") == nullptr);
+  TEST(json_parse_string("[-inf]") == nullptr);
+  TEST(json_parse_string("[1e400]") == nullptr);
+}
+
+void test_number_format_mode() {
+  JSON_Value *val = json_parse_string(
+      "[0.1, 1e22, -0.0, 5e-324, 0.000015, 100, 123456.789, 1e16, 1e17, "
+      "-2.5e-7, 1.7976931348623157e308, 9007199254740993]");
+  char *serialized = nullptr;
+  json_set_number_format_mode(JSONNumberFormatShortest);
+  serialized = json_serialize_to_string(val);
+  TEST(STREQ(serialized, "[0.1,1e+22,-0,5e-324,1.5e-05,100,123456.789,"
+                         "10000000000000000,1e+17,-2.5e-07,"
+                         "1.7976931348623157e+308,9007199254740993]"));
+  TEST(json_serialization_size(val) == strlen(serialized) + 1);
+  json_free_serialized_string(serialized);
+
+  /* a custom serialization function still takes precedence */
+  json_set_number_serialization_function(custom_serialization_func);
+  serialized =
+      json_serialize_to_string(json_array_get_value(json_array(val), 5));
+  TEST(STREQ(serialized, "100.0"));
+  json_free_serialized_string(serialized);
+  json_set_number_serialization_function(nullptr);
+
+  json_set_number_format_mode(JSONNumberFormatPrintf);
+  serialized =
+      json_serialize_to_string(json_array_get_value(json_array(val), 0));
+  TEST(STREQ(serialized, "0.10000000000000001"));
+  json_free_serialized_string(serialized);
+  json_value_free(val);
+}
+
+void test_serializer() {
+  JSON_Value *val = json_parse_file(get_file_path("test_2.txt"));
+  JSON_Serializer *serializer = json_serializer_new();
+  char *expected = nullptr;
+  const char *serialized = nullptr;
+  size_t len = 0;
+
+  expected = json_serialize_to_string(val);
+  serialized = json_serializer_serialize(serializer, val, &len);
+  TEST(STREQ(serialized, expected));
+  TEST(len == strlen(expected));
+  json_free_serialized_string(expected);
+
+  expected = json_serialize_to_string_pretty(val);
+  serialized = json_serializer_serialize_pretty(serializer, val, &len);
+  TEST(STREQ(serialized, expected));
+  TEST(len == strlen(expected));
+  json_free_serialized_string(expected);
+
+  /* buffer is reused for smaller values and grows for larger ones */
+  JSON_Value *small = json_value_init_string("a");
+  serialized = json_serializer_serialize(serializer, small, nullptr);
+  TEST(STREQ(serialized, "\"a\""));
+  JSON_Value *large = json_value_init_array();
+  for (int i = 0; i < 1'024; i++) {
+    json_array_append_value(json_array(large), json_value_deep_copy(val));
+  }
+  expected = json_serialize_to_string(large);
+  serialized = json_serializer_serialize(serializer, large, &len);
+  TEST(STREQ(serialized, expected));
+  TEST(len == strlen(expected));
+  json_free_serialized_string(expected);
+  TEST(json_serializer_serialize(nullptr, val, &len) == nullptr);
+  json_serializer_free(serializer);
+  json_value_free(large);
+  json_value_free(small);
+
+  /* failed growth leaves the serializer usable and leaks nothing */
+  json_set_allocation_functions(failing_malloc, failing_free);
+  g_failing_alloc.allocation_to_fail = 1;
+  g_failing_alloc.alloc_count = 0;
+  g_failing_alloc.total_count = 0;
+  g_failing_alloc.has_failed = false;
+  g_failing_alloc.should_fail = true;
+  serializer = json_serializer_new();
+  TEST(json_serializer_serialize(serializer, val, nullptr) == nullptr);
+  TEST(g_failing_alloc.has_failed);
+  g_failing_alloc.should_fail = false;
+  TEST(json_serializer_serialize(serializer, val, nullptr) != nullptr);
+  json_serializer_free(serializer);
+  TEST(g_failing_alloc.alloc_count == 0);
+  json_set_allocation_functions(counted_malloc, counted_free);
+  json_value_free(val);
+}
+
+typedef struct {
+  char *data;
+  size_t len;
+  size_t capacity;
+  size_t max_chunk;
+  int calls_left;
+} writer_sink;
+
+static JSON_Status sink_write(void *ctx, const char *data, size_t len) {
+  writer_sink *sink = (writer_sink *)ctx;
+  if (sink->calls_left-- == 0 || sink->len + len > sink->capacity) {
+    return JSONFailure;
+  }
+  memcpy(sink->data + sink->len, data, len);
+  sink->len += len;
+  if (len > sink->max_chunk) {
+    sink->max_chunk = len;
+  }
+  return JSONSuccess;
+}
+
+void test_serialize_to_writer() {
+  JSON_Value *val = json_parse_file(get_file_path("test_2.txt"));
+  JSON_Value *large = json_value_init_array();
+  for (int i = 0; i < 256; i++) {
+    json_array_append_value(json_array(large), json_value_deep_copy(val));
+  }
+  char *expected = json_serialize_to_string_pretty(large);
+  writer_sink sink = {.capacity = strlen(expected), .calls_left = -1};
+  sink.data = (char *)malloc(sink.capacity);
+  TEST(json_serialize_to_writer(large, sink_write, &sink,
+                                JSONSerializePretty) == JSONSuccess);
+  TEST(sink.len == strlen(expected));
+  TEST(memcmp(sink.data, expected, sink.len) == 0);
+  TEST(sink.max_chunk <= 64 * 1'024 && sink.len > 64 * 1'024);
+  json_free_serialized_string(expected);
+
+  /* a failing writer stops serialization */
+  sink.len = 0;
+  sink.calls_left = 1;
+  TEST(json_serialize_to_writer(large, sink_write, &sink, 0) == JSONFailure);
+  TEST(json_serialize_to_writer(large, nullptr, &sink, 0) == JSONFailure);
+  free(sink.data);
+
+  /* strings longer than a chunk are passed through */
+  size_t long_len = 100 * 1'024;
+  char *long_str = (char *)malloc(long_len + 1);
+  memset(long_str, 'x', long_len);
+  long_str[long_len] = '\0';
+  json_array_append_string(json_array(large), long_str);
+  expected = json_serialize_to_string(large);
+  sink = (writer_sink){.capacity = strlen(expected), .calls_left = -1};
+  sink.data = (char *)malloc(sink.capacity);
+  TEST(json_serialize_to_writer(large, sink_write, &sink, 0) == JSONSuccess);
+  TEST(sink.len == strlen(expected));
+  TEST(memcmp(sink.data, expected, sink.len) == 0);
+  json_free_serialized_string(expected);
+  free(sink.data);
+  free(long_str);
+
+  json_value_free(large);
+  json_value_free(val);
+}
+
+/* Feeds json in chunks of chunk_len bytes, compares with json_parse_string */
+static bool push_parses_same(JSON_Parser *parser, const char *json,
+                             size_t chunk_len) {
+  JSON_Value *expected = json_parse_string(json);
+  const size_t len = strlen(json);
+  bool fed = true;
+  for (size_t i = 0; i < len && fed; i += chunk_len) {
+    const size_t n = len - i < chunk_len ? len - i : chunk_len;
+    fed = json_parser_feed(parser, json + i, n) == JSONSuccess;
+  }
+  JSON_Value *value = json_parser_finish(parser);
+  const bool same = expected == nullptr
+                        ? value == nullptr
+                        : fed && json_value_equals(expected, value);
+  json_value_free(value);
+  json_value_free(expected);
+  return same;
+}
+
+void test_push_parser() {
+  const char *files[] = {"test_1_1.txt", "test_1_2.txt", "test_1_3.txt",
+                         "test_2.txt", "test_2_pretty.txt"};
+  const char *inputs[] = {
+      "\"lorem \\\"ipsum\\\" \\\\ \\u00e9 \\uD834\\uDD1E\"",
+      "  -12.5e+3  ",
+      "[1, 2.0, -0, 1e-5, true, false, null, \"\", {}, []]",
+      "{\"a\": {\"b\": [{\"c\": \"d\"}, 1E2,]},}",
+      "\xEF\xBB\xBF{\"bom\": true}",
+      "123",
+      "[1, 2] trailing",
+      "[1, 2",
+      "{\"a\" 1}",
+      "[01]",
+      "[1.2.3]",
+      "\"\\u12\"",
+      "\"tab\there\"",
+      "{\"a\": 1, \"a\": 2}",
+      "[nul]",
+      "",
+      /* numbers end where the number grammar does, not at the next
+         delimiter */
+      "5+",
+      "5-",
+      "0-1",
+      "1.5.3",
+      "1e5e",
+      "2E+3-",
+      "[5-3]",
+      "5.",
+      "5e+",
+      "-",
+  };
+  JSON_Parser *parser = json_parser_new();
+  const size_t chunk_lens[] = {1, 2, 3, 7, 64, 4'096};
+  for (size_t c = 0; c < sizeof(chunk_lens) / sizeof(chunk_lens[0]); c++) {
+    bool all_same = true;
+    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+      all_same = push_parses_same(parser, inputs[i], chunk_lens[c]) && all_same;
+    }
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+      char *contents = read_file(get_file_path(files[i]));
+      all_same = push_parses_same(parser, contents, chunk_lens[c]) && all_same;
+      free(contents);
+    }
+    TEST(all_same);
+  }
+
+  /* errors are reported while feeding and the parser is reusable after them */
+  TEST(json_parser_feed(parser, "[1, }", 5) == JSONFailure);
+  TEST(json_parser_feed(parser, "]", 1) == JSONFailure);
+  TEST(json_parser_finish(parser) == nullptr);
+  TEST(json_parser_feed(parser, "[\"abc", 5) == JSONSuccess);
+  TEST(json_parser_finish(parser) == nullptr); /* incomplete */
+  TEST(json_parser_feed(parser, "42", 2) == JSONSuccess);
+  JSON_Value *value = json_parser_finish(parser);
+  TEST(json_value_get_number(value) == 42);
+  json_value_free(value);
+
+  /* deep nesting is limited like in json_parse_string */
+  bool fed = true;
+  for (int i = 0; i < 2'049 && fed; i++) {
+    fed = json_parser_feed(parser, "[", 1) == JSONSuccess;
+  }
+  TEST(fed);
+  TEST(json_parser_feed(parser, "[", 1) == JSONFailure);
+  TEST(json_parser_finish(parser) == nullptr);
+  json_parser_free(parser);
+}
+
+void test_parse_buffer() {
+  const char *json = "\xEF\xBB\xBF{\"a\": [1, -2.5e-3, true, false, null], "
+                     "\"b\": \"esc \\\" \\u00e9 \\uD834\\uDD1E\", \"c\": {}}";
+  const size_t len = strlen(json);
+  bool all_same = true;
+  /* every prefix in an exactly sized buffer, so overreads would be caught by
+     sanitizers */
+  for (size_t n = 0; n <= len; n++) {
+    char *exact = (char *)malloc(n + 1);
+    char *terminated = (char *)malloc(n + 1);
+    memcpy(exact, json, n);
+    memcpy(terminated, json, n);
+    terminated[n] = '\0';
+    JSON_Value *expected = json_parse_string(terminated);
+    JSON_Value *value = json_parse_buffer(exact, n);
+    all_same = all_same && (expected == nullptr
+                                ? value == nullptr
+                                : json_value_equals(expected, value));
+    json_value_free(value);
+    json_value_free(expected);
+    free(terminated);
+    free(exact);
+  }
+  TEST(all_same);
+  JSON_Value *value = json_parse_buffer("[1] [2]", 3);
+  TEST(value != nullptr);
+  json_value_free(value);
+  TEST(json_parse_buffer("[1, 2]", 5) == nullptr);
+  value = json_parse_buffer("[1]\0", 4);
+  TEST(value != nullptr);
+  json_value_free(value);
+  TEST(json_parse_buffer("[\0]", 3) == nullptr);
+  TEST(json_parse_buffer(nullptr, 0) == nullptr);
+
+  /* a file ending exactly at a page boundary has no terminator when mapped */
+  const char *filename = "test_parse_buffer.json";
+  FILE *fp = fopen(get_file_path(filename), "w");
+  fputc('[', fp);
+  for (int i = 1; i < 4'095; i++) {
+    fputc(i % 2 == 1 ? '1' : ',', fp);
+  }
+  fputc(']', fp);
+  fclose(fp);
+  value = json_parse_file(get_file_path(filename));
+  TEST(json_array_get_count(json_array(value)) == 2'047);
+  json_value_free(value);
+  remove(get_file_path(filename));
+}
+
+void test_parse_insitu() {
+  char *json = read_file(get_file_path("test_2.txt"));
+  const size_t len = strlen(json);
+  const int allocations = g_malloc_count;
+  JSON_Value *expected = json_parse_string(json);
+  JSON_Value *value = json_parse_string_insitu(json, len);
+  TEST(json_value_equals(expected, value));
+  json_value_free(expected);
+
+  /* strings and names point into the buffer */
+  JSON_Object *object = json_object(value);
+  const char *string = json_object_get_string(object, "string");
+  const char *name = json_object_get_name(object, 0);
+  TEST(string >= json && string < json + len);
+  TEST(name >= json && name < json + len);
+
+  /* borrowed and owned entries mix freely */
+  TEST(json_object_set_string(object, "new key", "new value") == JSONSuccess);
+  TEST(json_object_set_string(object, "string", "replaced") == JSONSuccess);
+  TEST(json_object_remove(object, name) == JSONSuccess);
+  for (int i = 0; i < 64; i++) { /* forces rehashing */
+    char key[16];
+    snprintf(key, sizeof(key), "key %d", i);
+    TEST(json_object_set_number(object, key, i) == JSONSuccess);
+  }
+  TEST(STREQ(json_object_get_string(object, "new key"), "new value"));
+  TEST(json_object_get_count(json_object_get_object(object, "object")) > 0);
+  json_value_free(value);
+  TEST(g_malloc_count == allocations);
+  free(json);
+
+  /* escapes are decoded in place, the buffer needs no terminator */
+  char escaped[] = "{\"k\\u00e9y\": [\"a\\nb\", \"\\uD834\\uDD1E\", \"\"]}xyz";
+  value = json_parse_string_insitu(escaped, sizeof(escaped) - 4);
+  JSON_Array *array = json_object_get_array(json_object(value), "k\xC3\xA9y");
+  TEST(STREQ(json_array_get_string(array, 0), "a\nb"));
+  TEST(STREQ(json_array_get_string(array, 1), "\xF0\x9D\x84\x9E"));
+  TEST(json_array_get_string_len(array, 2) == 0);
+  json_value_free(value);
+
+  char invalid[] = "{\"a\": \"b\", \"a\": \"c\"}";
+  TEST(json_parse_string_insitu(invalid, strlen(invalid)) == nullptr);
+  TEST(json_parse_string_insitu(nullptr, 0) == nullptr);
+}
+
+void test_object_layout() {
+  JSON_Value *value = json_value_init_object();
+  JSON_Object *object = json_object(value);
+  char key[32];
+  size_t i = 0;
+  bool ok = true;
+
+  /* grow across the linear-scan threshold, then remove back below it */
+  for (i = 0; i < 100; i++) {
+    snprintf(key, sizeof(key), "key%zu", i);
+    ok = ok && json_object_set_number(object, key, (double)i) == JSONSuccess;
+  }
+  TEST(ok);
+  TEST(json_object_get_count(object) == 100);
+  for (i = 0; i < 100; i += 2) {
+    snprintf(key, sizeof(key), "key%zu", i);
+    ok = ok && json_object_remove(object, key) == JSONSuccess;
+  }
+  TEST(ok);
+  TEST(json_object_get_count(object) == 50);
+  for (i = 0; i < 100; i++) {
+    snprintf(key, sizeof(key), "key%zu", i);
+    const JSON_Value *found = json_object_get_value(object, key);
+    ok = ok && (i % 2 == 0 ? found == nullptr
+                           : json_value_get_number(found) == (double)i);
+  }
+  TEST(ok);
+  for (i = 0; i < json_object_get_count(object); i++) {
+    const char *name = json_object_get_name(object, i);
+    ok = ok && json_object_get_value(object, name) ==
+                   json_object_get_value_at(object, i);
+  }
+  TEST(ok);
+
+  TEST(json_object_clear(object) == JSONSuccess);
+  TEST(json_object_get_value(object, "key1") == nullptr);
+  TEST(json_object_set_boolean(object, "key1", true) == JSONSuccess);
+  TEST(json_object_get_boolean(object, "key1") == 1);
+  TEST(json_object_get_count(object) == 1);
+  json_value_free(value);
+
+  /* small objects keep insertion order */
+  value = json_parse_string("{\"c\": 1, \"a\": 2, \"b\": 3}");
+  object = json_object(value);
+  TEST(STREQ(json_object_get_name(object, 0), "c"));
+  TEST(STREQ(json_object_get_name(object, 2), "b"));
+  TEST(json_object_remove(object, "c") == JSONSuccess);
+  TEST(STREQ(json_object_get_name(object, 0), "b"));
+  TEST(json_object_get_number(object, "a") == 2);
+  json_value_free(value);
+}
+
+void test_object_key_lengths() {
+  /* names may contain null characters */
+  const char *json = "{\"a\\u0000b\":1,\"a\":2}";
+  JSON_Value *value = json_parse_string(json);
+  JSON_Object *object = json_object(value);
+  TEST(json_object_get_count(object) == 2);
+  TEST(json_object_get_name_len(object, 0) == 3);
+  TEST(json_object_get_name_len(object, 1) == 1);
+  TEST(json_object_get_name_len(object, 2) == 0);
+  TEST(json_value_get_number(
+           json_object_get_value_with_len(object, "a\0b", 3)) == 1);
+  TEST(json_object_get_number(object, "a") == 2);
+  TEST(json_object_get_value_with_len(object, "a\0c", 3) == nullptr);
+  TEST(json_object_set_value_with_len(object, "a\0c", 3,
+                                      json_value_init_null()) == JSONSuccess);
+  TEST(json_object_get_count(object) == 3);
+  TEST(json_object_remove(object, "a") == JSONSuccess);
+  TEST(json_object_get_value_with_len(object, "a\0b", 3) != nullptr);
+
+  JSON_Value *copy = json_value_deep_copy(value);
+  TEST(json_value_equals(value, copy));
+  char *serialized = json_serialize_to_string(copy);
+  TEST(STREQ(serialized, "{\"a\\u0000b\":1,\"a\\u0000c\":null}"));
+  json_free_serialized_string(serialized);
+  json_value_free(copy);
+  json_value_free(value);
+  TEST(json_parse_string("{\"a\\u0000\":1,\"a\\u0000\":2}") == nullptr);
+
+  /* a seeded hash keeps lookups working across growth */
+  json_set_hash_seed(0x5eed'1234'abcd'0001);
+  value = json_value_init_object();
+  object = json_object(value);
+  char key[32];
+  bool ok = true;
+  for (size_t i = 0; i < 200; i++) {
+    snprintf(key, sizeof(key), "metric_%04zu", i);
+    ok = ok && json_object_set_number(object, key, (double)i) == JSONSuccess;
+  }
+  for (size_t i = 0; i < 200; i++) {
+    snprintf(key, sizeof(key), "metric_%04zu", i);
+    ok = ok && json_object_get_number(object, key) == (double)i;
+  }
+  TEST(ok);
+  json_value_free(value);
+  json_set_hash_seed(0);
+}
+
+void test_paths() {
+  JSON_Value *root = json_parse_string(
+      "{\"a\": {\"b\": {\"c\": 1}}, \"list\": [10, {\"x\": true}],"
+      " \"a/b\": 2, \"m~n\": 3, \"\": 4, \"0\": 5}");
+  JSON_Object *object = json_object(root);
+
+  JSON_Path *dotted = json_path_compile("a.b.c");
+  TEST(json_path_get(root, dotted) ==
+       json_object_dotget_value(object, "a.b.c"));
+  TEST(json_path_set(root, dotted, json_value_init_number(7)) == JSONSuccess);
+  TEST(json_object_dotget_number(object, "a.b.c") == 7);
+  TEST(json_path_remove(root, dotted) == JSONSuccess);
+  TEST(json_path_get(root, dotted) == nullptr);
+  TEST(json_path_remove(root, dotted) == JSONFailure);
+  json_path_free(dotted);
+
+  /* missing members are created on the way */
+  JSON_Path *deep = json_path_compile("new.inner.leaf");
+  TEST(json_path_set(root, deep, json_value_init_string("v")) == JSONSuccess);
+  TEST(STREQ(json_object_dotget_string(object, "new.inner.leaf"), "v"));
+  json_path_free(deep);
+
+  JSON_Path *pointer = json_path_compile_pointer("/list/1/x");
+  TEST(json_value_get_boolean(json_path_get(root, pointer)) == 1);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("/list/0");
+  TEST(json_value_get_number(json_path_get(root, pointer)) == 10);
+  TEST(json_path_set(root, pointer, json_value_init_number(11)) ==
+       JSONSuccess);
+  TEST(json_array_get_number(json_object_get_array(object, "list"), 0) == 11);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("/list/-");
+  TEST(json_path_get(root, pointer) == nullptr);
+  TEST(json_path_set(root, pointer, json_value_init_null()) == JSONSuccess);
+  TEST(json_array_get_count(json_object_get_array(object, "list")) == 3);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("/list/5");
+  JSON_Value *orphan = json_value_init_null();
+  TEST(json_path_set(root, pointer, orphan) == JSONFailure);
+  json_value_free(orphan);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("/list/0");
+  TEST(json_path_remove(root, pointer) == JSONSuccess);
+  TEST(json_array_get_count(json_object_get_array(object, "list")) == 2);
+  json_path_free(pointer);
+
+  /* escapes, empty names and numeric names in objects */
+  pointer = json_path_compile_pointer("/a~1b");
+  TEST(json_value_get_number(json_path_get(root, pointer)) == 2);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("/m~0n");
+  TEST(json_value_get_number(json_path_get(root, pointer)) == 3);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("/");
+  TEST(json_value_get_number(json_path_get(root, pointer)) == 4);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("/0");
+  TEST(json_value_get_number(json_path_get(root, pointer)) == 5);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("");
+  TEST(json_path_get(root, pointer) == root);
+  TEST(json_path_remove(root, pointer) == JSONFailure);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("/list/01");
+  TEST(json_path_get(root, pointer) == nullptr);
+  json_path_free(pointer);
+
+  TEST(json_path_compile_pointer("a/b") == nullptr);
+  TEST(json_path_compile_pointer("/a~2") == nullptr);
+  TEST(json_path_compile_pointer("/a~") == nullptr);
+  TEST(json_path_compile(nullptr) == nullptr);
+  TEST(json_path_get(root, nullptr) == nullptr);
+  json_value_free(root);
+}
+
+void test_key_table() {
+  const char *record =
+      "{\"id\": 1, \"name\": \"x\", \"t\\u0061g\": [{\"id\": 2}]}";
+  JSON_Key_Table *keys = json_key_table_new();
+  JSON_Value *first = json_parse_string_with_key_table(record, keys);
+  JSON_Value *second = json_parse_string_with_key_table(record, keys);
+  TEST(first != nullptr && second != nullptr);
+  TEST(json_key_table_get_count(keys) == 3);
+  /* both documents share one copy of each name */
+  TEST(json_object_get_name(json_object(first), 0) ==
+       json_object_get_name(json_object(second), 0));
+  TEST(STREQ(json_object_get_name(json_object(first), 2), "tag"));
+  TEST(json_value_equals(first, second));
+  JSON_Value *plain = json_parse_string(record);
+  TEST(json_value_equals(first, plain));
+  json_value_free(plain);
+  TEST(json_object_dotget_number(json_object(first), "id") == 1);
+
+  /* interned and copied names can be mixed, removed and replaced */
+  JSON_Object *object = json_object(first);
+  TEST(json_object_set_number(object, "extra", 3) == JSONSuccess);
+  TEST(json_object_remove(object, "name") == JSONSuccess);
+  TEST(json_object_set_string(object, "id", "replaced") == JSONSuccess);
+  TEST(STREQ(json_object_get_string(object, "id"), "replaced"));
+  JSON_Value *copy = json_value_deep_copy(first);
+  TEST(json_value_equals(copy, first));
+  json_value_free(copy);
+  json_value_free(first);
+  TEST(json_object_get_count(json_object(second)) == 3);
+  json_value_free(second);
+
+  TEST(json_parse_string_with_key_table("{\"a\": 1, \"a\": 2}", keys) ==
+       nullptr);
+  TEST(json_parse_string_with_key_table("{\"a\": 1, \"b\"", keys) == nullptr);
+  TEST(json_parse_string_with_key_table(nullptr, keys) == nullptr);
+  json_key_table_free(keys);
+  json_key_table_free(nullptr);
+}
+
+/* Allocator for test_context that checks the sizes passed back to it */
+typedef struct {
+  size_t live_blocks;
+  size_t live_bytes;
+  size_t reallocs;
+  bool size_mismatch;
+} tracking_pool;
+
+static void *pool_malloc(void *ctx, size_t size) {
+  tracking_pool *pool = (tracking_pool *)ctx;
+  size_t *block = (size_t *)malloc(sizeof(max_align_t) + size);
+  if (block == nullptr) {
+    return nullptr;
+  }
+  *block = size;
+  pool->live_blocks++;
+  pool->live_bytes += size;
+  return (char *)block + sizeof(max_align_t);
+}
+
+static void pool_free(void *ctx, void *ptr, size_t size) {
+  tracking_pool *pool = (tracking_pool *)ctx;
+  size_t *block = (size_t *)((char *)ptr - sizeof(max_align_t));
+  if (*block != size) {
+    pool->size_mismatch = true;
+  }
+  pool->live_blocks--;
+  pool->live_bytes -= *block;
+  free(block);
+}
+
+static void *pool_realloc(void *ctx, void *ptr, size_t old_size,
+                          size_t new_size) {
+  tracking_pool *pool = (tracking_pool *)ctx;
+  void *result = pool_malloc(ctx, new_size);
+  if (result != nullptr) {
+    memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    pool_free(ctx, ptr, old_size);
+    pool->reallocs++;
+  }
+  return result;
+}
+
+static int serialize_number_as_x(double num, char *buf) {
+  (void)num;
+  if (buf != nullptr) {
+    buf[0] = 'x';
+  }
+  return 1;
+}
+
+void test_context() {
+  tracking_pool pool = {0};
+  const JSON_Allocator allocator = {
+      .ctx = &pool,
+      .malloc_fun = pool_malloc,
+      .realloc_fun = pool_realloc,
+      .free_fun = pool_free,
+  };
+  JSON_Context *context = json_context_new(&allocator);
+  TEST(context != nullptr && pool.live_blocks == 1);
+
+  /* documents in a context arena, deep enough to need heap parse frames */
+  char deep[256] = {0};
+  memset(deep, '[', 100);
+  memset(deep + 100, ']', 100);
+  JSON_Arena *arena = json_arena_new_ex(context);
+  JSON_Value *value = json_parse_string_ex(
+      "{\"path\": \"a/b\", \"pi\": 3.25}", arena, JSONParseStructuralIndex,
+      context);
+  TEST(value != nullptr && pool.live_blocks > 2);
+  TEST(json_parse_string_ex(deep, arena, JSONParseDefault, context) != nullptr);
+  TEST(json_parse_buffer_ex(deep, 99, arena, JSONParseDefault, context) ==
+       nullptr);
+
+  /* settings of a context don't leak into the default one */
+  json_context_set_escape_slashes(context, false);
+  TEST(json_context_set_float_serialization_format(context, "%.1f") ==
+       JSONSuccess);
+  const char *expected = "{\"path\":\"a/b\",\"pi\":3.2}";
+  char *string = json_serialize_to_string_ex(value, 0, context);
+  TEST(STREQ(string, expected));
+  TEST(json_serialization_size_ex(value, 0, context) == strlen(expected) + 1);
+  json_free_serialized_string_ex(string, context);
+  string = json_serialize_to_string(value);
+  TEST(STREQ(string, "{\"path\":\"a\\/b\",\"pi\":3.25}"));
+  json_free_serialized_string(string);
+  string = json_serialize_to_string_ex(value, 0, nullptr);
+  TEST(STREQ(string, "{\"path\":\"a\\/b\",\"pi\":3.25}"));
+  json_free_serialized_string_ex(string, nullptr);
+  char buf[64];
+  TEST(json_serialize_to_buffer_ex(value, buf, sizeof(buf), JSONSerializePretty,
+                                   context) == JSONSuccess);
+  TEST(strcmp(buf, "{\n    \"path\": \"a/b\",\n    \"pi\": 3.2\n}") == 0);
+  json_context_set_number_serialization_function(context,
+                                                 serialize_number_as_x);
+  TEST(json_serialize_to_buffer_ex(value, buf, sizeof(buf), 0, context) ==
+       JSONSuccess);
+  TEST(strcmp(buf, "{\"path\":\"a/b\",\"pi\":x}") == 0);
+  json_context_set_number_serialization_function(context, nullptr);
+  json_context_set_number_format_mode(context, JSONNumberFormatShortest);
+  TEST(json_serialize_to_buffer_ex(value, buf, sizeof(buf), 0, context) ==
+       JSONSuccess);
+  TEST(strcmp(buf, "{\"path\":\"a/b\",\"pi\":3.25}") == 0);
+
+  /* serializer and writer buffers come from the context */
+  JSON_Value *large = json_value_init_array();
+  for (int i = 0; i < 1'000; i++) {
+    json_array_append_string(json_array(large), "some/longer/string");
+  }
+  JSON_Serializer *serializer = json_serializer_new_ex(context);
+  size_t len = 0;
+  const char *serialized = json_serializer_serialize(serializer, large, &len);
+  TEST(serialized != nullptr && len == 1'000 * 21 + 1);
+  TEST(pool.reallocs > 0);
+  writer_sink sink = {.capacity = len, .calls_left = -1};
+  sink.data = (char *)malloc(sink.capacity);
+  TEST(json_serialize_to_writer_ex(large, sink_write, &sink, 0, context) ==
+       JSONSuccess);
+  TEST(sink.len == len && memcmp(sink.data, serialized, len) == 0);
+  free(sink.data);
+  json_serializer_free(serializer);
+  json_value_free(large);
+
+  json_arena_free(arena);
+  TEST(pool.live_blocks == 2); /* the context and its float format */
+  json_context_free(context);
+  TEST(pool.live_blocks == 0 && pool.live_bytes == 0);
+
+  /* without realloc, growing buffers are moved with malloc and free */
+  const JSON_Allocator no_realloc = {
+      .ctx = &pool, .malloc_fun = pool_malloc, .free_fun = pool_free};
+  context = json_context_new(&no_realloc);
+  arena = json_arena_new_ex(context);
+  bool appended = true;
+  for (int i = 0; i < 100; i++) {
+    JSON_Value *heap = json_value_init_string("adopted");
+    JSON_Value *root = json_parse_string_ex("[]", arena, 0, context);
+    appended &= json_array_append_value(json_array(root), heap) == JSONSuccess;
+  }
+  TEST(appended);
+  json_arena_free(arena);
+  json_context_free(context);
+  TEST(pool.live_blocks == 0 && !pool.size_mismatch);
+
+  const JSON_Allocator incomplete = {.malloc_fun = pool_malloc};
+  TEST(json_context_new(&incomplete) == nullptr);
+  context = json_context_new(nullptr);
+  TEST(json_context_set_float_serialization_format(context, "%.3f") ==
+       JSONSuccess);
+  TEST(json_context_set_float_serialization_format(context, nullptr) ==
+       JSONSuccess);
+  TEST(json_context_set_float_serialization_format(nullptr, "%f") ==
+       JSONFailure);
+  json_context_free(context);
+  json_context_free(nullptr);
+}
+
+/* Records the events seen by test_parse_events as text */
+typedef struct {
+  char text[256];
+  size_t len;
+  const char *skip_key; /* on_key skips the value of this name */
+  bool skip_arrays;
+  int events_until_stop; /* -1 for never */
+  const char *input;
+  size_t input_len;
+  bool borrowed; /* the last string pointed into the input */
+} event_log;
+
+static JSON_Event_Result log_event(void *ctx, const char *text, size_t len) {
+  event_log *log = (event_log *)ctx;
+  if (log->len + len + 1 < sizeof(log->text)) {
+    memcpy(log->text + log->len, text, len);
+    log->len += len;
+    log->text[log->len++] = ' ';
+    log->text[log->len] = '\0';
+  }
+  return log->events_until_stop-- == 0 ? JSONEventStop : JSONEventContinue;
+}
+
+static JSON_Event_Result log_object_begin(void *ctx) {
+  return log_event(ctx, "{", 1);
+}
+
+static JSON_Event_Result log_object_end(void *ctx) {
+  return log_event(ctx, "}", 1);
+}
+
+static JSON_Event_Result log_array_begin(void *ctx) {
+  event_log *log = (event_log *)ctx;
+  const JSON_Event_Result result = log_event(ctx, "[", 1);
+  return log->skip_arrays ? JSONEventSkip : result;
+}
+
+static JSON_Event_Result log_array_end(void *ctx) {
+  return log_event(ctx, "]", 1);
+}
+
+static JSON_Event_Result log_key(void *ctx, const char *name, size_t len) {
+  event_log *log = (event_log *)ctx;
+  const JSON_Event_Result result = log_event(ctx, name, len);
+  if (log->skip_key != nullptr && strlen(log->skip_key) == len &&
+      memcmp(log->skip_key, name, len) == 0) {
+    return JSONEventSkip;
+  }
+  return result;
+}
+
+static JSON_Event_Result log_string(void *ctx, const char *string,
+                                    size_t len) {
+  event_log *log = (event_log *)ctx;
+  log->borrowed =
+      string > log->input && string < log->input + log->input_len;
+  return log_event(ctx, string, len);
+}
+
+static JSON_Event_Result log_number(void *ctx, double number, const char *raw,
+                                    size_t raw_len) {
+  char text[64];
+  snprintf(text, sizeof(text), "%.*s=%g", (int)raw_len, raw, number);
+  return log_event(ctx, text, strlen(text));
+}
+
+static JSON_Event_Result log_boolean(void *ctx, bool boolean) {
+  return boolean ? log_event(ctx, "true", 4) : log_event(ctx, "false", 5);
+}
+
+static JSON_Event_Result log_null(void *ctx) {
+  return log_event(ctx, "null", 4);
+}
+
+static JSON_Status parse_logged(event_log *log, const char *input) {
+  static const JSON_Handler handler = {
+      .on_object_begin = log_object_begin,
+      .on_object_end = log_object_end,
+      .on_array_begin = log_array_begin,
+      .on_array_end = log_array_end,
+      .on_key = log_key,
+      .on_string = log_string,
+      .on_number = log_number,
+      .on_boolean = log_boolean,
+      .on_null = log_null,
+  };
+  log->len = 0;
+  log->text[0] = '\0';
+  log->input = input;
+  log->input_len = strlen(input);
+  return json_parse_events(input, log->input_len, &handler, log);
+}
+
+static bool logs_events(event_log *log, const char *input,
+                        const char *expected) {
+  return parse_logged(log, input) == JSONSuccess &&
+         strcmp(log->text, expected) == 0;
+}
+
+void test_parse_events() {
+  const char *doc = "{\"id\": 1e2, \"tags\": [\"a\", true, null], \"big\": "
+                    "{\"x\": [1, \"]\"], \"y\": {}}, \"n\": -0.5}";
+  event_log log = {.events_until_stop = -1};
+  TEST(logs_events(&log, doc,
+                   "{ id 1e2=100 tags [ a true null ] big { x [ 1=1 ] ] y { "
+                   "} } n -0.5=-0.5 } "));
+  TEST(log.borrowed);
+
+  /* skipped values report no events */
+  log.skip_key = "big";
+  TEST(logs_events(&log, doc,
+                   "{ id 1e2=100 tags [ a true null ] big n -0.5=-0.5 } "));
+  log.skip_key = nullptr;
+  log.skip_arrays = true;
+  TEST(logs_events(&log, doc,
+                   "{ id 1e2=100 tags [ big { x [ y { } } n -0.5=-0.5 } "));
+  log.skip_arrays = false;
+  log.skip_key = "id";
+  TEST(logs_events(&log, "{\"id\": \"\\\\\", \"v\": 2}", "{ id v 2=2 } "));
+  log.skip_key = nullptr;
+
+  /* stopping early succeeds without reading the rest */
+  log.events_until_stop = 2;
+  TEST(logs_events(&log, "{\"id\": 7, \"rest\": [[[[", "{ id 7=7 "));
+  log.events_until_stop = -1;
+
+  /* escaped strings are unescaped into a scratch buffer */
+  TEST(logs_events(&log, "[\"a\\u0062\\n\"]", "[ ab\n ] "));
+  TEST(!log.borrowed);
+  TEST(logs_events(&log, "\xEF\xBB\xBF \"top\" trailing", "top "));
+
+  const char *invalid[] = {"",         "{",         "{\"a\" 1}", "[1 2]",
+                           "[}",       "{\"a\": 1]", "\"open",     "[\"\\x\"]",
+                           "[tru]",    "[-]",       "{1: 2}",    "]",
+                           "{\"a\":: 1}", "[\"\x01\"]", "[1,,2]"};
+  for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+    TEST(parse_logged(&log, invalid[i]) == JSONFailure);
+  }
+  log.skip_key = "a";
+  TEST(parse_logged(&log, "{\"a\": [1, {\"b\": 2}") == JSONFailure);
+  TEST(parse_logged(&log, "{\"a\": \"open}") == JSONFailure);
+  log.skip_key = nullptr;
+
+  /* callbacks are optional and nesting is limited as in json_parse_string */
+  const JSON_Handler none = {0};
+  TEST(json_parse_events(doc, strlen(doc), &none, nullptr) == JSONSuccess);
+  TEST(json_parse_events(doc, strlen(doc) - 1, &none, nullptr) ==
+       JSONFailure);
+  TEST(json_parse_events(nullptr, 0, &none, nullptr) == JSONFailure);
+  TEST(json_parse_events(doc, strlen(doc), nullptr, nullptr) == JSONFailure);
+  char *deep = read_file(get_file_path("test_1_2.txt"));
+  TEST(deep != nullptr &&
+       json_parse_events(deep, strlen(deep), &none, nullptr) == JSONFailure);
+  free(deep);
+}
+
+void test_parse_lazy() {
+  const char *doc = "{\"header\": {\"id\": 7, \"kind\": \"x\"}, \"payload\": "
+                    "[1,  {\"deep\" : [true, null]}, \"s\\/\"], \"n\": 1.50}";
+  JSON_Value *eager = json_parse_string(doc);
+  JSON_Value *lazy =
+      json_parse_string_with_options(doc, nullptr, JSONParseLazy);
+  TEST(lazy != nullptr);
+  JSON_Object *root = json_object(lazy);
+  TEST(json_value_get_type(json_object_get_value(root, "payload")) ==
+       JSONArray);
+  /* untouched containers are written as they appear in the input */
+  char *serialized = json_serialize_to_string(lazy);
+  TEST(STREQ(serialized,
+             "{\"header\":{\"id\": 7, \"kind\": \"x\"},\"payload\":"
+             "[1,  {\"deep\" : [true, null]}, \"s\\/\"],\"n\":1.5}"));
+  json_free_serialized_string(serialized);
+  TEST(json_object_dotget_number(root, "header.id") == 7);
+  TEST(json_value_equals(lazy, eager));
+  serialized = json_serialize_to_string_pretty(lazy);
+  char *expected = json_serialize_to_string_pretty(eager);
+  TEST(STREQ(serialized, expected));
+  json_free_serialized_string(serialized);
+  json_free_serialized_string(expected);
+  JSON_Array *payload = json_object_get_array(root, "payload");
+  TEST(json_array_get_count(payload) == 3);
+  TEST(json_value_get_parent(json_array_get_value(payload, 1)) ==
+       json_object_get_value(root, "payload"));
+  /* json_value_equals has parsed everything, changes are serialized anew */
+  json_array_append_number(payload, 2);
+  serialized = json_serialize_to_string(lazy);
+  TEST(STREQ(serialized, "{\"header\":{\"id\":7,\"kind\":\"x\"},\"payload\":"
+                         "[1,{\"deep\":[true,null]},\"s\\/\",2],\"n\":1.5}"));
+  json_free_serialized_string(serialized);
+  JSON_Value *copy = json_value_deep_copy(lazy);
+  json_value_free(lazy);
+  TEST(json_object_dotget_number(json_object(copy), "header.id") == 7);
+  TEST(json_array_get_count(json_object_get_array(json_object(copy),
+                                                  "payload")) == 4);
+  json_value_free(copy);
+
+  /* the input is copied, so it may go away after parsing */
+  const size_t doc_len = strlen(doc);
+  char *mutable_doc = (char *)malloc(doc_len + 1);
+  memcpy(mutable_doc, doc, doc_len + 1);
+  lazy = json_parse_string_with_options(mutable_doc, nullptr, JSONParseLazy);
+  memset(mutable_doc, ' ', strlen(mutable_doc));
+  free(mutable_doc);
+  TEST(json_value_equals(lazy, eager));
+  json_value_free(lazy);
+
+  JSON_Arena *arena = json_arena_new();
+  lazy = json_parse_string_with_options(doc, arena, JSONParseLazy);
+  TEST(json_value_equals(lazy, eager));
+  json_arena_free(arena);
+  json_value_free(eager);
+
+  /* errors inside a lazy container show up when it is first accessed */
+  lazy = json_parse_string_with_options("{\"a\": [1 2], \"b\": {}}", nullptr,
+                                        JSONParseLazy);
+  TEST(lazy != nullptr);
+  TEST(json_object_get_array(json_object(lazy), "a") == nullptr);
+  TEST(json_array_get_count(json_object_get_array(json_object(lazy), "a")) ==
+       0);
+  TEST(json_object_get_object(json_object(lazy), "b") != nullptr);
+  json_value_free(lazy);
+  /* and make everything fail that would otherwise see an empty container */
+  const char *broken = "{\"a\":{\"b\" 1,\"c\":[1 2]},\"z\":3}";
+  lazy = json_parse_string_with_options(broken, nullptr, JSONParseLazy);
+  TEST(lazy != nullptr);
+  TEST(json_serialization_size_pretty(lazy) == 0);
+  TEST(json_serialize_to_string_pretty(lazy) == nullptr);
+  serialized = json_serialize_to_string(lazy);
+  TEST(STREQ(serialized, broken));
+  json_free_serialized_string(serialized);
+  JSON_Value *empty = json_parse_string("{\"a\":{},\"z\":3}");
+  TEST(!json_value_equals(lazy, empty));
+  TEST(!json_value_equals(empty, lazy));
+  TEST(json_value_hash(lazy) == 0);
+  json_value_free(empty);
+  json_value_free(lazy);
+  TEST(json_parse_string_with_options("{\"a\": [1, \"]}", nullptr,
+                                      JSONParseLazy) == nullptr);
+  TEST(json_parse_string_with_options("[[1]}", nullptr, JSONParseLazy) ==
+       nullptr);
+  lazy = json_parse_string_with_options(
+      "[1, 2]", nullptr, JSONParseLazy | JSONParseStructuralIndex);
+  TEST(json_array_get_number(json_array(lazy), 1) == 2);
+  json_value_free(lazy);
+}
+
+/* Read function for test_stream that delivers at most chunk bytes a call */
+typedef struct {
+  const char *data;
+  size_t len;
+  size_t chunk;
+  bool fail;
+} chunk_reader;
+
+static JSON_Status read_chunks(void *ctx, char *buf, size_t size,
+                               size_t *read) {
+  chunk_reader *reader = (chunk_reader *)ctx;
+  if (reader->fail) {
+    return JSONFailure;
+  }
+  size_t n = reader->len < reader->chunk ? reader->len : reader->chunk;
+  n = n < size ? n : size;
+  memcpy(buf, reader->data, n);
+  reader->data += n;
+  reader->len -= n;
+  *read = n;
+  return JSONSuccess;
+}
+
+/* Checks the records of tests/test_6.txt */
+static void test_stream_records(JSON_Stream *stream) {
+  JSON_Value *value = json_stream_next(stream);
+  TEST(json_object_get_number(json_object(value), "id") == 1);
+  TEST(json_stream_record_offset(stream) == 0);
+  TEST(json_stream_record_line(stream) == 1);
+  json_value_free(value);
+  value = json_stream_next(stream);
+  TEST(json_array_get_count(json_array(value)) == 3);
+  TEST(json_stream_record_offset(stream) == 26);
+  TEST(json_stream_record_line(stream) == 2);
+  json_value_free(value);
+  TEST(json_stream_next(stream) == nullptr);
+  TEST(!json_stream_at_end(stream));
+  TEST(json_stream_record_line(stream) == 4);
+  TEST(json_stream_record_offset(stream) == 37);
+  value = json_stream_next(stream);
+  TEST(STREQ(json_string(value), "last"));
+  TEST(json_stream_record_line(stream) == 5);
+  json_value_free(value);
+  TEST(json_stream_next(stream) == nullptr);
+  TEST(json_stream_at_end(stream));
+}
+
+void test_stream() {
+  char *contents = read_file(get_file_path("test_6.txt"));
+  const size_t len = strlen(contents);
+  JSON_Stream *stream = json_stream_open_buffer(contents, len);
+  test_stream_records(stream);
+  json_stream_close(stream);
+  stream = json_stream_open_file(get_file_path("test_6.txt"));
+  test_stream_records(stream);
+  json_stream_close(stream);
+  chunk_reader reader = {.data = contents, .len = len, .chunk = 3};
+  stream = json_stream_open_reader(read_chunks, &reader);
+  test_stream_records(stream);
+  json_stream_close(stream);
+
+  /* records from an arena are released by the next call */
+  JSON_Arena *arena = json_arena_new();
+  stream = json_stream_open_buffer("1\r\n  2  \n3", 10);
+  json_stream_set_arena(stream, arena);
+  double sum = 0;
+  JSON_Value *value = nullptr;
+  while ((value = json_stream_next(stream)) != nullptr) {
+    sum += json_number(value);
+  }
+  TEST(sum == 6 && json_stream_at_end(stream));
+  TEST(json_stream_record_line(stream) == 3);
+  json_stream_close(stream);
+  json_arena_free(arena);
+
+  /* the writer's output reads back record by record, however it is chunked */
+  writer_sink sink = {.capacity = 1'024 * 1'024, .calls_left = -1};
+  sink.data = (char *)malloc(sink.capacity);
+  JSON_Stream_Writer *writer = json_stream_writer_new(sink_write, &sink);
+  JSON_Value *record = json_parse_string("{\"name\": \"x\", \"n\": [1, 2]}");
+  bool written = true;
+  for (int i = 0; i < 10'000; i++) {
+    json_object_set_number(json_object(record), "i", i);
+    written &= json_stream_write(writer, record) == JSONSuccess;
+  }
+  TEST(written && sink.len > 0 && sink.max_chunk <= 64 * 1'024);
+  TEST(json_stream_writer_close(writer) == JSONSuccess);
+  const char *expected_line = "{\"name\":\"x\",\"n\":[1,2],\"i\":9999}\n";
+  TEST(sink.len > strlen(expected_line) &&
+       memcmp(sink.data + sink.len - strlen(expected_line), expected_line,
+              strlen(expected_line)) == 0);
+  reader = (chunk_reader){.data = sink.data, .len = sink.len, .chunk = 4'096};
+  stream = json_stream_open_reader(read_chunks, &reader);
+  int records = 0;
+  bool in_order = true;
+  while ((value = json_stream_next(stream)) != nullptr) {
+    in_order &= json_object_get_number(json_object(value), "i") == records;
+    records++;
+    json_value_free(value);
+  }
+  TEST(records == 10'000 && in_order && json_stream_at_end(stream));
+  json_stream_close(stream);
+
+  /* lines longer than the stream's buffer */
+  JSON_Value *long_value = json_value_init_array();
+  for (int i = 0; i < 50'000; i++) {
+    json_array_append_number(json_array(long_value), i);
+  }
+  sink.len = 0;
+  writer = json_stream_writer_new(sink_write, &sink);
+  TEST(json_stream_write(writer, long_value) == JSONSuccess);
+  TEST(json_stream_write(writer, record) == JSONSuccess);
+  TEST(json_stream_writer_close(writer) == JSONSuccess);
+  reader = (chunk_reader){.data = sink.data, .len = sink.len, .chunk = 1'000};
+  stream = json_stream_open_reader(read_chunks, &reader);
+  value = json_stream_next(stream);
+  TEST(json_value_equals(value, long_value));
+  json_value_free(value);
+  value = json_stream_next(stream);
+  TEST(json_value_equals(value, record));
+  json_value_free(value);
+  json_stream_close(stream);
+
+  /* failures are sticky */
+  sink.len = 0;
+  sink.calls_left = 0;
+  writer = json_stream_writer_new(sink_write, &sink);
+  TEST(json_stream_write(writer, long_value) == JSONFailure);
+  TEST(json_stream_write(writer, record) == JSONFailure);
+  TEST(json_stream_writer_close(writer) == JSONFailure);
+  free(sink.data);
+  reader = (chunk_reader){.fail = true};
+  stream = json_stream_open_reader(read_chunks, &reader);
+  TEST(json_stream_next(stream) == nullptr && json_stream_at_end(stream));
+  json_stream_close(stream);
+  json_value_free(long_value);
+  json_value_free(record);
+
+  TEST(json_stream_open_file("missing.ndjson") == nullptr);
+  TEST(json_stream_open_buffer(nullptr, 0) == nullptr);
+  TEST(json_stream_open_reader(nullptr, nullptr) == nullptr);
+  TEST(json_stream_writer_new(nullptr, nullptr) == nullptr);
+  TEST(json_stream_next(nullptr) == nullptr && json_stream_at_end(nullptr));
+  json_stream_close(nullptr);
+  free(contents);
+}
+
+/* Offsets reported to parallel_record, one slot per record id so that the
+   parsing threads never write to the same memory */
+typedef struct {
+  size_t *offsets;
+  size_t count;
+  double fail_id;
+} parallel_records;
+
+static JSON_Status parallel_record(void *ctx, size_t offset,
+                                   JSON_Value *record) {
+  parallel_records *records = (parallel_records *)ctx;
+  const double id = json_object_get_number(json_object(record), "id");
+  if (id == records->fail_id || id < 0 || id >= (double)records->count) {
+    return JSONFailure;
+  }
+  records->offsets[(size_t)id] = offset + 1;
+  return JSONSuccess;
+}
+
+static size_t parallel_count(const char *input, JSON_Records_Format format) {
+  JSON_Value *value =
+      json_parse_records_parallel(input, strlen(input), format, 4, nullptr);
+  const size_t count =
+      value != nullptr ? json_array_get_count(json_array(value)) : SIZE_MAX;
+  json_value_free(value);
+  return count;
+}
+
+void test_parse_parallel() {
+  /* the counting allocator isn't thread safe */
+  json_set_allocation_functions(malloc, free);
+  constexpr size_t record_count = 20'000;
+  JSON_Value *expected = json_value_init_array();
+  writer_sink sink = {.capacity = 4 * 1'024 * 1'024, .calls_left = -1};
+  sink.data = (char *)malloc(sink.capacity);
+  JSON_Stream_Writer *writer = json_stream_writer_new(sink_write, &sink);
+  for (size_t i = 0; i < record_count; i++) {
+    JSON_Value *record = json_value_init_object();
+    json_object_set_number(json_object(record), "id", (double)i);
+    json_object_set_string(json_object(record), "name", "a, b]\n\"c\"");
+    json_object_dotset_boolean(json_object(record), "flags.on", i % 2 == 0);
+    (void)json_stream_write(writer, record);
+    json_array_append_value(json_array(expected), record);
+  }
+  TEST(json_stream_writer_close(writer) == JSONSuccess);
+  char *array_text = json_serialize_to_string_pretty(expected);
+  const size_t array_len = strlen(array_text);
+
+  JSON_Value *value = json_parse_records_parallel(sink.data, sink.len,
+                                                  JSONRecordsLines, 4, nullptr);
+  TEST(json_value_equals(value, expected));
+  json_value_free(value);
+  value = json_parse_records_parallel(array_text, array_len, JSONRecordsArray,
+                                      7, nullptr);
+  TEST(json_value_equals(value, expected));
+  json_value_free(value);
+
+  /* records parsed into worker arenas live as long as the caller's arena */
+  JSON_Arena *arena = json_arena_new();
+  value = json_parse_records_parallel(array_text, array_len, JSONRecordsArray,
+                                      0, arena);
+  TEST(json_value_equals(value, expected));
+  JSON_Object *last =
+      json_array_get_object(json_array(value), record_count - 1);
+  TEST(json_object_set_string(last, "name", "changed") == JSONSuccess);
+  TEST(json_object_dotset_number(last, "flags.count", 2) == JSONSuccess);
+  TEST(STREQ(json_object_get_string(last, "name"), "changed"));
+  json_arena_reset(arena);
+  value = json_parse_records_parallel(sink.data, sink.len, JSONRecordsLines, 3,
+                                      arena);
+  TEST(json_value_equals(value, expected));
+  json_arena_free(arena);
+
+  /* every record is passed once, with its offset */
+  parallel_records records = {
+      .offsets = (size_t *)calloc(record_count, sizeof(size_t)),
+      .count = record_count,
+      .fail_id = -1};
+  TEST(json_parse_records_parallel_each(sink.data, sink.len, JSONRecordsLines,
+                                        4, parallel_record,
+                                        &records) == JSONSuccess);
+  bool offsets_match = true;
+  const char *line = sink.data;
+  for (size_t i = 0; i < record_count; i++) {
+    offsets_match &= records.offsets[i] == (size_t)(line - sink.data) + 1;
+    line = strchr(line, '\n') + 1;
+  }
+  TEST(offsets_match);
+  memset(records.offsets, 0, record_count * sizeof(size_t));
+  TEST(json_parse_records_parallel_each(array_text, array_len,
+                                        JSONRecordsArray, 4, parallel_record,
+                                        &records) == JSONSuccess);
+  bool all_passed = true;
+  for (size_t i = 0; i < record_count; i++) {
+    all_passed &= records.offsets[i] != 0 &&
+                  array_text[records.offsets[i] - 1] == '{';
+  }
+  TEST(all_passed);
+  records.fail_id = 12'345;
+  TEST(json_parse_records_parallel_each(sink.data, sink.len, JSONRecordsLines,
+                                        4, parallel_record,
+                                        &records) == JSONFailure);
+  TEST(json_parse_records_parallel_each(sink.data, sink.len, JSONRecordsLines,
+                                        4, nullptr, nullptr) == JSONFailure);
+  free(records.offsets);
+
+  /* one malformed record fails the whole parse */
+  char *broken = strstr(sink.data + sink.len / 2, "\"id\"");
+  broken[1] = '\n';
+  TEST(json_parse_records_parallel(sink.data, sink.len, JSONRecordsLines, 4,
+                                   nullptr) == nullptr);
+  broken = strstr(array_text + array_len / 2, "true");
+  broken[0] = 'T';
+  TEST(json_parse_records_parallel(array_text, array_len, JSONRecordsArray, 4,
+                                   nullptr) == nullptr);
+  json_free_serialized_string(array_text);
+  free(sink.data);
+  json_value_free(expected);
+
+  TEST(parallel_count("\n1\r\n\n  [2, 3]  \n{}", JSONRecordsLines) == 3);
+  TEST(parallel_count("", JSONRecordsLines) == 0);
+  TEST(parallel_count("1 2\n", JSONRecordsLines) == SIZE_MAX);
+  TEST(parallel_count(" [ ] ", JSONRecordsArray) == 0);
+  TEST(parallel_count("[1, \"]\", [2, {\"a\": []}],]", JSONRecordsArray) == 3);
+  TEST(parallel_count("[1,,2]", JSONRecordsArray) == SIZE_MAX);
+  TEST(parallel_count("[1 2]", JSONRecordsArray) == SIZE_MAX);
+  TEST(parallel_count("[tru]", JSONRecordsArray) == SIZE_MAX);
+  TEST(parallel_count("[1, 2", JSONRecordsArray) == SIZE_MAX);
+  TEST(parallel_count("{}", JSONRecordsArray) == SIZE_MAX);
+  TEST(parallel_count("", JSONRecordsArray) == SIZE_MAX);
+
+  value = json_parse_file_parallel(get_file_path("test_1_1.txt"),
+                                   JSONRecordsArray, 2, nullptr);
+  JSON_Value *file_value = json_parse_file(get_file_path("test_1_1.txt"));
+  TEST(value != nullptr && json_value_equals(value, file_value));
+  json_value_free(value);
+  json_value_free(file_value);
+  TEST(json_parse_file_parallel(get_file_path("test_6.txt"), JSONRecordsLines,
+                                2, nullptr) == nullptr);
+  TEST(json_parse_file_parallel("missing.ndjson", JSONRecordsLines, 2,
+                                nullptr) == nullptr);
+  /* files parse like buffers of their whole contents, even without mapping */
+  const char *filename = "test_parallel.ndjson";
+  const struct {
+    const char *data;
+    size_t len;
+  } files[] = {{"", 0}, {"1\n\0\n2\n", 6}};
+  for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++) {
+    FILE *fp = fopen(get_file_path(filename), "wb");
+    fwrite(files[i].data, 1, files[i].len, fp);
+    fclose(fp);
+    value = json_parse_file_parallel(get_file_path(filename),
+                                     JSONRecordsLines, 2, nullptr);
+    JSON_Value *buffer_value = json_parse_records_parallel(
+        files[i].data, files[i].len, JSONRecordsLines, 2, nullptr);
+    TEST(buffer_value == nullptr ? value == nullptr
+                                 : json_value_equals(value, buffer_value));
+    json_value_free(value);
+    json_value_free(buffer_value);
+  }
+  remove(get_file_path(filename));
+  TEST(json_parse_records_parallel(nullptr, 0, JSONRecordsLines, 1,
+                                   nullptr) == nullptr);
+  json_set_allocation_functions(counted_malloc, counted_free);
+}
+
+/* A clock for test_stats that ticks once per reading */
+static uint64_t ticking_clock(void *ctx) {
+  uint64_t *ticks = (uint64_t *)ctx;
+  return (*ticks)++;
+}
+
+void test_stats() {
+  JSON_Context *context = json_context_new(nullptr);
+  uint64_t ticks = 10;
+  JSON_Stats stats = {.clock_fun = ticking_clock, .clock_ctx = &ticks};
+  json_context_set_stats(context, &stats);
+  const char *input =
+      "{\"a\": [1, 2, {\"b\": null}], \"c\": \"x\", \"d\": [[true]]}";
+  JSON_Value *value = json_parse_string_ex(input, nullptr, 0, context);
+  TEST(value != nullptr);
+  char *output = json_serialize_to_string_ex(value, 0, context);
+  TEST(output != nullptr);
+  JSON_Value *untracked = json_parse_string(input);
+#if defined(PARSON_ENABLE_STATS)
+  TEST(stats.parses == 1 && stats.bytes_in == strlen(input));
+  TEST(stats.values[JSONObject] == 2 && stats.values[JSONArray] == 3);
+  TEST(stats.values[JSONNumber] == 2 && stats.values[JSONString] == 1);
+  TEST(stats.values[JSONNull] == 1 && stats.values[JSONBoolean] == 1);
+  TEST(stats.max_depth == 3);
+  TEST(stats.serializations == 1 && stats.bytes_out == strlen(output));
+  TEST(stats.allocations > 0 && stats.allocated_bytes > stats.bytes_out);
+  /* parse, measure and write: one reading at the start and end of each */
+  TEST(stats.begin_time == 14 && stats.end_time == 15);
+  TEST(stats.total_time == 3 && ticks == 16);
+#else
+  TEST(stats.parses == 0 && stats.allocations == 0 && ticks == 10);
+#endif
+  const size_t allocations = stats.allocations;
+  const size_t frees = stats.frees;
+  json_free_serialized_string_ex(output, context);
+  json_value_free(value);
+  json_value_free(untracked);
+  TEST(stats.allocations == allocations && stats.frees == frees);
+
+  json_stats_reset(&stats);
+  TEST(stats.parses == 0 && stats.clock_fun == ticking_clock &&
+       stats.clock_ctx == &ticks);
+  constexpr size_t large_size = 64 * 1'024;
+  char *large = (char *)malloc(large_size);
+  size_t len = (size_t)snprintf(large, large_size, "{");
+  for (int i = 0; i < 1'000; i++) {
+    len += (size_t)snprintf(large + len, large_size - len, "%s\"key%d\": [%d]",
+                            i > 0 ? "," : "", i, i);
+  }
+  snprintf(large + len, large_size - len, "}");
+  JSON_Arena *arena = json_arena_new_ex(context);
+  value = json_parse_string_ex(large, arena, 0, context);
+  TEST(json_object_get_count(json_object(value)) == 1'000);
+#if defined(PARSON_ENABLE_STATS)
+  TEST(stats.parses == 1 && stats.values[JSONArray] == 1'000);
+  TEST(stats.object_grows >= 8 && stats.array_resizes == 1'000);
+  TEST(stats.max_probe_length >= 1 && stats.max_depth == 2);
+  TEST(stats.allocations > 0);
+#else
+  TEST(stats.object_grows == 0 && stats.max_probe_length == 0);
+#endif
+  json_context_set_stats(context, nullptr);
+  json_stats_reset(&stats);
+  TEST(json_parse_string_ex("[1]", arena, 0, context) != nullptr);
+  TEST(stats.parses == 0 && stats.values[JSONNumber] == 0);
+  json_arena_free(arena);
+  free(large);
+  json_stats_reset(nullptr);
+  json_context_set_stats(nullptr, &stats);
+  json_context_free(context);
+}
+
+static bool binary_round_trips(const JSON_Value *value, bool cbor) {
+  size_t len = 0;
+  char *encoded = cbor ? json_serialize_to_cbor(value, &len)
+                       : json_serialize_to_msgpack(value, &len);
+  if (encoded == nullptr) {
+    return false;
+  }
+  JSON_Arena *arena = json_arena_new();
+  JSON_Value *heap_copy = cbor ? json_parse_cbor(encoded, len, nullptr)
+                               : json_parse_msgpack(encoded, len, nullptr);
+  JSON_Value *arena_copy = cbor ? json_parse_cbor(encoded, len, arena)
+                                : json_parse_msgpack(encoded, len, arena);
+  const bool equal = json_value_equals(value, heap_copy) &&
+                     json_value_equals(value, arena_copy);
+  json_value_free(heap_copy);
+  json_arena_free(arena);
+  json_free_serialized_string(encoded);
+  return equal;
+}
+
+static bool binary_contains(const char *bytes, size_t len, const char *part,
+                            size_t part_len) {
+  for (size_t i = 0; i + part_len <= len; i++) {
+    if (memcmp(bytes + i, part, part_len) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool binary_bytes_equal(const char *bytes, size_t len,
+                               const unsigned char *expected,
+                               size_t expected_len) {
+  return bytes != nullptr && len == expected_len &&
+         memcmp(bytes, expected, len) == 0;
+}
+
+void test_binary_encoding() {
+  JSON_Value *value =
+      json_parse_string("{\"a\": [1, -1, 1.5, true, null], \"b\": \"x\"}");
+  size_t len = 0;
+  char *encoded = json_serialize_to_cbor(value, &len);
+  const unsigned char cbor[] = {0xA2, 0x61, 'a',  0x85, 0x01, 0x20,
+                                0xFA, 0x3F, 0xC0, 0x00, 0x00, 0xF5,
+                                0xF6, 0x61, 'b',  0x61, 'x'};
+  TEST(binary_bytes_equal(encoded, len, cbor, sizeof(cbor)));
+  json_free_serialized_string(encoded);
+  encoded = json_serialize_to_msgpack(value, &len);
+  const unsigned char msgpack[] = {0x82, 0xA1, 'a',  0x95, 0x01, 0xFF,
+                                   0xCA, 0x3F, 0xC0, 0x00, 0x00, 0xC3,
+                                   0xC0, 0xA1, 'b',  0xA1, 'x'};
+  TEST(binary_bytes_equal(encoded, len, msgpack, sizeof(msgpack)));
+  TEST(binary_round_trips(value, true) && binary_round_trips(value, false));
+
+  /* every proper prefix is truncated, one more byte is trailing data */
+  bool all_rejected = true;
+  for (size_t i = 0; i < len; i++) {
+    all_rejected = all_rejected && json_parse_msgpack(encoded, i, nullptr) ==
+                                       nullptr;
+    all_rejected = all_rejected && json_parse_cbor((const char *)cbor, i,
+                                                   nullptr) == nullptr;
+  }
+  TEST(all_rejected);
+  char trailing[sizeof(cbor) + 1];
+  memcpy(trailing, cbor, sizeof(cbor));
+  trailing[sizeof(cbor)] = 0x00;
+  TEST(json_parse_cbor(trailing, sizeof(trailing), nullptr) == nullptr);
+  json_free_serialized_string(encoded);
+  json_value_free(value);
+
+  value = json_parse_string(
+      "[0, 23, 24, 255, 256, 65536, 4294967296, -24, -25, -129, -32769,"
+      " 18446744073709549568, -9223372036854775808, 0.1, -0.0, 1e300,"
+      " -5e-324, \"\", \"caf\\u00e9 \\u0000 \\ud83d\\ude00\"]");
+  TEST(binary_round_trips(value, true) && binary_round_trips(value, false));
+  encoded = json_serialize_to_msgpack(value, &len);
+  /* 4294967296 is an uint64, -32769 an int32 and -0.0 a float32 */
+  TEST(encoded != nullptr &&
+       binary_contains(encoded, len, "\xCF\x00\x00\x00\x01", 5) &&
+       binary_contains(encoded, len, "\xD2\xFF\xFF\x7F\xFF", 5) &&
+       binary_contains(encoded, len, "\xCA\x80\x00\x00\x00", 5));
+  json_free_serialized_string(encoded);
+  json_value_free(value);
+
+  value = json_parse_file(get_file_path("test_1_1.txt"));
+  TEST(binary_round_trips(value, true) && binary_round_trips(value, false));
+  json_value_free(value);
+  value = json_parse_file(get_file_path("test_2.txt"));
+  TEST(binary_round_trips(value, true) && binary_round_trips(value, false));
+  encoded = json_serialize_to_cbor(value, &len);
+  TEST(encoded != nullptr && len < json_serialization_size(value));
+  json_free_serialized_string(encoded);
+  json_value_free(value);
+
+  /* the text parser lets invalid UTF-8 through, the encoders don't, as the
+     decoders would reject what they wrote */
+  const char *invalid_utf8[] = {"{\"a\":\"\xff\xfe\"}", "{\"\xff\xfe\":1}",
+                                "[\"ok\", [\"\xc3\"]]"};
+  bool all_refused = true;
+  for (size_t i = 0; i < sizeof(invalid_utf8) / sizeof(invalid_utf8[0]); i++) {
+    value = json_parse_string(invalid_utf8[i]);
+    all_refused = all_refused && value != nullptr &&
+                  json_serialize_to_cbor(value, &len) == nullptr &&
+                  json_serialize_to_msgpack(value, &len) == nullptr &&
+                  !binary_round_trips(value, true) &&
+                  !binary_round_trips(value, false);
+    json_value_free(value);
+  }
+  TEST(all_refused);
+
+  /* tags, half floats, undefined and indefinite-length containers */
+  const unsigned char extended[] = {0xBF, 0x61, 'a',  0xC1, 0x19, 0x01,
+                                    0x00, 0x61, 'h',  0xF9, 0xC1, 0x00,
+                                    0x61, 'u',  0xF7, 0x61, 'l',  0x9F,
+                                    0x01, 0x9F, 0xFF, 0xFF, 0xFF};
+  value = json_parse_cbor((const char *)extended, sizeof(extended), nullptr);
+  TEST(json_object_get_number(json_object(value), "a") == 256);
+  TEST(json_object_get_number(json_object(value), "h") == -2.5);
+  TEST(json_value_get_type(json_object_get_value(json_object(value), "u")) ==
+       JSONNull);
+  TEST(json_array_get_count(json_object_get_array(json_object(value), "l")) ==
+       2);
+  json_value_free(value);
+  const unsigned char msgpack_ints[] = {0x94, 0xD0, 0x80, 0xD3, 0x80, 0x00,
+                                        0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+                                        0xCD, 0x01, 0x00, 0xE0};
+  value = json_parse_msgpack((const char *)msgpack_ints, sizeof(msgpack_ints),
+                             nullptr);
+  TEST(json_array_get_number(json_array(value), 0) == -128);
+  TEST(json_array_get_number(json_array(value), 1) == -0x1p63);
+  TEST(json_array_get_number(json_array(value), 2) == 256);
+  TEST(json_array_get_number(json_array(value), 3) == -32);
+  json_value_free(value);
+
+  /* byte strings, bin, non-string and duplicate names, invalid UTF-8, NaN,
+     counts beyond the input and unterminated indefinite arrays */
+  const char *invalid_cbor[] = {"\x41\x00", "\xA1\x01\x02",
+                                "\xA2\x61" "a\x01\x61" "a\x02",
+                                "\x61\xFF", "\xF9\x7E\x00", "\xF0",
+                                "\x5F\xFF", "\x9B\xFF\xFF\xFF\xFF\xFF\xFF\xFF",
+                                "\x9F\x01"};
+  const size_t invalid_cbor_lens[] = {2, 3, 7, 2, 3, 1, 2, 8, 2};
+  bool cbor_rejected = true;
+  for (size_t i = 0; i < sizeof(invalid_cbor_lens) / sizeof(size_t); i++) {
+    cbor_rejected = cbor_rejected && json_parse_cbor(invalid_cbor[i],
+                                                     invalid_cbor_lens[i],
+                                                     nullptr) == nullptr;
+  }
+  TEST(cbor_rejected);
+  const char *invalid_msgpack[] = {"\xC4\x01\x00", "\xD4\x00\x00",
+                                   "\x81\x01\x02", "\xC1",
+                                   "\xA1\xFF", "\xDD\xFF\xFF\xFF\xFF"};
+  const size_t invalid_msgpack_lens[] = {3, 3, 3, 1, 2, 5};
+  bool msgpack_rejected = true;
+  for (size_t i = 0; i < sizeof(invalid_msgpack_lens) / sizeof(size_t); i++) {
+    msgpack_rejected =
+        msgpack_rejected && json_parse_msgpack(invalid_msgpack[i],
+                                               invalid_msgpack_lens[i],
+                                               nullptr) == nullptr;
+  }
+  TEST(msgpack_rejected);
+
+  /* a UTF-8 lead byte at the very end of an allocation, with no terminator
+     behind it: a string, a CBOR text string and a CBOR name */
+  const char *truncated[] = {"\xA1\xE2", "\x61\xE2", "\xA1\x61\xF0\x01"};
+  const size_t truncated_lens[] = {2, 2, 4};
+  for (size_t i = 0; i < sizeof(truncated_lens) / sizeof(size_t); i++) {
+    auto exact = (char *)malloc(truncated_lens[i]);
+    memcpy(exact, truncated[i], truncated_lens[i]);
+    TEST(i == 0 ? json_parse_msgpack(exact, truncated_lens[i], nullptr) ==
+                      nullptr
+                : json_parse_cbor(exact, truncated_lens[i], nullptr) ==
+                      nullptr);
+    free(exact);
+  }
+  TEST(json_parse_cbor(nullptr, 0, nullptr) == nullptr);
+  TEST(json_serialize_to_msgpack(nullptr, &len) == nullptr);
+
+  /* nesting is limited like in the text parser */
+  constexpr size_t too_deep = 2'049;
+  char *deep = (char *)malloc(too_deep + 1);
+  memset(deep, 0x81, too_deep);
+  deep[too_deep] = 0x01;
+  TEST(json_parse_cbor(deep, too_deep + 1, nullptr) == nullptr);
+  value = json_parse_cbor(deep + 1, too_deep, nullptr);
+  TEST(value != nullptr);
+  json_value_free(value);
+  free(deep);
+}
+
+void test_compact_values() {
+  const char *integers = "[9223372036854775807,-9223372036854775808,"
+                         "18446744073709551615,9007199254740993,"
+                         "-9007199254740993,12345678901234567890]";
+  JSON_Value *value = json_parse_string(integers);
+  JSON_Array *array = json_array(value);
+  TEST(json_array_get_int64(array, 0) == INT64_MAX);
+  TEST(json_array_get_int64(array, 1) == INT64_MIN);
+  TEST(json_value_get_uint64(json_array_get_value(array, 2)) == UINT64_MAX);
+  TEST(json_array_get_int64(array, 2) == 0);
+  TEST(json_array_get_int64(array, 3) == 9'007'199'254'740'993);
+  TEST(json_array_get_int64(array, 4) == -9'007'199'254'740'993);
+  TEST(json_value_get_uint64(json_array_get_value(array, 5)) ==
+       12'345'678'901'234'567'890ULL);
+  TEST(json_array_get_number(array, 3) == 0x1p53);
+  char *serialized = json_serialize_to_string(value);
+  TEST(STREQ(serialized, integers));
+  json_free_serialized_string(serialized);
+  JSON_Value *copy = json_value_deep_copy(value);
+  serialized = json_serialize_to_string(copy);
+  TEST(STREQ(serialized, integers));
+  json_free_serialized_string(serialized);
+  TEST(json_value_equals(value, copy));
+  json_value_free(copy);
+  for (int i = 0; i < 2; i++) {
+    size_t len = 0;
+    char *encoded = i == 0 ? json_serialize_to_cbor(value, &len)
+                           : json_serialize_to_msgpack(value, &len);
+    copy = i == 0 ? json_parse_cbor(encoded, len, nullptr)
+                  : json_parse_msgpack(encoded, len, nullptr);
+    serialized = json_serialize_to_string(copy);
+    TEST(STREQ(serialized, integers));
+    json_free_serialized_string(serialized);
+    json_free_serialized_string(encoded);
+    json_value_free(copy);
+  }
+  json_value_free(value);
+
+  /* integers a double holds exactly and numbers beyond 64 bits stay doubles */
+  value = json_parse_string("[9007199254740992, 18446744073709551616, 1.5, "
+                            "-1, 1e3, \"1\"]");
+  array = json_array(value);
+  TEST(json_array_get_int64(array, 0) == 9'007'199'254'740'992);
+  TEST(json_array_get_number(array, 1) == 0x1p64);
+  TEST(json_value_get_uint64(json_array_get_value(array, 1)) == 0);
+  TEST(json_array_get_int64(array, 2) == 0);
+  TEST(json_value_get_uint64(json_array_get_value(array, 3)) == 0);
+  TEST(json_array_get_int64(array, 3) == -1);
+  TEST(json_array_get_int64(array, 4) == 1'000);
+  TEST(json_array_get_int64(array, 5) == 0);
+  json_value_free(value);
+
+  JSON_Parser *parser = json_parser_new();
+  TEST(json_parser_feed(parser, "[1844674407370955", 17) == JSONSuccess);
+  TEST(json_parser_feed(parser, "1615, 9223372036854775807]", 26) ==
+       JSONSuccess);
+  value = json_parser_finish(parser);
+  json_parser_free(parser);
+  TEST(json_value_get_uint64(json_array_get_value(json_array(value), 0)) ==
+       UINT64_MAX);
+  TEST(json_array_get_int64(json_array(value), 1) == INT64_MAX);
+  json_value_free(value);
+
+  value = json_value_init_object();
+  TEST(json_object_set_int64(json_object(value), "id",
+                             -4'611'686'018'427'387'905) == JSONSuccess);
+  TEST(json_object_get_int64(json_object(value), "id") ==
+       -4'611'686'018'427'387'905);
+  TEST(json_object_set_value(json_object(value), "small",
+                             json_value_init_int64(7)) == JSONSuccess);
+  TEST(json_object_set_value(json_object(value), "big",
+                             json_value_init_uint64(UINT64_MAX)) ==
+       JSONSuccess);
+  JSON_Value *list = json_value_init_array();
+  TEST(json_array_append_int64(json_array(list), INT64_MIN) == JSONSuccess);
+  TEST(json_object_set_value(json_object(value), "list", list) ==
+       JSONSuccess);
+  serialized = json_serialize_to_string(value);
+  TEST(STREQ(serialized, "{\"id\":-4611686018427387905,\"small\":7,"
+                         "\"big\":18446744073709551615,"
+                         "\"list\":[-9223372036854775808]}"));
+  json_free_serialized_string(serialized);
+  /* exact integers compare exactly, and by value with doubles */
+  JSON_Value *near = json_parse_string("{\"id\":-4611686018427387904,"
+                                       "\"small\":7.0,"
+                                       "\"big\":18446744073709551615,"
+                                       "\"list\":[-9223372036854775808]}");
+  TEST(!json_value_equals(value, near));
+  json_object_set_int64(json_object(near), "id", -4'611'686'018'427'387'905);
+  TEST(json_value_equals(value, near));
+  json_value_free(near);
+  json_value_free(value);
+
+  /* strings of up to 14 bytes live in their value */
+  const char with_null[] = "ab\0cd";
+  value = json_value_init_string_with_len(with_null, sizeof(with_null) - 1);
+  TEST(json_value_get_string_len(value) == 5);
+  TEST(memcmp(json_value_get_string(value), with_null, sizeof(with_null)) ==
+       0);
+  copy = json_value_deep_copy(value);
+  TEST(json_value_equals(value, copy));
+  json_value_free(copy);
+  json_value_free(value);
+  JSON_Arena *arena = json_arena_new();
+  value = json_parse_string_arena("[\"fourteen bytes\", \"fifteen  bytes!\", "
+                                  "\"\", \"esc\\u0061ped\"]",
+                                  arena);
+  array = json_array(value);
+  TEST(STREQ(json_array_get_string(array, 0), "fourteen bytes"));
+  TEST(STREQ(json_array_get_string(array, 1), "fifteen  bytes!"));
+  TEST(json_array_get_string_len(array, 2) == 0);
+  TEST(STREQ(json_array_get_string(array, 3), "escaped"));
+  serialized = json_serialize_to_string(value);
+  TEST(STREQ(serialized, "[\"fourteen bytes\",\"fifteen  bytes!\",\"\","
+                         "\"escaped\"]"));
+  json_free_serialized_string(serialized);
+  json_arena_free(arena);
+}
+
+void test_reserve_and_bulk() {
+  json_set_allocation_functions(failing_malloc, failing_free);
+  g_failing_alloc.should_fail = false;
+  g_failing_alloc.alloc_count = 0;
+
+  /* a reserved array never moves its items */
+  g_failing_alloc.total_count = 0;
+  JSON_Value *value = json_value_init_array_with_capacity(1'000);
+  JSON_Array *array = json_array(value);
+  TEST(value != nullptr && g_failing_alloc.total_count == 3);
+  bool all_appended = true;
+  for (int i = 0; i < 1'000; i++) {
+    all_appended = all_appended && json_array_append_number(array, i) ==
+                                       JSONSuccess;
+  }
+  TEST(all_appended && g_failing_alloc.total_count == 1'003);
+  TEST(json_array_reserve(array, 10) == JSONSuccess);
+  TEST(json_array_get_count(array) == 1'000);
+  json_value_free(value);
+
+  g_failing_alloc.total_count = 0;
+  value = json_value_init_object_with_capacity(100);
+  JSON_Object *object = json_object(value);
+  TEST(value != nullptr && g_failing_alloc.total_count == 3);
+  all_appended = true;
+  for (int i = 0; i < 100; i++) {
+    char name[16];
+    snprintf(name, sizeof(name), "k%d", i);
+    all_appended = all_appended && json_object_set_null(object, name) ==
+                                       JSONSuccess;
+  }
+  /* a name and a value each */
+  TEST(all_appended && g_failing_alloc.total_count == 203);
+  TEST(json_object_get_count(object) == 100);
+  TEST(json_value_get_type(json_object_get_value(object, "k99")) == JSONNull);
+  TEST(json_object_reserve(object, 1'000) == JSONSuccess);
+  TEST(json_value_get_type(json_object_get_value(object, "k42")) == JSONNull);
+  json_value_free(value);
+  TEST(g_failing_alloc.alloc_count == 0);
+  json_set_allocation_functions(counted_malloc, counted_free);
+
+  value = json_value_init_array();
+  array = json_array(value);
+  const double numbers[] = {1, 2.5, -3};
+  const char *strings[] = {"a", "a string longer than fourteen bytes"};
+  TEST(json_array_append_numbers(array, numbers, 3) == JSONSuccess);
+  TEST(json_array_append_strings(array, strings, 2) == JSONSuccess);
+  TEST(json_array_append_numbers(array, nullptr, 0) == JSONSuccess);
+  char *serialized = json_serialize_to_string(value);
+  TEST(STREQ(serialized,
+             "[1,2.5,-3,\"a\",\"a string longer than fourteen bytes\"]"));
+  json_free_serialized_string(serialized);
+  /* all or nothing */
+  const double with_nan[] = {4, NAN};
+  const char *with_invalid[] = {"b", "\xFF"};
+  TEST(json_array_append_numbers(array, with_nan, 2) == JSONFailure);
+  TEST(json_array_append_strings(array, with_invalid, 2) == JSONFailure);
+  TEST(json_array_append_numbers(array, nullptr, 1) == JSONFailure);
+  TEST(json_array_get_count(array) == 5);
+  TEST(json_array_append_numbers(nullptr, numbers, 3) == JSONFailure);
+  TEST(json_array_reserve(nullptr, 1) == JSONFailure);
+  TEST(json_object_reserve(nullptr, 1) == JSONFailure);
+  TEST(json_array_reserve(array, SIZE_MAX) == JSONFailure);
+  json_value_free(value);
+
+  JSON_Arena *arena = json_arena_new();
+  value = json_parse_string_arena("[[], {}]", arena);
+  array = json_array_get_array(json_array(value), 0);
+  TEST(json_array_append_numbers(array, numbers, 3) == JSONSuccess);
+  TEST(json_array_append_strings(array, strings, 2) == JSONSuccess);
+  TEST(json_array_get_count(array) == 5);
+  TEST(json_object_reserve(json_array_get_object(json_array(value), 1), 64) ==
+       JSONSuccess);
+  json_arena_free(arena);
+}
+
+void test_compiled_schema() {
+  /* schema, value, whether json_validate accepts it */
+  const struct {
+    const char *schema;
+    const char *value;
+    bool valid;
+  } cases[] = {
+      {"{\"a\":0,\"b\":\"\"}", "{\"b\":\"x\",\"c\":[1,{}],\"a\":1}", true},
+      {"{\"a\":0,\"b\":\"\"}", "{\"a\":1}", false},
+      {"{\"a\":0,\"b\":\"\"}", "{\"a\":1,\"b\":2}", false},
+      {"{\"a\":0,\"b\":\"\"}", "{\"a\":1,\"c\":\"\",\"d\":\"\"}", false},
+      {"{\"a\":{\"b\":[true]}}", "{\"a\":{\"b\":[true,false]}}", true},
+      {"{\"a\":{\"b\":[true]}}", "{\"a\":{\"b\":[true,0]}}", false},
+      {"{\"a\":{\"b\":[true]}}", "{\"a\":{\"b\":[]}}", true},
+      {"[{\"id\":0}]", "[{\"id\":1},{\"id\":2,\"x\":null}]", true},
+      {"[{\"id\":0}]", "[{\"id\":1},{\"x\":2}]", false},
+      {"[[0]]", "[[1,2],[],[3]]", true},
+      {"[[0]]", "[[1,2],[\"3\"]]", false},
+      {"{\"a\":null}", "{\"a\":[1,{\"b\":\"\"}]}", true},
+      {"{\"a\":null}", "{\"b\":1}", false},
+      {"{}", "{\"a\":1}", true},
+      {"{}", "[]", false},
+      {"[]", "[1,\"a\",null]", true},
+      {"null", "\"anything\"", true},
+      {"0", "1e3", true},
+      {"0", "null", false},
+      {"{\"\\u0000a\":0}", "{\"\\u0000a\":1}", true},
+      {"{\"\\u0000a\":0}", "{\"a\":1,\"\\u0000\":2}", false},
+      /* enough members for a hash index */
+      {"{\"a\":0,\"b\":0,\"c\":0,\"d\":0,\"e\":0,\"f\":0,\"g\":0,"
+       "\"h\":0,\"i\":\"\"}",
+       "{\"i\":\"\",\"h\":1,\"g\":1,\"f\":1,\"x\":1,\"e\":1,\"d\":1,"
+       "\"c\":1,\"b\":1,\"a\":1}",
+       true},
+      {"{\"a\":0,\"b\":0,\"c\":0,\"d\":0,\"e\":0,\"f\":0,\"g\":0,"
+       "\"h\":0,\"i\":\"\"}",
+       "{\"i\":1,\"h\":1,\"g\":1,\"f\":1,\"e\":1,\"d\":1,\"c\":1,"
+       "\"b\":1,\"a\":1}",
+       false},
+      {"{\"a\":0,\"b\":0,\"c\":0,\"d\":0,\"e\":0,\"f\":0,\"g\":0,"
+       "\"h\":0,\"i\":\"\"}",
+       "{\"h\":1,\"g\":1,\"f\":1,\"e\":1,\"d\":1,\"c\":1,\"b\":1,"
+       "\"a\":1,\"j\":\"\"}",
+       false},
+  };
+  size_t i = 0;
+  bool all_agree = true;
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    JSON_Value *schema_value = json_parse_string(cases[i].schema);
+    JSON_Value *value = json_parse_string(cases[i].value);
+    JSON_Schema *schema = json_schema_compile(schema_value);
+    const JSON_Status expected =
+        cases[i].valid ? JSONSuccess : JSONFailure;
+    bool agree =
+        schema != nullptr && json_validate(schema_value, value) == expected;
+    /* the compiled schema doesn't refer to its source */
+    json_value_free(schema_value);
+    agree = agree && json_schema_validate(schema, value) == expected &&
+            json_schema_validate_buffer(schema, cases[i].value,
+                                        strlen(cases[i].value)) == expected;
+    if (!agree) {
+      printf("Compiled schema mismatch in case %zu\n", i);
+    }
+    all_agree = all_agree && agree;
+    json_schema_free(schema);
+    json_value_free(value);
+  }
+  TEST(all_agree);
+
+  /* same schema as test_suite_7 */
+  JSON_Value *value = json_parse_file(get_file_path("test_5.txt"));
+  JSON_Value *schema_value = json_parse_string(
+      "{\"first\":\"\",\"last\":\"\",\"age\":0,\"interests\":[\"\"],"
+      "\"favorites\":null}");
+  JSON_Schema *schema = json_schema_compile(schema_value);
+  TEST(json_schema_validate(schema, value) == JSONSuccess);
+  char *serialized = json_serialize_to_string(value);
+  TEST(json_schema_validate_buffer(schema, serialized, strlen(serialized)) ==
+       JSONSuccess);
+  json_free_serialized_string(serialized);
+  json_object_set_string(json_object(value), "age", "");
+  TEST(json_schema_validate(schema, value) == JSONFailure);
+  json_schema_free(schema);
+  json_value_free(schema_value);
+  json_value_free(value);
+
+  /* buffers must be valid JSON, also where the schema doesn't look */
+  schema_value = json_parse_string("{\"a\":0}");
+  schema = json_schema_compile(schema_value);
+  const char *unchecked_invalid = "{\"a\":1,\"b\":[1,2,}";
+  const char *truncated = "{\"a\":1";
+  const char *duplicated = "{\"a\":1,\"a\":2}";
+  const char *prefix_only = "{\"a\":1} trailing";
+  TEST(json_schema_validate_buffer(schema, unchecked_invalid,
+                                   strlen(unchecked_invalid)) == JSONFailure);
+  TEST(json_schema_validate_buffer(schema, truncated, strlen(truncated)) ==
+       JSONFailure);
+  TEST(json_schema_validate_buffer(schema, duplicated, strlen(duplicated)) ==
+       JSONFailure);
+  TEST(json_schema_validate_buffer(schema, prefix_only, 7) == JSONSuccess);
+  TEST(json_schema_validate_buffer(schema, "{\"a\":1}", 5) == JSONFailure);
+
+  TEST(json_schema_compile(nullptr) == nullptr);
+  TEST(json_schema_validate(nullptr, schema_value) == JSONFailure);
+  TEST(json_schema_validate(schema, nullptr) == JSONFailure);
+  TEST(json_schema_validate_buffer(nullptr, "{}", 2) == JSONFailure);
+  TEST(json_schema_validate_buffer(schema, nullptr, 0) == JSONFailure);
+  json_schema_free(nullptr);
+  json_schema_free(schema);
+
+  /* compiling allocates once, validating a buffer once */
+  json_set_allocation_functions(failing_malloc, failing_free);
+  g_failing_alloc.should_fail = false;
+  g_failing_alloc.alloc_count = 0;
+  g_failing_alloc.total_count = 0;
+  schema = json_schema_compile(schema_value);
+  TEST(schema != nullptr && g_failing_alloc.total_count == 1);
+  TEST(json_schema_validate_buffer(schema, "{\"a\":1}", 7) == JSONSuccess);
+  TEST(g_failing_alloc.total_count == 2);
+  json_schema_free(schema);
+  TEST(g_failing_alloc.alloc_count == 0);
+  json_set_allocation_functions(counted_malloc, counted_free);
+  json_value_free(schema_value);
+}
+
+void test_structure_hash() {
+  const char *doc = "{\"name\":\"svc\",\"port\":80,\"tags\":[true,null],"
+                    "\"limits\":{\"cpu\":1,\"mem\":{\"max\":2}}}";
+  const char *reordered = "{\"limits\":{\"mem\":{\"max\":2},\"cpu\":1},"
+                          "\"tags\":[true,null],\"port\":80,\"name\":\"svc\"}";
+  JSON_Value *a = json_parse_string(doc);
+  JSON_Value *b = json_parse_string(reordered);
+  const uint64_t a_hash = json_value_hash(a);
+  /* member order doesn't count */
+  TEST(a_hash != 0 && a_hash == json_value_hash(b));
+  TEST(json_value_equals(a, b));
+  JSON_Value *copy = json_value_deep_copy(a);
+  TEST(json_value_hash(copy) == a_hash);
+  json_value_free(copy);
+  JSON_Value *lazy = json_parse_string_with_options(doc, nullptr,
+                                                     JSONParseLazy);
+  TEST(json_value_hash(lazy) == a_hash);
+  json_value_free(lazy);
+
+  /* kept hashes follow changes deep in the tree */
+  TEST(json_object_dotset_boolean(json_object(b), "limits.mem.max", true) ==
+       JSONSuccess);
+  const uint64_t changed_hash = json_value_hash(b);
+  TEST(changed_hash != a_hash);
+  TEST(!json_value_equals(a, b));
+  TEST(json_object_dotset_number(json_object(b), "limits.mem.max", 2) ==
+       JSONSuccess);
+  TEST(json_value_hash(b) == a_hash && json_value_equals(a, b));
+  TEST(json_array_append_null(json_object_get_array(json_object(b), "tags")) ==
+       JSONSuccess);
+  TEST(json_value_hash(b) != a_hash && !json_value_equals(a, b));
+  TEST(json_array_remove(json_object_get_array(json_object(b), "tags"), 2) ==
+       JSONSuccess);
+  TEST(json_value_hash(b) == a_hash);
+  TEST(json_array_replace_boolean(json_object_get_array(json_object(b), "tags"),
+                                  0, false) == JSONSuccess);
+  TEST(json_value_hash(b) != a_hash);
+  TEST(json_array_clear(json_object_get_array(json_object(b), "tags")) ==
+       JSONSuccess);
+  TEST(json_value_hash(b) != a_hash);
+  TEST(json_object_remove(json_object(b), "tags") == JSONSuccess);
+  TEST(json_value_hash(b) != a_hash);
+  TEST(json_object_clear(json_object(b)) == JSONSuccess);
+  JSON_Value *empty = json_value_init_object();
+  TEST(json_value_hash(b) == json_value_hash(empty));
+  json_value_free(empty);
+  json_value_free(b);
+
+  /* array order counts, numbers only by type */
+  JSON_Value *x = json_parse_string("[true,null]");
+  JSON_Value *y = json_parse_string("[null,true]");
+  TEST(json_value_hash(x) != json_value_hash(y));
+  json_value_free(x);
+  json_value_free(y);
+  x = json_parse_string("[1]");
+  y = json_parse_string("[1.0000001]");
+  TEST(json_value_hash(x) == json_value_hash(y) && json_value_equals(x, y));
+  json_value_free(y);
+  y = json_parse_string("[2]");
+  TEST(json_value_hash(x) == json_value_hash(y) && !json_value_equals(x, y));
+  json_value_free(y);
+  y = json_parse_string("[\"1\"]");
+  TEST(json_value_hash(x) != json_value_hash(y));
+  json_value_free(x);
+  json_value_free(y);
+
+  TEST(json_value_hash(nullptr) == 0);
+  json_value_free(a);
+}
+
+void test_frozen_values() {
+  const char *doc = "{\"name\":\"svc\",\"tags\":[\"a\",\"b\"],"
+                    "\"limits\":{\"cpu\":1,\"mem\":{\"max\":2}},"
+                    "\"list\":[{\"x\":1},{\"x\":2}]}";
+  json_set_allocation_functions(failing_malloc, failing_free);
+  g_failing_alloc.should_fail = false;
+  g_failing_alloc.alloc_count = 0;
+  JSON_Value *base = json_parse_string(doc);
+  JSON_Object *base_object = json_object(base);
+  TEST(!json_value_is_frozen(base));
+  TEST(json_value_freeze(base) == JSONSuccess);
+  TEST(json_value_is_frozen(base));
+  TEST(json_value_is_frozen(json_object_get_value(base_object, "tags")));
+  TEST(json_value_freeze(base) == JSONSuccess);
+
+  /* nothing in a frozen tree changes */
+  JSON_Array *tags = json_object_get_array(base_object, "tags");
+  TEST(json_object_set_number(base_object, "name", 1) == JSONFailure);
+  TEST(json_object_set_null(base_object, "new") == JSONFailure);
+  TEST(json_object_remove(base_object, "name") == JSONFailure);
+  TEST(json_object_dotset_number(base_object, "limits.cpu", 2) ==
+       JSONFailure);
+  TEST(json_object_dotremove(base_object, "limits.cpu") == JSONFailure);
+  TEST(json_object_clear(json_object_get_object(base_object, "limits")) ==
+       JSONFailure);
+  TEST(json_object_reserve(base_object, 100) == JSONFailure);
+  TEST(json_array_append_null(tags) == JSONFailure);
+  TEST(json_array_replace_null(tags, 0) == JSONFailure);
+  TEST(json_array_remove(tags, 0) == JSONFailure);
+  TEST(json_array_clear(tags) == JSONFailure);
+  TEST(json_array_reserve(tags, 100) == JSONFailure);
+  char *serialized = json_serialize_to_string(base);
+  TEST(STREQ(serialized, doc));
+  json_free_serialized_string(serialized);
+
+  /* copies are references, and each can go into a container */
+  const int allocated = g_failing_alloc.alloc_count;
+  g_failing_alloc.total_count = 0;
+  JSON_Value *copies[64];
+  for (int i = 0; i < 64; i++) {
+    copies[i] = json_value_deep_copy(base);
+  }
+  TEST(g_failing_alloc.total_count == 0 && copies[63] == base);
+  JSON_Value *first = json_value_init_object();
+  JSON_Value *second = json_value_init_array();
+  TEST(json_object_set_value(json_object(first), "cfg", copies[0]) ==
+       JSONSuccess);
+  TEST(json_array_append_value(json_array(second), copies[1]) ==
+       JSONSuccess);
+  TEST(json_value_get_parent(base) == nullptr);
+  TEST(json_object_get_value(json_object(first), "cfg") ==
+       json_array_get_value(json_array(second), 0));
+  TEST(json_value_equals(json_object_get_value(json_object(first), "cfg"),
+                         base));
+  json_value_free(first);
+  json_value_free(second);
+  for (int i = 2; i < 64; i++) {
+    json_value_free(copies[i]);
+  }
+  TEST(g_failing_alloc.alloc_count == allocated);
+
+  /* changes copy only the containers on their way */
+  JSON_Value *overlay = json_value_thaw(json_value_deep_copy(base));
+  JSON_Object *overlay_object = json_object(overlay);
+  TEST(overlay != nullptr && overlay != base && !json_value_is_frozen(overlay));
+  TEST(json_object_get_value(overlay_object, "tags") ==
+       json_object_get_value(base_object, "tags"));
+  TEST(json_object_dotset_number(overlay_object, "limits.mem.max", 5) ==
+       JSONSuccess);
+  TEST(json_object_dotget_number(overlay_object, "limits.mem.max") == 5);
+  TEST(json_object_dotget_number(base_object, "limits.mem.max") == 2);
+  TEST(!json_value_is_frozen(json_object_get_value(overlay_object, "limits")));
+  TEST(json_value_get_parent(json_object_get_value(overlay_object,
+                                                   "limits")) == overlay);
+  TEST(json_object_dotremove(overlay_object, "limits.cpu") == JSONSuccess);
+  TEST(json_object_dotget_value(base_object, "limits.cpu") != nullptr);
+  TEST(json_object_set_string(overlay_object, "name", "overlay") ==
+       JSONSuccess);
+  JSON_Path *pointer = json_path_compile_pointer("/list/1/x");
+  TEST(json_path_set(overlay, pointer, json_value_init_number(3)) ==
+       JSONSuccess);
+  json_path_free(pointer);
+  pointer = json_path_compile_pointer("/list/0/x");
+  TEST(json_path_remove(overlay, pointer) == JSONSuccess);
+  json_path_free(pointer);
+  TEST(json_object_get_value(overlay_object, "tags") ==
+       json_object_get_value(base_object, "tags"));
+  serialized = json_serialize_to_string(overlay);
+  TEST(STREQ(serialized, "{\"name\":\"overlay\",\"tags\":[\"a\",\"b\"],"
+                         "\"limits\":{\"mem\":{\"max\":5}},"
+                         "\"list\":[{},{\"x\":3}]}"));
+  json_free_serialized_string(serialized);
+  serialized = json_serialize_to_string(base);
+  TEST(STREQ(serialized, doc));
+  json_free_serialized_string(serialized);
+  json_value_free(overlay);
+
+  /* freezing a tree that holds a frozen one */
+  JSON_Value *outer = json_value_init_array();
+  TEST(json_array_append_value(json_array(outer), json_value_deep_copy(base)) ==
+       JSONSuccess);
+  TEST(json_array_append_number(json_array(outer), 1) == JSONSuccess);
+  TEST(json_value_freeze(outer) == JSONSuccess);
+  json_value_free(base);
+  JSON_Value *parsed = json_parse_string(doc);
+  TEST(json_value_equals(json_array_get_value(json_array(outer), 0), parsed));
+  json_value_free(parsed);
+  json_value_free(outer);
+  TEST(g_failing_alloc.alloc_count == 0);
+  json_set_allocation_functions(counted_malloc, counted_free);
+
+  /* what can't be frozen */
+  JSON_Value *scalar = json_value_init_number(1);
+  TEST(json_value_freeze(nullptr) == JSONFailure);
+  TEST(json_value_freeze(scalar) == JSONFailure);
+  json_value_free(scalar);
+  JSON_Value *parent = json_parse_string("{\"child\":{}}");
+  TEST(json_value_freeze(json_object_get_value(json_object(parent),
+                                               "child")) == JSONFailure);
+  TEST(json_value_thaw(parent) == parent);
+  json_value_free(parent);
+  JSON_Arena *arena = json_arena_new();
+  JSON_Value *in_arena = json_parse_string_with_options("[{}]", arena, 0);
+  TEST(json_value_freeze(in_arena) == JSONFailure);
+  json_arena_free(arena);
+}
+
+void test_parallel_serialization() {
+  /* one large array next to small members, so only part of it is split */
+  JSON_Value *root = json_value_init_object();
+  JSON_Object *root_object = json_object(root);
+  TEST(json_object_set_string(root_object, "kind", "log") == JSONSuccess);
+  JSON_Value *records = json_value_init_array();
+  for (int i = 0; i < 20'000; i++) {
+    JSON_Value *record = json_value_init_object();
+    JSON_Object *record_object = json_object(record);
+    json_object_set_number(record_object, "id", i);
+    json_object_set_number(record_object, "ratio", i / 7.0);
+    json_object_set_string(record_object, "text", "a/longer \"message\"");
+    json_object_dotset_boolean(record_object, "meta.seen", i % 2);
+    json_array_append_value(json_array(records), record);
+  }
+  TEST(json_object_set_value(root_object, "records", records) == JSONSuccess);
+  TEST(json_object_set_null(root_object, "next") == JSONSuccess);
+
+  const size_t threads[] = {0, 1, 3, 8};
+  for (int pretty = 0; pretty < 2; pretty++) {
+    const unsigned int flags = pretty ? JSONSerializePretty
+                                      : JSONSerializeDefault;
+    char *serial = json_serialize_to_string_ex(root, flags, nullptr);
+    for (size_t i = 0; i < sizeof(threads) / sizeof(threads[0]); i++) {
+      char *parallel =
+          json_serialize_to_string_parallel(root, flags, threads[i]);
+      TEST(parallel != nullptr && STREQ(parallel, serial));
+      json_free_serialized_string(parallel);
+    }
+    /* a top-level array is split the same way */
+    char *array_serial = json_serialize_to_string_ex(records, flags, nullptr);
+    char *array_parallel = json_serialize_to_string_parallel(records, flags, 4);
+    TEST(array_parallel != nullptr && STREQ(array_parallel, array_serial));
+    json_free_serialized_string(array_parallel);
+    json_free_serialized_string(array_serial);
+
+    /* a lazily parsed tree, copied raw or materialized first */
+    JSON_Value *lazy = json_parse_string_with_options(serial, nullptr,
+                                                      JSONParseLazy);
+    char *lazy_parallel = json_serialize_to_string_parallel(lazy, flags, 4);
+    TEST(lazy_parallel != nullptr && STREQ(lazy_parallel, serial));
+    json_free_serialized_string(lazy_parallel);
+    json_value_free(lazy);
+    json_free_serialized_string(serial);
+  }
+
+  /* every thread uses the settings of the context */
+  JSON_Context *context = json_context_new(nullptr);
+  TEST(json_context_set_float_serialization_format(context, "%.2f") ==
+       JSONSuccess);
+  json_context_set_escape_slashes(context, false);
+  char *serial = json_serialize_to_string_ex(root, JSONSerializeDefault,
+                                             context);
+  char *parallel = json_serialize_to_string_parallel_ex(
+      root, JSONSerializeDefault, 4, context);
+  TEST(parallel != nullptr && STREQ(parallel, serial));
+  TEST(strstr(parallel, "\"ratio\":0.14,") != nullptr);
+  TEST(strstr(parallel, "\"a/longer") != nullptr);
+  json_free_serialized_string_ex(parallel, context);
+  json_free_serialized_string_ex(serial, context);
+  json_context_free(context);
+
+  /* small values and nullptr */
+  JSON_Value *small = json_parse_string("[1,{\"a\":[]},\"x\"]");
+  parallel = json_serialize_to_string_parallel(small, JSONSerializePretty, 4);
+  serial = json_serialize_to_string_pretty(small);
+  TEST(parallel != nullptr && STREQ(parallel, serial));
+  json_free_serialized_string(parallel);
+  json_free_serialized_string(serial);
+  json_value_free(small);
+  TEST(json_serialize_to_string_parallel(nullptr, 0, 4) == nullptr);
+  json_value_free(root);
+}
+
+static int g_numbers_serialized = 0;
+static int count_number_serialization(double num, char *buf) {
+  char num_buf[32];
+  g_numbers_serialized++;
+  if (buf == nullptr)
+    buf = num_buf;
+  return snprintf(buf, sizeof num_buf, "%.17g", num);
+}
+
+/* Serializes value, compact and pretty, and a copy of it without kept text */
+static bool serialization_cache_matches(const JSON_Value *value,
+                                        const JSON_Context *context) {
+  JSON_Value *copy = json_value_deep_copy(value);
+  bool matches = copy != nullptr;
+  for (unsigned int flags = 0; flags < 2 && matches; flags++) {
+    char *cached = json_serialize_to_string_ex(value, flags, context);
+    char *fresh = json_serialize_to_string_ex(copy, flags, context);
+    matches = cached != nullptr && fresh != nullptr && STREQ(cached, fresh);
+    json_free_serialized_string_ex(cached, context);
+    json_free_serialized_string_ex(fresh, context);
+  }
+  json_value_free(copy);
+  return matches;
+}
+
+void test_serialization_cache() {
+  JSON_Context *context = json_context_new(nullptr);
+  json_context_set_number_serialization_function(context,
+                                                 count_number_serialization);
+  JSON_Value *state = json_value_init_object();
+  JSON_Object *state_object = json_object(state);
+  char path[64];
+  for (int i = 0; i < 40; i++) {
+    snprintf(path, sizeof path, "services.svc%d.requests", i);
+    json_object_dotset_number(state_object, path, i);
+    snprintf(path, sizeof path, "services.svc%d.latency", i);
+    json_object_dotset_number(state_object, path, i * 1.5);
+    snprintf(path, sizeof path, "services.svc%d.endpoint", i);
+    json_object_dotset_string(state_object, path,
+                              "https://example.com/services/api/v1/health");
+    snprintf(path, sizeof path, "services.svc%d.owner", i);
+    json_object_dotset_string(state_object, path,
+                              "platform-reliability-team-west");
+  }
+  JSON_Value *history = json_value_init_array();
+  for (int i = 0; i < 100; i++) {
+    json_array_append_number(json_array(history), i);
+  }
+  json_object_set_value(state_object, "history", history);
+  TEST(json_value_cache_serialization(state, true) == JSONSuccess);
+  TEST(json_value_cache_serialization(nullptr, true) == JSONFailure);
+  JSON_Value *number = json_value_init_number(1);
+  TEST(json_value_cache_serialization(number, true) == JSONFailure);
+  json_value_free(number);
+
+  /* unchanged containers are spliced, the measuring pass included */
+  for (unsigned int flags = 0; flags < 2; flags++) {
+    g_numbers_serialized = 0;
+    char *first = json_serialize_to_string_ex(state, flags, context);
+    TEST(g_numbers_serialized == 2 * 180);
+    g_numbers_serialized = 0;
+    char *second = json_serialize_to_string_ex(state, flags, context);
+    TEST(g_numbers_serialized == 0);
+    TEST(first != nullptr && second != nullptr && STREQ(first, second));
+    json_free_serialized_string_ex(first, context);
+    json_free_serialized_string_ex(second, context);
+  }
+
+  /* a change serializes only the containers on its way */
+  TEST(json_object_dotset_number(state_object, "services.svc7.requests",
+                                 1'000) == JSONSuccess);
+  g_numbers_serialized = 0;
+  char *serialized = json_serialize_to_string_ex(state, 0, context);
+  TEST(g_numbers_serialized == 2 * 2);
+  TEST(strstr(serialized, "\"svc7\":{\"requests\":1000,") != nullptr);
+  json_free_serialized_string_ex(serialized, context);
+  TEST(serialization_cache_matches(state, context));
+
+  JSON_Object *services = json_object_get_object(state_object, "services");
+  TEST(json_array_replace_number(json_array(history), 5, -5) == JSONSuccess);
+  TEST(serialization_cache_matches(state, context));
+  TEST(json_array_remove(json_array(history), 0) == JSONSuccess);
+  TEST(serialization_cache_matches(state, context));
+  TEST(json_object_remove(services, "svc3") == JSONSuccess);
+  TEST(serialization_cache_matches(state, context));
+  TEST(json_object_clear(json_object_get_object(services, "svc5")) ==
+       JSONSuccess);
+  TEST(serialization_cache_matches(state, context));
+  TEST(json_object_dotset_string(state_object, "extra.a.b", "c") ==
+       JSONSuccess);
+  TEST(serialization_cache_matches(state, context));
+  TEST(json_object_dotset_boolean(state_object, "extra.a.b", true) ==
+       JSONSuccess);
+  TEST(serialization_cache_matches(state, context));
+  TEST(json_array_clear(json_array(history)) == JSONSuccess);
+  TEST(serialization_cache_matches(state, context));
+
+  /* kept text is for the settings it was written with */
+  json_context_set_number_serialization_function(context, nullptr);
+  TEST(serialization_cache_matches(state, context));
+  json_context_set_float_serialization_format(context, "%.3f");
+  TEST(serialization_cache_matches(state, context));
+  serialized = json_serialize_to_string_ex(state, 0, context);
+  TEST(strstr(serialized, "\"latency\":1.500") != nullptr);
+  JSON_Serializer *serializer = json_serializer_new_ex(context);
+  size_t len = 0;
+  const char *reused = json_serializer_serialize(serializer, state, &len);
+  TEST(reused != nullptr && STREQ(reused, serialized));
+  TEST(json_serialization_size_ex(state, 0, context) == len + 1);
+  writer_sink sink = {.capacity = len, .calls_left = -1};
+  sink.data = (char *)malloc(sink.capacity);
+  TEST(json_serialize_to_writer_ex(state, sink_write, &sink, 0, context) ==
+       JSONSuccess);
+  TEST(sink.len == len && memcmp(sink.data, serialized, len) == 0);
+  free(sink.data);
+  json_serializer_free(serializer);
+  json_free_serialized_string_ex(serialized, context);
+
+  /* switched off, everything is serialized every time */
+  json_context_set_number_serialization_function(context,
+                                                 count_number_serialization);
+  TEST(json_value_cache_serialization(state, false) == JSONSuccess);
+  serialized = json_serialize_to_string_ex(state, 0, context);
+  g_numbers_serialized = 0;
+  char *again = json_serialize_to_string_ex(state, 0, context);
+  TEST(g_numbers_serialized > 0 && STREQ(serialized, again));
+  json_free_serialized_string_ex(serialized, context);
+  json_free_serialized_string_ex(again, context);
+  json_value_free(state);
+
+  /* opening a lazy container, or switching off one below the root, leaves no
+     stale text above it */
+  const char *doc = "{\"pad\":\"the kept text of the root needs to be long "
+                    "enough to be worth keeping, so this string pads it out "
+                    "to that\",\"c\":{\"g\":{\"x\":1}}}";
+  for (int lazy = 0; lazy < 2; lazy++) {
+    JSON_Value *root = json_parse_string_with_options(
+        doc, nullptr, lazy ? JSONParseLazy : JSONParseDefault);
+    JSON_Object *root_object = json_object(root);
+    TEST(json_value_cache_serialization(root, true) == JSONSuccess);
+    serialized = json_serialize_to_string_ex(root, 0, context);
+    TEST(STREQ(serialized, doc));
+    json_free_serialized_string_ex(serialized, context);
+    if (lazy) {
+      TEST(json_object_set_number(json_object_dotget_object(root_object, "c.g"),
+                                  "x", 2) == JSONSuccess);
+    } else {
+      TEST(json_value_cache_serialization(
+               json_object_get_value(root_object, "c"), false) == JSONSuccess);
+      TEST(json_object_dotset_number(root_object, "c.g.x", 2) == JSONSuccess);
+    }
+    serialized = json_serialize_to_string_ex(root, 0, context);
+    TEST(strstr(serialized, "\"c\":{\"g\":{\"x\":2}}") != nullptr);
+    json_free_serialized_string_ex(serialized, context);
+    TEST(serialization_cache_matches(root, context));
+    json_value_free(root);
+  }
+  json_context_free(context);
+}
+
 void print_commits_info(const char *username, const char *repo) {
   JSON_Value *root_value;
   JSON_Array *commits;
@@ -38,6 +38,15 @@ constexpr char PARSON_VERSION_STRING[] = "1.5.3";
 typedef struct json_object_t JSON_Object;
 typedef struct json_array_t JSON_Array;
 typedef struct json_value_t JSON_Value;
+typedef struct json_arena_t JSON_Arena;
+typedef struct json_serializer_t JSON_Serializer;
+typedef struct json_parser_t JSON_Parser;
+typedef struct json_path_t JSON_Path;
+typedef struct json_schema_t JSON_Schema;
+typedef struct json_key_table_t JSON_Key_Table;
+typedef struct json_context_t JSON_Context;
+typedef struct json_stream_t JSON_Stream;
+typedef struct json_stream_writer_t JSON_Stream_Writer;
 
 enum json_value_type {
   JSONError = -1,
@@ -53,6 +62,25 @@ typedef enum json_value_type JSON_Value_Type;
 enum json_result_t { JSONSuccess = 0, JSONFailure = -1 };
 typedef enum json_result_t JSON_Status;
 
+/* Options for json_parse_string_with_options, can be combined with | */
+enum json_parse_options {
+  JSONParseDefault = 0,
+  JSONParseStructuralIndex = 1 << 0,
+  JSONParseLazy = 1 << 1
+};
+
+enum json_serialize_flags {
+  JSONSerializeDefault = 0,
+  JSONSerializePretty = 1 << 0
+};
+
+/* Input layouts for json_parse_records_parallel */
+enum json_records_format {
+  JSONRecordsLines = 0, /* NDJSON: one value per line */
+  JSONRecordsArray = 1  /* a single top-level array */
+};
+typedef enum json_records_format JSON_Records_Format;
+
 enum json_boolean_result {
   JSONBooleanError = -1,
   JSONBooleanFalse = 0,
@@ -60,6 +88,12 @@ enum json_boolean_result {
 };
 typedef enum json_boolean_result JSON_Boolean;
 
+enum json_number_format_mode {
+  JSONNumberFormatPrintf = 0,  /* printf with the float format (default) */
+  JSONNumberFormatShortest = 1 /* shortest digits that round-trip */
+};
+typedef enum json_number_format_mode JSON_Number_Format_Mode;
+
 typedef void *(*JSON_Malloc_Function)(size_t);
 typedef void (*JSON_Free_Function)(void *);
 
@@ -70,11 +104,95 @@ typedef void (*JSON_Free_Function)(void *);
 */
 typedef int (*JSON_Number_Serialization_Function)(double num, char *buf);
 
+/* A function receiving serialized output (see json_serialize_to_writer). It
+   should consume all len bytes of data and return JSONSuccess, or return
+   JSONFailure to stop serialization. */
+typedef JSON_Status (*JSON_Write_Function)(void *ctx, const char *data,
+                                           size_t len);
+
+/* A function supplying input to a JSON_Stream (see json_stream_open_reader).
+   It should store up to size bytes in buf and their count in *read, which is
+   0 only at the end of the input, or return JSONFailure to end the stream. */
+typedef JSON_Status (*JSON_Read_Function)(void *ctx, char *buf, size_t size,
+                                          size_t *read);
+
+/* A function receiving the records of json_parse_records_parallel_each.
+   offset is the position of the record's first byte in the input. Returning
+   JSONFailure stops parsing. */
+typedef JSON_Status (*JSON_Record_Function)(void *ctx, size_t offset,
+                                            JSON_Value *record);
+
+/* An allocator for a JSON_Context. ctx is passed back to every call, and free
+   and realloc are told the size that was requested for ptr. realloc may be
+   null, then growing buffers are moved with malloc and free. */
+typedef struct json_allocator {
+  void *ctx;
+  void *(*malloc_fun)(void *ctx, size_t size);
+  void *(*realloc_fun)(void *ctx, void *ptr, size_t old_size, size_t new_size);
+  void (*free_fun)(void *ctx, void *ptr, size_t size);
+} JSON_Allocator;
+
+/* Returned by JSON_Handler callbacks (see json_parse_events) */
+enum json_event_result {
+  JSONEventContinue = 0,
+  JSONEventSkip = 1, /* skip a key's value or a container's contents */
+  JSONEventStop = 2  /* stop parsing */
+};
+typedef enum json_event_result JSON_Event_Result;
+
+/* Callbacks for json_parse_events, any of them may be null. ctx is the pointer
+   given to json_parse_events. Strings and names are not null-terminated and
+   are valid only during the call: they point into the input when they contain
+   no escapes and into a scratch buffer otherwise. raw is a number's text as it
+   appears in the input. */
+typedef struct json_handler {
+  JSON_Event_Result (*on_object_begin)(void *ctx);
+  JSON_Event_Result (*on_object_end)(void *ctx);
+  JSON_Event_Result (*on_array_begin)(void *ctx);
+  JSON_Event_Result (*on_array_end)(void *ctx);
+  JSON_Event_Result (*on_key)(void *ctx, const char *name, size_t len);
+  JSON_Event_Result (*on_string)(void *ctx, const char *string, size_t len);
+  JSON_Event_Result (*on_number)(void *ctx, double number, const char *raw,
+                                 size_t raw_len);
+  JSON_Event_Result (*on_boolean)(void *ctx, bool boolean);
+  JSON_Event_Result (*on_null)(void *ctx);
+} JSON_Handler;
+
+/* Counters filled in by the parse and serialize calls of a context (see
+   json_context_set_stats). Counts add up over calls until json_stats_reset,
+   maxima keep the largest value seen. clock_fun and clock_ctx are set by the
+   caller and may be null; when set, clock_fun is read when every call begins
+   and ends, in whatever unit it returns. */
+typedef struct json_stats {
+  size_t parses;
+  size_t serializations; /* serializations that wrote output, not measured */
+  size_t allocations;    /* allocator calls, including arena chunks */
+  size_t allocated_bytes;
+  size_t frees;
+  size_t values[JSONBoolean + 1]; /* values created, indexed by type */
+  size_t object_grows;  /* entry storage reallocated (and index rehashed) */
+  size_t array_resizes; /* item storage reallocated */
+  size_t max_depth;     /* deepest container nesting parsed, at most 2048 */
+  size_t max_probe_length; /* longest slot sequence probed by a name lookup */
+  size_t bytes_in;         /* input parsed */
+  size_t bytes_out;        /* output serialized */
+  uint64_t (*clock_fun)(void *ctx);
+  void *clock_ctx;
+  uint64_t begin_time; /* clock_fun at the start and end of the last call */
+  uint64_t end_time;
+  uint64_t total_time; /* sum of end_time - begin_time over all calls */
+} JSON_Stats;
+
 /* Call only once, before calling any other function from parson API. If not
    called, malloc and free from stdlib will be used for all allocations */
 void json_set_allocation_functions(JSON_Malloc_Function malloc_fun,
                                    JSON_Free_Function free_fun);
 
+/* Seeds the hash used for object names, e.g. with random bytes to resist
+   hash flooding from untrusted input. Call only once, before creating any
+   objects; existing objects are not rehashed. The default seed is 0. */
+void json_set_hash_seed(uint64_t seed);
+
 /* Sets if slashes should be escaped or not when serializing JSON. By default
  slashes are escaped. This function sets a global setting and is not thread
  safe. */
@@ -90,7 +208,52 @@ void json_set_float_serialization_format(const char *format);
 void json_set_number_serialization_function(
     JSON_Number_Serialization_Function fun);
 
-/* Parses first JSON value in a file, returns nullptr in case of error */
+/* Sets how numbers are serialized when no number serialization function is
+   set. JSONNumberFormatPrintf (the default) uses the float format, while
+   JSONNumberFormatShortest prints the fewest digits that parse back to the same
+   double (0.1 instead of 0.10000000000000001) without going through printf and
+   ignores the float format. This function sets a global setting and is not
+   thread safe. */
+void json_set_number_format_mode(JSON_Number_Format_Mode mode);
+
+/* Contexts
+   The json_set_* functions above configure the default context, which is used
+   whenever no context is given. A JSON_Context carries its own allocator and
+   serialization settings instead, so e.g. every thread can use a pool
+   allocator and number format of its own without touching global state. It
+   is passed to the *_ex variants below and must outlive everything created
+   with it. Its allocator serves arenas from json_arena_new_ex, serializers
+   from json_serializer_new_ex and the output and scratch buffers of *_ex
+   calls. Heap-allocated documents (no arena) always use the process
+   allocator, so parse into an arena to keep a document in the context's
+   allocator.
+   A context may be shared by threads once it is no longer modified. */
+/* allocator may be null to use the process allocator. New contexts start with
+   the library defaults, not with the settings made through json_set_*. */
+[[nodiscard]] JSON_Context *json_context_new(const JSON_Allocator *allocator);
+void json_context_free(JSON_Context *context);
+void json_context_set_escape_slashes(JSON_Context *context,
+                                     bool escape_slashes);
+JSON_Status json_context_set_float_serialization_format(JSON_Context *context,
+                                                        const char *format);
+void json_context_set_number_serialization_function(
+    JSON_Context *context, JSON_Number_Serialization_Function fun);
+void json_context_set_number_format_mode(JSON_Context *context,
+                                         JSON_Number_Format_Mode mode);
+
+/* Attaches stats (may be null to detach) to a context. Calls with the context
+   then update it from the calling thread, so a context with stats must not be
+   used by several threads at once. Values, lookups and allocations happening
+   during such a call are counted, whichever document they belong to.
+   Counting only takes place if parson.c is compiled with PARSON_ENABLE_STATS;
+   otherwise stats are never written and the counters cost nothing. */
+void json_context_set_stats(JSON_Context *context, JSON_Stats *stats);
+/* Clears every counter of stats, keeping clock_fun and clock_ctx. */
+void json_stats_reset(JSON_Stats *stats);
+
+/* Parses first JSON value in a file, returns nullptr in case of error. Regular
+   files are memory-mapped where supported (define PARSON_DISABLE_MMAP to
+   always read them into a buffer instead). */
 [[nodiscard]] JSON_Value *json_parse_file(const char *filename);
 
 /* Parses first JSON value in a file and ignores comments (/ * * / and //),
@@ -100,10 +263,110 @@ void json_set_number_serialization_function(
 /*  Parses first JSON value in a string, returns nullptr in case of error */
 [[nodiscard]] JSON_Value *json_parse_string(const char *string);
 
+/*  Parses first JSON value in the len bytes at buffer, which don't have to be
+    null-terminated, returns nullptr in case of error */
+[[nodiscard]] JSON_Value *json_parse_buffer(const char *buffer, size_t len);
+
+/*  Parses first JSON value in the len bytes at buffer in place: strings and
+    object names are unescaped inside buffer and the parsed value points into
+    it instead of copying them, so buffer is modified and must outlive the
+    value (and everything obtained from it). Values added later are copied as
+    usual, and json_value_free never frees borrowed memory. Returns nullptr in
+    case of error, buffer contents are unspecified afterwards. */
+[[nodiscard]] JSON_Value *json_parse_string_insitu(char *buffer, size_t len);
+
 /*  Parses first JSON value in a string and ignores comments (/ * * / and //),
     returns nullptr in case of error */
 [[nodiscard]] JSON_Value *json_parse_string_with_comments(const char *string);
 
+/* Arenas
+   An arena serves every allocation of a parsed document (values, keys, strings
+   and container storage) from large chunks, so the whole document is released
+   at once by json_arena_reset or json_arena_free instead of json_value_free.
+   json_value_free does nothing for arena-owned values. Mutators keep working on
+   arena documents: new keys, values and container storage come from the same
+   arena, and values passed to json_object_set_value, json_array_append_value
+   and similar functions are owned by the arena until they are removed.
+   Arena-owned values must not be used after the arena is reset or freed. */
+[[nodiscard]] JSON_Arena *json_arena_new();
+void json_arena_reset(JSON_Arena *arena); /* frees all documents in the arena,
+                                             but keeps memory for reuse */
+void json_arena_free(JSON_Arena *arena);
+
+/* Parses first JSON value in a string into an arena, returns nullptr in case
+   of error. If arena is null the document is heap-allocated exactly like with
+   json_parse_string. */
+[[nodiscard]] JSON_Value *json_parse_string_arena(const char *string,
+                                                  JSON_Arena *arena);
+
+/* Parses first JSON value in a string with a combination of
+   json_parse_options, optionally into an arena (see json_parse_string_arena).
+   With JSONParseStructuralIndex the input is first classified 64 bytes at a
+   time to index the start of every token, and the parser then steps from token
+   to token instead of rescanning whitespace. This pays off for large,
+   pretty-printed documents; for small inputs the default is faster. The index
+   needs up to 4 bytes of temporary memory per token.
+   With JSONParseLazy the input is copied once and only the root value is
+   parsed: each nested object or array is merely scanned for its closing
+   bracket and parsed on first access through json_value_get_object or
+   json_value_get_array (which every object and array getter goes through),
+   one level at a time. Until then it has the right type, and compact
+   serialization copies its original text verbatim, whitespace included.
+   Syntax errors inside such a container are only detected when it is
+   parsed: the getters then return nullptr, pretty-printing fails, the
+   container equals no other value and json_value_hash returns 0. Accessing a
+   lazy document modifies it, so threads must not read one concurrently.
+   Inputs of 4 GiB or more, and the structural index, fall back to a regular
+   parse. */
+[[nodiscard]] JSON_Value *json_parse_string_with_options(const char *string,
+                                                         JSON_Arena *arena,
+                                                         unsigned int options);
+
+/* Key tables
+   A key table interns object names across documents: every object parsed with
+   json_parse_string_with_key_table refers to the table's single copy of each
+   name, with its hash computed once, instead of allocating its own. Names
+   added later with json_object_set_value and friends are copied as usual.
+   Documents parsed with a table must be freed before the table, and a table
+   must not be used by two parses at once. */
+[[nodiscard]] JSON_Key_Table *json_key_table_new();
+void json_key_table_free(JSON_Key_Table *table);
+size_t json_key_table_get_count(const JSON_Key_Table *table); /* names held */
+
+/* Parses first JSON value in a string, interning object names in keys.
+   Returns nullptr in case of error. */
+[[nodiscard]] JSON_Value *
+json_parse_string_with_key_table(const char *string, JSON_Key_Table *keys);
+
+/* Push parser
+   Parses a JSON value delivered in chunks of any size, e.g. as they are read
+   from a socket, without assembling the whole input first. Tokens may be split
+   anywhere, including inside strings, escapes and numbers. json_parser_feed
+   returns JSONFailure as soon as the input can no longer be valid JSON.
+   json_parser_finish returns the parsed value (nullptr if the input was
+   invalid or incomplete) and resets the parser, so it can be reused for another
+   value. As with json_parse_string, input after the first value is ignored.
+   Comments are not supported. */
+[[nodiscard]] JSON_Parser *json_parser_new();
+JSON_Status json_parser_feed(JSON_Parser *parser, const char *data,
+                             size_t len);
+[[nodiscard]] JSON_Value *json_parser_finish(JSON_Parser *parser);
+void json_parser_free(JSON_Parser *parser);
+
+/* Event parser
+   Parses len bytes of buffer and reports the document to handler instead of
+   building values, in memory that depends only on the nesting depth, e.g. to
+   pick a few fields out of a large document or to validate one on its way
+   elsewhere. Returning JSONEventSkip from on_key skips the key's value and
+   from on_object_begin/on_array_begin skips the container's contents and end
+   callback; skipped input is only checked for balanced brackets and complete
+   strings. Other callbacks treat JSONEventSkip like JSONEventContinue.
+   JSONEventStop ends parsing with JSONSuccess without looking at the rest of
+   the input. Returns JSONFailure if the input is not valid JSON, and events
+   may already have been reported by then. */
+JSON_Status json_parse_events(const char *buffer, size_t len,
+                              const JSON_Handler *handler, void *ctx);
+
 /* Serialization */
 size_t json_serialization_size(const JSON_Value *value); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf,
@@ -122,11 +385,201 @@ JSON_Status json_serialize_to_file_pretty(const JSON_Value *value,
 [[nodiscard]] char *json_serialize_to_string_pretty(const JSON_Value *value);
 
 void json_free_serialized_string(
-    char *string); /* frees string from json_serialize_to_string and
-                      json_serialize_to_string_pretty */
+    char *string); /* frees string from json_serialize_to_string,
+                      json_serialize_to_string_pretty and the binary
+                      encodings */
+
+/* Binary encoding
+   Encodes value as a single CBOR (RFC 8949) or MessagePack item: strings are
+   length-prefixed and not escaped, integral numbers that fit an int64_t or
+   uint64_t are written as integers and other numbers as float32 when that is
+   exact, float64 otherwise. The size of the output, which is not
+   null-terminated, is stored in len if len is not null; free it with
+   json_free_serialized_string. Returns nullptr on failure, e.g. for a
+   MessagePack string or container too long for a 32-bit length, or for a
+   string or object name that is not valid UTF-8 (which the text parsers let
+   through), as neither encoding can carry one as text.
+   json_parse_cbor and json_parse_msgpack decode an item that must span all len
+   bytes of data, into arena if it is not null. Strings must be valid UTF-8 and
+   object names must be strings. CBOR tags are ignored, undefined is read as
+   null and indefinite-length arrays and maps are accepted; byte strings,
+   indefinite-length strings, other simple values, MessagePack bin and ext, and
+   infinite or NaN floats make the input invalid. Returns nullptr if it is. */
+[[nodiscard]] char *json_serialize_to_cbor(const JSON_Value *value,
+                                           size_t *len);
+[[nodiscard]] char *json_serialize_to_msgpack(const JSON_Value *value,
+                                              size_t *len);
+[[nodiscard]] JSON_Value *json_parse_cbor(const char *data, size_t len,
+                                          JSON_Arena *arena);
+[[nodiscard]] JSON_Value *json_parse_msgpack(const char *data, size_t len,
+                                             JSON_Arena *arena);
+
+/* Streaming serialization
+   Serializes value (pretty if flags contain JSONSerializePretty) and passes the
+   output to write_fun in chunks of at most 64 KiB (longer strings may be passed
+   in one piece), so memory use does not depend on document size. Output is not
+   null-terminated. On failure some output may already have been written. */
+JSON_Status json_serialize_to_writer(const JSON_Value *value,
+                                     JSON_Write_Function write_fun, void *ctx,
+                                     unsigned int flags);
+
+/* Reusable serializer
+   Serializes in a single pass into a buffer owned by the serializer, which
+   grows geometrically and is kept between calls, so serializing many values
+   reuses the same memory. Returned string is null-terminated, its length
+   (without the terminator) is stored in len if len is not null, and it stays
+   valid until the next call with the same serializer or until it is freed.
+   Returns nullptr on failure. */
+[[nodiscard]] JSON_Serializer *json_serializer_new();
+void json_serializer_free(JSON_Serializer *serializer);
+const char *json_serializer_serialize(JSON_Serializer *serializer,
+                                      const JSON_Value *value, size_t *len);
+const char *json_serializer_serialize_pretty(JSON_Serializer *serializer,
+                                             const JSON_Value *value,
+                                             size_t *len);
+
+/* NDJSON streams
+   A JSON_Stream reads newline-delimited JSON (JSON Lines): one value per
+   line, blank lines are skipped and a final newline is optional. Records are
+   parsed straight from the buffer given to json_stream_open_buffer, from a
+   memory-mapped file or from a buffer owned by the stream that is refilled by
+   a read function, so no line is copied. json_stream_open_file reads files
+   that can't be mapped (e.g. pipes) in chunks.
+   json_stream_next returns the next record, or nullptr at the end of the input
+   and for a malformed record, which json_stream_at_end tells apart; parsing
+   continues with the following line after an error. The returned value must be
+   freed with json_value_free, unless an arena was set with
+   json_stream_set_arena: the arena is then reset by every json_stream_next,
+   which releases the previous record. json_stream_record_offset and
+   json_stream_record_line (counted from 1) locate the record last returned or
+   rejected. */
+[[nodiscard]] JSON_Stream *json_stream_open_buffer(const char *buffer,
+                                                   size_t len);
+[[nodiscard]] JSON_Stream *json_stream_open_file(const char *filename);
+[[nodiscard]] JSON_Stream *json_stream_open_reader(JSON_Read_Function read_fun,
+                                                   void *ctx);
+void json_stream_set_arena(JSON_Stream *stream, JSON_Arena *arena);
+[[nodiscard]] JSON_Value *json_stream_next(JSON_Stream *stream);
+bool json_stream_at_end(const JSON_Stream *stream);
+size_t json_stream_record_offset(const JSON_Stream *stream);
+size_t json_stream_record_line(const JSON_Stream *stream);
+void json_stream_close(JSON_Stream *stream);
+
+/* A JSON_Stream_Writer appends each value, serialized compactly and followed
+   by a newline, to a buffer that is passed to write_fun (or written to the
+   file) in chunks of 64 KiB and by json_stream_writer_flush. Once a write or
+   flush has failed, all later ones fail. json_stream_writer_close flushes,
+   closes a file opened by json_stream_writer_open_file, frees the writer and
+   returns whether all output was written. */
+[[nodiscard]] JSON_Stream_Writer *
+json_stream_writer_new(JSON_Write_Function write_fun, void *ctx);
+[[nodiscard]] JSON_Stream_Writer *
+json_stream_writer_open_file(const char *filename);
+JSON_Status json_stream_write(JSON_Stream_Writer *writer,
+                              const JSON_Value *value);
+JSON_Status json_stream_writer_flush(JSON_Stream_Writer *writer);
+JSON_Status json_stream_writer_close(JSON_Stream_Writer *writer);
+
+/* Parallel parsing
+   Parses the records of an NDJSON input or the elements of a top-level array
+   on up to threads threads (0 picks one per online processor). The input is
+   split into one chunk per thread at record boundaries: NDJSON at the next
+   newline, arrays by a scan that only skips over strings and containers. Small
+   inputs use fewer threads, and a build without <threads.h> (or with
+   PARSON_DISABLE_THREADS) parses the chunks one after the other.
+   json_parse_records_parallel returns an array of the records in input order,
+   or nullptr if any record is malformed. With an arena, every thread parses
+   into an arena of its own created with the same context, which is then owned
+   by arena and released with it; the context's allocator must be safe to call
+   from several threads. Without an arena records are heap-allocated with the
+   functions from json_set_allocation_functions.
+   json_parse_records_parallel_each passes every record to record_fun instead,
+   from the parsing threads and concurrently, in input order within a chunk.
+   A record is valid only during the call (use json_value_deep_copy to keep
+   it). Records already passed stay passed if a later one is malformed or
+   record_fun fails, and the function then returns JSONFailure. */
+[[nodiscard]] JSON_Value *
+json_parse_records_parallel(const char *buffer, size_t len,
+                            JSON_Records_Format format, size_t threads,
+                            JSON_Arena *arena);
+[[nodiscard]] JSON_Value *
+json_parse_file_parallel(const char *filename, JSON_Records_Format format,
+                         size_t threads, JSON_Arena *arena);
+JSON_Status json_parse_records_parallel_each(const char *buffer, size_t len,
+                                             JSON_Records_Format format,
+                                             size_t threads,
+                                             JSON_Record_Function record_fun,
+                                             void *ctx);
+
+/* Parallel serialization
+   Serializes value like json_serialize_to_string (pretty if flags contain
+   JSONSerializePretty) on up to threads threads, 0 picking one per online
+   processor. Large arrays and objects are split into runs of members of about
+   the same estimated size, every thread serializes its runs into a buffer of
+   its own and the buffers are joined in order, so the output is the same as
+   the serial one. The tree must not change during the call, lazy values are
+   materialized first when pretty-printing. Small values are serialized on
+   the calling thread only, and a build without <threads.h> (or with
+   PARSON_DISABLE_THREADS) serializes the runs one after the other. Threads
+   other than the calling one don't update the context's stats, and the
+   context's allocator must be safe to call from several threads. Free the
+   result with json_free_serialized_string (json_free_serialized_string_ex
+   for the _ex variant). */
+[[nodiscard]] char *json_serialize_to_string_parallel(const JSON_Value *value,
+                                                      unsigned int flags,
+                                                      size_t threads);
+
+/* Context variants
+   Work like the functions above, with context (see json_context_new) in place
+   of the default context; a null context selects the default. Serialization
+   flags are json_serialize_flags. Strings from json_serialize_to_string_ex
+   must be freed with json_free_serialized_string_ex and the same context. */
+[[nodiscard]] JSON_Arena *json_arena_new_ex(const JSON_Context *context);
+[[nodiscard]] JSON_Value *json_parse_string_ex(const char *string,
+                                               JSON_Arena *arena,
+                                               unsigned int options,
+                                               const JSON_Context *context);
+[[nodiscard]] JSON_Value *json_parse_buffer_ex(const char *buffer, size_t len,
+                                               JSON_Arena *arena,
+                                               unsigned int options,
+                                               const JSON_Context *context);
+size_t json_serialization_size_ex(const JSON_Value *value, unsigned int flags,
+                                  const JSON_Context *context);
+JSON_Status json_serialize_to_buffer_ex(const JSON_Value *value, char *buf,
+                                        size_t buf_size_in_bytes,
+                                        unsigned int flags,
+                                        const JSON_Context *context);
+JSON_Status json_serialize_to_file_ex(const JSON_Value *value,
+                                      const char *filename, unsigned int flags,
+                                      const JSON_Context *context);
+[[nodiscard]] char *json_serialize_to_string_ex(const JSON_Value *value,
+                                                unsigned int flags,
+                                                const JSON_Context *context);
+[[nodiscard]] char *
+json_serialize_to_string_parallel_ex(const JSON_Value *value,
+                                     unsigned int flags, size_t threads,
+                                     const JSON_Context *context);
+void json_free_serialized_string_ex(char *string,
+                                    const JSON_Context *context);
+JSON_Status json_serialize_to_writer_ex(const JSON_Value *value,
+                                        JSON_Write_Function write_fun,
+                                        void *ctx, unsigned int flags,
+                                        const JSON_Context *context);
+[[nodiscard]] JSON_Serializer *
+json_serializer_new_ex(const JSON_Context *context);
 
 /* Comparing */
 bool json_value_equals(const JSON_Value *a, const JSON_Value *b);
+/* Hash of the structure of value, for deduplicating documents in a hash set:
+   values that json_value_equals accepts hash the same. Object members count
+   regardless of their order; numbers count only as numbers, as they are
+   compared with a tolerance. The hash of every container in value is kept
+   until the container changes, so hashing again is O(1) and json_value_equals
+   can reject containers whose kept hashes differ. Keeping them writes to
+   value, so don't hash a tree that other threads are reading. Like object
+   names, the hash depends on json_set_hash_seed. Returns 0 for nullptr and
+   for values containing lazy containers whose text fails to parse. */
+uint64_t json_value_hash(const JSON_Value *value);
 
 /* Validation
    This is *NOT* JSON Schema. It validates json by checking if object have
@@ -140,10 +593,29 @@ bool json_value_equals(const JSON_Value *a, const JSON_Value *b);
  */
 JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value);
 
+/* Compiled schemas
+   A json_validate schema flattened into nodes with hashed member names, for
+   checking many values against the same schema. The schema value can be freed
+   once compiled. Compile schemas after json_set_hash_seed. */
+[[nodiscard]] JSON_Schema *json_schema_compile(const JSON_Value *schema);
+void json_schema_free(JSON_Schema *schema);
+/* Same result as json_validate with the schema value it was compiled from. */
+JSON_Status json_schema_validate(const JSON_Schema *schema,
+                                 const JSON_Value *value);
+/* Checks len bytes of buffer with the event parser, without building values,
+   and stops at the first mismatch. Succeeds if buffer is valid JSON that
+   json_schema_validate would accept once parsed. Duplicate names are only
+   rejected when they are names in the schema. */
+JSON_Status json_schema_validate_buffer(const JSON_Schema *schema,
+                                        const char *buffer, size_t len);
+
 /*
  * JSON Object
  */
 JSON_Value *json_object_get_value(const JSON_Object *object, const char *name);
+/* Looks up a name of name_len bytes, which may contain null characters. */
+JSON_Value *json_object_get_value_with_len(const JSON_Object *object,
+                                           const char *name, size_t name_len);
 const char *json_object_get_string(const JSON_Object *object, const char *name);
 size_t json_object_get_string_len(
     const JSON_Object *object,
@@ -153,6 +625,8 @@ JSON_Object *json_object_get_object(const JSON_Object *object,
 JSON_Array *json_object_get_array(const JSON_Object *object, const char *name);
 double json_object_get_number(const JSON_Object *object,
                               const char *name); /* returns 0 on fail */
+int64_t json_object_get_int64(const JSON_Object *object,
+                              const char *name); /* returns 0 on fail */
 JSON_Boolean json_object_get_boolean(const JSON_Object *object,
                                      const char *name);
 
@@ -179,6 +653,7 @@ JSON_Boolean json_object_dotget_boolean(const JSON_Object *object,
 /* Functions to get available names */
 size_t json_object_get_count(const JSON_Object *object);
 const char *json_object_get_name(const JSON_Object *object, size_t index);
+size_t json_object_get_name_len(const JSON_Object *object, size_t index);
 JSON_Value *json_object_get_value_at(const JSON_Object *object, size_t index);
 JSON_Value *json_object_get_wrapping_value(const JSON_Object *object);
 
@@ -198,6 +673,9 @@ bool json_object_dothas_value_of_type(const JSON_Object *object,
  * afterwards. */
 JSON_Status json_object_set_value(JSON_Object *object, const char *name,
                                   JSON_Value *value);
+JSON_Status json_object_set_value_with_len(JSON_Object *object,
+                                           const char *name, size_t name_len,
+                                           JSON_Value *value);
 JSON_Status json_object_set_string(JSON_Object *object, const char *name,
                                    const char *string);
 JSON_Status json_object_set_string_with_len(
@@ -205,6 +683,8 @@ JSON_Status json_object_set_string_with_len(
     size_t len); /* length shouldn't include last null character */
 JSON_Status json_object_set_number(JSON_Object *object, const char *name,
                                    double number);
+JSON_Status json_object_set_int64(JSON_Object *object, const char *name,
+                                  int64_t number);
 JSON_Status json_object_set_boolean(JSON_Object *object, const char *name,
                                     bool boolean);
 JSON_Status json_object_set_null(JSON_Object *object, const char *name);
@@ -235,6 +715,10 @@ JSON_Status json_object_dotremove(JSON_Object *object, const char *key);
 /* Removes all name-value pairs in object */
 JSON_Status json_object_clear(JSON_Object *object);
 
+/* Makes room for capacity name-value pairs in total, so that adding up to that
+   many doesn't grow the object again. Never shrinks. */
+JSON_Status json_object_reserve(JSON_Object *object, size_t capacity);
+
 /*
  *JSON Array
  */
@@ -247,6 +731,8 @@ JSON_Object *json_array_get_object(const JSON_Array *array, size_t index);
 JSON_Array *json_array_get_array(const JSON_Array *array, size_t index);
 double json_array_get_number(const JSON_Array *array,
                              size_t index); /* returns 0 on fail */
+int64_t json_array_get_int64(const JSON_Array *array,
+                             size_t index); /* returns 0 on fail */
 JSON_Boolean json_array_get_boolean(const JSON_Array *array, size_t index);
 size_t json_array_get_count(const JSON_Array *array);
 JSON_Value *json_array_get_wrapping_value(const JSON_Array *array);
@@ -276,6 +762,10 @@ JSON_Status json_array_replace_null(JSON_Array *array, size_t i);
 /* Frees and removes all values from array */
 JSON_Status json_array_clear(JSON_Array *array);
 
+/* Makes room for capacity values in total, so that appending up to that many
+   doesn't grow the array again. Never shrinks. */
+JSON_Status json_array_reserve(JSON_Array *array, size_t capacity);
+
 /* Appends new value at the end of array.
  * json_array_append_value does not copy passed value so it shouldn't be freed
  * afterwards. */
@@ -285,14 +775,50 @@ JSON_Status json_array_append_string_with_len(
     JSON_Array *array, const char *string,
     size_t len); /* length shouldn't include last null character */
 JSON_Status json_array_append_number(JSON_Array *array, double number);
+JSON_Status json_array_append_int64(JSON_Array *array, int64_t number);
 JSON_Status json_array_append_boolean(JSON_Array *array, bool boolean);
 JSON_Status json_array_append_null(JSON_Array *array);
 
+/* Append count numbers or copies of null-terminated strings with a single
+   reservation. Either all of them are appended or, on failure, none. */
+JSON_Status json_array_append_numbers(JSON_Array *array,
+                                      const double *numbers, size_t count);
+JSON_Status json_array_append_strings(JSON_Array *array,
+                                      const char *const *strings,
+                                      size_t count);
+
+/*
+ * Compiled paths
+ * A path is split and hashed once, so repeated lookups only probe. Names are
+ * hashed with the seed in effect at compile time, so compile paths after
+ * json_set_hash_seed.
+ */
+/* Dotted path like json_object_dotget_value, e.g. "a.b.c". */
+[[nodiscard]] JSON_Path *json_path_compile(const char *path);
+/* RFC 6901 JSON Pointer, e.g. "/a/0/b~1c". Numeric segments index arrays and
+   "-" refers to the end of an array. Returns nullptr for invalid pointers. */
+[[nodiscard]] JSON_Path *json_path_compile_pointer(const char *pointer);
+void json_path_free(JSON_Path *path);
+
+/* Returns nullptr if the path doesn't exist. An empty pointer is value. */
+JSON_Value *json_path_get(const JSON_Value *value, const JSON_Path *path);
+/* Replaces or adds the value at path. Missing object members on the way are
+   created as empty objects; in arrays, an index equal to the count or "-"
+   appends. Like json_object_set_value, value is not copied and shouldn't be
+   freed afterwards unless this fails. */
+JSON_Status json_path_set(JSON_Value *root, const JSON_Path *path,
+                          JSON_Value *value);
+/* Frees and removes the value at path. */
+JSON_Status json_path_remove(JSON_Value *root, const JSON_Path *path);
+
 /*
  *JSON Value
  */
 [[nodiscard]] JSON_Value *json_value_init_object();
 [[nodiscard]] JSON_Value *json_value_init_array();
+/* Same as above, with room reserved for capacity members or values */
+[[nodiscard]] JSON_Value *json_value_init_object_with_capacity(size_t capacity);
+[[nodiscard]] JSON_Value *json_value_init_array_with_capacity(size_t capacity);
 [[nodiscard]] JSON_Value *
 json_value_init_string(const char *string); /* copies passed string */
 [[nodiscard]] JSON_Value *json_value_init_string_with_len(
@@ -300,11 +826,54 @@ json_value_init_string(const char *string); /* copies passed string */
     size_t length); /* copies passed string, length shouldn't include last null
                        character */
 [[nodiscard]] JSON_Value *json_value_init_number(double number);
+/* Exact integers: serialized with all their digits, regardless of the number
+   format, and returned unrounded by json_value_get_int64 and
+   json_value_get_uint64. Parsing keeps integers exact where a double would
+   round them, i.e. beyond 2^53 up to the range of int64_t or uint64_t. */
+[[nodiscard]] JSON_Value *json_value_init_int64(int64_t number);
+[[nodiscard]] JSON_Value *json_value_init_uint64(uint64_t number);
 [[nodiscard]] JSON_Value *json_value_init_boolean(bool boolean);
 [[nodiscard]] JSON_Value *json_value_init_null();
 [[nodiscard]] JSON_Value *json_value_deep_copy(const JSON_Value *value);
 void json_value_free(JSON_Value *value);
 
+/* Frozen values
+   json_value_freeze makes the object or array value and everything in it
+   immutable, so that it can be shared instead of copied: json_value_deep_copy
+   of a frozen object or array only counts another holder and returns value
+   itself, and json_value_free releases one holder, freeing the tree with the
+   last one. The count is atomic, so holders may be on different threads.
+   Each holder may put its reference into one container, and frozen objects
+   and arrays report no parent, as they can be in several at once. Functions
+   that would change a frozen value fail, except that json_object_dotset_*,
+   json_object_dotremove, json_path_set and json_path_remove replace the frozen
+   containers on their way with mutable copies that share the members they
+   don't change. value must have no parent and nothing in it may belong to an
+   arena. Freezing again and freezing trees that contain frozen values is
+   allowed. */
+JSON_Status json_value_freeze(JSON_Value *value);
+bool json_value_is_frozen(const JSON_Value *value);
+/* Returns a mutable copy of a frozen object or array that shares its members
+   and releases value, or value itself if it isn't frozen. Returns nullptr on
+   failure, in which case value is still held. */
+[[nodiscard]] JSON_Value *json_value_thaw(JSON_Value *value);
+
+/* Cached serialization
+   With enabled, the serialization functions keep the text of the object or
+   array value and of the containers in it, compact and pretty-printed
+   separately, and splice it in again while the container doesn't change.
+   Changing a container drops the text kept for it and for the containers
+   above it, so serializing a large tree after changing a few members only
+   serializes the containers on their way. Text is kept only for containers
+   of 128 bytes or more, only when serializing to a string or a buffer (not to
+   a writer or file), and only for the context settings it was written with.
+   It takes memory for every nesting level, and serializing a cached tree
+   writes to it, so don't serialize it from several threads at once except
+   with json_serialize_to_string_parallel, which only reuses kept text.
+   Passing false frees the kept text. Fails for values that are not objects or
+   arrays and for frozen and arena values. */
+JSON_Status json_value_cache_serialization(JSON_Value *value, bool enabled);
+
 JSON_Value_Type json_value_get_type(const JSON_Value *value);
 JSON_Object *json_value_get_object(const JSON_Value *value);
 JSON_Array *json_value_get_array(const JSON_Value *value);
@@ -312,6 +881,10 @@ const char *json_value_get_string(const JSON_Value *value);
 size_t json_value_get_string_len(
     const JSON_Value *value); /* doesn't account for last null character */
 double json_value_get_number(const JSON_Value *value);
+/* Return 0 unless value is a number with an integer value in the range of the
+   result type. */
+int64_t json_value_get_int64(const JSON_Value *value);
+uint64_t json_value_get_uint64(const JSON_Value *value);
 JSON_Boolean json_value_get_boolean(const JSON_Value *value);
 JSON_Value *json_value_get_parent(const JSON_Value *value);
 
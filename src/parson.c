@@ -27,6 +27,9 @@
 #define _CRT_SECURE_NO_WARNINGS
 #endif /* _CRT_SECURE_NO_WARNINGS */
 #endif /* _MSC_VER */
+#if !defined(_WIN32) && !defined(_DEFAULT_SOURCE)
+#define _DEFAULT_SOURCE /* posix_madvise and MAP_POPULATE */
+#endif
 
 #include "parson/parson.h"
 
@@ -35,13 +38,52 @@ static constexpr int PARSON_IMPL_VERSION_MINOR = 5;
 static constexpr int PARSON_IMPL_VERSION_PATCH = 3;
 
 #include <ctype.h>
-#include <errno.h>
+#include <float.h>
+#include <locale.h>
 #include <math.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if !defined(PARSON_DISABLE_SIMD) && (defined(__GNUC__) || defined(__clang__))
+#if defined(__x86_64__) && defined(__SSE2__)
+#define PARSON_SIMD_SSE2
+#if !defined(__AVX2__)
+#define PARSON_SIMD_AVX2_DISPATCH
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON) && !defined(__ARM_BIG_ENDIAN)
+#define PARSON_SIMD_NEON
+#include <arm_neon.h>
+#endif
+#endif
+
+#if !defined(PARSON_DISABLE_MMAP)
+#if defined(_WIN32)
+#define PARSON_MMAP_WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif defined(__unix__) || defined(__APPLE__)
+#define PARSON_MMAP_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#endif
+
+#if !defined(PARSON_DISABLE_THREADS) && !defined(__STDC_NO_THREADS__) &&      \
+    __has_include(<threads.h>)
+#define PARSON_THREADS
+#include <threads.h>
+#endif
+
 static_assert(PARSON_VERSION_MAJOR == PARSON_IMPL_VERSION_MAJOR,
               "parson version mismatch between parson.c and parson.h");
 static_assert(PARSON_VERSION_MINOR == PARSON_IMPL_VERSION_MINOR,
@@ -73,15 +115,118 @@ static constexpr char parson_indent_str[] = "    ";
 static constexpr double json_number_epsilon = 0.000'001;
 
 static constexpr size_t object_invalid_ix = SIZE_MAX;
+static constexpr size_t object_initial_capacity = 4;
+/* objects up to this size are scanned linearly instead of hashed */
+static constexpr size_t object_linear_scan_max = 8;
+static constexpr size_t object_index_max = UINT32_MAX / 2;
+
+static constexpr size_t key_table_initial_capacity = 64;
+
+static constexpr size_t path_no_index = SIZE_MAX;
+static constexpr size_t path_end_index = SIZE_MAX - 1;
+
+static constexpr size_t arena_chunk_size = 64 * 1'024;
+static constexpr size_t serializer_initial_capacity = 4 * 1'024;
+static constexpr size_t serialization_chunk_size = 64 * 1'024;
+static constexpr size_t stream_buffer_initial_capacity = 64 * 1'024;
+/* smallest chunk worth a thread of its own in json_parse_records_parallel */
+static constexpr size_t parallel_min_chunk_size = 64 * 1'024;
+static constexpr size_t parallel_max_threads = 256;
+static constexpr size_t arena_alignment = alignof(max_align_t);
+
+static constexpr uint32_t value_flag_arena = 1U << 0; /* owned by an arena */
+/* string chars borrowed from the input of json_parse_string_insitu */
+static constexpr uint32_t value_flag_borrowed = 1U << 1;
+/* container not parsed yet, value.lazy refers to its text (JSONParseLazy) */
+static constexpr uint32_t value_flag_lazy = 1U << 2;
+/* string chars stored in value.small instead of an allocation of their own */
+static constexpr uint32_t value_flag_small_string = 1U << 3;
+/* number stored exactly in value.int64, or in value.uint64 above INT64_MAX */
+static constexpr uint32_t value_flag_int64 = 1U << 4;
+static constexpr uint32_t value_flag_uint64 = 1U << 5;
+/* container whose structure_hash is up to date, see json_value_hash; the
+   containers below a hashed one are hashed too */
+static constexpr uint32_t value_flag_hashed = 1U << 6;
+/* immutable, see json_value_freeze; frozen containers are reference-counted
+   and have no parent, as they can be members of several containers */
+static constexpr uint32_t value_flag_frozen = 1U << 7;
+/* container whose serialized text is kept, with the containers below it, see
+   json_value_cache_serialization */
+static constexpr uint32_t value_flag_cache_text = 1U << 8;
+/* container not changed since it was last serialized within a cached tree, so
+   its fragments are valid; the containers below a serialized one are
+   serialized too */
+static constexpr uint32_t value_flag_serialized = 1U << 9;
+/* smaller containers are serialized again rather than kept */
+static constexpr size_t fragment_min_size = 128;
+static constexpr size_t small_string_max_len = 14;
+/* integers up to this magnitude are exact as doubles */
+static constexpr uint64_t max_exact_double_integer = 1ULL << 53;
 
 static inline size_t max_size(size_t a, size_t b) { return a > b ? a : b; }
+static inline size_t min_size(size_t a, size_t b) { return a < b ? a : b; }
+
+/* Slots of the hash index for count entries, 0 if they are scanned instead.
+   Probing masks the hash, so the slot count is a power of two, and slots are
+   at most half full. */
+static inline size_t index_slot_capacity(size_t count) {
+  size_t slots = 1;
+  if (count <= object_linear_scan_max) {
+    return 0;
+  }
+  while (slots < count * 2) {
+    slots *= 2;
+  }
+  return slots;
+}
+
+/* Whether -magnitude (if negative) or magnitude is an integer a double can't
+   hold but an int64_t or uint64_t can. */
+static inline bool integer_needs_exact(bool negative, uint64_t magnitude) {
+  return magnitude > max_exact_double_integer &&
+         (!negative || magnitude <= 1ULL << 63);
+}
+
+static inline uint64_t int64_magnitude(int64_t number) {
+  return number < 0 ? 0 - (uint64_t)number : (uint64_t)number;
+}
 
 static inline void skip_char(const char **str) { ++(*str); }
 
-static inline void skip_whitespaces(const char **str) {
-  while (isspace((unsigned char)(**str))) {
-    skip_char(str);
+static inline unsigned int trailing_zeros_u64(uint64_t bits) { /* bits != 0 */
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_ctzll(bits);
+#else
+  unsigned int count = 0;
+  for (; (bits & 1U) == 0; bits >>= 1) {
+    count++;
+  }
+  return count;
+#endif
+}
+
+static inline unsigned int leading_zeros_u64(uint64_t bits) { /* bits != 0 */
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_clzll(bits);
+#else
+  unsigned int count = 0;
+  for (; (bits & (1ULL << 63)) == 0; bits <<= 1) {
+    count++;
+  }
+  return count;
+#endif
+}
+
+static inline unsigned int popcount_u64(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+  return (unsigned int)__builtin_popcountll(bits);
+#else
+  unsigned int count = 0;
+  for (; bits != 0; bits &= bits - 1) {
+    count++;
   }
+  return count;
+#endif
 }
 
 static inline bool is_continuation_byte(unsigned char byte) {
@@ -96,15 +241,109 @@ static inline bool is_number_invalid(double value) {
 #endif
 }
 
-static JSON_Malloc_Function parson_malloc = malloc;
-static JSON_Free_Function parson_free = free;
+static JSON_Malloc_Function parson_malloc_fun = malloc;
+static JSON_Free_Function parson_free_fun = free;
+
+static uint64_t parson_hash_seed = 0;
+
+struct json_context_t {
+  JSON_Allocator allocator;
+  bool escape_slashes;
+  char *float_format; /* nullptr selects parson_default_float_format */
+  JSON_Number_Serialization_Function number_serialization_function;
+  JSON_Number_Format_Mode number_format_mode;
+  JSON_Stats *stats; /* updated by calls with this context when not null */
+  /* unique to the serialization settings above, see serialized_fragment */
+  uint64_t generation;
+};
+
+/* Source of context generations, the default context starts at 0 */
+static atomic_uint_least64_t parson_generation = 1;
+
+#if defined(PARSON_ENABLE_STATS)
+/* Stats of the call running on this thread, if its context has any */
+static thread_local JSON_Stats *parson_active_stats = nullptr;
+#endif
+
+/* Returns the stats to update, always null without PARSON_ENABLE_STATS so
+   that the counting compiles out. */
+static inline JSON_Stats *stats_active() {
+#if defined(PARSON_ENABLE_STATS)
+  return parson_active_stats;
+#else
+  return nullptr;
+#endif
+}
+
+static inline void stats_count_allocation(size_t size) {
+  JSON_Stats *stats = stats_active();
+  if (stats != nullptr) {
+    stats->allocations++;
+    stats->allocated_bytes += size;
+  }
+}
+
+static inline void stats_count_free() {
+  JSON_Stats *stats = stats_active();
+  if (stats != nullptr) {
+    stats->frees++;
+  }
+}
+
+/* Makes the stats of context (if any) the active ones until stats_end and
+   returns the stats that were active before. */
+static inline JSON_Stats *
+stats_begin([[maybe_unused]] const JSON_Context *context) {
+#if defined(PARSON_ENABLE_STATS)
+  JSON_Stats *previous = parson_active_stats;
+  if (context != nullptr && context->stats != nullptr) {
+    JSON_Stats *stats = context->stats;
+    if (stats->clock_fun != nullptr) {
+      stats->begin_time = stats->clock_fun(stats->clock_ctx);
+    }
+    parson_active_stats = stats;
+  }
+  return previous;
+#else
+  return nullptr;
+#endif
+}
+
+static inline void stats_end([[maybe_unused]] const JSON_Context *context,
+                             [[maybe_unused]] JSON_Stats *previous) {
+#if defined(PARSON_ENABLE_STATS)
+  if (context != nullptr && context->stats != nullptr) {
+    JSON_Stats *stats = context->stats;
+    if (stats->clock_fun != nullptr) {
+      stats->end_time = stats->clock_fun(stats->clock_ctx);
+      stats->total_time += stats->end_time - stats->begin_time;
+    }
+  }
+  parson_active_stats = previous;
+#endif
+}
 
-static bool parson_escape_slashes = true;
+static inline void *parson_malloc(size_t size) {
+  stats_count_allocation(size);
+  return parson_malloc_fun(size);
+}
+
+static inline void parson_free(void *memory) {
+  if (memory != nullptr) {
+    stats_count_free();
+  }
+  parson_free_fun(memory);
+}
 
-static char *parson_float_format = nullptr;
+static void *process_malloc(void *ctx, size_t size);
+static void process_free(void *ctx, void *ptr, size_t size);
 
-static JSON_Number_Serialization_Function parson_number_serialization_function =
-    nullptr;
+/* Used when no context is given, configured with json_set_* */
+static JSON_Context parson_default_context = {
+    .allocator = {.malloc_fun = process_malloc, .free_fun = process_free},
+    .escape_slashes = true,
+    .number_format_mode = JSONNumberFormatPrintf,
+};
 
 typedef struct json_string {
   char *chars;
@@ -112,68 +351,483 @@ typedef struct json_string {
 } JSON_String;
 
 /* Type definitions */
+/* Copy of the input of a JSONParseLazy parse, shared by the lazy containers
+   that refer to it. Heap sources are freed with the last of them. */
+typedef struct lazy_source {
+  JSON_Arena *arena; /* owns the source when not null */
+  size_t refs;
+  char text[];
+} lazy_source;
+
+typedef struct lazy_span {
+  lazy_source *source;
+  uint32_t offset; /* of the opening bracket in source->text */
+  uint32_t len;    /* up to and including the closing bracket */
+} lazy_span;
+
+/* A string short enough to be kept inside its value */
+typedef struct small_string {
+  char chars[small_string_max_len + 1]; /* null-terminated */
+  unsigned char length;
+} small_string;
+
 typedef union json_value_value {
   JSON_String string;
+  small_string small;
   double number;
+  int64_t int64;
+  uint64_t uint64;
   JSON_Object *object;
   JSON_Array *array;
   bool boolean;
+  lazy_span lazy;
 } JSON_Value_Value;
 
+static_assert(sizeof(small_string) <= sizeof(JSON_String),
+              "small strings must not make values larger");
+
 struct json_value_t {
   JSON_Value *parent;
   JSON_Value_Type type;
+  uint32_t flags;
   JSON_Value_Value value;
 };
 
+/* Text of a container as last serialized, compact or pretty-printed at
+   level, valid for the context settings of generation. */
+typedef struct serialized_fragment {
+  char *text;
+  size_t len;
+  size_t capacity;
+  uint64_t generation;
+  int level;
+  bool valid;
+} serialized_fragment;
+
+typedef struct object_entry {
+  uint64_t hash;
+  size_t key_len;
+  char *key;
+  JSON_Value *value;
+} object_entry;
+
 struct json_object_t {
   JSON_Value *wrapping_value;
-  size_t *cells;
-  unsigned long *hashes;
-  char **names;
-  JSON_Value **values;
-  size_t *cell_ixs;
+  JSON_Arena *arena; /* nullptr for heap-allocated objects */
+  const JSON_Key_Table *keys; /* names interned there are not freed */
+  /* names within this range are borrowed from an in-situ input */
+  const char *borrowed_start;
+  const char *borrowed_end;
+  /* A single block: capacity entries in insertion order, then
+     slot_capacity index slots (entry index + 1, 0 when empty). Small
+     objects have no slots and are scanned linearly. */
+  object_entry *entries;
   size_t count;
-  size_t item_capacity;
-  size_t cell_capacity;
+  size_t capacity;
+  size_t slot_capacity;
+  uint64_t structure_hash; /* valid while the value is value_flag_hashed */
+  atomic_size_t refs;      /* holders of a frozen object */
+  serialized_fragment *fragments; /* compact and pretty, or nullptr */
 };
 
 struct json_array_t {
   JSON_Value *wrapping_value;
+  JSON_Arena *arena; /* nullptr for heap-allocated arrays */
   JSON_Value **items;
   size_t count;
   size_t capacity;
+  uint64_t structure_hash; /* valid while the value is value_flag_hashed */
+  atomic_size_t refs;      /* holders of a frozen array */
+  serialized_fragment *fragments; /* compact and pretty, or nullptr */
+};
+
+typedef struct arena_chunk {
+  struct arena_chunk *next;
+  size_t capacity;
+  size_t used;
+  max_align_t data[];
+} arena_chunk;
+
+struct json_arena_t {
+  const JSON_Context *context; /* allocates chunks and the adopted list */
+  arena_chunk *chunks; /* chunk currently served from comes first */
+  JSON_Value **adopted; /* heap values attached to arena-owned containers */
+  size_t adopted_count;
+  size_t adopted_capacity;
+  struct json_arena_t *children; /* arenas of json_parse_records_parallel */
+  struct json_arena_t *next_sibling;
+};
+
+/* Offsets of every token start in the input (structural characters, opening
+   quotes and the first byte of literals and numbers), followed by the input
+   length as a sentinel. */
+typedef struct structural_index {
+  const JSON_Context *context;
+  uint32_t *offsets;
+  size_t count;
+  size_t capacity;
+  size_t cursor; /* first offset not yet behind the parser */
+} structural_index;
+
+typedef struct parse_context {
+  const JSON_Context *context; /* nullptr for the default context */
+  JSON_Arena *arena;
+  JSON_Key_Table *keys; /* interns object names when not null */
+  bool insitu; /* strings are decoded in place and borrowed from the input */
+  const char *start;
+  const char *end;         /* end of the input (not necessarily null) */
+  structural_index *index; /* nullptr unless JSONParseStructuralIndex */
+  lazy_source *lazy; /* nested containers are left unparsed when not null */
+} parse_context;
+
+/* Grammar state shared by the string and push parsers. Nesting is tracked on
+   an explicit stack instead of the C stack: every container is attached to
+   its parent as soon as it is opened, so freeing root releases a partial
+   document. */
+typedef enum parse_expect {
+  parse_expect_value,        /* root value or value after ':' */
+  parse_expect_value_or_end, /* after '[' or ',' in an array */
+  parse_expect_key_or_end,   /* after '{' or ',' in an object */
+  parse_expect_colon,
+  parse_expect_comma_or_end,
+  parse_expect_nothing /* root value is complete */
+} parse_expect;
+
+typedef struct parse_frame {
+  JSON_Value *container;
+  char *key; /* key waiting for its value */
+  size_t key_len;
+} parse_frame;
+
+static constexpr size_t parse_stack_inline_frames = 16;
+
+typedef struct parse_stack {
+  const JSON_Context *context; /* allocates frames beyond inline_frames */
+  JSON_Arena *arena;
+  bool insitu;
+  bool interned_keys; /* pending keys belong to a key table */
+  JSON_Value *root;
+  parse_frame *frames; /* inline_frames until the document gets deeper */
+  size_t depth;
+  size_t capacity;
+  parse_expect expect;
+  parse_frame inline_frames[parse_stack_inline_frames];
+} parse_stack;
+
+typedef enum push_lexer_state {
+  push_lexer_between, /* between tokens */
+  push_lexer_string,  /* raw bytes of an unterminated string are in token */
+  push_lexer_number,  /* bytes of a number that may continue are in token */
+  push_lexer_literal  /* part of literal has been matched */
+} push_lexer_state;
+
+/* Position in the number grammar of the last byte of a number token, so that
+   the token ends exactly where parse_number would stop. */
+typedef enum push_number_state {
+  push_number_start,         /* nothing scanned yet */
+  push_number_minus,         /* after the leading minus */
+  push_number_zero,          /* after a leading zero */
+  push_number_integer,       /* in the integer digits */
+  push_number_point,         /* after the decimal point */
+  push_number_fraction,      /* in the fraction digits */
+  push_number_exponent,      /* after 'e' or 'E' */
+  push_number_exponent_sign, /* after the sign of the exponent */
+  push_number_exponent_digits
+} push_number_state;
+
+struct json_parser_t {
+  parse_stack stack;
+  push_lexer_state lexer;
+  push_number_state number_state;
+  char *token;
+  size_t token_len;
+  size_t token_capacity;
+  const char *literal;
+  size_t literal_matched;
+  bool escape_pending; /* token ends with a backslash escaping the next byte */
+  bool started;        /* first byte (possible BOM) has been seen */
+  bool failed;
+};
+
+/* State of json_parse_events. Instead of a stack of frames only the kind of
+   every open container is kept, one bit per level (set for arrays). */
+typedef struct event_parser {
+  const JSON_Handler *handler;
+  void *ctx;
+  parse_context input; /* bounds of the input for skip_whitespaces */
+  char *scratch;       /* strings with escapes are unescaped here */
+  size_t scratch_capacity;
+  size_t depth;
+  parse_expect expect;
+  bool skip_value; /* on_key asked to skip the value after the colon */
+  uint64_t array_levels[max_nesting / 64 + 1];
+} event_parser;
+
+/* One chunk of the input of json_parse_records_parallel and the thread that
+   parses it. Records are collected in records, or passed to record_fun and
+   released by resetting arena when record_fun is not null. */
+typedef struct parallel_worker {
+  const char *buffer; /* whole input, record offsets are relative to it */
+  const char *start;
+  const char *end;
+  JSON_Records_Format format;
+  JSON_Arena *arena; /* nullptr for heap-allocated records */
+  JSON_Value **records;
+  size_t count;
+  size_t capacity;
+  JSON_Record_Function record_fun;
+  void *record_ctx;
+  atomic_bool *stop; /* set by the first worker that fails */
+  JSON_Status status;
+} parallel_worker;
+
+/* Piece of the output of json_serialize_to_string_parallel. Containers too
+   large for one piece are split into their brackets, runs of members and the
+   members around a nested container that is split in turn. */
+typedef enum serialize_task_kind {
+  serialize_task_value,   /* value at level */
+  serialize_task_open,    /* opening bracket of value */
+  serialize_task_close,   /* indentation and closing bracket of value */
+  serialize_task_members, /* members first to last - 1 of value */
+  serialize_task_head,    /* indentation and name before member first */
+  serialize_task_tail     /* separator after member first */
+} serialize_task_kind;
+
+typedef struct serialize_task {
+  serialize_task_kind kind;
+  const JSON_Value *value;
+  size_t first;
+  size_t last;
+  int level;     /* of value, its members are one level deeper */
+  size_t weight; /* estimated output size */
+} serialize_task;
+
+typedef struct serialize_plan {
+  const JSON_Context *context;
+  serialize_task *tasks;
+  size_t count;
+  size_t capacity;
+  size_t chunk; /* weight up to which a value is not split */
+  bool is_pretty;
+  bool failed;
+} serialize_plan;
+
+/* A contiguous run of tasks and the thread that serializes them, into buf
+   grown with the allocator of context. */
+typedef struct serialize_worker {
+  const JSON_Context *context;
+  const serialize_task *tasks;
+  size_t count;
+  bool is_pretty;
+  char *buf;
+  size_t capacity;
+  size_t len;
+  JSON_Status status;
+} serialize_worker;
+
+typedef enum binary_format { binary_cbor, binary_msgpack } binary_format;
+
+/* Input of json_parse_cbor and json_parse_msgpack */
+typedef struct binary_reader {
+  const unsigned char *ptr;
+  const unsigned char *end;
+  binary_format format;
+  JSON_Arena *arena;
+  size_t depth;
+} binary_reader;
+
+/* Leading bytes of a CBOR or MessagePack item with the type they decode to */
+typedef struct binary_head {
+  JSON_Value_Type type; /* JSONError for items with no JSON equivalent */
+  uint64_t len;         /* bytes of strings, elements or members */
+  bool indefinite;      /* CBOR container closed by a break byte */
+  double number;
+  bool integer; /* number is -magnitude (if negative) or magnitude */
+  bool negative;
+  uint64_t magnitude;
+  bool boolean;
+} binary_head;
+
+/* An interned name, shared by every object that uses it */
+typedef struct key_record {
+  uint64_t hash;
+  size_t len;
+  char chars[];
+} key_record;
+
+struct json_key_table_t {
+  key_record **slots;
+  size_t count;
+  size_t capacity;
+};
+
+typedef struct path_segment {
+  const char *name; /* unescaped, null-terminated copy */
+  size_t name_len;
+  uint64_t hash;
+  size_t index; /* array index, path_end_index for "-" or path_no_index */
+} path_segment;
+
+struct json_path_t {
+  size_t count;
+  path_segment segments[]; /* followed by the segment names */
+};
+
+/* Marks a value that no schema node checks */
+static constexpr size_t schema_any_op = SIZE_MAX;
+
+/* A schema node in pre-order; its subtree is ops[ix, end). An array's element
+   schema is ops[ix + 1], an object's members follow it one subtree after the
+   other. */
+typedef struct schema_op {
+  JSON_Value_Type type; /* JSONNull matches values of every type */
+  size_t count;         /* members, or 1 for an array with an element schema */
+  size_t end;
+  const char *name; /* name of the member this node checks, if any */
+  size_t name_len;
+  uint64_t hash;
+  size_t *slots; /* members + 1 by hash, like an object index, or nullptr */
+  size_t slot_capacity;
+} schema_op;
+
+struct json_schema_t {
+  size_t count;
+  size_t depth;    /* nesting of the containers that are checked */
+  schema_op ops[]; /* followed by the member slots and names */
+};
+
+/* An open container being checked against ops[op] */
+typedef struct schema_frame {
+  size_t op;
+  size_t matched; /* schema members seen so far */
+} schema_frame;
+
+/* State of json_schema_validate_buffer while it receives events */
+typedef struct schema_events {
+  const JSON_Schema *schema;
+  schema_frame *frames; /* schema->depth of them */
+  size_t depth;
+  unsigned char *seen; /* per op, whether the open object had that member */
+  size_t expect;       /* op for the next value or schema_any_op */
+  size_t skip_depth;   /* containers open inside an unchecked value */
+  bool failed;
+} schema_events;
+
+/* Read-only view of a whole file, see map_file */
+typedef struct mapped_file {
+  const char *data;
+  size_t len;
+#if defined(PARSON_MMAP_WIN32)
+  HANDLE mapping;
+#endif
+} mapped_file;
+
+struct json_stream_t {
+  const char *data; /* data[pos, len) has not been read yet */
+  size_t len;
+  size_t pos;
+  size_t scanned;  /* data[pos, pos + scanned) holds no newline */
+  size_t consumed; /* input dropped from the front of buffer so far */
+  char *buffer;    /* owned input when reading through read_fun */
+  size_t buffer_capacity;
+  JSON_Read_Function read_fun;
+  void *read_ctx;
+  bool read_done;
+  FILE *file; /* opened by json_stream_open_file, read by read_fun */
+  mapped_file mapping;
+  bool mapped;
+  JSON_Arena *arena; /* reset by every json_stream_next */
+  size_t line;       /* line number of data + pos */
+  size_t record_offset;
+  size_t record_line;
+};
+
+struct json_stream_writer_t {
+  JSON_Write_Function write_fun;
+  void *write_ctx;
+  FILE *file; /* opened by json_stream_writer_open_file */
+  char *chunk; /* serialization_chunk_size bytes, used of them pending */
+  size_t used;
+  bool failed;
 };
 
 /* Various */
-[[nodiscard]] static char *read_file(const char *filename);
+[[nodiscard]] static char *read_file(const char *filename, size_t *len);
+static JSON_Status map_file(const char *filename, bool populate,
+                            mapped_file *file);
+static void unmap_file(mapped_file *file);
 static void remove_comments(char *string, const char *start_token,
                             const char *end_token);
 [[nodiscard]] static char *parson_strndup(const char *string, size_t n);
 [[nodiscard]] static char *parson_strdup(const char *string);
+[[nodiscard]] static void *parson_calloc_in(JSON_Arena *arena, size_t count,
+                                            size_t size);
+static void parson_free_in(JSON_Arena *arena, void *memory);
+[[nodiscard]] static char *parson_strndup_in(JSON_Arena *arena,
+                                             const char *string, size_t n);
 static int parson_sprintf(char *s, size_t size, const char *format, ...);
+static const JSON_Context *context_or_default(const JSON_Context *context);
+static uint64_t context_next_generation();
+[[nodiscard]] static void *context_malloc(const JSON_Context *context,
+                                          size_t size);
+[[nodiscard]] static void *context_realloc(const JSON_Context *context,
+                                           void *memory, size_t old_size,
+                                           size_t new_size);
+static void context_free(const JSON_Context *context, void *memory,
+                         size_t size);
 
 static int hex_char_to_int(char c);
-static JSON_Status parse_utf16_hex(const char *string, unsigned int *result);
+static JSON_Status parse_utf16_hex(const char *string, const char *end,
+                                   unsigned int *result);
 static int num_bytes_in_utf8_sequence(unsigned char c);
-static JSON_Status verify_utf8_sequence(const unsigned char *string, int *len);
+static JSON_Status verify_utf8_sequence(const unsigned char *string,
+                                        const unsigned char *end, int *len);
 static bool is_valid_utf8(const char *string, size_t string_len);
-static bool is_decimal(const char *string, size_t length);
-static unsigned long hash_string(const char *string, size_t n);
+#ifndef PARSON_FORCE_HASH_COLLISIONS
+static uint64_t hash_mix(uint64_t a, uint64_t b);
+static uint64_t hash_read64(const char *p);
+static uint64_t hash_read32(const char *p);
+#endif
+static uint64_t hash_string(const char *string, size_t n);
+static uint64_t structure_mix(uint64_t hash, uint64_t bits);
+static JSON_Status json_value_hash_r(const JSON_Value *value, uint64_t *hash);
+
+/* JSON Arena */
+[[nodiscard]] static void *json_arena_alloc(JSON_Arena *arena, size_t size);
+static JSON_Status json_arena_adopt(JSON_Arena *arena, JSON_Value *value);
+static void json_arena_forget(JSON_Arena *arena, const JSON_Value *value);
 
 /* JSON Object */
-[[nodiscard]] static JSON_Object *json_object_make(JSON_Value *wrapping_value);
-static JSON_Status json_object_init(JSON_Object *object, size_t capacity);
+[[nodiscard]] static JSON_Object *json_object_make(JSON_Value *wrapping_value,
+                                                   JSON_Arena *arena);
+static uint32_t *json_object_slots(const JSON_Object *object);
+static void json_object_free_name(JSON_Object *object,
+                                  const object_entry *entry);
 static void json_object_deinit(JSON_Object *object, bool free_keys,
                                bool free_values);
-static JSON_Status json_object_grow_and_rehash(JSON_Object *object);
-static size_t json_object_get_cell_ix(const JSON_Object *object,
-                                      const char *key, size_t key_len,
-                                      unsigned long hash, bool *out_found);
+static void json_object_insert_slot(JSON_Object *object, uint64_t hash,
+                                    size_t entry_ix);
+static JSON_Status json_object_grow(JSON_Object *object);
+static JSON_Status json_object_resize(JSON_Object *object,
+                                      size_t new_capacity);
+static size_t json_object_find(const JSON_Object *object, const char *key,
+                               size_t key_len, uint64_t hash);
+static size_t json_object_find_slot(const JSON_Object *object,
+                                    size_t entry_ix);
+static JSON_Status json_object_append(JSON_Object *object, char *name,
+                                      size_t name_len, uint64_t hash,
+                                      JSON_Value *value);
 static JSON_Status json_object_add(JSON_Object *object, char *name,
-                                   JSON_Value *value);
-static JSON_Value *json_object_getn_value(const JSON_Object *object,
-                                          const char *name, size_t name_len);
+                                   size_t name_len, JSON_Value *value);
+static JSON_Status json_object_add_hashed(JSON_Object *object, char *name,
+                                          size_t name_len, uint64_t hash,
+                                          JSON_Value *value);
+static JSON_Status json_object_set_hashed(JSON_Object *object,
+                                          const char *name, size_t name_len,
+                                          uint64_t hash, JSON_Value *value);
+static void json_object_remove_slot(JSON_Object *object, size_t entry_ix);
+static void json_object_remove_at(JSON_Object *object, size_t entry_ix,
+                                  bool free_value);
 static JSON_Status json_object_remove_internal(JSON_Object *object,
                                                const char *name,
                                                bool free_value);
@@ -181,40 +835,185 @@ static JSON_Status json_object_dotremove_internal(JSON_Object *object,
                                                   const char *name,
                                                   bool free_value);
 static void json_object_free(JSON_Object *object);
+static JSON_Arena *json_object_get_arena(const JSON_Object *object);
 
 /* JSON Array */
-[[nodiscard]] static JSON_Array *json_array_make(JSON_Value *wrapping_value);
+[[nodiscard]] static JSON_Array *json_array_make(JSON_Value *wrapping_value,
+                                                 JSON_Arena *arena);
 static JSON_Status json_array_add(JSON_Array *array, JSON_Value *value);
 static JSON_Status json_array_resize(JSON_Array *array, size_t new_capacity);
 static void json_array_free(JSON_Array *array);
+static void json_array_truncate(JSON_Array *array, size_t count);
+static JSON_Arena *json_array_get_arena(const JSON_Array *array);
+
+/* Key table */
+static key_record *key_record_of(const char *chars);
+static char *json_key_table_intern(JSON_Key_Table *table, const char *name,
+                                   size_t len, uint64_t hash);
+static bool json_key_table_owns(const JSON_Key_Table *table, const char *name,
+                                uint64_t hash);
+
+/* Compiled paths */
+static size_t json_path_parse_index(const char *name, size_t name_len);
+[[nodiscard]] static JSON_Path *json_path_make(const char *path,
+                                               bool pointer);
+static JSON_Value *json_path_step(const JSON_Value *value,
+                                  const path_segment *segment);
+static JSON_Value *json_path_walk(const JSON_Value *value,
+                                  const JSON_Path *path, size_t count);
+static JSON_Value *json_path_thaw_step(JSON_Value *parent,
+                                       const path_segment *segment,
+                                       JSON_Value *child);
+
+/* Compiled schemas */
+static void json_schema_measure(const JSON_Value *schema, size_t depth,
+                                size_t *count, size_t *slots,
+                                size_t *names_len, size_t *max_depth);
+static size_t json_schema_emit(JSON_Schema *result, const JSON_Value *schema,
+                               size_t ix, size_t **slots, char **names);
+static size_t json_schema_find(const JSON_Schema *schema, size_t ix,
+                               const char *name, size_t name_len);
+static JSON_Status json_schema_check(const JSON_Schema *schema, size_t ix,
+                                     const JSON_Value *value);
+static JSON_Event_Result schema_events_value(schema_events *events,
+                                             JSON_Value_Type type,
+                                             bool container);
+static JSON_Event_Result schema_events_end(schema_events *events);
+static JSON_Event_Result schema_on_object_begin(void *ctx);
+static JSON_Event_Result schema_on_array_begin(void *ctx);
+static JSON_Event_Result schema_on_end(void *ctx);
+static JSON_Event_Result schema_on_key(void *ctx, const char *name,
+                                       size_t len);
+static JSON_Event_Result schema_on_string(void *ctx, const char *string,
+                                          size_t len);
+static JSON_Event_Result schema_on_number(void *ctx, double number,
+                                          const char *raw, size_t raw_len);
+static JSON_Event_Result schema_on_boolean(void *ctx, bool boolean);
+static JSON_Event_Result schema_on_null(void *ctx);
 
 /* JSON Value */
-[[nodiscard]] static JSON_Value *json_value_init_string_no_copy(char *string,
-                                                                size_t length);
-static const JSON_String *json_value_get_string_desc(const JSON_Value *value);
+[[nodiscard]] static JSON_Value *json_value_make(JSON_Arena *arena,
+                                                 JSON_Value_Type type);
+[[nodiscard]] static JSON_Value *json_value_init_object_in(JSON_Arena *arena);
+[[nodiscard]] static JSON_Value *json_value_init_array_in(JSON_Arena *arena);
+[[nodiscard]] static JSON_Value *
+json_value_init_string_no_copy(JSON_Arena *arena, char *string, size_t length);
+[[nodiscard]] static JSON_Value *json_value_init_string_in(JSON_Arena *arena,
+                                                           const char *string);
+[[nodiscard]] static JSON_Value *
+json_value_init_string_with_len_in(JSON_Arena *arena, const char *string,
+                                   size_t length);
+[[nodiscard]] static JSON_Value *
+json_value_init_small_string(JSON_Arena *arena, const char *string,
+                             size_t length);
+[[nodiscard]] static JSON_Value *json_value_init_number_in(JSON_Arena *arena,
+                                                           double number);
+[[nodiscard]] static JSON_Value *
+json_value_init_integer_in(JSON_Arena *arena, bool negative,
+                           uint64_t magnitude);
+[[nodiscard]] static JSON_Value *json_value_init_boolean_in(JSON_Arena *arena,
+                                                            bool boolean);
+[[nodiscard]] static JSON_Value *json_value_init_null_in(JSON_Arena *arena);
+static void json_value_free_child(JSON_Arena *arena, JSON_Value *value);
+static void json_value_forget_cached(JSON_Value *value);
+static serialized_fragment *json_value_fragments(const JSON_Value *value);
+static void json_fragments_free(serialized_fragment *fragments);
+static void json_value_set_parent(JSON_Value *value, JSON_Value *parent);
+static bool json_value_is_shared(const JSON_Value *value);
+static atomic_size_t *json_value_refs(const JSON_Value *value);
+static JSON_Status json_value_freeze_check(const JSON_Value *value);
+static void json_value_freeze_mark(JSON_Value *value);
+[[nodiscard]] static JSON_Value *
+json_value_copy_contents(const JSON_Value *value);
+[[nodiscard]] static JSON_Value *
+json_value_thaw_child(JSON_Value *parent, const char *name, size_t name_len,
+                      uint64_t hash, size_t index, JSON_Value *child);
+static JSON_String json_value_get_string_desc(const JSON_Value *value);
 
 /* Parser */
-static JSON_Status skip_quotes(const char **string);
-static JSON_Status parse_utf16(const char **unprocessed, char **processed);
+static size_t scan_string_run(const char *string, const char *end,
+                              bool stop_at_slash);
+static JSON_Status skip_quotes(const char **string, const char *end);
+static JSON_Status skip_container(const char **string, const char *end);
+static void skip_whitespaces(const char **string, const parse_context *ctx);
+static JSON_Status structural_index_build(structural_index *index,
+                                          const char *string, size_t len,
+                                          const JSON_Context *context);
+static void structural_index_free(structural_index *index);
+static JSON_Status parse_number(const char **string, const char *end,
+                                double *result);
+static JSON_Status parse_utf16(const char **unprocessed, const char *end,
+                               char **processed);
+static JSON_Status decode_string(const char *input, size_t input_len,
+                                 char *output, size_t *output_len);
 [[nodiscard]] static char *process_string(const char *input, size_t input_len,
-                                          size_t *output_len);
+                                          size_t *output_len,
+                                          JSON_Arena *arena);
 [[nodiscard]] static char *get_quoted_string(const char **string,
-                                             size_t *output_string_len);
-[[nodiscard]] static JSON_Value *parse_object_value(const char **string,
-                                                    size_t nesting);
-[[nodiscard]] static JSON_Value *parse_array_value(const char **string,
-                                                   size_t nesting);
-[[nodiscard]] static JSON_Value *parse_string_value(const char **string);
-[[nodiscard]] static JSON_Value *parse_boolean_value(const char **string);
-[[nodiscard]] static JSON_Value *parse_number_value(const char **string);
-[[nodiscard]] static JSON_Value *parse_null_value(const char **string);
+                                             size_t *output_string_len,
+                                             const parse_context *ctx);
+[[nodiscard]] static char *get_interned_key(const char **string, size_t *len,
+                                            const parse_context *ctx);
+static void parse_stack_init(parse_stack *stack, JSON_Arena *arena,
+                             bool insitu, const JSON_Context *context);
+static void parse_stack_reset(parse_stack *stack);
+static void parse_stack_free(parse_stack *stack);
+[[nodiscard]] static JSON_Value *parse_stack_release(parse_stack *stack);
+static JSON_Status parse_stack_add(parse_stack *stack, JSON_Value *value);
+static JSON_Status parse_stack_string(parse_stack *stack, char *string,
+                                      size_t len);
+static JSON_Status parse_stack_close(parse_stack *stack, JSON_Value_Type type);
+static JSON_Status parse_stack_colon(parse_stack *stack);
+static JSON_Status parse_stack_comma(parse_stack *stack);
+[[nodiscard]] static JSON_Value *parse_boolean_value(const char **string,
+                                                     const parse_context *ctx);
+static bool parse_integer(const char *start, const char *end,
+                          uint64_t *magnitude);
+[[nodiscard]] static JSON_Value *
+parse_number_result(JSON_Arena *arena, const char *start, const char *end,
+                    double number);
+[[nodiscard]] static JSON_Value *parse_number_value(const char **string,
+                                                    const parse_context *ctx);
+static bool parse_small_string(const char **string, const parse_context *ctx,
+                               JSON_Value **value);
+[[nodiscard]] static JSON_Value *parse_null_value(const char **string,
+                                                  const parse_context *ctx);
 [[nodiscard]] static JSON_Value *parse_value(const char **string,
-                                             size_t nesting);
+                                             const parse_context *ctx);
+[[nodiscard]] static lazy_source *lazy_source_new(JSON_Arena *arena,
+                                                  const char *text, size_t len);
+static void lazy_source_release(lazy_source *source);
+[[nodiscard]] static JSON_Value *parse_lazy_container(const char **string,
+                                                      const parse_context *ctx);
+static JSON_Status json_value_materialize(JSON_Value *value);
+[[nodiscard]] static JSON_Value *binary_parse_value(binary_reader *reader);
 
 /* Serialization */
-static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf,
-                                      int level, bool is_pretty, char *num_buf);
-static int json_serialize_string(const char *string, size_t len, char *buf);
+typedef struct serialization_buffer serialization_buffer;
+static JSON_Status json_serialize_to_buffer_r(const JSON_Value *value,
+                                              serialization_buffer *out,
+                                              int level, bool is_pretty,
+                                              char *num_buf);
+static JSON_Status json_serialize_plain_r(const JSON_Value *value,
+                                          serialization_buffer *out,
+                                          int level, bool is_pretty,
+                                          char *num_buf);
+static JSON_Status json_serialize_cached(const JSON_Value *value,
+                                         serialization_buffer *out, int level,
+                                         bool is_pretty, char *num_buf);
+static void json_value_keep_fragment(JSON_Value *value, bool is_pretty,
+                                     int level, const char *text, size_t len,
+                                     uint64_t generation);
+static void json_value_drop_fragments(JSON_Value *value);
+static void json_serialize_string(const char *string, size_t len,
+                                  serialization_buffer *out);
+static int json_serialize_number_shortest(double num, char *buf);
+static int json_serialize_integer(const JSON_Value *value, char *buf);
+
+/* Streams */
+static JSON_Status read_from_file(void *ctx, char *buf, size_t size,
+                                  size_t *read);
+static JSON_Status json_stream_fill(JSON_Stream *stream);
 
 /* Various */
 [[nodiscard]] static void *parson_calloc(size_t count, size_t size) {
@@ -230,7 +1029,34 @@ static int json_serialize_string(const char *string, size_t len, char *buf);
   return memory;
 }
 
-[[nodiscard]] static char *read_file(const char *filename) {
+/* Allocates from the arena if there is one and from the heap otherwise. */
+[[nodiscard]] static void *parson_calloc_in(JSON_Arena *arena, size_t count,
+                                            size_t size) {
+  if (arena == nullptr) {
+    return parson_calloc(count, size);
+  }
+  if (count != 0U && size > SIZE_MAX / count) {
+    return nullptr;
+  }
+  const size_t total_size = count * size;
+  auto memory = json_arena_alloc(arena, total_size);
+  if (memory == nullptr) {
+    return nullptr;
+  }
+  memset(memory, 0, total_size);
+  return memory;
+}
+
+/* Arena memory is released only by json_arena_reset/json_arena_free. */
+static void parson_free_in(JSON_Arena *arena, void *memory) {
+  if (arena == nullptr) {
+    parson_free(memory);
+  }
+}
+
+/* Reads a whole file and null-terminates it; len, when not null, receives the
+   number of bytes read, as the file may contain null bytes itself. */
+[[nodiscard]] static char *read_file(const char *filename, size_t *len) {
   auto fp = fopen(filename, "r");
   size_t size_to_read = 0;
   size_t size_read = 0;
@@ -254,22 +1080,110 @@ static int json_serialize_string(const char *string, size_t len, char *buf);
     return nullptr;
   }
   rewind(fp);
-  file_contents = (char *)parson_calloc(size_to_read + 1, sizeof(char));
+  /* every byte up to size_read is overwritten, no need to zero it first */
+  file_contents = (char *)parson_malloc(size_to_read + 1);
   if (file_contents == nullptr) {
     fclose(fp);
     return nullptr;
   }
   size_read = fread(file_contents, 1, size_to_read, fp);
-  if (size_read == 0 || ferror(fp)) {
+  if ((size_read == 0 && size_to_read > 0) || ferror(fp)) {
     fclose(fp);
     parson_free(file_contents);
     return nullptr;
   }
   fclose(fp);
   file_contents[size_read] = '\0';
+  if (len != nullptr) {
+    *len = size_read;
+  }
   return file_contents;
 }
 
+/* Maps a regular, non-empty file into memory for reading. With populate pages
+   are requested up front, so parsing does not stall on page faults; they are
+   read sequentially either way and the file is never copied. The view is not
+   null-terminated. */
+static JSON_Status map_file(const char *filename, bool populate,
+                            mapped_file *file) {
+  *file = (mapped_file){0};
+#if defined(PARSON_MMAP_POSIX)
+  const int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0) {
+    return JSONFailure;
+  }
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0 ||
+      (uintmax_t)st.st_size > SIZE_MAX) {
+    close(fd);
+    return JSONFailure;
+  }
+  int flags = MAP_PRIVATE;
+#if defined(MAP_POPULATE)
+  if (populate) {
+    flags |= MAP_POPULATE;
+  }
+#else
+  (void)populate;
+#endif
+  void *data = mmap(nullptr, (size_t)st.st_size, PROT_READ, flags, fd, 0);
+  close(fd); /* the mapping keeps the file open */
+  if (data == MAP_FAILED) {
+    return JSONFailure;
+  }
+#if defined(POSIX_MADV_SEQUENTIAL)
+  posix_madvise(data, (size_t)st.st_size, POSIX_MADV_SEQUENTIAL);
+#endif
+  file->data = (const char *)data;
+  file->len = (size_t)st.st_size;
+  return JSONSuccess;
+#elif defined(PARSON_MMAP_WIN32)
+  (void)populate; /* views are faulted in on access */
+  LARGE_INTEGER size;
+  HANDLE handle =
+      CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                  OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+  if (handle == INVALID_HANDLE_VALUE) {
+    return JSONFailure;
+  }
+  if (!GetFileSizeEx(handle, &size) || size.QuadPart <= 0 ||
+      (unsigned long long)size.QuadPart > SIZE_MAX) {
+    CloseHandle(handle);
+    return JSONFailure;
+  }
+  HANDLE mapping =
+      CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  CloseHandle(handle); /* the mapping keeps the file open */
+  if (mapping == nullptr) {
+    return JSONFailure;
+  }
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    return JSONFailure;
+  }
+  file->data = (const char *)data;
+  file->len = (size_t)size.QuadPart;
+  file->mapping = mapping;
+  return JSONSuccess;
+#else
+  (void)filename;
+  (void)populate;
+  return JSONFailure;
+#endif
+}
+
+static void unmap_file(mapped_file *file) {
+#if defined(PARSON_MMAP_POSIX)
+  munmap((void *)file->data, file->len);
+#elif defined(PARSON_MMAP_WIN32)
+  UnmapViewOfFile(file->data);
+  CloseHandle(file->mapping);
+#else
+  (void)file;
+#endif
+}
+
 static void remove_comments(char *string, const char *start_token,
                             const char *end_token) {
   bool in_string = false, escaped = false;
@@ -323,6 +1237,17 @@ static void remove_comments(char *string, const char *start_token,
   return parson_strndup(string, strlen(string));
 }
 
+[[nodiscard]] static char *parson_strndup_in(JSON_Arena *arena,
+                                             const char *string, size_t n) {
+  auto output_string = (char *)parson_calloc_in(arena, n + 1, sizeof(char));
+  if (output_string == nullptr) {
+    return nullptr;
+  }
+  memcpy(output_string, string, n);
+  output_string[n] = '\0';
+  return output_string;
+}
+
 static int parson_sprintf(char *s, size_t size, const char *format, ...) {
   va_list args;
   va_start(args, format);
@@ -331,6 +1256,62 @@ static int parson_sprintf(char *s, size_t size, const char *format, ...) {
   return result;
 }
 
+/* context_malloc and context_free count the calls, so these don't */
+static void *process_malloc(void *ctx, size_t size) {
+  (void)ctx;
+  return parson_malloc_fun(size);
+}
+
+static void process_free(void *ctx, void *ptr, size_t size) {
+  (void)ctx;
+  (void)size;
+  parson_free_fun(ptr);
+}
+
+static const JSON_Context *context_or_default(const JSON_Context *context) {
+  return context != nullptr ? context : &parson_default_context;
+}
+
+/* Called whenever serialization settings change, so that text serialized with
+   the old ones isn't reused */
+static uint64_t context_next_generation() {
+  return atomic_fetch_add_explicit(&parson_generation, 1, memory_order_relaxed);
+}
+
+[[nodiscard]] static void *context_malloc(const JSON_Context *context,
+                                          size_t size) {
+  stats_count_allocation(size);
+  return context->allocator.malloc_fun(context->allocator.ctx, size);
+}
+
+/* Moves memory (old_size bytes, may be null) to a block of new_size bytes. */
+[[nodiscard]] static void *context_realloc(const JSON_Context *context,
+                                           void *memory, size_t old_size,
+                                           size_t new_size) {
+  if (memory != nullptr && context->allocator.realloc_fun != nullptr) {
+    stats_count_allocation(new_size);
+    return context->allocator.realloc_fun(context->allocator.ctx, memory,
+                                          old_size, new_size);
+  }
+  void *new_memory = context_malloc(context, new_size);
+  if (new_memory == nullptr) {
+    return nullptr;
+  }
+  if (memory != nullptr) {
+    memcpy(new_memory, memory, old_size < new_size ? old_size : new_size);
+    context_free(context, memory, old_size);
+  }
+  return new_memory;
+}
+
+static void context_free(const JSON_Context *context, void *memory,
+                         size_t size) {
+  if (memory != nullptr) {
+    stats_count_free();
+    context->allocator.free_fun(context->allocator.ctx, memory, size);
+  }
+}
+
 static int hex_char_to_int(char c) {
   if (c >= '0' && c <= '9') {
     return c - '0';
@@ -342,9 +1323,10 @@ static int hex_char_to_int(char c) {
   return -1;
 }
 
-static JSON_Status parse_utf16_hex(const char *s, unsigned int *result) {
+static JSON_Status parse_utf16_hex(const char *s, const char *end,
+                                   unsigned int *result) {
   int x1, x2, x3, x4;
-  if (s[0] == '\0' || s[1] == '\0' || s[2] == '\0' || s[3] == '\0') {
+  if (end - s < 4) {
     return JSONFailure;
   }
   x1 = hex_char_to_int(s[0]);
@@ -373,11 +1355,16 @@ static int num_bytes_in_utf8_sequence(unsigned char c) {
   return 0; /* won't happen */
 }
 
-static JSON_Status verify_utf8_sequence(const unsigned char *string, int *len) {
+/* string is not null-terminated when decoding CBOR or MessagePack, so no byte
+   at or after end is read */
+static JSON_Status verify_utf8_sequence(const unsigned char *string,
+                                        const unsigned char *end, int *len) {
   unsigned int cp = 0;
   *len = num_bytes_in_utf8_sequence(string[0]);
 
-  if (*len == 1) {
+  if (*len > end - string) {
+    return JSONFailure; /* truncated sequence */
+  } else if (*len == 1) {
     cp = string[0];
   } else if (*len == 2 && is_continuation_byte(string[1])) {
     cp = string[0] & 0x1F;
@@ -421,8 +1408,9 @@ static bool is_valid_utf8(const char *string, size_t string_len) {
   int len = 0;
   const char *string_end = string + string_len;
   while (string < string_end) {
-    if (verify_utf8_sequence((const unsigned char *)string, &len) !=
-        JSONSuccess) {
+    if (verify_utf8_sequence((const unsigned char *)string,
+                             (const unsigned char *)string_end,
+                             &len) != JSONSuccess) {
       return false;
     }
     string += len;
@@ -430,100 +1418,194 @@ static bool is_valid_utf8(const char *string, size_t string_len) {
   return true;
 }
 
-static bool is_decimal(const char *string, size_t length) {
-  if (length > 1 && string[0] == '0' && string[1] != '.') {
-    return false;
-  }
-  if (length > 2 && !strncmp(string, "-0", 2) && string[2] != '.') {
-    return false;
-  }
-  while (length--) {
-    if (strchr("xX", string[length])) {
-      return false;
-    }
-  }
-  return true;
+#ifndef PARSON_FORCE_HASH_COLLISIONS
+static constexpr uint64_t hash_secret[] = {0xa076'1d64'78bd'642f,
+                                           0xe703'7ed1'a0b4'28db};
+
+/* 64x64 -> 128 bit multiply with the halves folded together. */
+static uint64_t hash_mix(uint64_t a, uint64_t b) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 hash_u128;
+  const hash_u128 product = (hash_u128)a * b;
+  return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+  const uint64_t a_hi = a >> 32, a_lo = (uint32_t)a;
+  const uint64_t b_hi = b >> 32, b_lo = (uint32_t)b;
+  const uint64_t mid_a = a_hi * b_lo, mid_b = b_hi * a_lo;
+  const uint64_t lo_part = a_lo * b_lo;
+  const uint64_t t = lo_part + (mid_a << 32);
+  const uint64_t lo = t + (mid_b << 32);
+  const uint64_t carry = (uint64_t)(t < lo_part) + (uint64_t)(lo < t);
+  const uint64_t hi = a_hi * b_hi + (mid_a >> 32) + (mid_b >> 32) + carry;
+  return lo ^ hi;
+#endif
+}
+
+static uint64_t hash_read64(const char *p) {
+  uint64_t v = 0;
+  memcpy(&v, p, sizeof(v));
+  return v;
+}
+
+static uint64_t hash_read32(const char *p) {
+  uint32_t v = 0;
+  memcpy(&v, p, sizeof(v));
+  return v;
 }
+#endif
 
-static unsigned long hash_string(const char *string, size_t n) {
+/* wyhash-style: keys are consumed 16 bytes per multiply, and short keys
+   with a few overlapping loads and no loop. */
+static uint64_t hash_string(const char *string, size_t n) {
 #ifdef PARSON_FORCE_HASH_COLLISIONS
   (void)string;
   (void)n;
   return 0;
 #else
-  unsigned long hash = 5381;
-  unsigned char c;
-  size_t i = 0;
-  for (i = 0; i < n; i++) {
-    c = string[i];
-    if (c == '\0') {
-      break;
+  const char *p = string;
+  uint64_t seed =
+      parson_hash_seed ^ hash_mix(parson_hash_seed ^ hash_secret[0],
+                                  hash_secret[1]);
+  uint64_t a = 0;
+  uint64_t b = 0;
+  size_t i = n;
+  if (n <= 16) {
+    if (n >= 4) {
+      const size_t shift = (n >> 3) << 2;
+      a = (hash_read32(p) << 32) | hash_read32(p + shift);
+      b = (hash_read32(p + n - 4) << 32) | hash_read32(p + n - 4 - shift);
+    } else if (n > 0) {
+      a = ((uint64_t)(unsigned char)p[0] << 16) |
+          ((uint64_t)(unsigned char)p[n >> 1] << 8) |
+          (uint64_t)(unsigned char)p[n - 1];
+    }
+  } else {
+    while (i > 16) {
+      seed = hash_mix(hash_read64(p) ^ hash_secret[1],
+                      hash_read64(p + 8) ^ seed);
+      p += 16;
+      i -= 16;
     }
-    hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+    a = hash_read64(p + i - 16);
+    b = hash_read64(p + i - 8);
   }
-  return hash;
+  return hash_mix(hash_mix(a ^ hash_secret[1], b ^ seed) ^ hash_secret[0] ^ n,
+                  hash_secret[1]);
 #endif
 }
 
-/* JSON Object */
-[[nodiscard]] static JSON_Object *json_object_make(JSON_Value *wrapping_value) {
-  JSON_Status res = JSONFailure;
-  auto new_obj = (JSON_Object *)parson_calloc(1, sizeof(JSON_Object));
-  if (new_obj == nullptr) {
+/* Combines bits into hash; the order of calls matters. splitmix64's
+   finalizer, which unlike hash_mix is available with
+   PARSON_FORCE_HASH_COLLISIONS too. */
+static uint64_t structure_mix(uint64_t hash, uint64_t bits) {
+  uint64_t z = hash + bits + 0x9e37'79b9'7f4a'7c15;
+  z = (z ^ (z >> 30)) * 0xbf58'476d'1ce4'e5b9;
+  z = (z ^ (z >> 27)) * 0x94d0'49bb'1331'11eb;
+  return z ^ (z >> 31);
+}
+
+/* JSON Arena */
+[[nodiscard]] static void *json_arena_alloc(JSON_Arena *arena, size_t size) {
+  arena_chunk *chunk = arena->chunks;
+  if (size > SIZE_MAX - arena_alignment) {
     return nullptr;
   }
-  new_obj->wrapping_value = wrapping_value;
-  res = json_object_init(new_obj, 0);
-  if (res != JSONSuccess) {
-    parson_free(new_obj);
-    return nullptr;
+  size = (size + arena_alignment - 1) & ~(arena_alignment - 1);
+  if (chunk == nullptr || chunk->capacity - chunk->used < size) {
+    const size_t capacity = max_size(arena_chunk_size, size);
+    if (capacity > SIZE_MAX - sizeof(arena_chunk)) {
+      return nullptr;
+    }
+    chunk = (arena_chunk *)context_malloc(arena->context,
+                                          sizeof(arena_chunk) + capacity);
+    if (chunk == nullptr) {
+      return nullptr;
+    }
+    chunk->capacity = capacity;
+    chunk->used = 0;
+    if (capacity > arena_chunk_size && arena->chunks != nullptr) {
+      /* Oversized requests get a chunk of their own, so the partially used
+         current chunk keeps serving small allocations. */
+      chunk->next = arena->chunks->next;
+      arena->chunks->next = chunk;
+    } else {
+      chunk->next = arena->chunks;
+      arena->chunks = chunk;
+    }
   }
-  return new_obj;
+  void *memory = (unsigned char *)chunk->data + chunk->used;
+  chunk->used += size;
+  return memory;
 }
 
-static JSON_Status json_object_init(JSON_Object *object, size_t capacity) {
-  size_t i = 0;
-
-  object->cells = nullptr;
-  object->names = nullptr;
-  object->values = nullptr;
-  object->cell_ixs = nullptr;
-  object->hashes = nullptr;
+static JSON_Status json_arena_adopt(JSON_Arena *arena, JSON_Value *value) {
+  if (arena == nullptr || (value->flags & value_flag_arena) != 0U) {
+    return JSONSuccess;
+  }
+  if (arena->adopted_count >= arena->adopted_capacity) {
+    const size_t new_capacity =
+        max_size(arena->adopted_capacity * 2, starting_capacity);
+    if (new_capacity > SIZE_MAX / sizeof(JSON_Value *)) {
+      return JSONFailure;
+    }
+    auto new_adopted = (JSON_Value **)context_realloc(
+        arena->context, arena->adopted,
+        arena->adopted_capacity * sizeof(JSON_Value *),
+        new_capacity * sizeof(JSON_Value *));
+    if (new_adopted == nullptr) {
+      return JSONFailure;
+    }
+    arena->adopted = new_adopted;
+    arena->adopted_capacity = new_capacity;
+  }
+  arena->adopted[arena->adopted_count] = value;
+  arena->adopted_count++;
+  return JSONSuccess;
+}
 
-  object->count = 0;
-  object->cell_capacity = capacity;
-  object->item_capacity = (capacity * 7U) / 10U;
+static void json_arena_forget(JSON_Arena *arena, const JSON_Value *value) {
+  if (arena == nullptr || (value->flags & value_flag_arena) != 0U) {
+    return;
+  }
+  /* Recently attached values are the most likely to be removed again. */
+  for (size_t i = arena->adopted_count; i > 0; i--) {
+    if (arena->adopted[i - 1] == value) {
+      arena->adopted[i - 1] = arena->adopted[arena->adopted_count - 1];
+      arena->adopted_count--;
+      return;
+    }
+  }
+}
 
-  if (capacity == 0) {
-    return JSONSuccess;
+/* JSON Object */
+[[nodiscard]] static JSON_Object *json_object_make(JSON_Value *wrapping_value,
+                                                   JSON_Arena *arena) {
+  auto new_obj =
+      (JSON_Object *)parson_calloc_in(arena, 1, sizeof(JSON_Object));
+  if (new_obj == nullptr) {
+    return nullptr;
   }
+  new_obj->wrapping_value = wrapping_value;
+  new_obj->arena = arena;
+  return new_obj;
+}
 
-  object->cells =
-      (size_t *)parson_calloc(object->cell_capacity, sizeof(*object->cells));
-  object->names =
-      (char **)parson_calloc(object->item_capacity, sizeof(*object->names));
-  object->values = (JSON_Value **)parson_calloc(object->item_capacity,
-                                                sizeof(*object->values));
-  object->cell_ixs =
-      (size_t *)parson_calloc(object->item_capacity, sizeof(*object->cell_ixs));
-  object->hashes = (unsigned long *)parson_calloc(object->item_capacity,
-                                                  sizeof(*object->hashes));
-  if (object->cells == nullptr || object->names == nullptr ||
-      object->values == nullptr || object->cell_ixs == nullptr ||
-      object->hashes == nullptr) {
-    goto error;
+static uint32_t *json_object_slots(const JSON_Object *object) {
+  return (uint32_t *)(object->entries + object->capacity);
+}
+
+static void json_object_free_name(JSON_Object *object,
+                                  const object_entry *entry) {
+  const uintptr_t address = (uintptr_t)entry->key;
+  if (address >= (uintptr_t)object->borrowed_start &&
+      address < (uintptr_t)object->borrowed_end) {
+    return; /* points into an in-situ input */
   }
-  for (i = 0; i < object->cell_capacity; i++) {
-    object->cells[i] = object_invalid_ix;
+  if (object->keys != nullptr &&
+      json_key_table_owns(object->keys, entry->key, entry->hash)) {
+    return;
   }
-  return JSONSuccess;
-error:
-  parson_free(object->cells);
-  parson_free(object->names);
-  parson_free(object->values);
-  parson_free(object->cell_ixs);
-  parson_free(object->hashes);
-  return JSONFailure;
+  parson_free_in(object->arena, entry->key);
 }
 
 static void json_object_deinit(JSON_Object *object, bool free_keys,
@@ -531,208 +1613,242 @@ static void json_object_deinit(JSON_Object *object, bool free_keys,
   size_t i = 0;
   for (i = 0; i < object->count; i++) {
     if (free_keys) {
-      parson_free(object->names[i]);
+      json_object_free_name(object, &object->entries[i]);
     }
     if (free_values) {
-      json_value_free(object->values[i]);
+      json_value_free(object->entries[i].value);
     }
   }
-
+  parson_free_in(object->arena, object->entries);
+  object->entries = nullptr;
   object->count = 0;
-  object->item_capacity = 0;
-  object->cell_capacity = 0;
-
-  parson_free(object->cells);
-  parson_free(object->names);
-  parson_free(object->values);
-  parson_free(object->cell_ixs);
-  parson_free(object->hashes);
-
-  object->cells = nullptr;
-  object->names = nullptr;
-  object->values = nullptr;
-  object->cell_ixs = nullptr;
-  object->hashes = nullptr;
-}
-
-static JSON_Status json_object_grow_and_rehash(JSON_Object *object) {
-  JSON_Value *wrapping_value = nullptr;
-  JSON_Object new_object;
-  char *key = nullptr;
-  JSON_Value *value = nullptr;
-  size_t i = 0;
-  size_t new_capacity = max_size(object->cell_capacity * 2, starting_capacity);
-  JSON_Status res = json_object_init(&new_object, new_capacity);
-  if (res != JSONSuccess) {
-    return JSONFailure;
+  object->capacity = 0;
+  object->slot_capacity = 0;
+}
+
+static void json_object_insert_slot(JSON_Object *object, uint64_t hash,
+                                    size_t entry_ix) {
+  uint32_t *slots = json_object_slots(object);
+  size_t mask = object->slot_capacity - 1;
+  size_t ix = hash & mask;
+  while (slots[ix] != 0) {
+    ix = (ix + 1) & mask;
   }
+  slots[ix] = (uint32_t)(entry_ix + 1);
+}
 
-  wrapping_value = json_object_get_wrapping_value(object);
-  new_object.wrapping_value = wrapping_value;
+static JSON_Status json_object_grow(JSON_Object *object) {
+  return json_object_resize(
+      object, max_size(object->capacity * 2, object_initial_capacity));
+}
 
-  for (i = 0; i < object->count; i++) {
-    key = object->names[i];
-    value = object->values[i];
-    res = json_object_add(&new_object, key, value);
-    if (res != JSONSuccess) {
-      json_object_deinit(&new_object, false, false);
-      return JSONFailure;
+/* Moves the entries to room for new_capacity ones, which must be at least the
+   count, and rebuilds the index. */
+static JSON_Status json_object_resize(JSON_Object *object,
+                                      size_t new_capacity) {
+  size_t new_slot_capacity = 0;
+  size_t entries_size = 0;
+  size_t i = 0;
+  object_entry *old_entries = object->entries;
+
+  if (new_capacity > object_index_max) {
+    return JSONFailure;
+  }
+  new_slot_capacity = index_slot_capacity(new_capacity);
+  entries_size = new_capacity * sizeof(object_entry);
+  auto new_entries = (object_entry *)parson_calloc_in(
+      object->arena, 1, entries_size + new_slot_capacity * sizeof(uint32_t));
+  if (new_entries == nullptr) {
+    return JSONFailure;
+  }
+  if (object->count > 0) {
+    memcpy(new_entries, old_entries, object->count * sizeof(object_entry));
+  }
+  parson_free_in(object->arena, old_entries);
+  object->entries = new_entries;
+  object->capacity = new_capacity;
+  object->slot_capacity = new_slot_capacity;
+  JSON_Stats *stats = stats_active();
+  if (stats != nullptr) {
+    stats->object_grows++;
+  }
+  if (new_slot_capacity > 0) {
+    for (i = 0; i < object->count; i++) {
+      json_object_insert_slot(object, object->entries[i].hash, i);
     }
-    value->parent = wrapping_value;
   }
-  json_object_deinit(object, false, false);
-  *object = new_object;
   return JSONSuccess;
 }
 
-static size_t json_object_get_cell_ix(const JSON_Object *object,
-                                      const char *key, size_t key_len,
-                                      unsigned long hash, bool *out_found) {
-  size_t cell_ix = hash & (object->cell_capacity - 1);
-  size_t cell = 0;
+static size_t json_object_find(const JSON_Object *object, const char *key,
+                               size_t key_len, uint64_t hash) {
+  const object_entry *entry = nullptr;
+  const uint32_t *slots = nullptr;
+  size_t mask = 0;
   size_t ix = 0;
   size_t i = 0;
-  unsigned long hash_to_check = 0;
-  const char *key_to_check = nullptr;
-  size_t key_to_check_len = 0;
 
-  *out_found = false;
-
-  for (i = 0; i < object->cell_capacity; i++) {
-    ix = (cell_ix + i) & (object->cell_capacity - 1);
-    cell = object->cells[ix];
-    if (cell == object_invalid_ix) {
-      return ix;
-    }
-    hash_to_check = object->hashes[cell];
-    if (hash != hash_to_check) {
-      continue;
+  if (object->slot_capacity == 0) {
+    for (i = 0; i < object->count; i++) {
+      entry = &object->entries[i];
+      if (entry->hash == hash && entry->key_len == key_len &&
+          (entry->key == key || memcmp(entry->key, key, key_len) == 0)) {
+        return i;
+      }
     }
-    key_to_check = object->names[cell];
-    key_to_check_len = strlen(key_to_check);
-    if (key_to_check_len == key_len &&
-        strncmp(key, key_to_check, key_len) == 0) {
-      *out_found = true;
-      return ix;
+    return object_invalid_ix;
+  }
+
+  /* Slots are at most half full, so every probe sequence ends early. */
+  slots = json_object_slots(object);
+  mask = object->slot_capacity - 1;
+  JSON_Stats *stats = stats_active();
+  size_t probes = 1;
+  for (ix = hash & mask; slots[ix] != 0; ix = (ix + 1) & mask, probes++) {
+    entry = &object->entries[slots[ix] - 1];
+    if (entry->hash == hash && entry->key_len == key_len &&
+        (entry->key == key || memcmp(entry->key, key, key_len) == 0)) {
+      break;
     }
   }
-  return object_invalid_ix;
+  if (stats != nullptr && probes > stats->max_probe_length) {
+    stats->max_probe_length = probes;
+  }
+  return slots[ix] != 0 ? slots[ix] - 1 : object_invalid_ix;
 }
 
-static JSON_Status json_object_add(JSON_Object *object, char *name,
-                                   JSON_Value *value) {
-  unsigned long hash = 0;
-  bool found = false;
-  size_t cell_ix = 0;
-  JSON_Status res = JSONFailure;
-
-  if (object == nullptr || name == nullptr || value == nullptr) {
-    return JSONFailure;
+static size_t json_object_find_slot(const JSON_Object *object,
+                                    size_t entry_ix) {
+  const uint32_t *slots = json_object_slots(object);
+  size_t mask = object->slot_capacity - 1;
+  size_t ix = object->entries[entry_ix].hash & mask;
+  while (slots[ix] != entry_ix + 1) {
+    ix = (ix + 1) & mask;
   }
+  return ix;
+}
 
-  hash = hash_string(name, strlen(name));
-  found = false;
-  cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
-  if (found) {
+static JSON_Status json_object_append(JSON_Object *object, char *name,
+                                      size_t name_len, uint64_t hash,
+                                      JSON_Value *value) {
+  if (json_value_is_frozen(object->wrapping_value) ||
+      (object->count >= object->capacity &&
+       json_object_grow(object) != JSONSuccess)) {
     return JSONFailure;
   }
+  json_value_forget_cached(object->wrapping_value);
+  object->entries[object->count] = (object_entry){
+      .hash = hash, .key_len = name_len, .key = name, .value = value};
+  if (object->slot_capacity > 0) {
+    json_object_insert_slot(object, hash, object->count);
+  }
+  object->count++;
+  json_value_set_parent(value, json_object_get_wrapping_value(object));
+  return JSONSuccess;
+}
 
-  if (object->count >= object->item_capacity) {
-    res = json_object_grow_and_rehash(object);
-    if (res != JSONSuccess) {
-      return JSONFailure;
-    }
-    cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
+static JSON_Status json_object_add(JSON_Object *object, char *name,
+                                   size_t name_len, JSON_Value *value) {
+  uint64_t hash = 0;
+
+  if (object == nullptr || name == nullptr || value == nullptr) {
+    return JSONFailure;
   }
 
-  object->names[object->count] = name;
-  object->cells[cell_ix] = object->count;
-  object->values[object->count] = value;
-  object->cell_ixs[object->count] = cell_ix;
-  object->hashes[object->count] = hash;
-  object->count++;
-  value->parent = json_object_get_wrapping_value(object);
+  hash = hash_string(name, name_len);
+  return json_object_add_hashed(object, name, name_len, hash, value);
+}
 
-  return JSONSuccess;
+static JSON_Status json_object_add_hashed(JSON_Object *object, char *name,
+                                          size_t name_len, uint64_t hash,
+                                          JSON_Value *value) {
+  if (json_object_find(object, name, name_len, hash) != object_invalid_ix) {
+    return JSONFailure;
+  }
+  return json_object_append(object, name, name_len, hash, value);
 }
 
-static JSON_Value *json_object_getn_value(const JSON_Object *object,
-                                          const char *name, size_t name_len) {
-  unsigned long hash = 0;
-  bool found = false;
-  size_t cell_ix = 0;
-  size_t item_ix = 0;
+JSON_Value *json_object_get_value_with_len(const JSON_Object *object,
+                                           const char *name, size_t name_len) {
+  size_t entry_ix = 0;
   if (object == nullptr || name == nullptr) {
     return nullptr;
   }
-  hash = hash_string(name, name_len);
-  found = false;
-  cell_ix = json_object_get_cell_ix(object, name, name_len, hash, &found);
-  if (!found) {
+  entry_ix =
+      json_object_find(object, name, name_len, hash_string(name, name_len));
+  if (entry_ix == object_invalid_ix) {
     return nullptr;
   }
-  item_ix = object->cells[cell_ix];
-  return object->values[item_ix];
+  return object->entries[entry_ix].value;
 }
 
-static JSON_Status json_object_remove_internal(JSON_Object *object,
-                                               const char *name,
-                                               bool free_value) {
-  unsigned long hash = 0;
-  bool found = false;
-  size_t cell = 0;
-  size_t item_ix = 0;
-  size_t last_item_ix = 0;
-  size_t i = 0;
-  size_t j = 0;
-  size_t x = 0;
+static void json_object_remove_slot(JSON_Object *object, size_t entry_ix) {
+  uint32_t *slots = json_object_slots(object);
+  size_t mask = object->slot_capacity - 1;
+  size_t i = json_object_find_slot(object, entry_ix);
+  size_t j = i;
   size_t k = 0;
-  JSON_Value *val = nullptr;
-
-  if (object == nullptr) {
-    return JSONFailure;
-  }
 
-  hash = hash_string(name, strlen(name));
-  found = false;
-  cell = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
-  if (!found) {
-    return JSONFailure;
+  /* Backward-shift deletion keeps probe sequences free of tombstones. */
+  for (;;) {
+    j = (j + 1) & mask;
+    if (slots[j] == 0) {
+      break;
+    }
+    k = object->entries[slots[j] - 1].hash & mask;
+    if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
+      slots[i] = slots[j];
+      i = j;
+    }
   }
+  slots[i] = 0;
+}
 
-  item_ix = object->cells[cell];
+static void json_object_remove_at(JSON_Object *object, size_t entry_ix,
+                                  bool free_value) {
+  size_t last_ix = 0;
+  JSON_Value *val = object->entries[entry_ix].value;
+  json_value_forget_cached(object->wrapping_value);
   if (free_value) {
-    val = object->values[item_ix];
-    json_value_free(val);
-    val = nullptr;
+    json_value_free_child(object->arena, val);
+  } else {
+    json_arena_forget(object->arena, val);
+  }
+  val = nullptr;
+  json_object_free_name(object, &object->entries[entry_ix]);
+
+  /* The last entry moves into the hole, as removal never preserved order. */
+  last_ix = object->count - 1;
+  if (object->slot_capacity > 0) {
+    json_object_remove_slot(object, entry_ix);
+    if (entry_ix < last_ix) {
+      uint32_t *slots = json_object_slots(object);
+      slots[json_object_find_slot(object, last_ix)] = (uint32_t)(entry_ix + 1);
+    }
   }
-
-  parson_free(object->names[item_ix]);
-  last_item_ix = object->count - 1;
-  if (item_ix < last_item_ix) {
-    object->names[item_ix] = object->names[last_item_ix];
-    object->values[item_ix] = object->values[last_item_ix];
-    object->cell_ixs[item_ix] = object->cell_ixs[last_item_ix];
-    object->hashes[item_ix] = object->hashes[last_item_ix];
-    object->cells[object->cell_ixs[item_ix]] = item_ix;
+  if (entry_ix < last_ix) {
+    object->entries[entry_ix] = object->entries[last_ix];
   }
   object->count--;
+}
 
-  i = cell;
-  j = i;
-  for (x = 0; x < (object->cell_capacity - 1); x++) {
-    j = (j + 1) & (object->cell_capacity - 1);
-    if (object->cells[j] == object_invalid_ix) {
-      break;
-    }
-    k = object->hashes[object->cells[j]] & (object->cell_capacity - 1);
-    if ((j > i && (k <= i || k > j)) || (j < i && (k <= i && k > j))) {
-      object->cell_ixs[object->cells[j]] = i;
-      object->cells[i] = object->cells[j];
-      i = j;
-    }
+static JSON_Status json_object_remove_internal(JSON_Object *object,
+                                               const char *name,
+                                               bool free_value) {
+  size_t entry_ix = 0;
+  size_t name_len = 0;
+
+  if (object == nullptr || json_value_is_frozen(object->wrapping_value)) {
+    return JSONFailure;
+  }
+
+  name_len = strlen(name);
+  entry_ix =
+      json_object_find(object, name, name_len, hash_string(name, name_len));
+  if (entry_ix == object_invalid_ix) {
+    return JSONFailure;
   }
-  object->cells[i] = object_invalid_ix;
+  json_object_remove_at(object, entry_ix, free_value);
   return JSONSuccess;
 }
 
@@ -745,37 +1861,55 @@ static JSON_Status json_object_dotremove_internal(JSON_Object *object,
   if (dot_pos == nullptr) {
     return json_object_remove_internal(object, name, free_value);
   }
-  temp_value = json_object_getn_value(object, name, dot_pos - name);
+  temp_value =
+      json_object_get_value_with_len(object, name, dot_pos - name);
   if (json_value_get_type(temp_value) != JSONObject) {
     return JSONFailure;
   }
+  temp_value = json_value_thaw_child(
+      json_object_get_wrapping_value(object), name, dot_pos - name,
+      hash_string(name, dot_pos - name), 0, temp_value);
   temp_object = json_value_get_object(temp_value);
+  if (temp_object == nullptr) {
+    return JSONFailure;
+  }
   return json_object_dotremove_internal(temp_object, dot_pos + 1, free_value);
 }
 
 static void json_object_free(JSON_Object *object) {
   json_object_deinit(object, true, true);
-  parson_free(object);
+  json_fragments_free(object->fragments);
+  parson_free_in(object->arena, object);
+}
+
+static JSON_Arena *json_object_get_arena(const JSON_Object *object) {
+  return object == nullptr ? nullptr : object->arena;
 }
 
 /* JSON Array */
-[[nodiscard]] static JSON_Array *json_array_make(JSON_Value *wrapping_value) {
-  auto new_array = (JSON_Array *)parson_calloc(1, sizeof(JSON_Array));
+[[nodiscard]] static JSON_Array *json_array_make(JSON_Value *wrapping_value,
+                                                 JSON_Arena *arena) {
+  auto new_array = (JSON_Array *)parson_calloc_in(arena, 1, sizeof(JSON_Array));
   if (new_array == nullptr) {
     return nullptr;
   }
   new_array->wrapping_value = wrapping_value;
+  new_array->arena = arena;
   return new_array;
 }
 
 static JSON_Status json_array_add(JSON_Array *array, JSON_Value *value) {
+  if (json_value_is_frozen(array->wrapping_value)) {
+    return JSONFailure;
+  }
   if (array->count >= array->capacity) {
     size_t new_capacity = max_size(array->capacity * 2, starting_capacity);
     if (json_array_resize(array, new_capacity) != JSONSuccess) {
       return JSONFailure;
     }
   }
-  value->parent = json_array_get_wrapping_value(array);
+  json_value_forget_cached(array->wrapping_value);
+  json_value_set_parent(value, json_array_get_wrapping_value(array));
   array->items[array->count] = value;
   array->count++;
   return JSONSuccess;
@@ -786,16 +1920,21 @@ static JSON_Status json_array_resize(JSON_Array *array, size_t new_capacity) {
   if (new_capacity == 0) {
     return JSONFailure;
   }
-  new_items = (JSON_Value **)parson_calloc(new_capacity, sizeof(JSON_Value *));
+  new_items = (JSON_Value **)parson_calloc_in(array->arena, new_capacity,
+                                             sizeof(JSON_Value *));
   if (new_items == nullptr) {
     return JSONFailure;
   }
   if (array->items != nullptr && array->count > 0) {
     memcpy(new_items, array->items, array->count * sizeof(JSON_Value *));
   }
-  parson_free(array->items);
+  parson_free_in(array->arena, array->items);
   array->items = new_items;
   array->capacity = new_capacity;
+  JSON_Stats *stats = stats_active();
+  if (stats != nullptr) {
+    stats->array_resizes++;
+  }
   return JSONSuccess;
 }
 
@@ -804,1715 +1943,7425 @@ static void json_array_free(JSON_Array *array) {
   for (i = 0; i < array->count; i++) {
     json_value_free(array->items[i]);
   }
-  parson_free(array->items);
-  parson_free(array);
+  parson_free_in(array->arena, array->items);
+  json_fragments_free(array->fragments);
+  parson_free_in(array->arena, array);
 }
 
-/* JSON Value */
-[[nodiscard]] static JSON_Value *json_value_init_string_no_copy(char *string,
-                                                                size_t length) {
-  auto new_value = (JSON_Value *)parson_calloc(1, sizeof(JSON_Value));
-  if (new_value == nullptr) {
-    return nullptr;
+/* Frees the values from count on, undoing a failed bulk append. */
+static void json_array_truncate(JSON_Array *array, size_t count) {
+  json_value_forget_cached(array->wrapping_value);
+  for (size_t i = count; i < array->count; i++) {
+    json_value_free(array->items[i]);
   }
-  new_value->parent = nullptr;
-  new_value->type = JSONString;
-  new_value->value.string.chars = string;
-  new_value->value.string.length = length;
-  return new_value;
+  array->count = count;
 }
 
-/* Parser */
-static JSON_Status skip_quotes(const char **string) {
-  if (**string != '\"') {
-    return JSONFailure;
-  }
-  skip_char(string);
-  while (**string != '\"') {
-    if (**string == '\0') {
-      return JSONFailure;
-    } else if (**string == '\\') {
-      skip_char(string);
-      if (**string == '\0') {
-        return JSONFailure;
+static JSON_Arena *json_array_get_arena(const JSON_Array *array) {
+  return array == nullptr ? nullptr : array->arena;
+}
+
+/* Key table */
+static key_record *key_record_of(const char *chars) {
+  return (key_record *)(chars - offsetof(key_record, chars));
+}
+
+static char *json_key_table_intern(JSON_Key_Table *table, const char *name,
+                                   size_t len, uint64_t hash) {
+  size_t ix = 0;
+  if (table->count >= table->capacity / 2) {
+    const size_t new_capacity =
+        max_size(table->capacity * 2, key_table_initial_capacity);
+    auto new_slots =
+        (key_record **)parson_calloc(new_capacity, sizeof(key_record *));
+    if (new_slots == nullptr) {
+      return nullptr;
+    }
+    for (size_t i = 0; i < table->capacity; i++) {
+      key_record *record = table->slots[i];
+      if (record == nullptr) {
+        continue;
+      }
+      ix = record->hash & (new_capacity - 1);
+      while (new_slots[ix] != nullptr) {
+        ix = (ix + 1) & (new_capacity - 1);
       }
+      new_slots[ix] = record;
+    }
+    parson_free(table->slots);
+    table->slots = new_slots;
+    table->capacity = new_capacity;
+  }
+  const size_t mask = table->capacity - 1;
+  for (ix = hash & mask; table->slots[ix] != nullptr; ix = (ix + 1) & mask) {
+    key_record *record = table->slots[ix];
+    if (record->hash == hash && record->len == len &&
+        memcmp(record->chars, name, len) == 0) {
+      return record->chars;
     }
-    skip_char(string);
   }
-  skip_char(string);
-  return JSONSuccess;
+  if (len > SIZE_MAX - sizeof(key_record) - 1) {
+    return nullptr;
+  }
+  auto record = (key_record *)parson_malloc(sizeof(key_record) + len + 1);
+  if (record == nullptr) {
+    return nullptr;
+  }
+  record->hash = hash;
+  record->len = len;
+  memcpy(record->chars, name, len);
+  record->chars[len] = '\0';
+  table->slots[ix] = record;
+  table->count++;
+  return record->chars;
 }
 
-static JSON_Status parse_utf16(const char **unprocessed, char **processed) {
-  unsigned int cp, lead, trail;
-  char *processed_ptr = *processed;
-  const char *unprocessed_ptr = *unprocessed;
-  JSON_Status status = JSONFailure;
-  unprocessed_ptr++; /* skips u */
-  status = parse_utf16_hex(unprocessed_ptr, &cp);
-  if (status != JSONSuccess) {
-    return JSONFailure;
+/* Probes with the name's stored hash; a name is owned only if it is the
+   table's own copy. */
+static bool json_key_table_owns(const JSON_Key_Table *table, const char *name,
+                                uint64_t hash) {
+  if (table->capacity == 0) {
+    return false;
   }
-  if (cp < 0x80) {
-    processed_ptr[0] = (char)cp; /* 0xxxxxxx */
-  } else if (cp < 0x800) {
-    processed_ptr[0] = ((cp >> 6) & 0x1F) | 0xC0; /* 110xxxxx */
-    processed_ptr[1] = ((cp) & 0x3F) | 0x80;      /* 10xxxxxx */
-    processed_ptr += 1;
-  } else if (cp < 0xD800 || cp > 0xDFFF) {
-    processed_ptr[0] = ((cp >> 12) & 0x0F) | 0xE0; /* 1110xxxx */
-    processed_ptr[1] = ((cp >> 6) & 0x3F) | 0x80;  /* 10xxxxxx */
-    processed_ptr[2] = ((cp) & 0x3F) | 0x80;       /* 10xxxxxx */
-    processed_ptr += 2;
-  } else if (cp >= 0xD800 &&
-             cp <= 0xDBFF) { /* lead surrogate (0xD800..0xDBFF) */
-    lead = cp;
-    unprocessed_ptr += 4; /* should always be within the buffer, otherwise
-                             previous sscanf would fail */
-    if (*unprocessed_ptr++ != '\\' || *unprocessed_ptr++ != 'u') {
-      return JSONFailure;
+  const size_t mask = table->capacity - 1;
+  for (size_t ix = hash & mask; table->slots[ix] != nullptr;
+       ix = (ix + 1) & mask) {
+    if (table->slots[ix]->chars == name) {
+      return true;
     }
-    status = parse_utf16_hex(unprocessed_ptr, &trail);
-    if (status != JSONSuccess || trail < 0xDC00 ||
-        trail > 0xDFFF) { /* valid trail surrogate? (0xDC00..0xDFFF) */
-      return JSONFailure;
+  }
+  return false;
+}
+
+/* Compiled paths */
+static size_t json_path_parse_index(const char *name, size_t name_len) {
+  size_t index = 0;
+  size_t i = 0;
+  if (name_len == 1 && name[0] == '-') {
+    return path_end_index;
+  }
+  if (name_len == 0 || (name[0] == '0' && name_len > 1)) {
+    return path_no_index;
+  }
+  for (i = 0; i < name_len; i++) {
+    if (name[i] < '0' || name[i] > '9' || index > (path_end_index - 10) / 10) {
+      return path_no_index;
     }
-    cp = ((((lead - 0xD800) & 0x3FF) << 10) | ((trail - 0xDC00) & 0x3FF)) +
-         0x010000;
-    processed_ptr[0] = (((cp >> 18) & 0x07) | 0xF0); /* 11110xxx */
-    processed_ptr[1] = (((cp >> 12) & 0x3F) | 0x80); /* 10xxxxxx */
-    processed_ptr[2] = (((cp >> 6) & 0x3F) | 0x80);  /* 10xxxxxx */
-    processed_ptr[3] = (((cp) & 0x3F) | 0x80);       /* 10xxxxxx */
-    processed_ptr += 3;
-  } else { /* trail surrogate before lead surrogate */
-    return JSONFailure;
+    index = index * 10 + (size_t)(name[i] - '0');
   }
-  unprocessed_ptr += 3;
-  *processed = processed_ptr;
-  *unprocessed = unprocessed_ptr;
-  return JSONSuccess;
+  return index;
 }
 
-/* Copies and processes passed string up to supplied length.
-Example: "\u006Corem ipsum" -> lorem ipsum */
-[[nodiscard]] static char *process_string(const char *input, size_t input_len,
-                                          size_t *output_len) {
-  const char *input_ptr = input;
-  const size_t initial_size = input_len + 1;
-  size_t final_size = 0;
-  char *output = nullptr, *output_ptr = nullptr, *resized_output = nullptr;
-  output = (char *)parson_calloc(initial_size, sizeof(char));
-  if (output == nullptr) {
-    goto error;
+[[nodiscard]] static JSON_Path *json_path_make(const char *path,
+                                               bool pointer) {
+  const char separator = pointer ? '/' : '.';
+  size_t path_len = 0;
+  size_t count = 0;
+  size_t i = 0;
+
+  if (path == nullptr) {
+    return nullptr;
   }
-  output_ptr = output;
-  while ((*input_ptr != '\0') && (size_t)(input_ptr - input) < input_len) {
-    if (*input_ptr == '\\') {
-      input_ptr++;
-      switch (*input_ptr) {
-      case '\"':
-        *output_ptr = '\"';
-        break;
-      case '\\':
-        *output_ptr = '\\';
-        break;
-      case '/':
-        *output_ptr = '/';
-        break;
-      case 'b':
-        *output_ptr = '\b';
-        break;
-      case 'f':
-        *output_ptr = '\f';
-        break;
-      case 'n':
-        *output_ptr = '\n';
-        break;
-      case 'r':
-        *output_ptr = '\r';
-        break;
-      case 't':
-        *output_ptr = '\t';
-        break;
-      case 'u':
-        if (parse_utf16(&input_ptr, &output_ptr) != JSONSuccess) {
-          goto error;
+  path_len = strlen(path);
+  if (pointer) {
+    /* "" is the whole document, anything else starts with '/' */
+    if (path_len > 0 && path[0] != '/') {
+      return nullptr;
+    }
+  } else {
+    count = 1;
+  }
+  for (i = 0; i < path_len; i++) {
+    count += path[i] == separator;
+  }
+  auto result = (JSON_Path *)parson_malloc(
+      sizeof(JSON_Path) + count * sizeof(path_segment) + path_len + 1);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  result->count = count;
+
+  /* Names are stored unescaped after the segments; unescaping only shrinks */
+  char *names = (char *)(result->segments + count);
+  const char *cursor = pointer ? path + 1 : path;
+  for (i = 0; i < count; i++) {
+    path_segment *segment = &result->segments[i];
+    segment->name = names;
+    while (*cursor != '\0' && *cursor != separator) {
+      if (pointer && *cursor == '~') {
+        if (cursor[1] != '0' && cursor[1] != '1') {
+          parson_free(result);
+          return nullptr;
         }
-        break;
-      default:
-        goto error;
+        *names++ = cursor[1] == '0' ? '~' : '/';
+        cursor += 2;
+      } else {
+        *names++ = *cursor++;
       }
-    } else if ((unsigned char)*input_ptr < 0x20) {
-      goto error; /* 0x00-0x19 are invalid characters for json string
-                     (http://www.ietf.org/rfc/rfc4627.txt) */
-    } else {
-      *output_ptr = *input_ptr;
     }
-    output_ptr++;
-    input_ptr++;
-  }
-  *output_ptr = '\0';
-  /* resize to new length */
-  final_size = (size_t)(output_ptr - output) + 1;
-  /* todo: don't resize if final_size == initial_size */
-  resized_output = (char *)parson_calloc(final_size, sizeof(char));
-  if (resized_output == nullptr) {
-    goto error;
+    segment->name_len = (size_t)(names - segment->name);
+    *names++ = '\0';
+    cursor++;
+    segment->hash = hash_string(segment->name, segment->name_len);
+    segment->index = pointer ? json_path_parse_index(segment->name,
+                                                     segment->name_len)
+                             : path_no_index;
   }
-  memcpy(resized_output, output, final_size);
-  *output_len = final_size - 1;
-  parson_free(output);
-  return resized_output;
-error:
-  parson_free(output);
-  return nullptr;
+  return result;
 }
 
-/* Return processed contents of a string between quotes and
-   skips passed argument to a matching quote. */
-[[nodiscard]] static char *get_quoted_string(const char **string,
-                                             size_t *output_string_len) {
-  const char *string_start = *string;
-  size_t input_string_len = 0;
-  JSON_Status status = skip_quotes(string);
-  if (status != JSONSuccess) {
+static JSON_Value *json_path_step(const JSON_Value *value,
+                                  const path_segment *segment) {
+  const JSON_Object *object = nullptr;
+  size_t entry_ix = 0;
+  switch (json_value_get_type(value)) {
+  case JSONObject:
+    object = json_value_get_object(value);
+    entry_ix = json_object_find(object, segment->name, segment->name_len,
+                                segment->hash);
+    return entry_ix == object_invalid_ix ? nullptr
+                                         : object->entries[entry_ix].value;
+  case JSONArray:
+    return json_array_get_value(json_value_get_array(value), segment->index);
+  default:
     return nullptr;
   }
-  input_string_len = *string - string_start - 2; /* length without quotes */
-  return process_string(string_start + 1, input_string_len, output_string_len);
 }
 
-[[nodiscard]] static JSON_Value *parse_value(const char **string,
-                                             size_t nesting) {
-  if (nesting > max_nesting) {
-    return nullptr;
+/* Follows the first count segments of path. */
+static JSON_Value *json_path_walk(const JSON_Value *value,
+                                  const JSON_Path *path, size_t count) {
+  size_t i = 0;
+  for (i = 0; i < count && value != nullptr; i++) {
+    value = json_path_step(value, &path->segments[i]);
   }
-  skip_whitespaces(string);
-  switch (**string) {
-  case '{':
-    return parse_object_value(string, nesting + 1);
-  case '[':
-    return parse_array_value(string, nesting + 1);
-  case '\"':
-    return parse_string_value(string);
-  case 'f':
-  case 't':
-    return parse_boolean_value(string);
-  case '-':
-  case '0':
-  case '1':
-  case '2':
-  case '3':
-  case '4':
-  case '5':
-  case '6':
-  case '7':
-  case '8':
-  case '9':
-    return parse_number_value(string);
-  case 'n':
-    return parse_null_value(string);
+  return (JSON_Value *)value;
+}
+
+/* child is where segment leads from parent, on the way to a change. */
+static JSON_Value *json_path_thaw_step(JSON_Value *parent,
+                                       const path_segment *segment,
+                                       JSON_Value *child) {
+  return json_value_thaw_child(parent, segment->name, segment->name_len,
+                               segment->hash, segment->index, child);
+}
+
+/* Compiled schemas */
+static void json_schema_measure(const JSON_Value *schema, size_t depth,
+                                size_t *count, size_t *slots,
+                                size_t *names_len, size_t *max_depth) {
+  const JSON_Array *array = nullptr;
+  const JSON_Object *object = nullptr;
+  size_t i = 0;
+
+  (*count)++;
+  switch (json_value_get_type(schema)) {
+  case JSONArray:
+    array = json_value_get_array(schema);
+    if (json_array_get_count(array) == 0) {
+      return;
+    }
+    *max_depth = max_size(*max_depth, depth + 1);
+    json_schema_measure(json_array_get_value(array, 0), depth + 1, count,
+                        slots, names_len, max_depth);
+    return;
+  case JSONObject:
+    object = json_value_get_object(schema);
+    if (json_object_get_count(object) == 0) {
+      return;
+    }
+    *max_depth = max_size(*max_depth, depth + 1);
+    *slots += index_slot_capacity(json_object_get_count(object));
+    for (i = 0; i < json_object_get_count(object); i++) {
+      *names_len += json_object_get_name_len(object, i);
+      json_schema_measure(json_object_get_value_at(object, i), depth + 1,
+                          count, slots, names_len, max_depth);
+    }
+    return;
   default:
-    return nullptr;
+    return;
   }
 }
 
-[[nodiscard]] static JSON_Value *parse_object_value(const char **string,
-                                                    size_t nesting) {
-  JSON_Status status = JSONFailure;
-  JSON_Value *output_value = nullptr, *new_value = nullptr;
-  JSON_Object *output_object = nullptr;
-  char *new_key = nullptr;
+/* Writes the subtree of schema from ops[ix] on and returns its end. */
+static size_t json_schema_emit(JSON_Schema *result, const JSON_Value *schema,
+                               size_t ix, size_t **slots, char **names) {
+  schema_op *op = &result->ops[ix];
+  const JSON_Object *object = nullptr;
+  const JSON_Array *array = nullptr;
+  size_t next = ix + 1;
+  size_t i = 0;
 
-  output_value = json_value_init_object();
-  if (output_value == nullptr) {
-    return nullptr;
-  }
-  if (**string != '{') {
-    json_value_free(output_value);
-    return nullptr;
-  }
-  output_object = json_value_get_object(output_value);
-  skip_char(string);
-  skip_whitespaces(string);
-  if (**string == '}') { /* empty object */
-    skip_char(string);
-    return output_value;
-  }
-  while (**string != '\0') {
-    size_t key_len = 0;
-    new_key = get_quoted_string(string, &key_len);
-    /* We do not support key names with embedded \0 chars */
-    if (new_key == nullptr) {
-      json_value_free(output_value);
-      return nullptr;
+  op->type = json_value_get_type(schema);
+  op->count = 0;
+  op->name = nullptr;
+  op->name_len = 0;
+  op->hash = 0;
+  op->slots = nullptr;
+  op->slot_capacity = 0;
+  if (op->type == JSONArray) {
+    array = json_value_get_array(schema);
+    if (json_array_get_count(array) > 0) {
+      op->count = 1;
+      next = json_schema_emit(result, json_array_get_value(array, 0), next,
+                              slots, names);
     }
-    if (key_len != strlen(new_key)) {
-      parson_free(new_key);
-      json_value_free(output_value);
-      return nullptr;
+  } else if (op->type == JSONObject) {
+    object = json_value_get_object(schema);
+    op->count = json_object_get_count(object);
+    op->slot_capacity = index_slot_capacity(op->count);
+    if (op->slot_capacity > 0) {
+      op->slots = *slots;
+      memset(op->slots, 0, op->slot_capacity * sizeof(size_t));
+      *slots += op->slot_capacity;
     }
-    skip_whitespaces(string);
-    if (**string != ':') {
-      parson_free(new_key);
-      json_value_free(output_value);
-      return nullptr;
+    for (i = 0; i < op->count; i++) {
+      const size_t member = next;
+      const size_t name_len = json_object_get_name_len(object, i);
+      next = json_schema_emit(result, json_object_get_value_at(object, i),
+                              member, slots, names);
+      schema_op *member_op = &result->ops[member];
+      memcpy(*names, json_object_get_name(object, i), name_len);
+      member_op->name = *names;
+      member_op->name_len = name_len;
+      member_op->hash = hash_string(*names, name_len);
+      *names += name_len;
+      if (op->slots != nullptr) {
+        const size_t mask = op->slot_capacity - 1;
+        size_t slot = member_op->hash & mask;
+        while (op->slots[slot] != 0) {
+          slot = (slot + 1) & mask;
+        }
+        op->slots[slot] = member + 1;
+      }
     }
-    skip_char(string);
-    new_value = parse_value(string, nesting);
-    if (new_value == nullptr) {
-      parson_free(new_key);
-      json_value_free(output_value);
-      return nullptr;
+  }
+  op->end = next;
+  return next;
+}
+
+/* Returns the member of the object node ops[ix] with the given name, or
+   schema_any_op. */
+static size_t json_schema_find(const JSON_Schema *schema, size_t ix,
+                               const char *name, size_t name_len) {
+  const schema_op *op = &schema->ops[ix];
+  const uint64_t hash = hash_string(name, name_len);
+  const schema_op *member_op = nullptr;
+  size_t member = 0;
+
+  if (op->slots == nullptr) {
+    for (member = ix + 1; member < op->end; member = schema->ops[member].end) {
+      member_op = &schema->ops[member];
+      if (member_op->hash == hash && member_op->name_len == name_len &&
+          memcmp(member_op->name, name, name_len) == 0) {
+        return member;
+      }
     }
-    status = json_object_add(output_object, new_key, new_value);
-    if (status != JSONSuccess) {
-      parson_free(new_key);
-      json_value_free(new_value);
-      json_value_free(output_value);
-      return nullptr;
+    return schema_any_op;
+  }
+  const size_t mask = op->slot_capacity - 1;
+  for (size_t slot = hash & mask; op->slots[slot] != 0;
+       slot = (slot + 1) & mask) {
+    member = op->slots[slot] - 1;
+    member_op = &schema->ops[member];
+    if (member_op->hash == hash && member_op->name_len == name_len &&
+        memcmp(member_op->name, name, name_len) == 0) {
+      return member;
     }
-    skip_whitespaces(string);
-    if (**string != ',') {
-      break;
+  }
+  return schema_any_op;
+}
+
+static JSON_Status json_schema_check(const JSON_Schema *schema, size_t ix,
+                                     const JSON_Value *value) {
+  const schema_op *op = &schema->ops[ix];
+  const JSON_Object *object = nullptr;
+  const JSON_Array *array = nullptr;
+  size_t member = 0;
+  size_t entry_ix = 0;
+  size_t i = 0;
+
+  if (op->type == JSONNull) {
+    return JSONSuccess; /* null represents all values */
+  }
+  if (json_value_get_type(value) != op->type) {
+    return JSONFailure;
+  }
+  if (op->count == 0) {
+    return JSONSuccess;
+  }
+  if (op->type == JSONArray) {
+    array = json_value_get_array(value);
+    for (i = 0; i < json_array_get_count(array); i++) {
+      if (json_schema_check(schema, ix + 1, json_array_get_value(array, i)) !=
+          JSONSuccess) {
+        return JSONFailure;
+      }
     }
-    skip_char(string);
-    skip_whitespaces(string);
-    if (**string == '}') {
-      break;
+    return JSONSuccess;
+  }
+  object = json_value_get_object(value);
+  if (json_object_get_count(object) < op->count) {
+    return JSONFailure;
+  }
+  for (member = ix + 1; member < op->end; member = schema->ops[member].end) {
+    const schema_op *member_op = &schema->ops[member];
+    entry_ix = json_object_find(object, member_op->name, member_op->name_len,
+                                member_op->hash);
+    if (entry_ix == object_invalid_ix ||
+        json_schema_check(schema, member, object->entries[entry_ix].value) !=
+            JSONSuccess) {
+      return JSONFailure;
+    }
+  }
+  return JSONSuccess;
+}
+
+/* Checks the start of a value against the op expected for it. Values no op
+   checks still go through the event parser, so the input is fully validated,
+   but their events are only counted. */
+static JSON_Event_Result schema_events_value(schema_events *events,
+                                             JSON_Value_Type type,
+                                             bool container) {
+  const schema_op *op = nullptr;
+  size_t member = 0;
+
+  if (events->skip_depth > 0) {
+    events->skip_depth += container;
+    return JSONEventContinue;
+  }
+  if (events->expect != schema_any_op) {
+    op = &events->schema->ops[events->expect];
+  }
+  if (op != nullptr && op->type != JSONNull && op->type != type) {
+    events->failed = true;
+    return JSONEventStop;
+  }
+  if (!container) {
+    return JSONEventContinue;
+  }
+  if (op == nullptr || op->type == JSONNull || op->count == 0) {
+    events->skip_depth = 1;
+    return JSONEventContinue;
+  }
+  schema_frame *frame = &events->frames[events->depth++];
+  frame->op = events->expect;
+  frame->matched = 0;
+  if (type == JSONArray) {
+    events->expect = frame->op + 1;
+  } else {
+    for (member = frame->op + 1; member < op->end;
+         member = events->schema->ops[member].end) {
+      events->seen[member] = 0;
+    }
+    events->expect = schema_any_op;
+  }
+  return JSONEventContinue;
+}
+
+static JSON_Event_Result schema_events_end(schema_events *events) {
+  if (events->skip_depth > 0) {
+    events->skip_depth--;
+    return JSONEventContinue;
+  }
+  const schema_frame *frame = &events->frames[--events->depth];
+  const schema_op *op = &events->schema->ops[frame->op];
+  if (op->type == JSONObject && frame->matched < op->count) {
+    events->failed = true;
+    return JSONEventStop;
+  }
+  if (events->depth > 0) {
+    frame = &events->frames[events->depth - 1];
+    if (events->schema->ops[frame->op].type == JSONArray) {
+      events->expect = frame->op + 1;
     }
   }
-  skip_whitespaces(string);
-  if (**string != '}') {
-    json_value_free(output_value);
+  return JSONEventContinue;
+}
+
+static JSON_Event_Result schema_on_object_begin(void *ctx) {
+  return schema_events_value((schema_events *)ctx, JSONObject, true);
+}
+
+static JSON_Event_Result schema_on_array_begin(void *ctx) {
+  return schema_events_value((schema_events *)ctx, JSONArray, true);
+}
+
+static JSON_Event_Result schema_on_end(void *ctx) {
+  return schema_events_end((schema_events *)ctx);
+}
+
+static JSON_Event_Result schema_on_key(void *ctx, const char *name,
+                                       size_t len) {
+  auto events = (schema_events *)ctx;
+
+  if (events->skip_depth > 0) {
+    return JSONEventContinue;
+  }
+  schema_frame *frame = &events->frames[events->depth - 1];
+  /* members the schema lacks are allowed and not checked */
+  const size_t member = json_schema_find(events->schema, frame->op, name, len);
+  events->expect = member;
+  if (member == schema_any_op) {
+    return JSONEventContinue;
+  }
+  if (events->seen[member]) {
+    events->failed = true; /* a tree can't hold duplicate names */
+    return JSONEventStop;
+  }
+  events->seen[member] = 1;
+  frame->matched++;
+  return JSONEventContinue;
+}
+
+static JSON_Event_Result schema_on_string(void *ctx, const char *string,
+                                          size_t len) {
+  (void)string;
+  (void)len;
+  return schema_events_value((schema_events *)ctx, JSONString, false);
+}
+
+static JSON_Event_Result schema_on_number(void *ctx, double number,
+                                          const char *raw, size_t raw_len) {
+  (void)number;
+  (void)raw;
+  (void)raw_len;
+  return schema_events_value((schema_events *)ctx, JSONNumber, false);
+}
+
+static JSON_Event_Result schema_on_boolean(void *ctx, bool boolean) {
+  (void)boolean;
+  return schema_events_value((schema_events *)ctx, JSONBoolean, false);
+}
+
+static JSON_Event_Result schema_on_null(void *ctx) {
+  return schema_events_value((schema_events *)ctx, JSONNull, false);
+}
+
+/* JSON Value */
+[[nodiscard]] static JSON_Value *json_value_make(JSON_Arena *arena,
+                                                 JSON_Value_Type type) {
+  auto new_value = (JSON_Value *)parson_calloc_in(arena, 1, sizeof(JSON_Value));
+  if (new_value == nullptr) {
     return nullptr;
   }
-  skip_char(string);
-  return output_value;
+  new_value->parent = nullptr;
+  new_value->type = type;
+  new_value->flags = arena != nullptr ? value_flag_arena : 0U;
+  JSON_Stats *stats = stats_active();
+  if (stats != nullptr) {
+    stats->values[type]++;
+  }
+  return new_value;
 }
 
-[[nodiscard]] static JSON_Value *parse_array_value(const char **string,
-                                                   size_t nesting) {
-  JSON_Value *output_value = nullptr, *new_array_value = nullptr;
-  JSON_Array *output_array = nullptr;
-  output_value = json_value_init_array();
-  if (output_value == nullptr) {
+[[nodiscard]] static JSON_Value *json_value_init_object_in(JSON_Arena *arena) {
+  auto new_value = json_value_make(arena, JSONObject);
+  if (new_value == nullptr) {
     return nullptr;
   }
-  if (**string != '[') {
-    json_value_free(output_value);
+  new_value->value.object = json_object_make(new_value, arena);
+  if (new_value->value.object == nullptr) {
+    parson_free_in(arena, new_value);
     return nullptr;
   }
-  output_array = json_value_get_array(output_value);
-  skip_char(string);
-  skip_whitespaces(string);
-  if (**string == ']') { /* empty array */
-    skip_char(string);
-    return output_value;
+  return new_value;
+}
+
+[[nodiscard]] static JSON_Value *json_value_init_array_in(JSON_Arena *arena) {
+  auto new_value = json_value_make(arena, JSONArray);
+  if (new_value == nullptr) {
+    return nullptr;
   }
-  while (**string != '\0') {
-    new_array_value = parse_value(string, nesting);
-    if (new_array_value == nullptr) {
-      json_value_free(output_value);
-      return nullptr;
-    }
-    if (json_array_add(output_array, new_array_value) != JSONSuccess) {
-      json_value_free(new_array_value);
-      json_value_free(output_value);
-      return nullptr;
-    }
-    skip_whitespaces(string);
-    if (**string != ',') {
-      break;
-    }
-    skip_char(string);
-    skip_whitespaces(string);
-    if (**string == ']') {
-      break;
-    }
+  new_value->value.array = json_array_make(new_value, arena);
+  if (new_value->value.array == nullptr) {
+    parson_free_in(arena, new_value);
+    return nullptr;
   }
-  skip_whitespaces(string);
-  if (**string != ']' || /* Trim array after parsing is over */
-      json_array_resize(output_array, json_array_get_count(output_array)) !=
-          JSONSuccess) {
-    json_value_free(output_value);
+  return new_value;
+}
+
+[[nodiscard]] static JSON_Value *
+json_value_init_string_no_copy(JSON_Arena *arena, char *string, size_t length) {
+  auto new_value = json_value_make(arena, JSONString);
+  if (new_value == nullptr) {
     return nullptr;
   }
-  skip_char(string);
-  return output_value;
+  new_value->value.string.chars = string;
+  new_value->value.string.length = length;
+  return new_value;
 }
 
-[[nodiscard]] static JSON_Value *parse_string_value(const char **string) {
-  JSON_Value *value = nullptr;
-  size_t new_string_len = 0;
-  char *new_string = get_quoted_string(string, &new_string_len);
-  if (new_string == nullptr) {
+/* Copies up to small_string_max_len bytes into the value itself */
+[[nodiscard]] static JSON_Value *
+json_value_init_small_string(JSON_Arena *arena, const char *string,
+                             size_t length) {
+  auto new_value = json_value_make(arena, JSONString);
+  if (new_value == nullptr) {
     return nullptr;
   }
-  value = json_value_init_string_no_copy(new_string, new_string_len);
-  if (value == nullptr) {
-    parson_free(new_string);
+  new_value->flags |= value_flag_small_string;
+  memcpy(new_value->value.small.chars, string, length);
+  new_value->value.small.chars[length] = '\0';
+  new_value->value.small.length = (unsigned char)length;
+  return new_value;
+}
+
+[[nodiscard]] static JSON_Value *json_value_init_string_in(JSON_Arena *arena,
+                                                           const char *string) {
+  if (string == nullptr) {
     return nullptr;
   }
-  return value;
+  return json_value_init_string_with_len_in(arena, string, strlen(string));
 }
 
-[[nodiscard]] static JSON_Value *parse_boolean_value(const char **string) {
-  constexpr size_t true_token_size = sizeof("true") - 1;
-  constexpr size_t false_token_size = sizeof("false") - 1;
-  if (strncmp("true", *string, true_token_size) == 0) {
-    *string += true_token_size;
-    return json_value_init_boolean(true);
-  } else if (strncmp("false", *string, false_token_size) == 0) {
-    *string += false_token_size;
-    return json_value_init_boolean(false);
+[[nodiscard]] static JSON_Value *
+json_value_init_string_with_len_in(JSON_Arena *arena, const char *string,
+                                   size_t length) {
+  char *copy = nullptr;
+  JSON_Value *value;
+  if (string == nullptr) {
+    return nullptr;
   }
-  return nullptr;
+  if (!is_valid_utf8(string, length)) {
+    return nullptr;
+  }
+  if (length <= small_string_max_len) {
+    return json_value_init_small_string(arena, string, length);
+  }
+  copy = parson_strndup_in(arena, string, length);
+  if (copy == nullptr) {
+    return nullptr;
+  }
+  value = json_value_init_string_no_copy(arena, copy, length);
+  if (value == nullptr) {
+    parson_free_in(arena, copy);
+  }
+  return value;
 }
 
-[[nodiscard]] static JSON_Value *parse_number_value(const char **string) {
-  char *end;
-  double number = 0;
-  errno = 0;
-  number = strtod(*string, &end);
-  if (end == *string) {
+[[nodiscard]] static JSON_Value *json_value_init_number_in(JSON_Arena *arena,
+                                                           double number) {
+  if (is_number_invalid(number)) {
     return nullptr;
   }
-  if (errno == ERANGE && (number <= -HUGE_VAL || number >= HUGE_VAL)) {
+  auto new_value = json_value_make(arena, JSONNumber);
+  if (new_value == nullptr) {
     return nullptr;
   }
-  if ((errno && errno != ERANGE) || !is_decimal(*string, end - *string)) {
+  new_value->value.number = number;
+  return new_value;
+}
+
+[[nodiscard]] static JSON_Value *
+json_value_init_integer_in(JSON_Arena *arena, bool negative,
+                           uint64_t magnitude) {
+  auto new_value = json_value_make(arena, JSONNumber);
+  if (new_value == nullptr) {
     return nullptr;
   }
-  *string = end;
-  return json_value_init_number(number);
+  if (!negative && magnitude > INT64_MAX) {
+    new_value->flags |= value_flag_uint64;
+    new_value->value.uint64 = magnitude;
+  } else {
+    new_value->flags |= value_flag_int64;
+    new_value->value.int64 = negative && magnitude > 0
+                                 ? -(int64_t)(magnitude - 1) - 1
+                                 : (int64_t)magnitude;
+  }
+  return new_value;
 }
 
-[[nodiscard]] static JSON_Value *parse_null_value(const char **string) {
-  constexpr size_t token_size = sizeof("null") - 1;
-  if (strncmp("null", *string, token_size) == 0) {
-    *string += token_size;
-    return json_value_init_null();
+[[nodiscard]] static JSON_Value *json_value_init_boolean_in(JSON_Arena *arena,
+                                                            bool boolean) {
+  auto new_value = json_value_make(arena, JSONBoolean);
+  if (new_value == nullptr) {
+    return nullptr;
   }
-  return nullptr;
+  new_value->value.boolean = boolean;
+  return new_value;
 }
 
-/* Serialization */
+[[nodiscard]] static JSON_Value *json_value_init_null_in(JSON_Arena *arena) {
+  return json_value_make(arena, JSONNull);
+}
 
-typedef struct serialization_buffer {
-  char *cursor;
-  int written_total;
-} serialization_buffer;
+/* Frees a value that is being removed from a container owned by 'arena'. */
+static void json_value_free_child(JSON_Arena *arena, JSON_Value *value) {
+  json_arena_forget(arena, value);
+  json_value_free(value);
+}
 
-static inline void append_literal(serialization_buffer *buffer,
-                                  const char *literal) {
-  const size_t written = strlen(literal);
-  if (buffer->cursor != nullptr) {
-    memcpy(buffer->cursor, literal, written);
-    buffer->cursor[written] = '\0';
-    buffer->cursor += written;
+/* Called when the contents of the container value change, drops its hash and
+   serialized text and those of the containers above it. Containers above one
+   that has neither have none either, so this stops there. */
+static void json_value_forget_cached(JSON_Value *value) {
+  constexpr uint32_t cached = value_flag_hashed | value_flag_serialized;
+  while (value != nullptr && (value->flags & cached) != 0U) {
+    serialized_fragment *fragments = json_value_fragments(value);
+    if (fragments != nullptr) {
+      fragments[0].valid = false;
+      fragments[1].valid = false;
+    }
+    value->flags &= ~cached;
+    value = value->parent;
   }
-  buffer->written_total += (int)written;
 }
 
-static inline void append_indent(serialization_buffer *buffer, int level) {
-  for (int level_i = 0; level_i < level; level_i++) {
-    append_literal(buffer, parson_indent_str);
+/* nullptr for values without any, including lazy containers */
+static serialized_fragment *json_value_fragments(const JSON_Value *value) {
+  if ((value->flags & value_flag_lazy) != 0U) {
+    return nullptr;
   }
+  if (value->type == JSONObject) {
+    return value->value.object->fragments;
+  }
+  return value->type == JSONArray ? value->value.array->fragments : nullptr;
 }
 
-static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf,
-                                      int level, bool is_pretty,
-                                      char *num_buf) {
-  const char *key = nullptr, *string = nullptr;
-  JSON_Value *temp_value = nullptr;
-  JSON_Array *array = nullptr;
-  JSON_Object *object = nullptr;
-  size_t i = 0, count = 0;
-  double num = 0.0;
-  int written = -1;
-  size_t len = 0;
-  serialization_buffer out = {
-      .cursor = buf,
-      .written_total = 0,
-  };
+static void json_fragments_free(serialized_fragment *fragments) {
+  if (fragments != nullptr) {
+    parson_free(fragments[0].text);
+    parson_free(fragments[1].text);
+    parson_free(fragments);
+  }
+}
+
+/* Frozen containers may be members of several containers at once, so they
+   keep no parent. */
+static void json_value_set_parent(JSON_Value *value, JSON_Value *parent) {
+  if ((value->flags & value_flag_frozen) == 0U) {
+    value->parent = parent;
+  }
+}
+
+/* A frozen container, which is shared rather than copied */
+static bool json_value_is_shared(const JSON_Value *value) {
+  return json_value_is_frozen(value) &&
+         (value->type == JSONObject || value->type == JSONArray);
+}
+
+/* value is shared */
+static atomic_size_t *json_value_refs(const JSON_Value *value) {
+  return value->type == JSONObject ? &value->value.object->refs
+                                   : &value->value.array->refs;
+}
+
+/* Fails for values that can't be shared: values owned by an arena, which
+   would be freed under their other holders, and lazy values whose text
+   doesn't parse. */
+static JSON_Status json_value_freeze_check(const JSON_Value *value) {
+  const JSON_Object *object = nullptr;
+  const JSON_Array *array = nullptr;
+  size_t i = 0;
 
+  if ((value->flags & value_flag_frozen) != 0U) {
+    return JSONSuccess;
+  }
+  if ((value->flags & value_flag_arena) != 0U) {
+    return JSONFailure;
+  }
   switch (json_value_get_type(value)) {
-  case JSONArray:
-    array = json_value_get_array(value);
-    count = json_array_get_count(array);
-    append_literal(&out, "[");
-    if (count > 0 && is_pretty) {
-      append_literal(&out, "\n");
-    }
-    for (i = 0; i < count; i++) {
-      if (is_pretty) {
-        append_indent(&out, level + 1);
-      }
-      temp_value = json_array_get_value(array, i);
-      written = json_serialize_to_buffer_r(temp_value, out.cursor, level + 1,
-                                           is_pretty, num_buf);
-      if (written < 0) {
-        return -1;
-      }
-      if (out.cursor != nullptr) {
-        out.cursor += written;
-      }
-      out.written_total += written;
-      if (i < (count - 1)) {
-        append_literal(&out, ",");
-      }
-      if (is_pretty) {
-        append_literal(&out, "\n");
-      }
-    }
-    if (count > 0 && is_pretty) {
-      append_indent(&out, level);
-    }
-    append_literal(&out, "]");
-    return out.written_total;
   case JSONObject:
     object = json_value_get_object(value);
-    count = json_object_get_count(object);
-    append_literal(&out, "{");
-    if (count > 0 && is_pretty) {
-      append_literal(&out, "\n");
+    if (object == nullptr) {
+      return JSONFailure;
     }
-    for (i = 0; i < count; i++) {
-      key = json_object_get_name(object, i);
-      if (key == nullptr) {
-        return -1;
-      }
-      if (is_pretty) {
-        append_indent(&out, level + 1);
-      }
-      /* We do not support key names with embedded \\0 chars */
-      written = json_serialize_string(key, strlen(key), out.cursor);
-      if (written < 0) {
-        return -1;
-      }
-      if (out.cursor != nullptr) {
-        out.cursor += written;
-      }
-      out.written_total += written;
-      append_literal(&out, ":");
-      if (is_pretty) {
-        append_literal(&out, " ");
-      }
-      temp_value = json_object_get_value_at(object, i);
-      written = json_serialize_to_buffer_r(temp_value, out.cursor, level + 1,
-                                           is_pretty, num_buf);
-      if (written < 0) {
-        return -1;
-      }
-      if (out.cursor != nullptr) {
-        out.cursor += written;
-      }
-      out.written_total += written;
-      if (i < (count - 1)) {
-        append_literal(&out, ",");
-      }
-      if (is_pretty) {
-        append_literal(&out, "\n");
+    for (i = 0; i < object->count; i++) {
+      if (json_value_freeze_check(object->entries[i].value) != JSONSuccess) {
+        return JSONFailure;
       }
     }
-    if (count > 0 && is_pretty) {
-      append_indent(&out, level);
-    }
-    append_literal(&out, "}");
-    return out.written_total;
-  case JSONString:
-    string = json_value_get_string(value);
-    if (string == nullptr) {
-      return -1;
+    return JSONSuccess;
+  case JSONArray:
+    array = json_value_get_array(value);
+    if (array == nullptr) {
+      return JSONFailure;
     }
-    len = json_value_get_string_len(value);
-    written = json_serialize_string(string, len, out.cursor);
-    if (written < 0) {
-      return -1;
+    for (i = 0; i < array->count; i++) {
+      if (json_value_freeze_check(array->items[i]) != JSONSuccess) {
+        return JSONFailure;
+      }
     }
-    if (out.cursor != nullptr) {
-      out.cursor += written;
-    }
-    out.written_total += written;
-    return out.written_total;
-  case JSONBoolean: {
-    const JSON_Boolean boolean_value = json_value_get_boolean(value);
-    if (boolean_value == JSONBooleanError) {
-      return -1;
-    }
-    append_literal(&out, boolean_value == JSONBooleanTrue ? "true" : "false");
-    return out.written_total;
-  }
-  case JSONNumber: {
-    num = json_value_get_number(value);
-    char *local_num_buf = num_buf;
-    if (out.cursor != nullptr) {
-      local_num_buf = out.cursor;
-    }
-    if (parson_number_serialization_function) {
-      written = parson_number_serialization_function(num, local_num_buf);
-    } else {
-      const char *float_format = parson_float_format
-                                     ? parson_float_format
-                                     : parson_default_float_format;
-      written =
-          parson_sprintf(local_num_buf, parson_num_buf_size, float_format, num);
-    }
-    if (written < 0) {
-      return -1;
-    }
-    if (out.cursor != nullptr) {
-      out.cursor += written;
-    }
-    out.written_total += written;
-    return out.written_total;
-  }
-  case JSONNull:
-    append_literal(&out, "null");
-    return out.written_total;
-  case JSONError:
-    return -1;
+    return JSONSuccess;
   default:
-    return -1;
+    return JSONSuccess;
   }
 }
 
-static int json_serialize_string(const char *string, size_t len, char *buf) {
+static void json_value_freeze_mark(JSON_Value *value) {
   size_t i = 0;
-  char c = '\0';
-  serialization_buffer out = {
-      .cursor = buf,
-      .written_total = 0,
-  };
-  append_literal(&out, "\"");
-  for (i = 0; i < len; i++) {
-    c = string[i];
-    switch (c) {
-    case '\"':
-      append_literal(&out, "\\\"");
-      break;
-    case '\\':
-      append_literal(&out, "\\\\");
-      break;
-    case '\b':
-      append_literal(&out, "\\b");
-      break;
-    case '\f':
-      append_literal(&out, "\\f");
-      break;
-    case '\n':
-      append_literal(&out, "\\n");
-      break;
-    case '\r':
-      append_literal(&out, "\\r");
-      break;
-    case '\t':
-      append_literal(&out, "\\t");
-      break;
-    case '\x00':
-      append_literal(&out, "\\u0000");
-      break;
-    case '\x01':
-      append_literal(&out, "\\u0001");
-      break;
-    case '\x02':
-      append_literal(&out, "\\u0002");
-      break;
-    case '\x03':
-      append_literal(&out, "\\u0003");
-      break;
-    case '\x04':
-      append_literal(&out, "\\u0004");
-      break;
-    case '\x05':
-      append_literal(&out, "\\u0005");
-      break;
-    case '\x06':
-      append_literal(&out, "\\u0006");
-      break;
-    case '\x07':
-      append_literal(&out, "\\u0007");
-      break;
-    case '\x0b':
-      append_literal(&out, "\\u000b");
-      break;
-    case '\x0e':
-      append_literal(&out, "\\u000e");
-      break;
-    case '\x0f':
-      append_literal(&out, "\\u000f");
-      break;
-    case '\x10':
-      append_literal(&out, "\\u0010");
-      break;
-    case '\x11':
-      append_literal(&out, "\\u0011");
-      break;
-    case '\x12':
-      append_literal(&out, "\\u0012");
-      break;
-    case '\x13':
-      append_literal(&out, "\\u0013");
-      break;
-    case '\x14':
-      append_literal(&out, "\\u0014");
-      break;
-    case '\x15':
-      append_literal(&out, "\\u0015");
-      break;
-    case '\x16':
-      append_literal(&out, "\\u0016");
-      break;
-    case '\x17':
-      append_literal(&out, "\\u0017");
-      break;
-    case '\x18':
-      append_literal(&out, "\\u0018");
-      break;
-    case '\x19':
-      append_literal(&out, "\\u0019");
-      break;
-    case '\x1a':
-      append_literal(&out, "\\u001a");
-      break;
-    case '\x1b':
-      append_literal(&out, "\\u001b");
-      break;
-    case '\x1c':
-      append_literal(&out, "\\u001c");
-      break;
-    case '\x1d':
-      append_literal(&out, "\\u001d");
-      break;
-    case '\x1e':
-      append_literal(&out, "\\u001e");
-      break;
-    case '\x1f':
-      append_literal(&out, "\\u001f");
-      break;
-    case '/':
-      if (parson_escape_slashes) {
-        append_literal(&out, "\\/");
-      } else {
-        append_literal(&out, "/");
-      }
-      break;
-    default:
-      if (out.cursor != nullptr) {
-        out.cursor[0] = c;
-        out.cursor += 1;
-      }
-      out.written_total += 1;
-      break;
+
+  if ((value->flags & value_flag_frozen) != 0U) {
+    return; /* frozen before, its count already has this holder */
+  }
+  value->flags |= value_flag_frozen;
+  switch (value->type) {
+  case JSONObject:
+    value->parent = nullptr;
+    atomic_init(&value->value.object->refs, 1);
+    for (i = 0; i < value->value.object->count; i++) {
+      json_value_freeze_mark(value->value.object->entries[i].value);
+    }
+    return;
+  case JSONArray:
+    value->parent = nullptr;
+    atomic_init(&value->value.array->refs, 1);
+    for (i = 0; i < value->value.array->count; i++) {
+      json_value_freeze_mark(value->value.array->items[i]);
     }
+    return;
+  default:
+    return; /* owned by its frozen container, so it keeps its parent */
   }
-  append_literal(&out, "\"");
-  return out.written_total;
 }
 
-/* Parser API */
-JSON_Value *json_parse_file(const char *filename) {
-  char *file_contents = read_file(filename);
-  JSON_Value *output_value = nullptr;
-  if (file_contents == nullptr) {
-    return nullptr;
+/* Replaces child, the member of parent at name or index, with a mutable copy
+   if it is frozen, so that changes below it leave its other holders alone.
+   The copy shares child's frozen members. Returns the member to change or
+   nullptr on failure. */
+static JSON_Value *json_value_thaw_child(JSON_Value *parent, const char *name,
+                                         size_t name_len, uint64_t hash,
+                                         size_t index, JSON_Value *child) {
+  JSON_Status status = JSONFailure;
+  if (!json_value_is_shared(child)) {
+    return child;
   }
-  output_value = json_parse_string(file_contents);
-  parson_free(file_contents);
-  return output_value;
-}
-
-JSON_Value *json_parse_file_with_comments(const char *filename) {
-  char *file_contents = read_file(filename);
-  JSON_Value *output_value = nullptr;
-  if (file_contents == nullptr) {
+  JSON_Value *copy = json_value_copy_contents(child);
+  if (copy == nullptr) {
     return nullptr;
   }
-  output_value = json_parse_string_with_comments(file_contents);
-  parson_free(file_contents);
-  return output_value;
-}
-
-JSON_Value *json_parse_string(const char *string) {
-  if (string == nullptr) {
-    return nullptr;
+  if (json_value_get_type(parent) == JSONArray) {
+    status =
+        json_array_replace_value(json_value_get_array(parent), index, copy);
+  } else {
+    status = json_object_set_hashed(json_value_get_object(parent), name,
+                                    name_len, hash, copy);
   }
-  if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
-    string = string + 3; /* Support for UTF-8 BOM */
+  if (status != JSONSuccess) {
+    json_value_free(copy);
+    return nullptr;
   }
-  return parse_value((const char **)&string, 0);
+  return copy;
 }
 
-JSON_Value *json_parse_string_with_comments(const char *string) {
-  JSON_Value *result = nullptr;
-  char *string_mutable_copy = nullptr, *string_mutable_copy_ptr = nullptr;
-  if (string == nullptr) {
-    return nullptr;
-  }
-  string_mutable_copy = parson_strdup(string);
-  if (string_mutable_copy == nullptr) {
-    return nullptr;
+/* Parser */
+/* String scanning: the kernels below return the length of the leading run
+   of characters that need no special handling, i.e. anything except quotes,
+   backslashes, control characters (including the terminating null) and,
+   with stop_at_slash, forward slashes. Each kernel stops either at such a
+   character or when fewer bytes than its block size remain before end, so
+   they can be chained from the widest to the narrowest. */
+static inline bool is_string_special(unsigned char c, bool stop_at_slash) {
+  return c == '\"' || c == '\\' || c < 0x20 || (stop_at_slash && c == '/');
+}
+
+#if defined(PARSON_SIMD_AVX2_DISPATCH)
+static bool cpu_has_avx2() {
+  static atomic_int has_avx2 = -1;
+  int result = atomic_load_explicit(&has_avx2, memory_order_relaxed);
+  if (result >= 0) {
+    return result != 0;
+  }
+  unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+  result = 0;
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_OSXSAVE) &&
+      (ecx & bit_AVX)) {
+    unsigned int xcr0_lo = 0, xcr0_hi = 0;
+    __asm__("xgetbv" : "=a"(xcr0_lo), "=d"(xcr0_hi) : "c"(0));
+    if ((xcr0_lo & 0x6U) == 0x6U && /* OS saves xmm and ymm state */
+        __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_AVX2)) {
+      result = 1;
+    }
   }
-  remove_comments(string_mutable_copy, "/*", "*/");
-  remove_comments(string_mutable_copy, "//", "\n");
-  string_mutable_copy_ptr = string_mutable_copy;
-  result = parse_value((const char **)&string_mutable_copy_ptr, 0);
-  parson_free(string_mutable_copy);
-  return result;
+  atomic_store_explicit(&has_avx2, result, memory_order_relaxed);
+  return result != 0;
 }
+#endif
 
-/* JSON Object API */
-
-JSON_Value *json_object_get_value(const JSON_Object *object, const char *name) {
-  if (object == nullptr || name == nullptr) {
-    return nullptr;
+#if defined(PARSON_SIMD_SSE2)
+#if defined(PARSON_SIMD_AVX2_DISPATCH)
+__attribute__((target("avx2")))
+#endif
+static size_t scan_string_run_avx2(const char *string, const char *end,
+                                   bool stop_at_slash) {
+  const __m256i quote = _mm256_set1_epi8('\"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i slash = _mm256_set1_epi8(stop_at_slash ? '/' : '\"');
+  const __m256i control_max = _mm256_set1_epi8(0x1F);
+  const char *ptr = string;
+  while (end - ptr >= 64) {
+    uint64_t mask = 0;
+    for (int half = 0; half < 2; half++) {
+      const __m256i chunk =
+          _mm256_loadu_si256((const __m256i *)(ptr + 32 * half));
+      __m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote),
+                                     _mm256_cmpeq_epi8(chunk, backslash));
+      hits = _mm256_or_si256(hits, _mm256_cmpeq_epi8(chunk, slash));
+      hits = _mm256_or_si256(
+          hits, _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, control_max), chunk));
+      mask |= (uint64_t)(uint32_t)_mm256_movemask_epi8(hits) << (32 * half);
+    }
+    if (mask != 0) {
+      return (size_t)(ptr - string) + (size_t)__builtin_ctzll(mask);
+    }
+    ptr += 64;
+  }
+  return (size_t)(ptr - string);
+}
+
+static size_t scan_string_run_sse2(const char *string, const char *end,
+                                   bool stop_at_slash) {
+  const __m128i quote = _mm_set1_epi8('\"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i slash = _mm_set1_epi8(stop_at_slash ? '/' : '\"');
+  const __m128i control_max = _mm_set1_epi8(0x1F);
+  const char *ptr = string;
+  while (end - ptr >= 16) {
+    const __m128i chunk = _mm_loadu_si128((const __m128i *)ptr);
+    __m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                _mm_cmpeq_epi8(chunk, backslash));
+    hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, slash));
+    hits = _mm_or_si128(
+        hits, _mm_cmpeq_epi8(_mm_min_epu8(chunk, control_max), chunk));
+    const unsigned int mask = (unsigned int)_mm_movemask_epi8(hits);
+    if (mask != 0) {
+      return (size_t)(ptr - string) + (size_t)__builtin_ctz(mask);
+    }
+    ptr += 16;
   }
-  return json_object_getn_value(object, name, strlen(name));
+  return (size_t)(ptr - string);
 }
+#endif
 
-const char *json_object_get_string(const JSON_Object *object,
-                                   const char *name) {
-  return json_value_get_string(json_object_get_value(object, name));
+#if defined(PARSON_SIMD_NEON)
+static size_t scan_string_run_neon(const char *string, const char *end,
+                                   bool stop_at_slash) {
+  const uint8x16_t quote = vdupq_n_u8('\"');
+  const uint8x16_t backslash = vdupq_n_u8('\\');
+  const uint8x16_t slash = vdupq_n_u8(stop_at_slash ? '/' : '\"');
+  const uint8x16_t control_end = vdupq_n_u8(0x20);
+  const char *ptr = string;
+  while (end - ptr >= 16) {
+    const uint8x16_t chunk = vld1q_u8((const uint8_t *)ptr);
+    uint8x16_t hits =
+        vorrq_u8(vceqq_u8(chunk, quote), vceqq_u8(chunk, backslash));
+    hits = vorrq_u8(hits, vceqq_u8(chunk, slash));
+    hits = vorrq_u8(hits, vcltq_u8(chunk, control_end));
+    /* narrow to 4 bits per byte so the mask fits in a general register */
+    const uint64_t mask = vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(hits), 4)), 0);
+    if (mask != 0) {
+      return (size_t)(ptr - string) + (size_t)(__builtin_ctzll(mask) >> 2);
+    }
+    ptr += 16;
+  }
+  return (size_t)(ptr - string);
 }
+#endif
 
-size_t json_object_get_string_len(const JSON_Object *object, const char *name) {
-  return json_value_get_string_len(json_object_get_value(object, name));
+/* Portable fallback: tests 8 bytes at a time with the usual "has zero byte"
+   and "has byte less than n" bit tricks, which are exact for detecting
+   whether any byte in the word matches. */
+static size_t scan_string_run_swar(const char *string, const char *end,
+                                   bool stop_at_slash) {
+  constexpr uint64_t ones = 0x0101'0101'0101'0101ULL;
+  constexpr uint64_t highs = 0x8080'8080'8080'8080ULL;
+  const char *ptr = string;
+  while (end - ptr >= 8) {
+    uint64_t word = 0;
+    memcpy(&word, ptr, sizeof(word));
+    const uint64_t quote = word ^ (ones * '\"');
+    const uint64_t backslash = word ^ (ones * '\\');
+    const uint64_t slash = word ^ (ones * (stop_at_slash ? '/' : '\"'));
+    const uint64_t hits = ((word - ones * 0x20) & ~word) |
+                          ((quote - ones) & ~quote) |
+                          ((backslash - ones) & ~backslash) |
+                          ((slash - ones) & ~slash);
+    if ((hits & highs) != 0) {
+      break;
+    }
+    ptr += 8;
+  }
+  return (size_t)(ptr - string);
 }
 
-double json_object_get_number(const JSON_Object *object, const char *name) {
-  return json_value_get_number(json_object_get_value(object, name));
+static size_t scan_string_run(const char *string, const char *end,
+                              bool stop_at_slash) {
+  const char *ptr = string;
+#if defined(PARSON_SIMD_SSE2)
+#if defined(PARSON_SIMD_AVX2_DISPATCH)
+  if (end - ptr >= 64 && cpu_has_avx2())
+#endif
+  {
+    ptr += scan_string_run_avx2(ptr, end, stop_at_slash);
+  }
+  ptr += scan_string_run_sse2(ptr, end, stop_at_slash);
+#elif defined(PARSON_SIMD_NEON)
+  ptr += scan_string_run_neon(ptr, end, stop_at_slash);
+#endif
+  ptr += scan_string_run_swar(ptr, end, stop_at_slash);
+  while (ptr < end && !is_string_special((unsigned char)*ptr, stop_at_slash)) {
+    ptr++;
+  }
+  return (size_t)(ptr - string);
+}
+
+/* Whitespace as accepted by isspace in the "C" locale: space and \t to \r. */
+static inline bool is_space(unsigned char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static size_t scan_whitespace_run(const char *string, const char *end) {
+  const char *ptr = string;
+#if defined(PARSON_SIMD_SSE2)
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i control_range = _mm_set1_epi8('\r' - '\t');
+  while (end - ptr >= 16) {
+    const __m128i chunk = _mm_loadu_si128((const __m128i *)ptr);
+    const __m128i rebased = _mm_sub_epi8(chunk, tab);
+    const __m128i spaces = _mm_or_si128(
+        _mm_cmpeq_epi8(chunk, space),
+        _mm_cmpeq_epi8(_mm_min_epu8(rebased, control_range), rebased));
+    const unsigned int mask =
+        ~(unsigned int)_mm_movemask_epi8(spaces) & 0xFFFFU;
+    if (mask != 0) {
+      return (size_t)(ptr - string) + (size_t)__builtin_ctz(mask);
+    }
+    ptr += 16;
+  }
+#elif defined(PARSON_SIMD_NEON)
+  const uint8x16_t space = vdupq_n_u8(' ');
+  const uint8x16_t tab = vdupq_n_u8('\t');
+  const uint8x16_t control_range = vdupq_n_u8('\r' - '\t');
+  while (end - ptr >= 16) {
+    const uint8x16_t chunk = vld1q_u8((const uint8_t *)ptr);
+    const uint8x16_t spaces =
+        vorrq_u8(vceqq_u8(chunk, space),
+                 vcleq_u8(vsubq_u8(chunk, tab), control_range));
+    const uint64_t mask = ~vget_lane_u64(
+        vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(spaces), 4)), 0);
+    if (mask != 0) {
+      return (size_t)(ptr - string) + (size_t)(__builtin_ctzll(mask) >> 2);
+    }
+    ptr += 16;
+  }
+#endif
+  while (ptr < end && is_space((unsigned char)*ptr)) {
+    ptr++;
+  }
+  return (size_t)(ptr - string);
 }
 
-JSON_Object *json_object_get_object(const JSON_Object *object,
-                                    const char *name) {
-  return json_value_get_object(json_object_get_value(object, name));
+static void skip_whitespaces(const char **string, const parse_context *ctx) {
+  const char *ptr = *string;
+  if (ptr == ctx->end || !is_space((unsigned char)*ptr)) {
+    return;
+  }
+  if (ctx->index != nullptr) {
+    /* The next token start after whitespace is the next indexed offset. The
+       parser only moves forward, so the cursor never has to go back. */
+    structural_index *index = ctx->index;
+    const size_t offset = (size_t)(ptr - ctx->start);
+    while (index->offsets[index->cursor] < offset) {
+      index->cursor++;
+    }
+    *string = ctx->start + index->offsets[index->cursor];
+    return;
+  }
+  ptr++;
+  if (ptr < ctx->end && is_space((unsigned char)*ptr)) {
+    ptr += scan_whitespace_run(ptr, ctx->end);
+  }
+  *string = ptr;
+}
+
+/* Structural index (stage one of JSONParseStructuralIndex)
+   The input is classified 64 bytes at a time into bitmasks, in the style of
+   simdjson: escaped characters and string interiors are resolved with carries
+   between blocks, and the offsets of all token starts are collected into the
+   index. */
+typedef struct block_masks {
+  uint64_t quote;
+  uint64_t backslash;
+  uint64_t whitespace;
+  uint64_t structural; /* {}[]:, */
+} block_masks;
+
+typedef struct index_state {
+  uint64_t escaped_carry; /* first byte of the next block is escaped */
+  uint64_t in_string;     /* all ones if a string continues into the block */
+  uint64_t scalar_carry;  /* last byte of the block is part of a literal */
+} index_state;
+
+#if defined(PARSON_SIMD_NEON)
+static inline uint64_t neon_movemask_64(uint8x16_t v0, uint8x16_t v1,
+                                        uint8x16_t v2, uint8x16_t v3) {
+  const uint8x16_t bits = {0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
+                           0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80};
+  uint8x16_t sum0 = vpaddq_u8(vandq_u8(v0, bits), vandq_u8(v1, bits));
+  const uint8x16_t sum1 = vpaddq_u8(vandq_u8(v2, bits), vandq_u8(v3, bits));
+  sum0 = vpaddq_u8(sum0, sum1);
+  sum0 = vpaddq_u8(sum0, sum0);
+  return vgetq_lane_u64(vreinterpretq_u64_u8(sum0), 0);
 }
+#endif
 
-JSON_Array *json_object_get_array(const JSON_Object *object, const char *name) {
-  return json_value_get_array(json_object_get_value(object, name));
+static void classify_block(const char *block, block_masks *masks) {
+#if defined(PARSON_SIMD_SSE2)
+  const __m128i quote = _mm_set1_epi8('\"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i control_range = _mm_set1_epi8('\r' - '\t');
+  const __m128i lower_case = _mm_set1_epi8(0x20);
+  const __m128i open_brace = _mm_set1_epi8('{');
+  const __m128i close_brace = _mm_set1_epi8('}');
+  const __m128i colon = _mm_set1_epi8(':');
+  const __m128i comma = _mm_set1_epi8(',');
+  *masks = (block_masks){0};
+  for (int i = 0; i < 4; i++) {
+    const __m128i chunk = _mm_loadu_si128((const __m128i *)(block + 16 * i));
+    const __m128i rebased = _mm_sub_epi8(chunk, tab);
+    const __m128i spaces = _mm_or_si128(
+        _mm_cmpeq_epi8(chunk, space),
+        _mm_cmpeq_epi8(_mm_min_epu8(rebased, control_range), rebased));
+    /* '[' and ']' are '{' and '}' without the 0x20 bit */
+    const __m128i folded = _mm_or_si128(chunk, lower_case);
+    const __m128i structural = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(folded, open_brace),
+                     _mm_cmpeq_epi8(folded, close_brace)),
+        _mm_or_si128(_mm_cmpeq_epi8(chunk, colon),
+                     _mm_cmpeq_epi8(chunk, comma)));
+    const int shift = 16 * i;
+    masks->quote |=
+        (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quote))
+        << shift;
+    masks->backslash |=
+        (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash))
+        << shift;
+    masks->whitespace |= (uint64_t)(uint16_t)_mm_movemask_epi8(spaces)
+                         << shift;
+    masks->structural |= (uint64_t)(uint16_t)_mm_movemask_epi8(structural)
+                         << shift;
+  }
+#elif defined(PARSON_SIMD_NEON)
+  uint8x16_t chunks[4], quotes[4], backslashes[4], spaces[4], structurals[4];
+  for (int i = 0; i < 4; i++) {
+    chunks[i] = vld1q_u8((const uint8_t *)(block + 16 * i));
+    const uint8x16_t folded = vorrq_u8(chunks[i], vdupq_n_u8(0x20));
+    quotes[i] = vceqq_u8(chunks[i], vdupq_n_u8('\"'));
+    backslashes[i] = vceqq_u8(chunks[i], vdupq_n_u8('\\'));
+    spaces[i] = vorrq_u8(vceqq_u8(chunks[i], vdupq_n_u8(' ')),
+                         vcleq_u8(vsubq_u8(chunks[i], vdupq_n_u8('\t')),
+                                  vdupq_n_u8('\r' - '\t')));
+    structurals[i] = vorrq_u8(vorrq_u8(vceqq_u8(folded, vdupq_n_u8('{')),
+                                       vceqq_u8(folded, vdupq_n_u8('}'))),
+                              vorrq_u8(vceqq_u8(chunks[i], vdupq_n_u8(':')),
+                                       vceqq_u8(chunks[i], vdupq_n_u8(','))));
+  }
+  masks->quote = neon_movemask_64(quotes[0], quotes[1], quotes[2], quotes[3]);
+  masks->backslash = neon_movemask_64(backslashes[0], backslashes[1],
+                                      backslashes[2], backslashes[3]);
+  masks->whitespace =
+      neon_movemask_64(spaces[0], spaces[1], spaces[2], spaces[3]);
+  masks->structural = neon_movemask_64(structurals[0], structurals[1],
+                                       structurals[2], structurals[3]);
+#else
+  *masks = (block_masks){0};
+  for (int i = 0; i < 64; i++) {
+    const unsigned char c = (unsigned char)block[i];
+    const uint64_t bit = 1ULL << i;
+    if (c == '\"') {
+      masks->quote |= bit;
+    } else if (c == '\\') {
+      masks->backslash |= bit;
+    } else if (is_space(c)) {
+      masks->whitespace |= bit;
+    } else if (c == '{' || c == '}' || c == '[' || c == ']' || c == ':' ||
+               c == ',') {
+      masks->structural |= bit;
+    }
+  }
+#endif
 }
 
-JSON_Boolean json_object_get_boolean(const JSON_Object *object,
-                                     const char *name) {
-  return json_value_get_boolean(json_object_get_value(object, name));
+/* Returns the mask of characters escaped by an odd-length run of
+   backslashes. */
+static uint64_t find_escaped(uint64_t backslash, uint64_t *escaped_carry) {
+  constexpr uint64_t even_bits = 0x5555'5555'5555'5555ULL;
+  backslash &= ~*escaped_carry;
+  const uint64_t follows_escape = (backslash << 1) | *escaped_carry;
+  const uint64_t odd_starts = backslash & ~even_bits & ~follows_escape;
+  const uint64_t even_sequences = odd_starts + backslash;
+  *escaped_carry = even_sequences < odd_starts;
+  const uint64_t invert_mask = even_sequences << 1;
+  return (even_bits ^ invert_mask) & follows_escape;
+}
+
+/* Each bit becomes the xor of itself and all lower bits. */
+static inline uint64_t prefix_xor(uint64_t bits) {
+  bits ^= bits << 1;
+  bits ^= bits << 2;
+  bits ^= bits << 4;
+  bits ^= bits << 8;
+  bits ^= bits << 16;
+  bits ^= bits << 32;
+  return bits;
+}
+
+static uint64_t find_token_starts(const block_masks *masks,
+                                  index_state *state) {
+  const uint64_t escaped =
+      find_escaped(masks->backslash, &state->escaped_carry);
+  const uint64_t quote = masks->quote & ~escaped;
+  /* set from an opening quote up to, but excluding, the closing quote */
+  const uint64_t in_string = prefix_xor(quote) ^ state->in_string;
+  state->in_string = 0 - (in_string >> 63);
+  const uint64_t outside = ~in_string;
+  const uint64_t scalar =
+      outside & ~(masks->whitespace | masks->structural | masks->quote);
+  const uint64_t scalar_starts =
+      scalar & ~((scalar << 1) | state->scalar_carry);
+  state->scalar_carry = scalar >> 63;
+  return (masks->structural & outside) | (quote & in_string) | scalar_starts;
+}
+
+static JSON_Status structural_index_reserve(structural_index *index,
+                                            size_t extra) {
+  if (index->capacity - index->count >= extra) {
+    return JSONSuccess;
+  }
+  size_t new_capacity = max_size(index->capacity * 2, index->count + extra);
+  auto new_offsets = (uint32_t *)context_realloc(
+      index->context, index->offsets, index->capacity * sizeof(uint32_t),
+      new_capacity * sizeof(uint32_t));
+  if (new_offsets == nullptr) {
+    return JSONFailure;
+  }
+  index->offsets = new_offsets;
+  index->capacity = new_capacity;
+  return JSONSuccess;
 }
 
-JSON_Value *json_object_dotget_value(const JSON_Object *object,
-                                     const char *name) {
-  if (object == nullptr || name == nullptr) {
-    return nullptr;
+static JSON_Status structural_index_build(structural_index *index,
+                                          const char *string, size_t len,
+                                          const JSON_Context *context) {
+  index_state state = {0};
+  block_masks masks;
+  char tail[64];
+  *index = (structural_index){.context = context};
+  /* roughly one token per 8 bytes is typical for pretty-printed documents */
+  if (structural_index_reserve(index, len / 8 + 64) != JSONSuccess) {
+    return JSONFailure;
   }
-  const char *dot_position = strchr(name, '.');
-  if (dot_position == nullptr) {
-    return json_object_get_value(object, name);
+  for (size_t base = 0; base < len; base += 64) {
+    const char *block = string + base;
+    if (len - base < 64) {
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, block, len - base);
+      block = tail;
+    }
+    classify_block(block, &masks);
+    uint64_t starts = find_token_starts(&masks, &state);
+    const size_t found = popcount_u64(starts);
+    if (structural_index_reserve(index, found + 1) != JSONSuccess) {
+      structural_index_free(index);
+      return JSONFailure;
+    }
+    while (starts != 0) {
+      index->offsets[index->count++] =
+          (uint32_t)(base + trailing_zeros_u64(starts));
+      starts &= starts - 1;
+    }
   }
-  object = json_value_get_object(
-      json_object_getn_value(object, name, dot_position - name));
-  return json_object_dotget_value(object, dot_position + 1);
+  index->offsets[index->count++] = (uint32_t)len;
+  return JSONSuccess;
 }
 
-const char *json_object_dotget_string(const JSON_Object *object,
-                                      const char *name) {
-  return json_value_get_string(json_object_dotget_value(object, name));
-}
+static void structural_index_free(structural_index *index) {
+  context_free(index->context, index->offsets,
+               index->capacity * sizeof(uint32_t));
+  *index = (structural_index){.context = index->context};
+}
+
+/* Number parsing
+   Numbers are validated against the JSON grammar and converted in a single
+   pass. Up to 19 significant digits are accumulated into an integer mantissa,
+   which is converted with Clinger's fast path when both the mantissa and the
+   power of ten are exact doubles, and with the Eisel-Lemire algorithm
+   otherwise. The few inputs those can't round correctly (exact halfway cases,
+   subnormals, truncated mantissas that straddle two doubles) fall back to
+   strtod. */
+static constexpr int max_mantissa_digits = 19;
+static constexpr int64_t power_of_ten_min_exp10 = -342;
+static constexpr int64_t max_double_exp10 = 308;
+
+/* 128-bit approximations of 10^e for e from -342 to 324 (high and low 64
+   bits), normalized so the top bit is set and rounded down. Above 1e308 they
+   are only used for printing subnormals. */
+static constexpr uint64_t power_of_ten_mantissas[][2] = {
+    {0xEEF453D6923BD65A, 0x113FAA2906A13B3F}, /* 1e-342 */
+    {0x9558B4661B6565F8, 0x4AC7CA59A424C507}, /* 1e-341 */
+    {0xBAAEE17FA23EBF76, 0x5D79BCF00D2DF649}, /* 1e-340 */
+    {0xE95A99DF8ACE6F53, 0xF4D82C2C107973DC}, /* 1e-339 */
+    {0x91D8A02BB6C10594, 0x79071B9B8A4BE869}, /* 1e-338 */
+    {0xB64EC836A47146F9, 0x9748E2826CDEE284}, /* 1e-337 */
+    {0xE3E27A444D8D98B7, 0xFD1B1B2308169B25}, /* 1e-336 */
+    {0x8E6D8C6AB0787F72, 0xFE30F0F5E50E20F7}, /* 1e-335 */
+    {0xB208EF855C969F4F, 0xBDBD2D335E51A935}, /* 1e-334 */
+    {0xDE8B2B66B3BC4723, 0xAD2C788035E61382}, /* 1e-333 */
+    {0x8B16FB203055AC76, 0x4C3BCB5021AFCC31}, /* 1e-332 */
+    {0xADDCB9E83C6B1793, 0xDF4ABE242A1BBF3D}, /* 1e-331 */
+    {0xD953E8624B85DD78, 0xD71D6DAD34A2AF0D}, /* 1e-330 */
+    {0x87D4713D6F33AA6B, 0x8672648C40E5AD68}, /* 1e-329 */
+    {0xA9C98D8CCB009506, 0x680EFDAF511F18C2}, /* 1e-328 */
+    {0xD43BF0EFFDC0BA48, 0x0212BD1B2566DEF2}, /* 1e-327 */
+    {0x84A57695FE98746D, 0x014BB630F7604B57}, /* 1e-326 */
+    {0xA5CED43B7E3E9188, 0x419EA3BD35385E2D}, /* 1e-325 */
+    {0xCF42894A5DCE35EA, 0x52064CAC828675B9}, /* 1e-324 */
+    {0x818995CE7AA0E1B2, 0x7343EFEBD1940993}, /* 1e-323 */
+    {0xA1EBFB4219491A1F, 0x1014EBE6C5F90BF8}, /* 1e-322 */
+    {0xCA66FA129F9B60A6, 0xD41A26E077774EF6}, /* 1e-321 */
+    {0xFD00B897478238D0, 0x8920B098955522B4}, /* 1e-320 */
+    {0x9E20735E8CB16382, 0x55B46E5F5D5535B0}, /* 1e-319 */
+    {0xC5A890362FDDBC62, 0xEB2189F734AA831D}, /* 1e-318 */
+    {0xF712B443BBD52B7B, 0xA5E9EC7501D523E4}, /* 1e-317 */
+    {0x9A6BB0AA55653B2D, 0x47B233C92125366E}, /* 1e-316 */
+    {0xC1069CD4EABE89F8, 0x999EC0BB696E840A}, /* 1e-315 */
+    {0xF148440A256E2C76, 0xC00670EA43CA250D}, /* 1e-314 */
+    {0x96CD2A865764DBCA, 0x380406926A5E5728}, /* 1e-313 */
+    {0xBC807527ED3E12BC, 0xC605083704F5ECF2}, /* 1e-312 */
+    {0xEBA09271E88D976B, 0xF7864A44C633682E}, /* 1e-311 */
+    {0x93445B8731587EA3, 0x7AB3EE6AFBE0211D}, /* 1e-310 */
+    {0xB8157268FDAE9E4C, 0x5960EA05BAD82964}, /* 1e-309 */
+    {0xE61ACF033D1A45DF, 0x6FB92487298E33BD}, /* 1e-308 */
+    {0x8FD0C16206306BAB, 0xA5D3B6D479F8E056}, /* 1e-307 */
+    {0xB3C4F1BA87BC8696, 0x8F48A4899877186C}, /* 1e-306 */
+    {0xE0B62E2929ABA83C, 0x331ACDABFE94DE87}, /* 1e-305 */
+    {0x8C71DCD9BA0B4925, 0x9FF0C08B7F1D0B14}, /* 1e-304 */
+    {0xAF8E5410288E1B6F, 0x07ECF0AE5EE44DD9}, /* 1e-303 */
+    {0xDB71E91432B1A24A, 0xC9E82CD9F69D6150}, /* 1e-302 */
+    {0x892731AC9FAF056E, 0xBE311C083A225CD2}, /* 1e-301 */
+    {0xAB70FE17C79AC6CA, 0x6DBD630A48AAF406}, /* 1e-300 */
+    {0xD64D3D9DB981787D, 0x092CBBCCDAD5B108}, /* 1e-299 */
+    {0x85F0468293F0EB4E, 0x25BBF56008C58EA5}, /* 1e-298 */
+    {0xA76C582338ED2621, 0xAF2AF2B80AF6F24E}, /* 1e-297 */
+    {0xD1476E2C07286FAA, 0x1AF5AF660DB4AEE1}, /* 1e-296 */
+    {0x82CCA4DB847945CA, 0x50D98D9FC890ED4D}, /* 1e-295 */
+    {0xA37FCE126597973C, 0xE50FF107BAB528A0}, /* 1e-294 */
+    {0xCC5FC196FEFD7D0C, 0x1E53ED49A96272C8}, /* 1e-293 */
+    {0xFF77B1FCBEBCDC4F, 0x25E8E89C13BB0F7A}, /* 1e-292 */
+    {0x9FAACF3DF73609B1, 0x77B191618C54E9AC}, /* 1e-291 */
+    {0xC795830D75038C1D, 0xD59DF5B9EF6A2417}, /* 1e-290 */
+    {0xF97AE3D0D2446F25, 0x4B0573286B44AD1D}, /* 1e-289 */
+    {0x9BECCE62836AC577, 0x4EE367F9430AEC32}, /* 1e-288 */
+    {0xC2E801FB244576D5, 0x229C41F793CDA73F}, /* 1e-287 */
+    {0xF3A20279ED56D48A, 0x6B43527578C1110F}, /* 1e-286 */
+    {0x9845418C345644D6, 0x830A13896B78AAA9}, /* 1e-285 */
+    {0xBE5691EF416BD60C, 0x23CC986BC656D553}, /* 1e-284 */
+    {0xEDEC366B11C6CB8F, 0x2CBFBE86B7EC8AA8}, /* 1e-283 */
+    {0x94B3A202EB1C3F39, 0x7BF7D71432F3D6A9}, /* 1e-282 */
+    {0xB9E08A83A5E34F07, 0xDAF5CCD93FB0CC53}, /* 1e-281 */
+    {0xE858AD248F5C22C9, 0xD1B3400F8F9CFF68}, /* 1e-280 */
+    {0x91376C36D99995BE, 0x23100809B9C21FA1}, /* 1e-279 */
+    {0xB58547448FFFFB2D, 0xABD40A0C2832A78A}, /* 1e-278 */
+    {0xE2E69915B3FFF9F9, 0x16C90C8F323F516C}, /* 1e-277 */
+    {0x8DD01FAD907FFC3B, 0xAE3DA7D97F6792E3}, /* 1e-276 */
+    {0xB1442798F49FFB4A, 0x99CD11CFDF41779C}, /* 1e-275 */
+    {0xDD95317F31C7FA1D, 0x40405643D711D583}, /* 1e-274 */
+    {0x8A7D3EEF7F1CFC52, 0x482835EA666B2572}, /* 1e-273 */
+    {0xAD1C8EAB5EE43B66, 0xDA3243650005EECF}, /* 1e-272 */
+    {0xD863B256369D4A40, 0x90BED43E40076A82}, /* 1e-271 */
+    {0x873E4F75E2224E68, 0x5A7744A6E804A291}, /* 1e-270 */
+    {0xA90DE3535AAAE202, 0x711515D0A205CB36}, /* 1e-269 */
+    {0xD3515C2831559A83, 0x0D5A5B44CA873E03}, /* 1e-268 */
+    {0x8412D9991ED58091, 0xE858790AFE9486C2}, /* 1e-267 */
+    {0xA5178FFF668AE0B6, 0x626E974DBE39A872}, /* 1e-266 */
+    {0xCE5D73FF402D98E3, 0xFB0A3D212DC8128F}, /* 1e-265 */
+    {0x80FA687F881C7F8E, 0x7CE66634BC9D0B99}, /* 1e-264 */
+    {0xA139029F6A239F72, 0x1C1FFFC1EBC44E80}, /* 1e-263 */
+    {0xC987434744AC874E, 0xA327FFB266B56220}, /* 1e-262 */
+    {0xFBE9141915D7A922, 0x4BF1FF9F0062BAA8}, /* 1e-261 */
+    {0x9D71AC8FADA6C9B5, 0x6F773FC3603DB4A9}, /* 1e-260 */
+    {0xC4CE17B399107C22, 0xCB550FB4384D21D3}, /* 1e-259 */
+    {0xF6019DA07F549B2B, 0x7E2A53A146606A48}, /* 1e-258 */
+    {0x99C102844F94E0FB, 0x2EDA7444CBFC426D}, /* 1e-257 */
+    {0xC0314325637A1939, 0xFA911155FEFB5308}, /* 1e-256 */
+    {0xF03D93EEBC589F88, 0x793555AB7EBA27CA}, /* 1e-255 */
+    {0x96267C7535B763B5, 0x4BC1558B2F3458DE}, /* 1e-254 */
+    {0xBBB01B9283253CA2, 0x9EB1AAEDFB016F16}, /* 1e-253 */
+    {0xEA9C227723EE8BCB, 0x465E15A979C1CADC}, /* 1e-252 */
+    {0x92A1958A7675175F, 0x0BFACD89EC191EC9}, /* 1e-251 */
+    {0xB749FAED14125D36, 0xCEF980EC671F667B}, /* 1e-250 */
+    {0xE51C79A85916F484, 0x82B7E12780E7401A}, /* 1e-249 */
+    {0x8F31CC0937AE58D2, 0xD1B2ECB8B0908810}, /* 1e-248 */
+    {0xB2FE3F0B8599EF07, 0x861FA7E6DCB4AA15}, /* 1e-247 */
+    {0xDFBDCECE67006AC9, 0x67A791E093E1D49A}, /* 1e-246 */
+    {0x8BD6A141006042BD, 0xE0C8BB2C5C6D24E0}, /* 1e-245 */
+    {0xAECC49914078536D, 0x58FAE9F773886E18}, /* 1e-244 */
+    {0xDA7F5BF590966848, 0xAF39A475506A899E}, /* 1e-243 */
+    {0x888F99797A5E012D, 0x6D8406C952429603}, /* 1e-242 */
+    {0xAAB37FD7D8F58178, 0xC8E5087BA6D33B83}, /* 1e-241 */
+    {0xD5605FCDCF32E1D6, 0xFB1E4A9A90880A64}, /* 1e-240 */
+    {0x855C3BE0A17FCD26, 0x5CF2EEA09A55067F}, /* 1e-239 */
+    {0xA6B34AD8C9DFC06F, 0xF42FAA48C0EA481E}, /* 1e-238 */
+    {0xD0601D8EFC57B08B, 0xF13B94DAF124DA26}, /* 1e-237 */
+    {0x823C12795DB6CE57, 0x76C53D08D6B70858}, /* 1e-236 */
+    {0xA2CB1717B52481ED, 0x54768C4B0C64CA6E}, /* 1e-235 */
+    {0xCB7DDCDDA26DA268, 0xA9942F5DCF7DFD09}, /* 1e-234 */
+    {0xFE5D54150B090B02, 0xD3F93B35435D7C4C}, /* 1e-233 */
+    {0x9EFA548D26E5A6E1, 0xC47BC5014A1A6DAF}, /* 1e-232 */
+    {0xC6B8E9B0709F109A, 0x359AB6419CA1091B}, /* 1e-231 */
+    {0xF867241C8CC6D4C0, 0xC30163D203C94B62}, /* 1e-230 */
+    {0x9B407691D7FC44F8, 0x79E0DE63425DCF1D}, /* 1e-229 */
+    {0xC21094364DFB5636, 0x985915FC12F542E4}, /* 1e-228 */
+    {0xF294B943E17A2BC4, 0x3E6F5B7B17B2939D}, /* 1e-227 */
+    {0x979CF3CA6CEC5B5A, 0xA705992CEECF9C42}, /* 1e-226 */
+    {0xBD8430BD08277231, 0x50C6FF782A838353}, /* 1e-225 */
+    {0xECE53CEC4A314EBD, 0xA4F8BF5635246428}, /* 1e-224 */
+    {0x940F4613AE5ED136, 0x871B7795E136BE99}, /* 1e-223 */
+    {0xB913179899F68584, 0x28E2557B59846E3F}, /* 1e-222 */
+    {0xE757DD7EC07426E5, 0x331AEADA2FE589CF}, /* 1e-221 */
+    {0x9096EA6F3848984F, 0x3FF0D2C85DEF7621}, /* 1e-220 */
+    {0xB4BCA50B065ABE63, 0x0FED077A756B53A9}, /* 1e-219 */
+    {0xE1EBCE4DC7F16DFB, 0xD3E8495912C62894}, /* 1e-218 */
+    {0x8D3360F09CF6E4BD, 0x64712DD7ABBBD95C}, /* 1e-217 */
+    {0xB080392CC4349DEC, 0xBD8D794D96AACFB3}, /* 1e-216 */
+    {0xDCA04777F541C567, 0xECF0D7A0FC5583A0}, /* 1e-215 */
+    {0x89E42CAAF9491B60, 0xF41686C49DB57244}, /* 1e-214 */
+    {0xAC5D37D5B79B6239, 0x311C2875C522CED5}, /* 1e-213 */
+    {0xD77485CB25823AC7, 0x7D633293366B828B}, /* 1e-212 */
+    {0x86A8D39EF77164BC, 0xAE5DFF9C02033197}, /* 1e-211 */
+    {0xA8530886B54DBDEB, 0xD9F57F830283FDFC}, /* 1e-210 */
+    {0xD267CAA862A12D66, 0xD072DF63C324FD7B}, /* 1e-209 */
+    {0x8380DEA93DA4BC60, 0x4247CB9E59F71E6D}, /* 1e-208 */
+    {0xA46116538D0DEB78, 0x52D9BE85F074E608}, /* 1e-207 */
+    {0xCD795BE870516656, 0x67902E276C921F8B}, /* 1e-206 */
+    {0x806BD9714632DFF6, 0x00BA1CD8A3DB53B6}, /* 1e-205 */
+    {0xA086CFCD97BF97F3, 0x80E8A40ECCD228A4}, /* 1e-204 */
+    {0xC8A883C0FDAF7DF0, 0x6122CD128006B2CD}, /* 1e-203 */
+    {0xFAD2A4B13D1B5D6C, 0x796B805720085F81}, /* 1e-202 */
+    {0x9CC3A6EEC6311A63, 0xCBE3303674053BB0}, /* 1e-201 */
+    {0xC3F490AA77BD60FC, 0xBEDBFC4411068A9C}, /* 1e-200 */
+    {0xF4F1B4D515ACB93B, 0xEE92FB5515482D44}, /* 1e-199 */
+    {0x991711052D8BF3C5, 0x751BDD152D4D1C4A}, /* 1e-198 */
+    {0xBF5CD54678EEF0B6, 0xD262D45A78A0635D}, /* 1e-197 */
+    {0xEF340A98172AACE4, 0x86FB897116C87C34}, /* 1e-196 */
+    {0x9580869F0E7AAC0E, 0xD45D35E6AE3D4DA0}, /* 1e-195 */
+    {0xBAE0A846D2195712, 0x8974836059CCA109}, /* 1e-194 */
+    {0xE998D258869FACD7, 0x2BD1A438703FC94B}, /* 1e-193 */
+    {0x91FF83775423CC06, 0x7B6306A34627DDCF}, /* 1e-192 */
+    {0xB67F6455292CBF08, 0x1A3BC84C17B1D542}, /* 1e-191 */
+    {0xE41F3D6A7377EECA, 0x20CABA5F1D9E4A93}, /* 1e-190 */
+    {0x8E938662882AF53E, 0x547EB47B7282EE9C}, /* 1e-189 */
+    {0xB23867FB2A35B28D, 0xE99E619A4F23AA43}, /* 1e-188 */
+    {0xDEC681F9F4C31F31, 0x6405FA00E2EC94D4}, /* 1e-187 */
+    {0x8B3C113C38F9F37E, 0xDE83BC408DD3DD04}, /* 1e-186 */
+    {0xAE0B158B4738705E, 0x9624AB50B148D445}, /* 1e-185 */
+    {0xD98DDAEE19068C76, 0x3BADD624DD9B0957}, /* 1e-184 */
+    {0x87F8A8D4CFA417C9, 0xE54CA5D70A80E5D6}, /* 1e-183 */
+    {0xA9F6D30A038D1DBC, 0x5E9FCF4CCD211F4C}, /* 1e-182 */
+    {0xD47487CC8470652B, 0x7647C3200069671F}, /* 1e-181 */
+    {0x84C8D4DFD2C63F3B, 0x29ECD9F40041E073}, /* 1e-180 */
+    {0xA5FB0A17C777CF09, 0xF468107100525890}, /* 1e-179 */
+    {0xCF79CC9DB955C2CC, 0x7182148D4066EEB4}, /* 1e-178 */
+    {0x81AC1FE293D599BF, 0xC6F14CD848405530}, /* 1e-177 */
+    {0xA21727DB38CB002F, 0xB8ADA00E5A506A7C}, /* 1e-176 */
+    {0xCA9CF1D206FDC03B, 0xA6D90811F0E4851C}, /* 1e-175 */
+    {0xFD442E4688BD304A, 0x908F4A166D1DA663}, /* 1e-174 */
+    {0x9E4A9CEC15763E2E, 0x9A598E4E043287FE}, /* 1e-173 */
+    {0xC5DD44271AD3CDBA, 0x40EFF1E1853F29FD}, /* 1e-172 */
+    {0xF7549530E188C128, 0xD12BEE59E68EF47C}, /* 1e-171 */
+    {0x9A94DD3E8CF578B9, 0x82BB74F8301958CE}, /* 1e-170 */
+    {0xC13A148E3032D6E7, 0xE36A52363C1FAF01}, /* 1e-169 */
+    {0xF18899B1BC3F8CA1, 0xDC44E6C3CB279AC1}, /* 1e-168 */
+    {0x96F5600F15A7B7E5, 0x29AB103A5EF8C0B9}, /* 1e-167 */
+    {0xBCB2B812DB11A5DE, 0x7415D448F6B6F0E7}, /* 1e-166 */
+    {0xEBDF661791D60F56, 0x111B495B3464AD21}, /* 1e-165 */
+    {0x936B9FCEBB25C995, 0xCAB10DD900BEEC34}, /* 1e-164 */
+    {0xB84687C269EF3BFB, 0x3D5D514F40EEA742}, /* 1e-163 */
+    {0xE65829B3046B0AFA, 0x0CB4A5A3112A5112}, /* 1e-162 */
+    {0x8FF71A0FE2C2E6DC, 0x47F0E785EABA72AB}, /* 1e-161 */
+    {0xB3F4E093DB73A093, 0x59ED216765690F56}, /* 1e-160 */
+    {0xE0F218B8D25088B8, 0x306869C13EC3532C}, /* 1e-159 */
+    {0x8C974F7383725573, 0x1E414218C73A13FB}, /* 1e-158 */
+    {0xAFBD2350644EEACF, 0xE5D1929EF90898FA}, /* 1e-157 */
+    {0xDBAC6C247D62A583, 0xDF45F746B74ABF39}, /* 1e-156 */
+    {0x894BC396CE5DA772, 0x6B8BBA8C328EB783}, /* 1e-155 */
+    {0xAB9EB47C81F5114F, 0x066EA92F3F326564}, /* 1e-154 */
+    {0xD686619BA27255A2, 0xC80A537B0EFEFEBD}, /* 1e-153 */
+    {0x8613FD0145877585, 0xBD06742CE95F5F36}, /* 1e-152 */
+    {0xA798FC4196E952E7, 0x2C48113823B73704}, /* 1e-151 */
+    {0xD17F3B51FCA3A7A0, 0xF75A15862CA504C5}, /* 1e-150 */
+    {0x82EF85133DE648C4, 0x9A984D73DBE722FB}, /* 1e-149 */
+    {0xA3AB66580D5FDAF5, 0xC13E60D0D2E0EBBA}, /* 1e-148 */
+    {0xCC963FEE10B7D1B3, 0x318DF905079926A8}, /* 1e-147 */
+    {0xFFBBCFE994E5C61F, 0xFDF17746497F7052}, /* 1e-146 */
+    {0x9FD561F1FD0F9BD3, 0xFEB6EA8BEDEFA633}, /* 1e-145 */
+    {0xC7CABA6E7C5382C8, 0xFE64A52EE96B8FC0}, /* 1e-144 */
+    {0xF9BD690A1B68637B, 0x3DFDCE7AA3C673B0}, /* 1e-143 */
+    {0x9C1661A651213E2D, 0x06BEA10CA65C084E}, /* 1e-142 */
+    {0xC31BFA0FE5698DB8, 0x486E494FCFF30A62}, /* 1e-141 */
+    {0xF3E2F893DEC3F126, 0x5A89DBA3C3EFCCFA}, /* 1e-140 */
+    {0x986DDB5C6B3A76B7, 0xF89629465A75E01C}, /* 1e-139 */
+    {0xBE89523386091465, 0xF6BBB397F1135823}, /* 1e-138 */
+    {0xEE2BA6C0678B597F, 0x746AA07DED582E2C}, /* 1e-137 */
+    {0x94DB483840B717EF, 0xA8C2A44EB4571CDC}, /* 1e-136 */
+    {0xBA121A4650E4DDEB, 0x92F34D62616CE413}, /* 1e-135 */
+    {0xE896A0D7E51E1566, 0x77B020BAF9C81D17}, /* 1e-134 */
+    {0x915E2486EF32CD60, 0x0ACE1474DC1D122E}, /* 1e-133 */
+    {0xB5B5ADA8AAFF80B8, 0x0D819992132456BA}, /* 1e-132 */
+    {0xE3231912D5BF60E6, 0x10E1FFF697ED6C69}, /* 1e-131 */
+    {0x8DF5EFABC5979C8F, 0xCA8D3FFA1EF463C1}, /* 1e-130 */
+    {0xB1736B96B6FD83B3, 0xBD308FF8A6B17CB2}, /* 1e-129 */
+    {0xDDD0467C64BCE4A0, 0xAC7CB3F6D05DDBDE}, /* 1e-128 */
+    {0x8AA22C0DBEF60EE4, 0x6BCDF07A423AA96B}, /* 1e-127 */
+    {0xAD4AB7112EB3929D, 0x86C16C98D2C953C6}, /* 1e-126 */
+    {0xD89D64D57A607744, 0xE871C7BF077BA8B7}, /* 1e-125 */
+    {0x87625F056C7C4A8B, 0x11471CD764AD4972}, /* 1e-124 */
+    {0xA93AF6C6C79B5D2D, 0xD598E40D3DD89BCF}, /* 1e-123 */
+    {0xD389B47879823479, 0x4AFF1D108D4EC2C3}, /* 1e-122 */
+    {0x843610CB4BF160CB, 0xCEDF722A585139BA}, /* 1e-121 */
+    {0xA54394FE1EEDB8FE, 0xC2974EB4EE658828}, /* 1e-120 */
+    {0xCE947A3DA6A9273E, 0x733D226229FEEA32}, /* 1e-119 */
+    {0x811CCC668829B887, 0x0806357D5A3F525F}, /* 1e-118 */
+    {0xA163FF802A3426A8, 0xCA07C2DCB0CF26F7}, /* 1e-117 */
+    {0xC9BCFF6034C13052, 0xFC89B393DD02F0B5}, /* 1e-116 */
+    {0xFC2C3F3841F17C67, 0xBBAC2078D443ACE2}, /* 1e-115 */
+    {0x9D9BA7832936EDC0, 0xD54B944B84AA4C0D}, /* 1e-114 */
+    {0xC5029163F384A931, 0x0A9E795E65D4DF11}, /* 1e-113 */
+    {0xF64335BCF065D37D, 0x4D4617B5FF4A16D5}, /* 1e-112 */
+    {0x99EA0196163FA42E, 0x504BCED1BF8E4E45}, /* 1e-111 */
+    {0xC06481FB9BCF8D39, 0xE45EC2862F71E1D6}, /* 1e-110 */
+    {0xF07DA27A82C37088, 0x5D767327BB4E5A4C}, /* 1e-109 */
+    {0x964E858C91BA2655, 0x3A6A07F8D510F86F}, /* 1e-108 */
+    {0xBBE226EFB628AFEA, 0x890489F70A55368B}, /* 1e-107 */
+    {0xEADAB0ABA3B2DBE5, 0x2B45AC74CCEA842E}, /* 1e-106 */
+    {0x92C8AE6B464FC96F, 0x3B0B8BC90012929D}, /* 1e-105 */
+    {0xB77ADA0617E3BBCB, 0x09CE6EBB40173744}, /* 1e-104 */
+    {0xE55990879DDCAABD, 0xCC420A6A101D0515}, /* 1e-103 */
+    {0x8F57FA54C2A9EAB6, 0x9FA946824A12232D}, /* 1e-102 */
+    {0xB32DF8E9F3546564, 0x47939822DC96ABF9}, /* 1e-101 */
+    {0xDFF9772470297EBD, 0x59787E2B93BC56F7}, /* 1e-100 */
+    {0x8BFBEA76C619EF36, 0x57EB4EDB3C55B65A}, /* 1e-99 */
+    {0xAEFAE51477A06B03, 0xEDE622920B6B23F1}, /* 1e-98 */
+    {0xDAB99E59958885C4, 0xE95FAB368E45ECED}, /* 1e-97 */
+    {0x88B402F7FD75539B, 0x11DBCB0218EBB414}, /* 1e-96 */
+    {0xAAE103B5FCD2A881, 0xD652BDC29F26A119}, /* 1e-95 */
+    {0xD59944A37C0752A2, 0x4BE76D3346F0495F}, /* 1e-94 */
+    {0x857FCAE62D8493A5, 0x6F70A4400C562DDB}, /* 1e-93 */
+    {0xA6DFBD9FB8E5B88E, 0xCB4CCD500F6BB952}, /* 1e-92 */
+    {0xD097AD07A71F26B2, 0x7E2000A41346A7A7}, /* 1e-91 */
+    {0x825ECC24C873782F, 0x8ED400668C0C28C8}, /* 1e-90 */
+    {0xA2F67F2DFA90563B, 0x728900802F0F32FA}, /* 1e-89 */
+    {0xCBB41EF979346BCA, 0x4F2B40A03AD2FFB9}, /* 1e-88 */
+    {0xFEA126B7D78186BC, 0xE2F610C84987BFA8}, /* 1e-87 */
+    {0x9F24B832E6B0F436, 0x0DD9CA7D2DF4D7C9}, /* 1e-86 */
+    {0xC6EDE63FA05D3143, 0x91503D1C79720DBB}, /* 1e-85 */
+    {0xF8A95FCF88747D94, 0x75A44C6397CE912A}, /* 1e-84 */
+    {0x9B69DBE1B548CE7C, 0xC986AFBE3EE11ABA}, /* 1e-83 */
+    {0xC24452DA229B021B, 0xFBE85BADCE996168}, /* 1e-82 */
+    {0xF2D56790AB41C2A2, 0xFAE27299423FB9C3}, /* 1e-81 */
+    {0x97C560BA6B0919A5, 0xDCCD879FC967D41A}, /* 1e-80 */
+    {0xBDB6B8E905CB600F, 0x5400E987BBC1C920}, /* 1e-79 */
+    {0xED246723473E3813, 0x290123E9AAB23B68}, /* 1e-78 */
+    {0x9436C0760C86E30B, 0xF9A0B6720AAF6521}, /* 1e-77 */
+    {0xB94470938FA89BCE, 0xF808E40E8D5B3E69}, /* 1e-76 */
+    {0xE7958CB87392C2C2, 0xB60B1D1230B20E04}, /* 1e-75 */
+    {0x90BD77F3483BB9B9, 0xB1C6F22B5E6F48C2}, /* 1e-74 */
+    {0xB4ECD5F01A4AA828, 0x1E38AEB6360B1AF3}, /* 1e-73 */
+    {0xE2280B6C20DD5232, 0x25C6DA63C38DE1B0}, /* 1e-72 */
+    {0x8D590723948A535F, 0x579C487E5A38AD0E}, /* 1e-71 */
+    {0xB0AF48EC79ACE837, 0x2D835A9DF0C6D851}, /* 1e-70 */
+    {0xDCDB1B2798182244, 0xF8E431456CF88E65}, /* 1e-69 */
+    {0x8A08F0F8BF0F156B, 0x1B8E9ECB641B58FF}, /* 1e-68 */
+    {0xAC8B2D36EED2DAC5, 0xE272467E3D222F3F}, /* 1e-67 */
+    {0xD7ADF884AA879177, 0x5B0ED81DCC6ABB0F}, /* 1e-66 */
+    {0x86CCBB52EA94BAEA, 0x98E947129FC2B4E9}, /* 1e-65 */
+    {0xA87FEA27A539E9A5, 0x3F2398D747B36224}, /* 1e-64 */
+    {0xD29FE4B18E88640E, 0x8EEC7F0D19A03AAD}, /* 1e-63 */
+    {0x83A3EEEEF9153E89, 0x1953CF68300424AC}, /* 1e-62 */
+    {0xA48CEAAAB75A8E2B, 0x5FA8C3423C052DD7}, /* 1e-61 */
+    {0xCDB02555653131B6, 0x3792F412CB06794D}, /* 1e-60 */
+    {0x808E17555F3EBF11, 0xE2BBD88BBEE40BD0}, /* 1e-59 */
+    {0xA0B19D2AB70E6ED6, 0x5B6ACEAEAE9D0EC4}, /* 1e-58 */
+    {0xC8DE047564D20A8B, 0xF245825A5A445275}, /* 1e-57 */
+    {0xFB158592BE068D2E, 0xEED6E2F0F0D56712}, /* 1e-56 */
+    {0x9CED737BB6C4183D, 0x55464DD69685606B}, /* 1e-55 */
+    {0xC428D05AA4751E4C, 0xAA97E14C3C26B886}, /* 1e-54 */
+    {0xF53304714D9265DF, 0xD53DD99F4B3066A8}, /* 1e-53 */
+    {0x993FE2C6D07B7FAB, 0xE546A8038EFE4029}, /* 1e-52 */
+    {0xBF8FDB78849A5F96, 0xDE98520472BDD033}, /* 1e-51 */
+    {0xEF73D256A5C0F77C, 0x963E66858F6D4440}, /* 1e-50 */
+    {0x95A8637627989AAD, 0xDDE7001379A44AA8}, /* 1e-49 */
+    {0xBB127C53B17EC159, 0x5560C018580D5D52}, /* 1e-48 */
+    {0xE9D71B689DDE71AF, 0xAAB8F01E6E10B4A6}, /* 1e-47 */
+    {0x9226712162AB070D, 0xCAB3961304CA70E8}, /* 1e-46 */
+    {0xB6B00D69BB55C8D1, 0x3D607B97C5FD0D22}, /* 1e-45 */
+    {0xE45C10C42A2B3B05, 0x8CB89A7DB77C506A}, /* 1e-44 */
+    {0x8EB98A7A9A5B04E3, 0x77F3608E92ADB242}, /* 1e-43 */
+    {0xB267ED1940F1C61C, 0x55F038B237591ED3}, /* 1e-42 */
+    {0xDF01E85F912E37A3, 0x6B6C46DEC52F6688}, /* 1e-41 */
+    {0x8B61313BBABCE2C6, 0x2323AC4B3B3DA015}, /* 1e-40 */
+    {0xAE397D8AA96C1B77, 0xABEC975E0A0D081A}, /* 1e-39 */
+    {0xD9C7DCED53C72255, 0x96E7BD358C904A21}, /* 1e-38 */
+    {0x881CEA14545C7575, 0x7E50D64177DA2E54}, /* 1e-37 */
+    {0xAA242499697392D2, 0xDDE50BD1D5D0B9E9}, /* 1e-36 */
+    {0xD4AD2DBFC3D07787, 0x955E4EC64B44E864}, /* 1e-35 */
+    {0x84EC3C97DA624AB4, 0xBD5AF13BEF0B113E}, /* 1e-34 */
+    {0xA6274BBDD0FADD61, 0xECB1AD8AEACDD58E}, /* 1e-33 */
+    {0xCFB11EAD453994BA, 0x67DE18EDA5814AF2}, /* 1e-32 */
+    {0x81CEB32C4B43FCF4, 0x80EACF948770CED7}, /* 1e-31 */
+    {0xA2425FF75E14FC31, 0xA1258379A94D028D}, /* 1e-30 */
+    {0xCAD2F7F5359A3B3E, 0x096EE45813A04330}, /* 1e-29 */
+    {0xFD87B5F28300CA0D, 0x8BCA9D6E188853FC}, /* 1e-28 */
+    {0x9E74D1B791E07E48, 0x775EA264CF55347D}, /* 1e-27 */
+    {0xC612062576589DDA, 0x95364AFE032A819D}, /* 1e-26 */
+    {0xF79687AED3EEC551, 0x3A83DDBD83F52204}, /* 1e-25 */
+    {0x9ABE14CD44753B52, 0xC4926A9672793542}, /* 1e-24 */
+    {0xC16D9A0095928A27, 0x75B7053C0F178293}, /* 1e-23 */
+    {0xF1C90080BAF72CB1, 0x5324C68B12DD6338}, /* 1e-22 */
+    {0x971DA05074DA7BEE, 0xD3F6FC16EBCA5E03}, /* 1e-21 */
+    {0xBCE5086492111AEA, 0x88F4BB1CA6BCF584}, /* 1e-20 */
+    {0xEC1E4A7DB69561A5, 0x2B31E9E3D06C32E5}, /* 1e-19 */
+    {0x9392EE8E921D5D07, 0x3AFF322E62439FCF}, /* 1e-18 */
+    {0xB877AA3236A4B449, 0x09BEFEB9FAD487C2}, /* 1e-17 */
+    {0xE69594BEC44DE15B, 0x4C2EBE687989A9B3}, /* 1e-16 */
+    {0x901D7CF73AB0ACD9, 0x0F9D37014BF60A10}, /* 1e-15 */
+    {0xB424DC35095CD80F, 0x538484C19EF38C94}, /* 1e-14 */
+    {0xE12E13424BB40E13, 0x2865A5F206B06FB9}, /* 1e-13 */
+    {0x8CBCCC096F5088CB, 0xF93F87B7442E45D3}, /* 1e-12 */
+    {0xAFEBFF0BCB24AAFE, 0xF78F69A51539D748}, /* 1e-11 */
+    {0xDBE6FECEBDEDD5BE, 0xB573440E5A884D1B}, /* 1e-10 */
+    {0x89705F4136B4A597, 0x31680A88F8953030}, /* 1e-9 */
+    {0xABCC77118461CEFC, 0xFDC20D2B36BA7C3D}, /* 1e-8 */
+    {0xD6BF94D5E57A42BC, 0x3D32907604691B4C}, /* 1e-7 */
+    {0x8637BD05AF6C69B5, 0xA63F9A49C2C1B10F}, /* 1e-6 */
+    {0xA7C5AC471B478423, 0x0FCF80DC33721D53}, /* 1e-5 */
+    {0xD1B71758E219652B, 0xD3C36113404EA4A8}, /* 1e-4 */
+    {0x83126E978D4FDF3B, 0x645A1CAC083126E9}, /* 1e-3 */
+    {0xA3D70A3D70A3D70A, 0x3D70A3D70A3D70A3}, /* 1e-2 */
+    {0xCCCCCCCCCCCCCCCC, 0xCCCCCCCCCCCCCCCC}, /* 1e-1 */
+    {0x8000000000000000, 0x0000000000000000}, /* 1e0 */
+    {0xA000000000000000, 0x0000000000000000}, /* 1e1 */
+    {0xC800000000000000, 0x0000000000000000}, /* 1e2 */
+    {0xFA00000000000000, 0x0000000000000000}, /* 1e3 */
+    {0x9C40000000000000, 0x0000000000000000}, /* 1e4 */
+    {0xC350000000000000, 0x0000000000000000}, /* 1e5 */
+    {0xF424000000000000, 0x0000000000000000}, /* 1e6 */
+    {0x9896800000000000, 0x0000000000000000}, /* 1e7 */
+    {0xBEBC200000000000, 0x0000000000000000}, /* 1e8 */
+    {0xEE6B280000000000, 0x0000000000000000}, /* 1e9 */
+    {0x9502F90000000000, 0x0000000000000000}, /* 1e10 */
+    {0xBA43B74000000000, 0x0000000000000000}, /* 1e11 */
+    {0xE8D4A51000000000, 0x0000000000000000}, /* 1e12 */
+    {0x9184E72A00000000, 0x0000000000000000}, /* 1e13 */
+    {0xB5E620F480000000, 0x0000000000000000}, /* 1e14 */
+    {0xE35FA931A0000000, 0x0000000000000000}, /* 1e15 */
+    {0x8E1BC9BF04000000, 0x0000000000000000}, /* 1e16 */
+    {0xB1A2BC2EC5000000, 0x0000000000000000}, /* 1e17 */
+    {0xDE0B6B3A76400000, 0x0000000000000000}, /* 1e18 */
+    {0x8AC7230489E80000, 0x0000000000000000}, /* 1e19 */
+    {0xAD78EBC5AC620000, 0x0000000000000000}, /* 1e20 */
+    {0xD8D726B7177A8000, 0x0000000000000000}, /* 1e21 */
+    {0x878678326EAC9000, 0x0000000000000000}, /* 1e22 */
+    {0xA968163F0A57B400, 0x0000000000000000}, /* 1e23 */
+    {0xD3C21BCECCEDA100, 0x0000000000000000}, /* 1e24 */
+    {0x84595161401484A0, 0x0000000000000000}, /* 1e25 */
+    {0xA56FA5B99019A5C8, 0x0000000000000000}, /* 1e26 */
+    {0xCECB8F27F4200F3A, 0x0000000000000000}, /* 1e27 */
+    {0x813F3978F8940984, 0x4000000000000000}, /* 1e28 */
+    {0xA18F07D736B90BE5, 0x5000000000000000}, /* 1e29 */
+    {0xC9F2C9CD04674EDE, 0xA400000000000000}, /* 1e30 */
+    {0xFC6F7C4045812296, 0x4D00000000000000}, /* 1e31 */
+    {0x9DC5ADA82B70B59D, 0xF020000000000000}, /* 1e32 */
+    {0xC5371912364CE305, 0x6C28000000000000}, /* 1e33 */
+    {0xF684DF56C3E01BC6, 0xC732000000000000}, /* 1e34 */
+    {0x9A130B963A6C115C, 0x3C7F400000000000}, /* 1e35 */
+    {0xC097CE7BC90715B3, 0x4B9F100000000000}, /* 1e36 */
+    {0xF0BDC21ABB48DB20, 0x1E86D40000000000}, /* 1e37 */
+    {0x96769950B50D88F4, 0x1314448000000000}, /* 1e38 */
+    {0xBC143FA4E250EB31, 0x17D955A000000000}, /* 1e39 */
+    {0xEB194F8E1AE525FD, 0x5DCFAB0800000000}, /* 1e40 */
+    {0x92EFD1B8D0CF37BE, 0x5AA1CAE500000000}, /* 1e41 */
+    {0xB7ABC627050305AD, 0xF14A3D9E40000000}, /* 1e42 */
+    {0xE596B7B0C643C719, 0x6D9CCD05D0000000}, /* 1e43 */
+    {0x8F7E32CE7BEA5C6F, 0xE4820023A2000000}, /* 1e44 */
+    {0xB35DBF821AE4F38B, 0xDDA2802C8A800000}, /* 1e45 */
+    {0xE0352F62A19E306E, 0xD50B2037AD200000}, /* 1e46 */
+    {0x8C213D9DA502DE45, 0x4526F422CC340000}, /* 1e47 */
+    {0xAF298D050E4395D6, 0x9670B12B7F410000}, /* 1e48 */
+    {0xDAF3F04651D47B4C, 0x3C0CDD765F114000}, /* 1e49 */
+    {0x88D8762BF324CD0F, 0xA5880A69FB6AC800}, /* 1e50 */
+    {0xAB0E93B6EFEE0053, 0x8EEA0D047A457A00}, /* 1e51 */
+    {0xD5D238A4ABE98068, 0x72A4904598D6D880}, /* 1e52 */
+    {0x85A36366EB71F041, 0x47A6DA2B7F864750}, /* 1e53 */
+    {0xA70C3C40A64E6C51, 0x999090B65F67D924}, /* 1e54 */
+    {0xD0CF4B50CFE20765, 0xFFF4B4E3F741CF6D}, /* 1e55 */
+    {0x82818F1281ED449F, 0xBFF8F10E7A8921A4}, /* 1e56 */
+    {0xA321F2D7226895C7, 0xAFF72D52192B6A0D}, /* 1e57 */
+    {0xCBEA6F8CEB02BB39, 0x9BF4F8A69F764490}, /* 1e58 */
+    {0xFEE50B7025C36A08, 0x02F236D04753D5B4}, /* 1e59 */
+    {0x9F4F2726179A2245, 0x01D762422C946590}, /* 1e60 */
+    {0xC722F0EF9D80AAD6, 0x424D3AD2B7B97EF5}, /* 1e61 */
+    {0xF8EBAD2B84E0D58B, 0xD2E0898765A7DEB2}, /* 1e62 */
+    {0x9B934C3B330C8577, 0x63CC55F49F88EB2F}, /* 1e63 */
+    {0xC2781F49FFCFA6D5, 0x3CBF6B71C76B25FB}, /* 1e64 */
+    {0xF316271C7FC3908A, 0x8BEF464E3945EF7A}, /* 1e65 */
+    {0x97EDD871CFDA3A56, 0x97758BF0E3CBB5AC}, /* 1e66 */
+    {0xBDE94E8E43D0C8EC, 0x3D52EEED1CBEA317}, /* 1e67 */
+    {0xED63A231D4C4FB27, 0x4CA7AAA863EE4BDD}, /* 1e68 */
+    {0x945E455F24FB1CF8, 0x8FE8CAA93E74EF6A}, /* 1e69 */
+    {0xB975D6B6EE39E436, 0xB3E2FD538E122B44}, /* 1e70 */
+    {0xE7D34C64A9C85D44, 0x60DBBCA87196B616}, /* 1e71 */
+    {0x90E40FBEEA1D3A4A, 0xBC8955E946FE31CD}, /* 1e72 */
+    {0xB51D13AEA4A488DD, 0x6BABAB6398BDBE41}, /* 1e73 */
+    {0xE264589A4DCDAB14, 0xC696963C7EED2DD1}, /* 1e74 */
+    {0x8D7EB76070A08AEC, 0xFC1E1DE5CF543CA2}, /* 1e75 */
+    {0xB0DE65388CC8ADA8, 0x3B25A55F43294BCB}, /* 1e76 */
+    {0xDD15FE86AFFAD912, 0x49EF0EB713F39EBE}, /* 1e77 */
+    {0x8A2DBF142DFCC7AB, 0x6E3569326C784337}, /* 1e78 */
+    {0xACB92ED9397BF996, 0x49C2C37F07965404}, /* 1e79 */
+    {0xD7E77A8F87DAF7FB, 0xDC33745EC97BE906}, /* 1e80 */
+    {0x86F0AC99B4E8DAFD, 0x69A028BB3DED71A3}, /* 1e81 */
+    {0xA8ACD7C0222311BC, 0xC40832EA0D68CE0C}, /* 1e82 */
+    {0xD2D80DB02AABD62B, 0xF50A3FA490C30190}, /* 1e83 */
+    {0x83C7088E1AAB65DB, 0x792667C6DA79E0FA}, /* 1e84 */
+    {0xA4B8CAB1A1563F52, 0x577001B891185938}, /* 1e85 */
+    {0xCDE6FD5E09ABCF26, 0xED4C0226B55E6F86}, /* 1e86 */
+    {0x80B05E5AC60B6178, 0x544F8158315B05B4}, /* 1e87 */
+    {0xA0DC75F1778E39D6, 0x696361AE3DB1C721}, /* 1e88 */
+    {0xC913936DD571C84C, 0x03BC3A19CD1E38E9}, /* 1e89 */
+    {0xFB5878494ACE3A5F, 0x04AB48A04065C723}, /* 1e90 */
+    {0x9D174B2DCEC0E47B, 0x62EB0D64283F9C76}, /* 1e91 */
+    {0xC45D1DF942711D9A, 0x3BA5D0BD324F8394}, /* 1e92 */
+    {0xF5746577930D6500, 0xCA8F44EC7EE36479}, /* 1e93 */
+    {0x9968BF6ABBE85F20, 0x7E998B13CF4E1ECB}, /* 1e94 */
+    {0xBFC2EF456AE276E8, 0x9E3FEDD8C321A67E}, /* 1e95 */
+    {0xEFB3AB16C59B14A2, 0xC5CFE94EF3EA101E}, /* 1e96 */
+    {0x95D04AEE3B80ECE5, 0xBBA1F1D158724A12}, /* 1e97 */
+    {0xBB445DA9CA61281F, 0x2A8A6E45AE8EDC97}, /* 1e98 */
+    {0xEA1575143CF97226, 0xF52D09D71A3293BD}, /* 1e99 */
+    {0x924D692CA61BE758, 0x593C2626705F9C56}, /* 1e100 */
+    {0xB6E0C377CFA2E12E, 0x6F8B2FB00C77836C}, /* 1e101 */
+    {0xE498F455C38B997A, 0x0B6DFB9C0F956447}, /* 1e102 */
+    {0x8EDF98B59A373FEC, 0x4724BD4189BD5EAC}, /* 1e103 */
+    {0xB2977EE300C50FE7, 0x58EDEC91EC2CB657}, /* 1e104 */
+    {0xDF3D5E9BC0F653E1, 0x2F2967B66737E3ED}, /* 1e105 */
+    {0x8B865B215899F46C, 0xBD79E0D20082EE74}, /* 1e106 */
+    {0xAE67F1E9AEC07187, 0xECD8590680A3AA11}, /* 1e107 */
+    {0xDA01EE641A708DE9, 0xE80E6F4820CC9495}, /* 1e108 */
+    {0x884134FE908658B2, 0x3109058D147FDCDD}, /* 1e109 */
+    {0xAA51823E34A7EEDE, 0xBD4B46F0599FD415}, /* 1e110 */
+    {0xD4E5E2CDC1D1EA96, 0x6C9E18AC7007C91A}, /* 1e111 */
+    {0x850FADC09923329E, 0x03E2CF6BC604DDB0}, /* 1e112 */
+    {0xA6539930BF6BFF45, 0x84DB8346B786151C}, /* 1e113 */
+    {0xCFE87F7CEF46FF16, 0xE612641865679A63}, /* 1e114 */
+    {0x81F14FAE158C5F6E, 0x4FCB7E8F3F60C07E}, /* 1e115 */
+    {0xA26DA3999AEF7749, 0xE3BE5E330F38F09D}, /* 1e116 */
+    {0xCB090C8001AB551C, 0x5CADF5BFD3072CC5}, /* 1e117 */
+    {0xFDCB4FA002162A63, 0x73D9732FC7C8F7F6}, /* 1e118 */
+    {0x9E9F11C4014DDA7E, 0x2867E7FDDCDD9AFA}, /* 1e119 */
+    {0xC646D63501A1511D, 0xB281E1FD541501B8}, /* 1e120 */
+    {0xF7D88BC24209A565, 0x1F225A7CA91A4226}, /* 1e121 */
+    {0x9AE757596946075F, 0x3375788DE9B06958}, /* 1e122 */
+    {0xC1A12D2FC3978937, 0x0052D6B1641C83AE}, /* 1e123 */
+    {0xF209787BB47D6B84, 0xC0678C5DBD23A49A}, /* 1e124 */
+    {0x9745EB4D50CE6332, 0xF840B7BA963646E0}, /* 1e125 */
+    {0xBD176620A501FBFF, 0xB650E5A93BC3D898}, /* 1e126 */
+    {0xEC5D3FA8CE427AFF, 0xA3E51F138AB4CEBE}, /* 1e127 */
+    {0x93BA47C980E98CDF, 0xC66F336C36B10137}, /* 1e128 */
+    {0xB8A8D9BBE123F017, 0xB80B0047445D4184}, /* 1e129 */
+    {0xE6D3102AD96CEC1D, 0xA60DC059157491E5}, /* 1e130 */
+    {0x9043EA1AC7E41392, 0x87C89837AD68DB2F}, /* 1e131 */
+    {0xB454E4A179DD1877, 0x29BABE4598C311FB}, /* 1e132 */
+    {0xE16A1DC9D8545E94, 0xF4296DD6FEF3D67A}, /* 1e133 */
+    {0x8CE2529E2734BB1D, 0x1899E4A65F58660C}, /* 1e134 */
+    {0xB01AE745B101E9E4, 0x5EC05DCFF72E7F8F}, /* 1e135 */
+    {0xDC21A1171D42645D, 0x76707543F4FA1F73}, /* 1e136 */
+    {0x899504AE72497EBA, 0x6A06494A791C53A8}, /* 1e137 */
+    {0xABFA45DA0EDBDE69, 0x0487DB9D17636892}, /* 1e138 */
+    {0xD6F8D7509292D603, 0x45A9D2845D3C42B6}, /* 1e139 */
+    {0x865B86925B9BC5C2, 0x0B8A2392BA45A9B2}, /* 1e140 */
+    {0xA7F26836F282B732, 0x8E6CAC7768D7141E}, /* 1e141 */
+    {0xD1EF0244AF2364FF, 0x3207D795430CD926}, /* 1e142 */
+    {0x8335616AED761F1F, 0x7F44E6BD49E807B8}, /* 1e143 */
+    {0xA402B9C5A8D3A6E7, 0x5F16206C9C6209A6}, /* 1e144 */
+    {0xCD036837130890A1, 0x36DBA887C37A8C0F}, /* 1e145 */
+    {0x802221226BE55A64, 0xC2494954DA2C9789}, /* 1e146 */
+    {0xA02AA96B06DEB0FD, 0xF2DB9BAA10B7BD6C}, /* 1e147 */
+    {0xC83553C5C8965D3D, 0x6F92829494E5ACC7}, /* 1e148 */
+    {0xFA42A8B73ABBF48C, 0xCB772339BA1F17F9}, /* 1e149 */
+    {0x9C69A97284B578D7, 0xFF2A760414536EFB}, /* 1e150 */
+    {0xC38413CF25E2D70D, 0xFEF5138519684ABA}, /* 1e151 */
+    {0xF46518C2EF5B8CD1, 0x7EB258665FC25D69}, /* 1e152 */
+    {0x98BF2F79D5993802, 0xEF2F773FFBD97A61}, /* 1e153 */
+    {0xBEEEFB584AFF8603, 0xAAFB550FFACFD8FA}, /* 1e154 */
+    {0xEEAABA2E5DBF6784, 0x95BA2A53F983CF38}, /* 1e155 */
+    {0x952AB45CFA97A0B2, 0xDD945A747BF26183}, /* 1e156 */
+    {0xBA756174393D88DF, 0x94F971119AEEF9E4}, /* 1e157 */
+    {0xE912B9D1478CEB17, 0x7A37CD5601AAB85D}, /* 1e158 */
+    {0x91ABB422CCB812EE, 0xAC62E055C10AB33A}, /* 1e159 */
+    {0xB616A12B7FE617AA, 0x577B986B314D6009}, /* 1e160 */
+    {0xE39C49765FDF9D94, 0xED5A7E85FDA0B80B}, /* 1e161 */
+    {0x8E41ADE9FBEBC27D, 0x14588F13BE847307}, /* 1e162 */
+    {0xB1D219647AE6B31C, 0x596EB2D8AE258FC8}, /* 1e163 */
+    {0xDE469FBD99A05FE3, 0x6FCA5F8ED9AEF3BB}, /* 1e164 */
+    {0x8AEC23D680043BEE, 0x25DE7BB9480D5854}, /* 1e165 */
+    {0xADA72CCC20054AE9, 0xAF561AA79A10AE6A}, /* 1e166 */
+    {0xD910F7FF28069DA4, 0x1B2BA1518094DA04}, /* 1e167 */
+    {0x87AA9AFF79042286, 0x90FB44D2F05D0842}, /* 1e168 */
+    {0xA99541BF57452B28, 0x353A1607AC744A53}, /* 1e169 */
+    {0xD3FA922F2D1675F2, 0x42889B8997915CE8}, /* 1e170 */
+    {0x847C9B5D7C2E09B7, 0x69956135FEBADA11}, /* 1e171 */
+    {0xA59BC234DB398C25, 0x43FAB9837E699095}, /* 1e172 */
+    {0xCF02B2C21207EF2E, 0x94F967E45E03F4BB}, /* 1e173 */
+    {0x8161AFB94B44F57D, 0x1D1BE0EEBAC278F5}, /* 1e174 */
+    {0xA1BA1BA79E1632DC, 0x6462D92A69731732}, /* 1e175 */
+    {0xCA28A291859BBF93, 0x7D7B8F7503CFDCFE}, /* 1e176 */
+    {0xFCB2CB35E702AF78, 0x5CDA735244C3D43E}, /* 1e177 */
+    {0x9DEFBF01B061ADAB, 0x3A0888136AFA64A7}, /* 1e178 */
+    {0xC56BAEC21C7A1916, 0x088AAA1845B8FDD0}, /* 1e179 */
+    {0xF6C69A72A3989F5B, 0x8AAD549E57273D45}, /* 1e180 */
+    {0x9A3C2087A63F6399, 0x36AC54E2F678864B}, /* 1e181 */
+    {0xC0CB28A98FCF3C7F, 0x84576A1BB416A7DD}, /* 1e182 */
+    {0xF0FDF2D3F3C30B9F, 0x656D44A2A11C51D5}, /* 1e183 */
+    {0x969EB7C47859E743, 0x9F644AE5A4B1B325}, /* 1e184 */
+    {0xBC4665B596706114, 0x873D5D9F0DDE1FEE}, /* 1e185 */
+    {0xEB57FF22FC0C7959, 0xA90CB506D155A7EA}, /* 1e186 */
+    {0x9316FF75DD87CBD8, 0x09A7F12442D588F2}, /* 1e187 */
+    {0xB7DCBF5354E9BECE, 0x0C11ED6D538AEB2F}, /* 1e188 */
+    {0xE5D3EF282A242E81, 0x8F1668C8A86DA5FA}, /* 1e189 */
+    {0x8FA475791A569D10, 0xF96E017D694487BC}, /* 1e190 */
+    {0xB38D92D760EC4455, 0x37C981DCC395A9AC}, /* 1e191 */
+    {0xE070F78D3927556A, 0x85BBE253F47B1417}, /* 1e192 */
+    {0x8C469AB843B89562, 0x93956D7478CCEC8E}, /* 1e193 */
+    {0xAF58416654A6BABB, 0x387AC8D1970027B2}, /* 1e194 */
+    {0xDB2E51BFE9D0696A, 0x06997B05FCC0319E}, /* 1e195 */
+    {0x88FCF317F22241E2, 0x441FECE3BDF81F03}, /* 1e196 */
+    {0xAB3C2FDDEEAAD25A, 0xD527E81CAD7626C3}, /* 1e197 */
+    {0xD60B3BD56A5586F1, 0x8A71E223D8D3B074}, /* 1e198 */
+    {0x85C7056562757456, 0xF6872D5667844E49}, /* 1e199 */
+    {0xA738C6BEBB12D16C, 0xB428F8AC016561DB}, /* 1e200 */
+    {0xD106F86E69D785C7, 0xE13336D701BEBA52}, /* 1e201 */
+    {0x82A45B450226B39C, 0xECC0024661173473}, /* 1e202 */
+    {0xA34D721642B06084, 0x27F002D7F95D0190}, /* 1e203 */
+    {0xCC20CE9BD35C78A5, 0x31EC038DF7B441F4}, /* 1e204 */
+    {0xFF290242C83396CE, 0x7E67047175A15271}, /* 1e205 */
+    {0x9F79A169BD203E41, 0x0F0062C6E984D386}, /* 1e206 */
+    {0xC75809C42C684DD1, 0x52C07B78A3E60868}, /* 1e207 */
+    {0xF92E0C3537826145, 0xA7709A56CCDF8A82}, /* 1e208 */
+    {0x9BBCC7A142B17CCB, 0x88A66076400BB691}, /* 1e209 */
+    {0xC2ABF989935DDBFE, 0x6ACFF893D00EA435}, /* 1e210 */
+    {0xF356F7EBF83552FE, 0x0583F6B8C4124D43}, /* 1e211 */
+    {0x98165AF37B2153DE, 0xC3727A337A8B704A}, /* 1e212 */
+    {0xBE1BF1B059E9A8D6, 0x744F18C0592E4C5C}, /* 1e213 */
+    {0xEDA2EE1C7064130C, 0x1162DEF06F79DF73}, /* 1e214 */
+    {0x9485D4D1C63E8BE7, 0x8ADDCB5645AC2BA8}, /* 1e215 */
+    {0xB9A74A0637CE2EE1, 0x6D953E2BD7173692}, /* 1e216 */
+    {0xE8111C87C5C1BA99, 0xC8FA8DB6CCDD0437}, /* 1e217 */
+    {0x910AB1D4DB9914A0, 0x1D9C9892400A22A2}, /* 1e218 */
+    {0xB54D5E4A127F59C8, 0x2503BEB6D00CAB4B}, /* 1e219 */
+    {0xE2A0B5DC971F303A, 0x2E44AE64840FD61D}, /* 1e220 */
+    {0x8DA471A9DE737E24, 0x5CEAECFED289E5D2}, /* 1e221 */
+    {0xB10D8E1456105DAD, 0x7425A83E872C5F47}, /* 1e222 */
+    {0xDD50F1996B947518, 0xD12F124E28F77719}, /* 1e223 */
+    {0x8A5296FFE33CC92F, 0x82BD6B70D99AAA6F}, /* 1e224 */
+    {0xACE73CBFDC0BFB7B, 0x636CC64D1001550B}, /* 1e225 */
+    {0xD8210BEFD30EFA5A, 0x3C47F7E05401AA4E}, /* 1e226 */
+    {0x8714A775E3E95C78, 0x65ACFAEC34810A71}, /* 1e227 */
+    {0xA8D9D1535CE3B396, 0x7F1839A741A14D0D}, /* 1e228 */
+    {0xD31045A8341CA07C, 0x1EDE48111209A050}, /* 1e229 */
+    {0x83EA2B892091E44D, 0x934AED0AAB460432}, /* 1e230 */
+    {0xA4E4B66B68B65D60, 0xF81DA84D5617853F}, /* 1e231 */
+    {0xCE1DE40642E3F4B9, 0x36251260AB9D668E}, /* 1e232 */
+    {0x80D2AE83E9CE78F3, 0xC1D72B7C6B426019}, /* 1e233 */
+    {0xA1075A24E4421730, 0xB24CF65B8612F81F}, /* 1e234 */
+    {0xC94930AE1D529CFC, 0xDEE033F26797B627}, /* 1e235 */
+    {0xFB9B7CD9A4A7443C, 0x169840EF017DA3B1}, /* 1e236 */
+    {0x9D412E0806E88AA5, 0x8E1F289560EE864E}, /* 1e237 */
+    {0xC491798A08A2AD4E, 0xF1A6F2BAB92A27E2}, /* 1e238 */
+    {0xF5B5D7EC8ACB58A2, 0xAE10AF696774B1DB}, /* 1e239 */
+    {0x9991A6F3D6BF1765, 0xACCA6DA1E0A8EF29}, /* 1e240 */
+    {0xBFF610B0CC6EDD3F, 0x17FD090A58D32AF3}, /* 1e241 */
+    {0xEFF394DCFF8A948E, 0xDDFC4B4CEF07F5B0}, /* 1e242 */
+    {0x95F83D0A1FB69CD9, 0x4ABDAF101564F98E}, /* 1e243 */
+    {0xBB764C4CA7A4440F, 0x9D6D1AD41ABE37F1}, /* 1e244 */
+    {0xEA53DF5FD18D5513, 0x84C86189216DC5ED}, /* 1e245 */
+    {0x92746B9BE2F8552C, 0x32FD3CF5B4E49BB4}, /* 1e246 */
+    {0xB7118682DBB66A77, 0x3FBC8C33221DC2A1}, /* 1e247 */
+    {0xE4D5E82392A40515, 0x0FABAF3FEAA5334A}, /* 1e248 */
+    {0x8F05B1163BA6832D, 0x29CB4D87F2A7400E}, /* 1e249 */
+    {0xB2C71D5BCA9023F8, 0x743E20E9EF511012}, /* 1e250 */
+    {0xDF78E4B2BD342CF6, 0x914DA9246B255416}, /* 1e251 */
+    {0x8BAB8EEFB6409C1A, 0x1AD089B6C2F7548E}, /* 1e252 */
+    {0xAE9672ABA3D0C320, 0xA184AC2473B529B1}, /* 1e253 */
+    {0xDA3C0F568CC4F3E8, 0xC9E5D72D90A2741E}, /* 1e254 */
+    {0x8865899617FB1871, 0x7E2FA67C7A658892}, /* 1e255 */
+    {0xAA7EEBFB9DF9DE8D, 0xDDBB901B98FEEAB7}, /* 1e256 */
+    {0xD51EA6FA85785631, 0x552A74227F3EA565}, /* 1e257 */
+    {0x8533285C936B35DE, 0xD53A88958F87275F}, /* 1e258 */
+    {0xA67FF273B8460356, 0x8A892ABAF368F137}, /* 1e259 */
+    {0xD01FEF10A657842C, 0x2D2B7569B0432D85}, /* 1e260 */
+    {0x8213F56A67F6B29B, 0x9C3B29620E29FC73}, /* 1e261 */
+    {0xA298F2C501F45F42, 0x8349F3BA91B47B8F}, /* 1e262 */
+    {0xCB3F2F7642717713, 0x241C70A936219A73}, /* 1e263 */
+    {0xFE0EFB53D30DD4D7, 0xED238CD383AA0110}, /* 1e264 */
+    {0x9EC95D1463E8A506, 0xF4363804324A40AA}, /* 1e265 */
+    {0xC67BB4597CE2CE48, 0xB143C6053EDCD0D5}, /* 1e266 */
+    {0xF81AA16FDC1B81DA, 0xDD94B7868E94050A}, /* 1e267 */
+    {0x9B10A4E5E9913128, 0xCA7CF2B4191C8326}, /* 1e268 */
+    {0xC1D4CE1F63F57D72, 0xFD1C2F611F63A3F0}, /* 1e269 */
+    {0xF24A01A73CF2DCCF, 0xBC633B39673C8CEC}, /* 1e270 */
+    {0x976E41088617CA01, 0xD5BE0503E085D813}, /* 1e271 */
+    {0xBD49D14AA79DBC82, 0x4B2D8644D8A74E18}, /* 1e272 */
+    {0xEC9C459D51852BA2, 0xDDF8E7D60ED1219E}, /* 1e273 */
+    {0x93E1AB8252F33B45, 0xCABB90E5C942B503}, /* 1e274 */
+    {0xB8DA1662E7B00A17, 0x3D6A751F3B936243}, /* 1e275 */
+    {0xE7109BFBA19C0C9D, 0x0CC512670A783AD4}, /* 1e276 */
+    {0x906A617D450187E2, 0x27FB2B80668B24C5}, /* 1e277 */
+    {0xB484F9DC9641E9DA, 0xB1F9F660802DEDF6}, /* 1e278 */
+    {0xE1A63853BBD26451, 0x5E7873F8A0396973}, /* 1e279 */
+    {0x8D07E33455637EB2, 0xDB0B487B6423E1E8}, /* 1e280 */
+    {0xB049DC016ABC5E5F, 0x91CE1A9A3D2CDA62}, /* 1e281 */
+    {0xDC5C5301C56B75F7, 0x7641A140CC7810FB}, /* 1e282 */
+    {0x89B9B3E11B6329BA, 0xA9E904C87FCB0A9D}, /* 1e283 */
+    {0xAC2820D9623BF429, 0x546345FA9FBDCD44}, /* 1e284 */
+    {0xD732290FBACAF133, 0xA97C177947AD4095}, /* 1e285 */
+    {0x867F59A9D4BED6C0, 0x49ED8EABCCCC485D}, /* 1e286 */
+    {0xA81F301449EE8C70, 0x5C68F256BFFF5A74}, /* 1e287 */
+    {0xD226FC195C6A2F8C, 0x73832EEC6FFF3111}, /* 1e288 */
+    {0x83585D8FD9C25DB7, 0xC831FD53C5FF7EAB}, /* 1e289 */
+    {0xA42E74F3D032F525, 0xBA3E7CA8B77F5E55}, /* 1e290 */
+    {0xCD3A1230C43FB26F, 0x28CE1BD2E55F35EB}, /* 1e291 */
+    {0x80444B5E7AA7CF85, 0x7980D163CF5B81B3}, /* 1e292 */
+    {0xA0555E361951C366, 0xD7E105BCC332621F}, /* 1e293 */
+    {0xC86AB5C39FA63440, 0x8DD9472BF3FEFAA7}, /* 1e294 */
+    {0xFA856334878FC150, 0xB14F98F6F0FEB951}, /* 1e295 */
+    {0x9C935E00D4B9D8D2, 0x6ED1BF9A569F33D3}, /* 1e296 */
+    {0xC3B8358109E84F07, 0x0A862F80EC4700C8}, /* 1e297 */
+    {0xF4A642E14C6262C8, 0xCD27BB612758C0FA}, /* 1e298 */
+    {0x98E7E9CCCFBD7DBD, 0x8038D51CB897789C}, /* 1e299 */
+    {0xBF21E44003ACDD2C, 0xE0470A63E6BD56C3}, /* 1e300 */
+    {0xEEEA5D5004981478, 0x1858CCFCE06CAC74}, /* 1e301 */
+    {0x95527A5202DF0CCB, 0x0F37801E0C43EBC8}, /* 1e302 */
+    {0xBAA718E68396CFFD, 0xD30560258F54E6BA}, /* 1e303 */
+    {0xE950DF20247C83FD, 0x47C6B82EF32A2069}, /* 1e304 */
+    {0x91D28B7416CDD27E, 0x4CDC331D57FA5441}, /* 1e305 */
+    {0xB6472E511C81471D, 0xE0133FE4ADF8E952}, /* 1e306 */
+    {0xE3D8F9E563A198E5, 0x58180FDDD97723A6}, /* 1e307 */
+    {0x8E679C2F5E44FF8F, 0x570F09EAA7EA7648}, /* 1e308 */
+    {0xB201833B35D63F73, 0x2CD2CC6551E513DA}, /* 1e309 */
+    {0xDE81E40A034BCF4F, 0xF8077F7EA65E58D1}, /* 1e310 */
+    {0x8B112E86420F6191, 0xFB04AFAF27FAF782}, /* 1e311 */
+    {0xADD57A27D29339F6, 0x79C5DB9AF1F9B563}, /* 1e312 */
+    {0xD94AD8B1C7380874, 0x18375281AE7822BC}, /* 1e313 */
+    {0x87CEC76F1C830548, 0x8F2293910D0B15B5}, /* 1e314 */
+    {0xA9C2794AE3A3C69A, 0xB2EB3875504DDB22}, /* 1e315 */
+    {0xD433179D9C8CB841, 0x5FA60692A46151EB}, /* 1e316 */
+    {0x849FEEC281D7F328, 0xDBC7C41BA6BCD333}, /* 1e317 */
+    {0xA5C7EA73224DEFF3, 0x12B9B522906C0800}, /* 1e318 */
+    {0xCF39E50FEAE16BEF, 0xD768226B34870A00}, /* 1e319 */
+    {0x81842F29F2CCE375, 0xE6A1158300D46640}, /* 1e320 */
+    {0xA1E53AF46F801C53, 0x60495AE3C1097FD0}, /* 1e321 */
+    {0xCA5E89B18B602368, 0x385BB19CB14BDFC4}, /* 1e322 */
+    {0xFCF62C1DEE382C42, 0x46729E03DD9ED7B5}, /* 1e323 */
+    {0x9E19DB92B4E31BA9, 0x6C07A2C26A8346D1}, /* 1e324 */
+};
 
-size_t json_object_dotget_string_len(const JSON_Object *object,
-                                     const char *name) {
-  return json_value_get_string_len(json_object_dotget_value(object, name));
-}
+static constexpr double exact_powers_of_ten[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
 
-double json_object_dotget_number(const JSON_Object *object, const char *name) {
-  return json_value_get_number(json_object_dotget_value(object, name));
-}
+static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
 
-JSON_Object *json_object_dotget_object(const JSON_Object *object,
-                                       const char *name) {
-  return json_value_get_object(json_object_dotget_value(object, name));
+/* floor(x / 2^shift), also for negative x */
+static inline int64_t floor_div_pow2(int64_t x, int shift) {
+  return x >= 0 ? x >> shift : -((-x + ((int64_t)1 << shift) - 1) >> shift);
 }
 
-JSON_Array *json_object_dotget_array(const JSON_Object *object,
-                                     const char *name) {
-  return json_value_get_array(json_object_dotget_value(object, name));
+/* floor(e * log2(10)) for |e| <= 1233 */
+static inline int64_t floor_log2_pow10(int64_t e) {
+  return floor_div_pow2(e * 1'741'647, 19);
 }
 
-JSON_Boolean json_object_dotget_boolean(const JSON_Object *object,
-                                        const char *name) {
-  return json_value_get_boolean(json_object_dotget_value(object, name));
+/* Returns the low 64 bits of a * b and stores the high 64 bits in *high. */
+static inline uint64_t multiply_u64(uint64_t a, uint64_t b, uint64_t *high) {
+#if defined(__SIZEOF_INT128__)
+  __extension__ typedef unsigned __int128 uint128;
+  const uint128 product = (uint128)a * b;
+  *high = (uint64_t)(product >> 64);
+  return (uint64_t)product;
+#else
+  const uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+  const uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+  const uint64_t lo_lo = a_lo * b_lo, hi_lo = a_hi * b_lo;
+  const uint64_t lo_hi = a_lo * b_hi, hi_hi = a_hi * b_hi;
+  const uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+  *high = (hi_lo >> 32) + (cross >> 32) + hi_hi;
+  return (cross << 32) | (uint32_t)lo_lo;
+#endif
 }
 
-size_t json_object_get_count(const JSON_Object *object) {
-  return object == nullptr ? 0 : object->count;
+/* Eisel-Lemire: computes mantissa * 10^exp10 correctly rounded, or returns
+   false if the result can't be decided from 128 bits of 10^exp10 or isn't a
+   normal double. mantissa must be non-zero. */
+static bool eisel_lemire(uint64_t mantissa, int64_t exp10, double *result) {
+  const uint64_t *power =
+      power_of_ten_mantissas[exp10 - power_of_ten_min_exp10];
+  const unsigned int shift = leading_zeros_u64(mantissa);
+  mantissa <<= shift;
+  const int64_t exp2_of_power = floor_log2_pow10(exp10);
+  uint64_t exp2 = (uint64_t)(exp2_of_power + 64 + 1'023) - shift;
+  uint64_t x_hi = 0;
+  uint64_t x_lo = multiply_u64(mantissa, power[0], &x_hi);
+  if ((x_hi & 0x1FF) == 0x1FF && x_lo + mantissa < mantissa) {
+    /* the low bits of the power of ten might carry into the result */
+    uint64_t y_hi = 0;
+    const uint64_t y_lo = multiply_u64(mantissa, power[1], &y_hi);
+    uint64_t merged_hi = x_hi;
+    const uint64_t merged_lo = x_lo + y_hi;
+    if (merged_lo < x_lo) {
+      merged_hi++;
+    }
+    if ((merged_hi & 0x1FF) == 0x1FF && merged_lo + 1 == 0 &&
+        y_lo + mantissa < mantissa) {
+      return false;
+    }
+    x_hi = merged_hi;
+    x_lo = merged_lo;
+  }
+  const uint64_t msb = x_hi >> 63;
+  uint64_t bits = x_hi >> (msb + 9); /* 54 bits */
+  exp2 -= 1 ^ msb;
+  if (x_lo == 0 && (x_hi & 0x1FF) == 0 && (bits & 3) == 1) {
+    return false; /* exactly halfway between two doubles */
+  }
+  bits += bits & 1; /* round to 53 bits */
+  bits >>= 1;
+  if ((bits >> 53) > 0) {
+    bits >>= 1;
+    exp2++;
+  }
+  if (exp2 - 1 >= 0x7FF - 1) {
+    return false; /* subnormal or out of range */
+  }
+  bits = (exp2 << 52) | (bits & 0x000F'FFFF'FFFF'FFFFULL);
+  memcpy(result, &bits, sizeof(*result));
+  return true;
 }
 
-const char *json_object_get_name(const JSON_Object *object, size_t index) {
-  if (object == nullptr || index >= json_object_get_count(object)) {
-    return nullptr;
+/* Slow path: strtod on a copy of the already validated number, with '.'
+   replaced by the decimal point of the current locale. */
+static JSON_Status parse_number_strtod(const char *string, size_t len,
+                                       double *result) {
+  const char *decimal_point = localeconv()->decimal_point;
+  const size_t point_len = strlen(decimal_point);
+  const size_t buf_size = len + point_len + 1;
+  char small_buf[64];
+  char *buf = small_buf, *end = nullptr;
+  size_t buf_len = 0;
+  if (buf_size > sizeof(small_buf)) {
+    buf = (char *)parson_malloc(buf_size);
+    if (buf == nullptr) {
+      return JSONFailure;
+    }
+  }
+  for (size_t i = 0; i < len; i++) {
+    if (string[i] == '.') {
+      memcpy(buf + buf_len, decimal_point, point_len);
+      buf_len += point_len;
+    } else {
+      buf[buf_len++] = string[i];
+    }
+  }
+  buf[buf_len] = '\0';
+  *result = strtod(buf, &end);
+  const bool consumed_all = end == buf + buf_len;
+  if (buf != small_buf) {
+    parson_free(buf);
+  }
+  return consumed_all ? JSONSuccess : JSONFailure;
+}
+
+/* Parses a number as defined by the JSON grammar and skips past it, reading
+   no further than end. */
+static JSON_Status parse_number(const char **string, const char *end,
+                                double *result) {
+  const char *ptr = *string;
+  uint64_t mantissa = 0;
+  int digit_count = 0; /* significant digits in mantissa */
+  int64_t exp10 = 0;
+  bool truncated = false; /* non-zero digits didn't fit into mantissa */
+  double value = 0.0;
+  const bool negative = ptr < end && *ptr == '-';
+  if (negative) {
+    ptr++;
+  }
+  const char *digits = ptr;
+  if (ptr < end && *ptr == '0') {
+    ptr++;
+    if (ptr < end && is_digit(*ptr)) {
+      return JSONFailure; /* leading zeros (and octals) */
+    }
+  } else if (ptr < end && is_digit(*ptr)) {
+    for (; ptr < end && is_digit(*ptr); ptr++) {
+      if (digit_count < max_mantissa_digits) {
+        mantissa = mantissa * 10 + (uint64_t)(*ptr - '0');
+        digit_count++;
+      } else {
+        truncated |= *ptr != '0';
+        exp10++;
+      }
+    }
+  } else {
+    return JSONFailure;
+  }
+  if (ptr < end && *ptr == '.') {
+    ptr++;
+    if (ptr == end || !is_digit(*ptr)) {
+      return JSONFailure;
+    }
+    for (; ptr < end && is_digit(*ptr); ptr++) {
+      if (mantissa == 0 && *ptr == '0') {
+        exp10--; /* leading zeros aren't significant */
+      } else if (digit_count < max_mantissa_digits) {
+        mantissa = mantissa * 10 + (uint64_t)(*ptr - '0');
+        digit_count++;
+        exp10--;
+      } else {
+        truncated |= *ptr != '0';
+      }
+    }
+  }
+  if (ptr < end && (*ptr == 'e' || *ptr == 'E')) {
+    int64_t exponent = 0;
+    bool exponent_negative = false;
+    ptr++;
+    if (ptr < end && (*ptr == '+' || *ptr == '-')) {
+      exponent_negative = *ptr == '-';
+      ptr++;
+    }
+    if (ptr == end || !is_digit(*ptr)) {
+      return JSONFailure;
+    }
+    for (; ptr < end && is_digit(*ptr); ptr++) {
+      if (exponent < 100'000'000) { /* far beyond the range of doubles */
+        exponent = exponent * 10 + (*ptr - '0');
+      }
+    }
+    exp10 += exponent_negative ? -exponent : exponent;
   }
-  return object->names[index];
-}
 
-JSON_Value *json_object_get_value_at(const JSON_Object *object, size_t index) {
-  if (object == nullptr || index >= json_object_get_count(object)) {
-    return nullptr;
+  if (mantissa == 0 || exp10 < power_of_ten_min_exp10) {
+    value = 0.0;
+  } else if (exp10 > max_double_exp10) {
+    return JSONFailure; /* too large for a double */
+  } else {
+    bool converted = false;
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    if (!truncated && mantissa <= (1ULL << 53) && exp10 >= -22 &&
+        exp10 <= 22) {
+      value = (double)mantissa;
+      value = exp10 < 0 ? value / exact_powers_of_ten[-exp10]
+                        : value * exact_powers_of_ten[exp10];
+      converted = true;
+    }
+#endif
+    if (!converted && eisel_lemire(mantissa, exp10, &value)) {
+      double upper = 0.0;
+      /* the digits lie between mantissa and mantissa + 1 */
+      converted = !truncated ||
+                  (eisel_lemire(mantissa + 1, exp10, &upper) && upper == value);
+    }
+    if (!converted &&
+        parse_number_strtod(digits, (size_t)(ptr - digits), &value) !=
+            JSONSuccess) {
+      return JSONFailure;
+    }
+  }
+  if (is_number_invalid(value)) {
+    return JSONFailure;
   }
-  return object->values[index];
+  *result = negative ? -value : value;
+  *string = ptr;
+  return JSONSuccess;
+}
+
+static JSON_Status skip_quotes(const char **string, const char *end) {
+  const char *ptr = *string;
+  if (*ptr != '\"') {
+    return JSONFailure;
+  }
+  ptr++;
+  while (true) {
+    ptr += scan_string_run(ptr, end, false);
+    if (ptr == end || *ptr == '\0') {
+      return JSONFailure;
+    } else if (*ptr == '\"') {
+      break;
+    } else if (*ptr == '\\') {
+      ptr++;
+      if (ptr == end || *ptr == '\0') {
+        return JSONFailure;
+      }
+    }
+    ptr++;
+  }
+  *string = ptr + 1;
+  return JSONSuccess;
+}
+
+/* Skips the rest of a container whose opening bracket has been consumed,
+   checking only that brackets outside strings balance. */
+static JSON_Status skip_container(const char **string, const char *end) {
+  const char *ptr = *string;
+  size_t depth = 1;
+  while (depth > 0) {
+    if (ptr == end) {
+      return JSONFailure;
+    }
+    switch (*ptr) {
+    case '\"':
+      if (skip_quotes(&ptr, end) != JSONSuccess) {
+        return JSONFailure;
+      }
+      continue;
+    case '{':
+    case '[':
+      depth++;
+      break;
+    case '}':
+    case ']':
+      depth--;
+      break;
+    case '\0':
+      return JSONFailure;
+    default:
+      break;
+    }
+    ptr++;
+  }
+  *string = ptr;
+  return JSONSuccess;
+}
+
+static JSON_Status parse_utf16(const char **unprocessed, const char *end,
+                               char **processed) {
+  unsigned int cp, lead, trail;
+  char *processed_ptr = *processed;
+  const char *unprocessed_ptr = *unprocessed;
+  JSON_Status status = JSONFailure;
+  unprocessed_ptr++; /* skips u */
+  status = parse_utf16_hex(unprocessed_ptr, end, &cp);
+  if (status != JSONSuccess) {
+    return JSONFailure;
+  }
+  if (cp < 0x80) {
+    processed_ptr[0] = (char)cp; /* 0xxxxxxx */
+  } else if (cp < 0x800) {
+    processed_ptr[0] = ((cp >> 6) & 0x1F) | 0xC0; /* 110xxxxx */
+    processed_ptr[1] = ((cp) & 0x3F) | 0x80;      /* 10xxxxxx */
+    processed_ptr += 1;
+  } else if (cp < 0xD800 || cp > 0xDFFF) {
+    processed_ptr[0] = ((cp >> 12) & 0x0F) | 0xE0; /* 1110xxxx */
+    processed_ptr[1] = ((cp >> 6) & 0x3F) | 0x80;  /* 10xxxxxx */
+    processed_ptr[2] = ((cp) & 0x3F) | 0x80;       /* 10xxxxxx */
+    processed_ptr += 2;
+  } else if (cp >= 0xD800 &&
+             cp <= 0xDBFF) { /* lead surrogate (0xD800..0xDBFF) */
+    lead = cp;
+    unprocessed_ptr += 4; /* within the buffer, checked by parse_utf16_hex */
+    if (end - unprocessed_ptr < 2 || *unprocessed_ptr++ != '\\' ||
+        *unprocessed_ptr++ != 'u') {
+      return JSONFailure;
+    }
+    status = parse_utf16_hex(unprocessed_ptr, end, &trail);
+    if (status != JSONSuccess || trail < 0xDC00 ||
+        trail > 0xDFFF) { /* valid trail surrogate? (0xDC00..0xDFFF) */
+      return JSONFailure;
+    }
+    cp = ((((lead - 0xD800) & 0x3FF) << 10) | ((trail - 0xDC00) & 0x3FF)) +
+         0x010000;
+    processed_ptr[0] = (((cp >> 18) & 0x07) | 0xF0); /* 11110xxx */
+    processed_ptr[1] = (((cp >> 12) & 0x3F) | 0x80); /* 10xxxxxx */
+    processed_ptr[2] = (((cp >> 6) & 0x3F) | 0x80);  /* 10xxxxxx */
+    processed_ptr[3] = (((cp) & 0x3F) | 0x80);       /* 10xxxxxx */
+    processed_ptr += 3;
+  } else { /* trail surrogate before lead surrogate */
+    return JSONFailure;
+  }
+  unprocessed_ptr += 3;
+  *processed = processed_ptr;
+  *unprocessed = unprocessed_ptr;
+  return JSONSuccess;
+}
+
+/* Unescapes input_len bytes of string contents into output, which has room
+   for input_len + 1 bytes (escapes never expand) and may be input itself: every
+   byte is read before the output catches up with it. Example:
+   "\u006Corem ipsum" -> lorem ipsum */
+static JSON_Status decode_string(const char *input, size_t input_len,
+                                 char *output, size_t *output_len) {
+  const char *input_ptr = input;
+  const char *input_end = input + input_len;
+  char *output_ptr = output;
+  while (input_ptr < input_end) {
+    const size_t run_len = scan_string_run(input_ptr, input_end, false);
+    memmove(output_ptr, input_ptr, run_len);
+    output_ptr += run_len;
+    input_ptr += run_len;
+    if (input_ptr == input_end) {
+      break;
+    }
+    if (*input_ptr == '\\') {
+      input_ptr++;
+      switch (*input_ptr) {
+      case '\"':
+        *output_ptr = '\"';
+        break;
+      case '\\':
+        *output_ptr = '\\';
+        break;
+      case '/':
+        *output_ptr = '/';
+        break;
+      case 'b':
+        *output_ptr = '\b';
+        break;
+      case 'f':
+        *output_ptr = '\f';
+        break;
+      case 'n':
+        *output_ptr = '\n';
+        break;
+      case 'r':
+        *output_ptr = '\r';
+        break;
+      case 't':
+        *output_ptr = '\t';
+        break;
+      case 'u':
+        if (parse_utf16(&input_ptr, input_end, &output_ptr) != JSONSuccess) {
+          return JSONFailure;
+        }
+        break;
+      default:
+        return JSONFailure;
+      }
+    } else if ((unsigned char)*input_ptr < 0x20) {
+      return JSONFailure; /* 0x00-0x19 are invalid characters for json string
+                             (http://www.ietf.org/rfc/rfc4627.txt) */
+    } else {
+      *output_ptr = *input_ptr;
+    }
+    output_ptr++;
+    input_ptr++;
+  }
+  *output_ptr = '\0';
+  *output_len = (size_t)(output_ptr - output);
+  return JSONSuccess;
+}
+
+/* Copies and processes passed string up to supplied length. */
+[[nodiscard]] static char *process_string(const char *input, size_t input_len,
+                                          size_t *output_len,
+                                          JSON_Arena *arena) {
+  /* The input length bounds the decoded length, so a single allocation is
+     enough. */
+  auto output = (char *)parson_calloc_in(arena, input_len + 1, sizeof(char));
+  if (output == nullptr) {
+    return nullptr;
+  }
+  if (decode_string(input, input_len, output, output_len) != JSONSuccess) {
+    parson_free_in(arena, output);
+    return nullptr;
+  }
+  return output;
+}
+
+/* Return processed contents of a string between quotes and
+   skips passed argument to a matching quote. */
+[[nodiscard]] static char *get_quoted_string(const char **string,
+                                             size_t *output_string_len,
+                                             const parse_context *ctx) {
+  const char *string_start = *string;
+  size_t input_string_len = 0;
+  if (*string_start != '\"') {
+    return nullptr;
+  }
+  /* Fast path: strings without escapes or control characters are copied
+     as they are. */
+  const char *run_start = string_start + 1;
+  const size_t run_len = scan_string_run(run_start, ctx->end, false);
+  if (run_start + run_len < ctx->end && run_start[run_len] == '\"') {
+    if (ctx->insitu) {
+      /* the closing quote becomes the terminator */
+      char *output = (char *)run_start;
+      output[run_len] = '\0';
+      *string = run_start + run_len + 1;
+      *output_string_len = run_len;
+      return output;
+    }
+    char *output = parson_strndup_in(ctx->arena, run_start, run_len);
+    if (output == nullptr) {
+      return nullptr;
+    }
+    *string = run_start + run_len + 1;
+    *output_string_len = run_len;
+    return output;
+  }
+  JSON_Status status = skip_quotes(string, ctx->end);
+  if (status != JSONSuccess) {
+    return nullptr;
+  }
+  input_string_len = *string - string_start - 2; /* length without quotes */
+  if (ctx->insitu) {
+    char *output = (char *)string_start + 1;
+    return decode_string(output, input_string_len, output,
+                         output_string_len) == JSONSuccess
+               ? output
+               : nullptr;
+  }
+  return process_string(string_start + 1, input_string_len, output_string_len,
+                        ctx->arena);
+}
+
+/* Like get_quoted_string, but returns the name's copy in ctx->keys. Names
+   without escapes are looked up straight from the input. */
+[[nodiscard]] static char *get_interned_key(const char **string, size_t *len,
+                                            const parse_context *ctx) {
+  const char *run_start = *string + 1;
+  const size_t run_len = scan_string_run(run_start, ctx->end, false);
+  if (run_start + run_len < ctx->end && run_start[run_len] == '\"') {
+    *string = run_start + run_len + 1;
+    *len = run_len;
+    return json_key_table_intern(ctx->keys, run_start, run_len,
+                                 hash_string(run_start, run_len));
+  }
+  char *decoded = get_quoted_string(string, len, ctx);
+  if (decoded == nullptr) {
+    return nullptr;
+  }
+  char *interned = json_key_table_intern(ctx->keys, decoded, *len,
+                                         hash_string(decoded, *len));
+  parson_free_in(ctx->arena, decoded);
+  return interned;
+}
+
+static void parse_stack_init(parse_stack *stack, JSON_Arena *arena,
+                             bool insitu, const JSON_Context *context) {
+  stack->context = context_or_default(context);
+  stack->arena = arena;
+  stack->insitu = insitu;
+  stack->interned_keys = false;
+  parse_stack_reset(stack);
+}
+
+/* Empties the stack, keeping its configuration */
+static void parse_stack_reset(parse_stack *stack) {
+  stack->root = nullptr;
+  stack->frames = stack->inline_frames;
+  stack->depth = 0;
+  stack->capacity = parse_stack_inline_frames;
+  stack->expect = parse_expect_value;
+}
+
+/* Frees a string decoded by the parser (in-situ strings are borrowed) */
+static void parse_stack_free_string(parse_stack *stack, char *string) {
+  if (!stack->insitu) {
+    parson_free_in(stack->arena, string);
+  }
+}
+
+static void parse_stack_free(parse_stack *stack) {
+  for (size_t i = 0; i < stack->depth && !stack->interned_keys; i++) {
+    parse_stack_free_string(stack, stack->frames[i].key);
+  }
+  json_value_free(stack->root);
+  if (stack->frames != stack->inline_frames) {
+    context_free(stack->context, stack->frames,
+                 stack->capacity * sizeof(parse_frame));
+  }
+  parse_stack_reset(stack);
+}
+
+/* Returns the finished root value and resets the stack. */
+static JSON_Value *parse_stack_release(parse_stack *stack) {
+  JSON_Value *root = stack->root;
+  stack->root = nullptr;
+  parse_stack_free(stack);
+  return root;
+}
+
+static JSON_Status parse_stack_push(parse_stack *stack, JSON_Value *container) {
+  if (stack->depth == stack->capacity) {
+    const size_t new_capacity = stack->capacity * 2;
+    auto new_frames = (parse_frame *)context_malloc(
+        stack->context, new_capacity * sizeof(parse_frame));
+    if (new_frames == nullptr) {
+      return JSONFailure;
+    }
+    memcpy(new_frames, stack->frames, stack->depth * sizeof(parse_frame));
+    if (stack->frames != stack->inline_frames) {
+      context_free(stack->context, stack->frames,
+                   stack->capacity * sizeof(parse_frame));
+    }
+    stack->frames = new_frames;
+    stack->capacity = new_capacity;
+  }
+  JSON_Stats *stats = stats_active();
+  if (stats != nullptr && stack->depth + 1 > stats->max_depth) {
+    stats->max_depth = stack->depth + 1;
+  }
+  stack->frames[stack->depth].container = container;
+  stack->frames[stack->depth].key = nullptr;
+  stack->depth++;
+  return JSONSuccess;
+}
+
+/* Attaches a value where the grammar expects one and, for containers, makes it
+   the innermost open container. Takes ownership of value, which may be null
+   after a failed allocation. */
+static JSON_Status parse_stack_add(parse_stack *stack, JSON_Value *value) {
+  if (value == nullptr) {
+    return JSONFailure;
+  }
+  if ((stack->expect != parse_expect_value &&
+       stack->expect != parse_expect_value_or_end) ||
+      stack->depth > max_nesting) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  if (stack->depth == 0) {
+    stack->root = value;
+  } else {
+    parse_frame *frame = &stack->frames[stack->depth - 1];
+    JSON_Status status = JSONFailure;
+    if (json_value_get_type(frame->container) == JSONArray) {
+      status = json_array_add(json_value_get_array(frame->container), value);
+    } else {
+      JSON_Object *object = json_value_get_object(frame->container);
+      status = stack->interned_keys
+                   ? json_object_add_hashed(object, frame->key, frame->key_len,
+                                            key_record_of(frame->key)->hash,
+                                            value)
+                   : json_object_add(object, frame->key, frame->key_len, value);
+      if (status == JSONSuccess) {
+        frame->key = nullptr;
+      }
+    }
+    if (status != JSONSuccess) {
+      json_value_free(value);
+      return JSONFailure;
+    }
+  }
+  if ((value->flags & value_flag_lazy) == 0U) {
+    switch (json_value_get_type(value)) {
+    case JSONArray:
+      stack->expect = parse_expect_value_or_end;
+      return parse_stack_push(stack, value);
+    case JSONObject:
+      stack->expect = parse_expect_key_or_end;
+      return parse_stack_push(stack, value);
+    default:
+      break;
+    }
+  }
+  stack->expect =
+      stack->depth == 0 ? parse_expect_nothing : parse_expect_comma_or_end;
+  return JSONSuccess;
+}
+
+/* Takes ownership of a decoded string, which is either a key or a value. */
+static JSON_Status parse_stack_string(parse_stack *stack, char *string,
+                                      size_t len) {
+  if (stack->expect == parse_expect_key_or_end) {
+    stack->frames[stack->depth - 1].key = string;
+    stack->frames[stack->depth - 1].key_len = len;
+    stack->expect = parse_expect_colon;
+    return JSONSuccess;
+  }
+  JSON_Value *value = json_value_init_string_no_copy(stack->arena, string, len);
+  if (value == nullptr) {
+    parse_stack_free_string(stack, string);
+    return JSONFailure;
+  }
+  if (stack->insitu) {
+    value->flags |= value_flag_borrowed;
+  }
+  return parse_stack_add(stack, value);
+}
+
+static JSON_Status parse_stack_close(parse_stack *stack, JSON_Value_Type type) {
+  if (stack->depth == 0) {
+    return JSONFailure;
+  }
+  JSON_Value *container = stack->frames[stack->depth - 1].container;
+  const parse_expect closable = type == JSONArray ? parse_expect_value_or_end
+                                                  : parse_expect_key_or_end;
+  if (json_value_get_type(container) != type ||
+      (stack->expect != closable &&
+       stack->expect != parse_expect_comma_or_end)) {
+    return JSONFailure;
+  }
+  if (type == JSONArray) {
+    /* Trim array after parsing is over (arena memory can't be given back) */
+    JSON_Array *array = json_value_get_array(container);
+    if (stack->arena == nullptr && json_array_get_count(array) > 0 &&
+        json_array_get_count(array) < array->capacity &&
+        json_array_resize(array, json_array_get_count(array)) != JSONSuccess) {
+      return JSONFailure;
+    }
+  }
+  stack->depth--;
+  stack->expect = stack->depth == 0 ? parse_expect_nothing
+                                    : parse_expect_comma_or_end;
+  return JSONSuccess;
+}
+
+static JSON_Status parse_stack_colon(parse_stack *stack) {
+  if (stack->expect != parse_expect_colon) {
+    return JSONFailure;
+  }
+  stack->expect = parse_expect_value;
+  return JSONSuccess;
+}
+
+static JSON_Status parse_stack_comma(parse_stack *stack) {
+  if (stack->expect != parse_expect_comma_or_end) {
+    return JSONFailure;
+  }
+  JSON_Value *container = stack->frames[stack->depth - 1].container;
+  stack->expect = json_value_get_type(container) == JSONArray
+                      ? parse_expect_value_or_end
+                      : parse_expect_key_or_end;
+  return JSONSuccess;
+}
+
+[[nodiscard]] static JSON_Value *parse_value(const char **string,
+                                             const parse_context *ctx) {
+  parse_stack stack;
+  parse_stack_init(&stack, ctx->arena, ctx->insitu, ctx->context);
+  stack.interned_keys = ctx->keys != nullptr;
+  while (stack.expect != parse_expect_nothing) {
+    JSON_Status status = JSONFailure;
+    skip_whitespaces(string, ctx);
+    switch (*string < ctx->end ? **string : '\0') {
+    case '{': {
+      if (ctx->lazy != nullptr && stack.depth > 0) {
+        status = parse_stack_add(&stack, parse_lazy_container(string, ctx));
+        break;
+      }
+      skip_char(string);
+      JSON_Value *object_value = json_value_init_object_in(ctx->arena);
+      if (object_value != nullptr && ctx->insitu) {
+        object_value->value.object->borrowed_start = ctx->start;
+        object_value->value.object->borrowed_end = ctx->end;
+      }
+      if (object_value != nullptr) {
+        object_value->value.object->keys = ctx->keys;
+      }
+      status = parse_stack_add(&stack, object_value);
+      break;
+    }
+    case '[':
+      if (ctx->lazy != nullptr && stack.depth > 0) {
+        status = parse_stack_add(&stack, parse_lazy_container(string, ctx));
+        break;
+      }
+      skip_char(string);
+      status = parse_stack_add(&stack, json_value_init_array_in(ctx->arena));
+      break;
+    case '}':
+      skip_char(string);
+      status = parse_stack_close(&stack, JSONObject);
+      break;
+    case ']':
+      skip_char(string);
+      status = parse_stack_close(&stack, JSONArray);
+      break;
+    case ':':
+      skip_char(string);
+      status = parse_stack_colon(&stack);
+      break;
+    case ',':
+      skip_char(string);
+      status = parse_stack_comma(&stack);
+      break;
+    case '\"': {
+      JSON_Value *small = nullptr;
+      if (stack.expect != parse_expect_key_or_end && !ctx->insitu &&
+          parse_small_string(string, ctx, &small)) {
+        status = parse_stack_add(&stack, small);
+        break;
+      }
+      size_t len = 0;
+      char *new_string = stack.interned_keys &&
+                                 stack.expect == parse_expect_key_or_end
+                             ? get_interned_key(string, &len, ctx)
+                             : get_quoted_string(string, &len, ctx);
+      status = new_string == nullptr
+                   ? JSONFailure
+                   : parse_stack_string(&stack, new_string, len);
+      break;
+    }
+    case 'f':
+    case 't':
+      status = parse_stack_add(&stack, parse_boolean_value(string, ctx));
+      break;
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9':
+      status = parse_stack_add(&stack, parse_number_value(string, ctx));
+      break;
+    case 'n':
+      status = parse_stack_add(&stack, parse_null_value(string, ctx));
+      break;
+    default:
+      break;
+    }
+    if (status != JSONSuccess) {
+      parse_stack_free(&stack);
+      return nullptr;
+    }
+  }
+  return parse_stack_release(&stack);
+}
+
+[[nodiscard]] static JSON_Value *parse_boolean_value(const char **string,
+                                                     const parse_context *ctx) {
+  constexpr size_t true_token_size = sizeof("true") - 1;
+  constexpr size_t false_token_size = sizeof("false") - 1;
+  const size_t available = (size_t)(ctx->end - *string);
+  if (available >= true_token_size &&
+      memcmp("true", *string, true_token_size) == 0) {
+    *string += true_token_size;
+    return json_value_init_boolean_in(ctx->arena, true);
+  } else if (available >= false_token_size &&
+             memcmp("false", *string, false_token_size) == 0) {
+    *string += false_token_size;
+    return json_value_init_boolean_in(ctx->arena, false);
+  }
+  return nullptr;
+}
+
+/* Reads a valid JSON number between start and end as an integer, failing for
+   fractions, exponents and magnitudes beyond uint64_t. */
+static bool parse_integer(const char *start, const char *end,
+                          uint64_t *magnitude) {
+  uint64_t result = 0;
+  if (start < end && *start == '-') {
+    start++;
+  }
+  for (; start < end; start++) {
+    if (!is_digit(*start)) {
+      return false;
+    }
+    const auto digit = (uint64_t)(*start - '0');
+    if (result > (UINT64_MAX - digit) / 10) {
+      return false;
+    }
+    result = result * 10 + digit;
+  }
+  *magnitude = result;
+  return true;
+}
+
+/* Makes the value of the number parsed from start to end. Integers that the
+   double rounded keep all their digits. */
+[[nodiscard]] static JSON_Value *
+parse_number_result(JSON_Arena *arena, const char *start, const char *end,
+                    double number) {
+  uint64_t magnitude = 0;
+  if (fabs(number) >= (double)max_exact_double_integer &&
+      parse_integer(start, end, &magnitude) &&
+      integer_needs_exact(number < 0, magnitude)) {
+    return json_value_init_integer_in(arena, number < 0, magnitude);
+  }
+  return json_value_init_number_in(arena, number);
+}
+
+[[nodiscard]] static JSON_Value *parse_number_value(const char **string,
+                                                    const parse_context *ctx) {
+  const char *start = *string;
+  double number = 0;
+  if (parse_number(string, ctx->end, &number) != JSONSuccess) {
+    return nullptr;
+  }
+  return parse_number_result(ctx->arena, start, *string, number);
+}
+
+/* Returns true for a string without escapes short enough to be kept inside
+   its value, which is then made in value (nullptr if allocation fails). */
+static bool parse_small_string(const char **string, const parse_context *ctx,
+                               JSON_Value **value) {
+  const char *run_start = *string + 1;
+  const char *limit =
+      run_start + min_size(small_string_max_len + 1,
+                           (size_t)(ctx->end - run_start));
+  const size_t run_len = scan_string_run(run_start, limit, false);
+  if (run_start + run_len == limit || run_start[run_len] != '\"') {
+    return false;
+  }
+  *string = run_start + run_len + 1;
+  *value = json_value_init_small_string(ctx->arena, run_start, run_len);
+  return true;
+}
+
+[[nodiscard]] static JSON_Value *parse_null_value(const char **string,
+                                                  const parse_context *ctx) {
+  constexpr size_t token_size = sizeof("null") - 1;
+  if ((size_t)(ctx->end - *string) >= token_size &&
+      memcmp("null", *string, token_size) == 0) {
+    *string += token_size;
+    return json_value_init_null_in(ctx->arena);
+  }
+  return nullptr;
+}
+
+/* Lazy parsing (JSONParseLazy) */
+[[nodiscard]] static lazy_source *lazy_source_new(JSON_Arena *arena,
+                                                  const char *text,
+                                                  size_t len) {
+  if (len > SIZE_MAX - sizeof(lazy_source)) {
+    return nullptr;
+  }
+  const size_t size = sizeof(lazy_source) + len;
+  auto source = (lazy_source *)(arena != nullptr ? json_arena_alloc(arena, size)
+                                                  : parson_malloc(size));
+  if (source == nullptr) {
+    return nullptr;
+  }
+  source->arena = arena;
+  source->refs = 1;
+  memcpy(source->text, text, len);
+  return source;
+}
+
+static void lazy_source_release(lazy_source *source) {
+  if (source->arena == nullptr && --source->refs == 0) {
+    parson_free(source);
+  }
+}
+
+/* Skips the container at *string and returns a value referring to its text,
+   to be parsed by json_value_materialize. */
+[[nodiscard]] static JSON_Value *
+parse_lazy_container(const char **string, const parse_context *ctx) {
+  const char *start = *string;
+  skip_char(string);
+  if (skip_container(string, ctx->end) != JSONSuccess) {
+    return nullptr;
+  }
+  JSON_Value *value =
+      json_value_make(ctx->arena, *start == '{' ? JSONObject : JSONArray);
+  if (value == nullptr) {
+    return nullptr;
+  }
+  value->flags |= value_flag_lazy;
+  value->value.lazy = (lazy_span){
+      .source = ctx->lazy,
+      .offset = (uint32_t)(start - ctx->lazy->text),
+      .len = (uint32_t)(*string - start),
+  };
+  ctx->lazy->refs++;
+  return value;
+}
+
+/* Parses a lazy container in place; its own nested containers stay lazy. */
+static JSON_Status json_value_materialize(JSON_Value *value) {
+  const lazy_span span = value->value.lazy;
+  const char *text = span.source->text + span.offset;
+  const parse_context ctx = {
+      .arena = span.source->arena,
+      .start = text,
+      .end = text + span.len,
+      .lazy = span.source,
+  };
+  const char *ptr = text;
+  JSON_Value *parsed = parse_value(&ptr, &ctx);
+  if (parsed == nullptr) {
+    return JSONFailure;
+  }
+  if (value->type == JSONObject) {
+    JSON_Object *object = parsed->value.object;
+    object->wrapping_value = value;
+    for (size_t i = 0; i < object->count; i++) {
+      object->entries[i].value->parent = value;
+    }
+    value->value.object = object;
+  } else {
+    JSON_Array *array = parsed->value.array;
+    array->wrapping_value = value;
+    for (size_t i = 0; i < array->count; i++) {
+      array->items[i]->parent = value;
+    }
+    value->value.array = array;
+  }
+  value->flags &= ~value_flag_lazy;
+  /* the new members have no kept hashes or text yet */
+  json_value_forget_cached(value);
+  parson_free_in(span.source->arena, parsed);
+  lazy_source_release(span.source);
+  return JSONSuccess;
+}
+
+/* Push parser
+   Tokens are lexed straight from each chunk; only a token cut by the end of a
+   chunk is copied to parser->token (raw, before unescaping) so that it can be
+   completed by the next chunk. */
+static JSON_Status push_token_append(JSON_Parser *parser, const char *bytes,
+                                     size_t len) {
+  if (parser->token_capacity - parser->token_len <= len) {
+    if (len >= SIZE_MAX / 2 - parser->token_len) {
+      return JSONFailure;
+    }
+    const size_t new_capacity = max_size(
+        parser->token_capacity * 2, max_size(parser->token_len + len + 1, 64));
+    char *new_token = (char *)parson_malloc(new_capacity);
+    if (new_token == nullptr) {
+      return JSONFailure;
+    }
+    if (parser->token_len > 0) {
+      memcpy(new_token, parser->token, parser->token_len);
+    }
+    parson_free(parser->token);
+    parser->token = new_token;
+    parser->token_capacity = new_capacity;
+  }
+  memcpy(parser->token + parser->token_len, bytes, len);
+  parser->token_len += len;
+  return JSONSuccess;
+}
+
+/* Returns the first byte from ptr that cannot continue a number in the given
+   state. Bytes parse_number rejects (e.g. a digit after a leading zero) are
+   kept in the token so that it fails the same way. */
+static const char *push_scan_number(const char *ptr, const char *end,
+                                    push_number_state *state) {
+  for (; ptr < end; ptr++) {
+    const char c = *ptr;
+    push_number_state next = *state;
+    switch (*state) {
+    case push_number_start:
+    case push_number_minus:
+      if (c == '-' && *state == push_number_start) {
+        next = push_number_minus;
+      } else if (c == '0') {
+        next = push_number_zero;
+      } else if (is_digit(c)) {
+        next = push_number_integer;
+      } else {
+        return ptr;
+      }
+      break;
+    case push_number_zero:
+    case push_number_integer:
+      if (is_digit(c)) {
+        next = push_number_integer;
+      } else if (c == '.') {
+        next = push_number_point;
+      } else if (c == 'e' || c == 'E') {
+        next = push_number_exponent;
+      } else {
+        return ptr;
+      }
+      break;
+    case push_number_point:
+    case push_number_fraction:
+      if (is_digit(c)) {
+        next = push_number_fraction;
+      } else if ((c == 'e' || c == 'E') && *state == push_number_fraction) {
+        next = push_number_exponent;
+      } else {
+        return ptr;
+      }
+      break;
+    case push_number_exponent:
+    case push_number_exponent_sign:
+    case push_number_exponent_digits:
+      if (is_digit(c)) {
+        next = push_number_exponent_digits;
+      } else if ((c == '+' || c == '-') && *state == push_number_exponent) {
+        next = push_number_exponent_sign;
+      } else {
+        return ptr;
+      }
+      break;
+    }
+    *state = next;
+  }
+  return ptr;
+}
+
+/* Scans string contents from ptr for the closing quote. Returns the closing
+   quote, or end if the string continues into the next chunk (escape_pending is
+   set if the chunk ends in the middle of an escape). */
+static JSON_Status push_scan_string(const char *ptr, const char *end,
+                                    bool *escape_pending, const char **quote) {
+  if (*escape_pending) {
+    ptr++; /* escaped byte from the previous chunk */
+    *escape_pending = false;
+  }
+  while (ptr < end) {
+    ptr += scan_string_run(ptr, end, false);
+    if (ptr == end || *ptr == '\"') {
+      break;
+    } else if (*ptr == '\\') {
+      ptr++;
+      if (ptr == end) {
+        *escape_pending = true;
+        break;
+      }
+    } else {
+      return JSONFailure; /* control character */
+    }
+    ptr++;
+  }
+  *quote = ptr;
+  return JSONSuccess;
+}
+
+static JSON_Status push_finish_number(JSON_Parser *parser) {
+  parse_stack *stack = &parser->stack;
+  double number = 0;
+  const char *ptr = parser->token;
+  const char *token_end = parser->token + parser->token_len;
+  parser->lexer = push_lexer_between;
+  if (parse_number(&ptr, token_end, &number) != JSONSuccess ||
+      ptr != token_end) {
+    return JSONFailure;
+  }
+  parser->token_len = 0;
+  return parse_stack_add(stack, parse_number_result(stack->arena,
+                                                    parser->token, token_end,
+                                                    number));
+}
+
+static JSON_Status push_finish_literal(JSON_Parser *parser) {
+  parse_stack *stack = &parser->stack;
+  parser->lexer = push_lexer_between;
+  switch (parser->literal[0]) {
+  case 't':
+    return parse_stack_add(stack,
+                           json_value_init_boolean_in(stack->arena, true));
+  case 'f':
+    return parse_stack_add(stack,
+                           json_value_init_boolean_in(stack->arena, false));
+  case 'n':
+    return parse_stack_add(stack, json_value_init_null_in(stack->arena));
+  default:
+    return JSONSuccess; /* UTF-8 BOM */
+  }
+}
+
+/* Lexes the token starting at *string; a token reaching end is kept in the
+   lexer state instead. */
+static JSON_Status push_lex_token(JSON_Parser *parser, const char **string,
+                                  const char *end) {
+  parse_stack *stack = &parser->stack;
+  const char *ptr = *string;
+  const char *token_end = nullptr;
+  double number = 0;
+  if (!parser->started) {
+    parser->started = true;
+    if (*ptr == '\xEF') {
+      parser->literal = "\xEF\xBB\xBF";
+      parser->literal_matched = 0;
+      parser->lexer = push_lexer_literal;
+      return JSONSuccess;
+    }
+  }
+  *string = ptr + 1;
+  switch (*ptr) {
+  case ' ':
+  case '\t':
+  case '\n':
+  case '\v':
+  case '\f':
+  case '\r':
+    *string = ptr + 1 + scan_whitespace_run(ptr + 1, end);
+    return JSONSuccess;
+  case '{':
+    return parse_stack_add(stack, json_value_init_object_in(stack->arena));
+  case '[':
+    return parse_stack_add(stack, json_value_init_array_in(stack->arena));
+  case '}':
+    return parse_stack_close(stack, JSONObject);
+  case ']':
+    return parse_stack_close(stack, JSONArray);
+  case ':':
+    return parse_stack_colon(stack);
+  case ',':
+    return parse_stack_comma(stack);
+  case '\"': {
+    bool escape_pending = false;
+    if (push_scan_string(ptr + 1, end, &escape_pending, &token_end) !=
+        JSONSuccess) {
+      return JSONFailure;
+    }
+    if (token_end == end) {
+      parser->lexer = push_lexer_string;
+      parser->escape_pending = escape_pending;
+      *string = end;
+      return push_token_append(parser, ptr + 1, (size_t)(end - ptr - 1));
+    }
+    const parse_context ctx = {.arena = stack->arena, .end = token_end + 1};
+    size_t len = 0;
+    char *new_string = get_quoted_string(&ptr, &len, &ctx);
+    if (new_string == nullptr) {
+      return JSONFailure;
+    }
+    *string = ptr;
+    return parse_stack_string(stack, new_string, len);
+  }
+  case 't':
+  case 'f':
+  case 'n':
+    parser->literal = *ptr == 't' ? "true" : *ptr == 'f' ? "false" : "null";
+    parser->literal_matched = 0;
+    parser->lexer = push_lexer_literal;
+    *string = ptr;
+    return JSONSuccess;
+  case '-':
+  case '0':
+  case '1':
+  case '2':
+  case '3':
+  case '4':
+  case '5':
+  case '6':
+  case '7':
+  case '8':
+  case '9':
+    parser->number_state = push_number_start;
+    token_end = push_scan_number(ptr, end, &parser->number_state);
+    if (token_end == end) {
+      parser->lexer = push_lexer_number;
+      *string = end;
+      return push_token_append(parser, ptr, (size_t)(end - ptr));
+    }
+    /* the number is followed by another byte, so it can be parsed in place */
+    const char *token_start = ptr;
+    if (parse_number(&ptr, token_end, &number) != JSONSuccess ||
+        ptr != token_end) {
+      return JSONFailure;
+    }
+    *string = ptr;
+    return parse_stack_add(stack, parse_number_result(stack->arena,
+                                                      token_start, token_end,
+                                                      number));
+  default:
+    return JSONFailure;
+  }
+}
+
+/* Continues a token cut by the end of the previous chunk. */
+static JSON_Status push_lex_continue(JSON_Parser *parser, const char **string,
+                                     const char *end) {
+  const char *ptr = *string;
+  const char *token_end = nullptr;
+  switch (parser->lexer) {
+  case push_lexer_string: {
+    if (push_scan_string(ptr, end, &parser->escape_pending, &token_end) !=
+            JSONSuccess ||
+        push_token_append(parser, ptr, (size_t)(token_end - ptr)) !=
+            JSONSuccess) {
+      return JSONFailure;
+    }
+    if (token_end == end) {
+      *string = end;
+      return JSONSuccess;
+    }
+    *string = token_end + 1;
+    parser->lexer = push_lexer_between;
+    size_t len = 0;
+    char *new_string = process_string(parser->token, parser->token_len, &len,
+                                      parser->stack.arena);
+    parser->token_len = 0;
+    if (new_string == nullptr) {
+      return JSONFailure;
+    }
+    return parse_stack_string(&parser->stack, new_string, len);
+  }
+  case push_lexer_number:
+    token_end = push_scan_number(ptr, end, &parser->number_state);
+    if (push_token_append(parser, ptr, (size_t)(token_end - ptr)) !=
+        JSONSuccess) {
+      return JSONFailure;
+    }
+    *string = token_end;
+    return token_end == end ? JSONSuccess : push_finish_number(parser);
+  case push_lexer_literal:
+    while (ptr < end && parser->literal[parser->literal_matched] != '\0') {
+      if (*ptr != parser->literal[parser->literal_matched]) {
+        return JSONFailure;
+      }
+      ptr++;
+      parser->literal_matched++;
+    }
+    *string = ptr;
+    if (parser->literal[parser->literal_matched] != '\0') {
+      return JSONSuccess;
+    }
+    return push_finish_literal(parser);
+  default:
+    return JSONFailure;
+  }
+}
+
+/* Event parser
+   Follows the grammar of parse_value without building values. Skipped values
+   are only scanned for their end (see skip_container). */
+/* Also rejects values nested deeper than parse_stack_add allows. */
+static bool event_expects_value(const event_parser *parser) {
+  return (parser->expect == parse_expect_value ||
+          parser->expect == parse_expect_value_or_end) &&
+         parser->depth <= max_nesting;
+}
+
+static bool event_in_array(const event_parser *parser) {
+  const size_t level = parser->depth - 1;
+  return ((parser->array_levels[level / 64] >> (level % 64)) & 1U) != 0;
+}
+
+static void event_value_done(event_parser *parser) {
+  parser->expect = parser->depth == 0 ? parse_expect_nothing
+                                      : parse_expect_comma_or_end;
+}
+
+static JSON_Status event_match_literal(const char **string, const char *end,
+                                       const char *literal) {
+  const size_t literal_len = strlen(literal);
+  if ((size_t)(end - *string) < literal_len ||
+      memcmp(literal, *string, literal_len) != 0) {
+    return JSONFailure;
+  }
+  *string += literal_len;
+  return JSONSuccess;
+}
+
+static JSON_Status event_skip_value(const char **string, const char *end) {
+  double number = 0;
+  switch (*string < end ? **string : '\0') {
+  case '{':
+  case '[':
+    skip_char(string);
+    return skip_container(string, end);
+  case '\"':
+    return skip_quotes(string, end);
+  case 't':
+    return event_match_literal(string, end, "true");
+  case 'f':
+    return event_match_literal(string, end, "false");
+  case 'n':
+    return event_match_literal(string, end, "null");
+  default:
+    return parse_number(string, end, &number);
+  }
+}
+
+/* Reads the string at *string and skips past it. Strings without escapes are
+   returned from the input, others are unescaped into parser->scratch. */
+static JSON_Status event_read_string(event_parser *parser, const char **string,
+                                     const char **chars, size_t *len) {
+  const char *end = parser->input.end;
+  const char *string_start = *string;
+  const char *run_start = string_start + 1;
+  const size_t run_len = scan_string_run(run_start, end, false);
+  if (run_start + run_len < end && run_start[run_len] == '\"') {
+    *string = run_start + run_len + 1;
+    *chars = run_start;
+    *len = run_len;
+    return JSONSuccess;
+  }
+  if (skip_quotes(string, end) != JSONSuccess) {
+    return JSONFailure;
+  }
+  const size_t input_len = (size_t)(*string - string_start) - 2;
+  if (parser->scratch_capacity <= input_len) {
+    const size_t new_capacity =
+        max_size(input_len + 1, parser->scratch_capacity * 2);
+    char *new_scratch = (char *)parson_malloc(new_capacity);
+    if (new_scratch == nullptr) {
+      return JSONFailure;
+    }
+    parson_free(parser->scratch);
+    parser->scratch = new_scratch;
+    parser->scratch_capacity = new_capacity;
+  }
+  if (decode_string(run_start, input_len, parser->scratch, len) !=
+      JSONSuccess) {
+    return JSONFailure;
+  }
+  *chars = parser->scratch;
+  return JSONSuccess;
+}
+
+static JSON_Status event_parse(event_parser *parser, const char **string) {
+  const JSON_Handler *handler = parser->handler;
+  void *ctx = parser->ctx;
+  const char *end = parser->input.end;
+  while (parser->expect != parse_expect_nothing) {
+    JSON_Event_Result result = JSONEventContinue;
+    skip_whitespaces(string, &parser->input);
+    const char c = *string < end ? **string : '\0';
+    switch (c) {
+    case '{':
+    case '[': {
+      const bool is_array = c == '[';
+      if (!event_expects_value(parser)) {
+        return JSONFailure;
+      }
+      skip_char(string);
+      JSON_Event_Result (*begin)(void *) =
+          is_array ? handler->on_array_begin : handler->on_object_begin;
+      result = begin != nullptr ? begin(ctx) : JSONEventContinue;
+      if (result == JSONEventSkip) {
+        if (skip_container(string, end) != JSONSuccess) {
+          return JSONFailure;
+        }
+        event_value_done(parser);
+        break;
+      }
+      const size_t level = parser->depth++;
+      const uint64_t bit = (uint64_t)1 << (level % 64);
+      if (is_array) {
+        parser->array_levels[level / 64] |= bit;
+      } else {
+        parser->array_levels[level / 64] &= ~bit;
+      }
+      parser->expect =
+          is_array ? parse_expect_value_or_end : parse_expect_key_or_end;
+      break;
+    }
+    case '}':
+    case ']': {
+      const bool is_array = c == ']';
+      const parse_expect closable =
+          is_array ? parse_expect_value_or_end : parse_expect_key_or_end;
+      if (parser->depth == 0 || event_in_array(parser) != is_array ||
+          (parser->expect != closable &&
+           parser->expect != parse_expect_comma_or_end)) {
+        return JSONFailure;
+      }
+      skip_char(string);
+      parser->depth--;
+      event_value_done(parser);
+      JSON_Event_Result (*end_fun)(void *) =
+          is_array ? handler->on_array_end : handler->on_object_end;
+      result = end_fun != nullptr ? end_fun(ctx) : JSONEventContinue;
+      break;
+    }
+    case ':':
+      if (parser->expect != parse_expect_colon) {
+        return JSONFailure;
+      }
+      skip_char(string);
+      parser->expect = parse_expect_value;
+      if (parser->skip_value) {
+        parser->skip_value = false;
+        skip_whitespaces(string, &parser->input);
+        if (event_skip_value(string, end) != JSONSuccess) {
+          return JSONFailure;
+        }
+        event_value_done(parser);
+      }
+      break;
+    case ',':
+      if (parser->expect != parse_expect_comma_or_end) {
+        return JSONFailure;
+      }
+      skip_char(string);
+      parser->expect = event_in_array(parser) ? parse_expect_value_or_end
+                                              : parse_expect_key_or_end;
+      break;
+    case '\"': {
+      const bool is_key = parser->expect == parse_expect_key_or_end;
+      const char *chars = nullptr;
+      size_t len = 0;
+      if ((!is_key && !event_expects_value(parser)) ||
+          event_read_string(parser, string, &chars, &len) != JSONSuccess) {
+        return JSONFailure;
+      }
+      if (is_key) {
+        parser->expect = parse_expect_colon;
+        result = handler->on_key != nullptr ? handler->on_key(ctx, chars, len)
+                                            : JSONEventContinue;
+        parser->skip_value = result == JSONEventSkip;
+      } else {
+        event_value_done(parser);
+        result = handler->on_string != nullptr
+                     ? handler->on_string(ctx, chars, len)
+                     : JSONEventContinue;
+      }
+      break;
+    }
+    case 't':
+    case 'f': {
+      const bool boolean = c == 't';
+      if (!event_expects_value(parser) ||
+          event_match_literal(string, end, boolean ? "true" : "false") !=
+              JSONSuccess) {
+        return JSONFailure;
+      }
+      event_value_done(parser);
+      result = handler->on_boolean != nullptr
+                   ? handler->on_boolean(ctx, boolean)
+                   : JSONEventContinue;
+      break;
+    }
+    case 'n':
+      if (!event_expects_value(parser) ||
+          event_match_literal(string, end, "null") != JSONSuccess) {
+        return JSONFailure;
+      }
+      event_value_done(parser);
+      result = handler->on_null != nullptr ? handler->on_null(ctx)
+                                           : JSONEventContinue;
+      break;
+    case '-':
+    case '0':
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+    case '6':
+    case '7':
+    case '8':
+    case '9': {
+      const char *raw = *string;
+      double number = 0;
+      if (!event_expects_value(parser) ||
+          parse_number(string, end, &number) != JSONSuccess) {
+        return JSONFailure;
+      }
+      event_value_done(parser);
+      result = handler->on_number != nullptr
+                   ? handler->on_number(ctx, number, raw,
+                                        (size_t)(*string - raw))
+                   : JSONEventContinue;
+      break;
+    }
+    default:
+      return JSONFailure;
+    }
+    if (result == JSONEventStop) {
+      return JSONSuccess;
+    }
+  }
+  return JSONSuccess;
+}
+
+/* Parallel parsing
+   The input is split once by the calling thread, then every worker parses its
+   chunk with parse_value. Workers share nothing but the stop flag. */
+static size_t parallel_thread_count(size_t threads, size_t len) {
+  if (threads == 0) {
+#if defined(_SC_NPROCESSORS_ONLN)
+    const long online = sysconf(_SC_NPROCESSORS_ONLN);
+    threads = online > 0 ? (size_t)online : 1;
+#elif defined(PARSON_MMAP_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    threads = info.dwNumberOfProcessors;
+#else
+    threads = 1;
+#endif
+  }
+  threads = min_size(threads, parallel_max_threads);
+  return max_size(min_size(threads, len / parallel_min_chunk_size), 1);
+}
+
+/* Gives every worker the lines from the first one starting at or after its
+   share of the input. Strings can't contain raw newlines, so any newline ends
+   a record. */
+static void parallel_split_lines(const char *string, const char *end,
+                                 parallel_worker *workers, size_t count) {
+  const size_t len = (size_t)(end - string);
+  const char *chunk_start = string;
+  for (size_t i = 0; i < count; i++) {
+    const char *chunk_end = end;
+    if (i + 1 < count) {
+      chunk_end = string + len / count * (i + 1);
+      chunk_end = chunk_end < chunk_start ? chunk_start : chunk_end;
+      const char *newline = (const char *)memchr(
+          chunk_end, '\n', (size_t)(end - chunk_end));
+      chunk_end = newline != nullptr ? newline + 1 : end;
+    }
+    workers[i].start = chunk_start;
+    workers[i].end = chunk_end;
+    chunk_start = chunk_end;
+  }
+}
+
+/* Splits the elements of the top-level array at string into at most *count
+   chunks of about the same size and sets *count to the number used. Elements
+   are only scanned for their end (see event_skip_value), the workers parse
+   them. */
+static JSON_Status parallel_split_array(const char *string, const char *end,
+                                        parallel_worker *workers,
+                                        size_t *count) {
+  const parse_context ctx = {.start = string, .end = end};
+  skip_whitespaces(&string, &ctx);
+  if (string == end || *string != '[') {
+    return JSONFailure;
+  }
+  string++;
+  const char *chunk_start = string;
+  const size_t target = (size_t)(end - string) / *count;
+  size_t used = 0;
+  skip_whitespaces(&string, &ctx);
+  while (string < end && *string != ']') {
+    if ((size_t)(string - chunk_start) >= target && used + 1 < *count) {
+      workers[used].start = chunk_start;
+      workers[used].end = string;
+      used++;
+      chunk_start = string;
+    }
+    if (event_skip_value(&string, end) != JSONSuccess) {
+      return JSONFailure;
+    }
+    skip_whitespaces(&string, &ctx);
+    if (string < end && *string == ',') {
+      string++; /* a trailing comma is accepted like by parse_value */
+      skip_whitespaces(&string, &ctx);
+    } else if (string == end || *string != ']') {
+      return JSONFailure;
+    }
+  }
+  if (string == end) {
+    return JSONFailure;
+  }
+  workers[used].start = chunk_start;
+  workers[used].end = string;
+  *count = used + 1;
+  return JSONSuccess;
+}
+
+/* Parses the next record of the worker's chunk into *record, which is left
+   null at the end of the chunk. */
+static JSON_Status parallel_next_record(const parallel_worker *worker,
+                                        const char **string,
+                                        JSON_Value **record,
+                                        const char **record_start) {
+  const char *end = worker->end;
+  *record = nullptr;
+  if (worker->format == JSONRecordsArray) {
+    const parse_context ctx = {
+        .arena = worker->arena, .start = worker->start, .end = end};
+    skip_whitespaces(string, &ctx);
+    if (*string == end) {
+      return JSONSuccess;
+    }
+    *record_start = *string;
+    *record = parse_value(string, &ctx);
+    skip_whitespaces(string, &ctx);
+    if (*record == nullptr || (*string < end && **string != ',')) {
+      return JSONFailure;
+    }
+    *string += *string < end;
+    return JSONSuccess;
+  }
+  while (*string < end) {
+    const char *line = *string;
+    const char *newline =
+        (const char *)memchr(line, '\n', (size_t)(end - line));
+    const char *line_end = newline != nullptr ? newline : end;
+    *string = newline != nullptr ? newline + 1 : end;
+    const parse_context ctx = {
+        .arena = worker->arena, .start = line, .end = line_end};
+    const char *ptr = line;
+    skip_whitespaces(&ptr, &ctx);
+    if (ptr == line_end) {
+      continue; /* blank line */
+    }
+    *record_start = ptr;
+    *record = parse_value(&ptr, &ctx);
+    skip_whitespaces(&ptr, &ctx);
+    return *record != nullptr && ptr == line_end ? JSONSuccess : JSONFailure;
+  }
+  return JSONSuccess;
+}
+
+static JSON_Status parallel_worker_add(parallel_worker *worker, size_t offset,
+                                       JSON_Value *record) {
+  if (worker->record_fun != nullptr) {
+    const JSON_Status status =
+        worker->record_fun(worker->record_ctx, offset, record);
+    json_arena_reset(worker->arena);
+    return status;
+  }
+  if (worker->count >= worker->capacity) {
+    const size_t new_capacity =
+        max_size(worker->capacity * 2, starting_capacity);
+    auto records =
+        (JSON_Value **)parson_malloc(new_capacity * sizeof(JSON_Value *));
+    if (records == nullptr) {
+      json_value_free(record);
+      return JSONFailure;
+    }
+    if (worker->count > 0) {
+      memcpy(records, worker->records, worker->count * sizeof(JSON_Value *));
+    }
+    parson_free(worker->records);
+    worker->records = records;
+    worker->capacity = new_capacity;
+  }
+  worker->records[worker->count] = record;
+  worker->count++;
+  return JSONSuccess;
+}
+
+static void parallel_worker_run(parallel_worker *worker) {
+  const char *ptr = worker->start;
+  JSON_Status status = JSONSuccess;
+  while (status == JSONSuccess &&
+         !atomic_load_explicit(worker->stop, memory_order_relaxed)) {
+    JSON_Value *record = nullptr;
+    const char *record_start = nullptr;
+    status = parallel_next_record(worker, &ptr, &record, &record_start);
+    if (status != JSONSuccess || record == nullptr) {
+      json_value_free(record);
+      break;
+    }
+    status = parallel_worker_add(
+        worker, (size_t)(record_start - worker->buffer), record);
+  }
+  if (status != JSONSuccess) {
+    atomic_store_explicit(worker->stop, true, memory_order_relaxed);
+  }
+  worker->status = status;
+}
+
+#if defined(PARSON_THREADS)
+static int parallel_thread_main(void *worker) {
+  parallel_worker_run((parallel_worker *)worker);
+  return 0;
+}
+#endif
+
+/* Splits the input (without a BOM) among at most *count workers, runs them
+   and sets *count to the number of workers used. The calling thread parses
+   the first chunk, and a chunk whose thread can't be started after it. */
+static JSON_Status parallel_run(const char *string, size_t len,
+                                parallel_worker *workers, size_t *count) {
+  if (workers[0].format == JSONRecordsArray) {
+    if (parallel_split_array(string, string + len, workers, count) !=
+        JSONSuccess) {
+      return JSONFailure;
+    }
+  } else {
+    parallel_split_lines(string, string + len, workers, *count);
+  }
+  JSON_Status status = JSONSuccess;
+#if defined(PARSON_THREADS)
+  thrd_t threads[parallel_max_threads];
+  bool started[parallel_max_threads] = {false};
+  for (size_t i = 1; i < *count; i++) {
+    started[i] = thrd_create(&threads[i], parallel_thread_main,
+                             &workers[i]) == thrd_success;
+  }
+  parallel_worker_run(&workers[0]);
+  for (size_t i = 1; i < *count; i++) {
+    if (started[i]) {
+      thrd_join(threads[i], nullptr);
+    } else {
+      parallel_worker_run(&workers[i]);
+    }
+  }
+#else
+  for (size_t i = 0; i < *count; i++) {
+    parallel_worker_run(&workers[i]);
+  }
+#endif
+  for (size_t i = 0; i < *count; i++) {
+    if (workers[i].status != JSONSuccess) {
+      status = JSONFailure;
+    }
+  }
+  return status;
+}
+
+/* Builds the array of all records in input order; they are only referenced,
+   so it can't fail after the array is allocated. */
+static JSON_Value *parallel_join(const parallel_worker *workers, size_t count,
+                                 JSON_Arena *arena) {
+  size_t total = 0;
+  for (size_t i = 0; i < count; i++) {
+    total += workers[i].count;
+  }
+  JSON_Value *root = json_value_init_array_in(arena);
+  if (root == nullptr) {
+    return nullptr;
+  }
+  JSON_Array *array = json_value_get_array(root);
+  if (total > 0 && json_array_resize(array, total) != JSONSuccess) {
+    json_value_free(root);
+    return nullptr;
+  }
+  for (size_t i = 0; i < count; i++) {
+    for (size_t j = 0; j < workers[i].count; j++) {
+      (void)json_array_add(array, workers[i].records[j]);
+    }
+  }
+  return root;
+}
+
+/* Serialization */
+
+/* Output of a serialization pass. With a null cursor only the size is
+   computed; otherwise bytes are written at cursor, and when the space up to end
+   runs out either the buffer of serializer is grown or, with write_fun set, the
+   chunk starting at start is handed to write_fun and reused. */
+struct serialization_buffer {
+  const JSON_Context *context; /* number format and escaping */
+  char *cursor;
+  char *end;
+  size_t written_total;
+  JSON_Serializer *serializer;
+  char *start;
+  JSON_Write_Function write_fun;
+  void *write_ctx;
+  bool failed;
+  bool in_cached_tree; /* below a value_flag_cache_text container */
+  bool concurrent;     /* other threads serialize parts of the same tree */
+};
+
+struct json_serializer_t {
+  const JSON_Context *context;
+  char *buf;
+  size_t capacity;
+};
+
+/* Passes the bytes buffered so far to write_fun. */
+static bool serialization_buffer_flush(serialization_buffer *buffer) {
+  if (buffer->failed) {
+    return false;
+  }
+  const size_t len = (size_t)(buffer->cursor - buffer->start);
+  if (len > 0 &&
+      buffer->write_fun(buffer->write_ctx, buffer->start, len) != JSONSuccess) {
+    buffer->failed = true;
+    return false;
+  }
+  buffer->cursor = buffer->start;
+  return true;
+}
+
+/* Makes room for len bytes, at most serialization_chunk_size when writing to
+   write_fun. */
+static bool serialization_buffer_grow(serialization_buffer *buffer,
+                                      size_t len) {
+  JSON_Serializer *serializer = buffer->serializer;
+  if (buffer->write_fun != nullptr) {
+    return serialization_buffer_flush(buffer);
+  }
+  if (serializer == nullptr || buffer->failed) {
+    buffer->failed = true;
+    return false;
+  }
+  const size_t used =
+      serializer->buf ? (size_t)(buffer->cursor - serializer->buf) : 0;
+  if (len > SIZE_MAX / 2 - used) {
+    buffer->failed = true;
+    return false;
+  }
+  const size_t new_capacity =
+      max_size(max_size(serializer->capacity * 2, used + len),
+               serializer_initial_capacity);
+  char *new_buf = (char *)context_realloc(
+      serializer->context, serializer->buf, serializer->capacity, new_capacity);
+  if (new_buf == nullptr) {
+    buffer->failed = true;
+    return false;
+  }
+  serializer->buf = new_buf;
+  serializer->capacity = new_capacity;
+  buffer->cursor = new_buf + used;
+  buffer->end = new_buf + new_capacity;
+  return true;
+}
+
+/* Makes room for len bytes at cursor, which must not be null. */
+static inline bool serialization_buffer_reserve(serialization_buffer *buffer,
+                                                size_t len) {
+  return (size_t)(buffer->end - buffer->cursor) >= len ||
+         serialization_buffer_grow(buffer, len);
+}
+
+static void append_bytes_slow(serialization_buffer *buffer, const char *bytes,
+                              size_t len) {
+  if (buffer->write_fun != nullptr && len >= serialization_chunk_size) {
+    /* too long to be worth buffering, pass it through */
+    if (serialization_buffer_flush(buffer) &&
+        buffer->write_fun(buffer->write_ctx, bytes, len) != JSONSuccess) {
+      buffer->failed = true;
+    }
+    return;
+  }
+  if (serialization_buffer_grow(buffer, len)) {
+    memcpy(buffer->cursor, bytes, len);
+    buffer->cursor += len;
+  }
+}
+
+static inline void append_bytes(serialization_buffer *buffer,
+                                const char *bytes, size_t len) {
+  if (buffer->cursor != nullptr) {
+    if ((size_t)(buffer->end - buffer->cursor) < len) {
+      append_bytes_slow(buffer, bytes, len);
+    } else {
+      memcpy(buffer->cursor, bytes, len);
+      buffer->cursor += len;
+    }
+  }
+  buffer->written_total += len;
+}
+
+/* strlen of a literal argument is folded at compile time once inlined */
+static inline void append_literal(serialization_buffer *buffer,
+                                  const char *literal) {
+  append_bytes(buffer, literal, strlen(literal));
+}
+
+static inline void append_indent(serialization_buffer *buffer, int level) {
+  for (int level_i = 0; level_i < level; level_i++) {
+    append_literal(buffer, parson_indent_str);
+  }
+}
+
+static JSON_Status json_serialize_to_buffer_r(const JSON_Value *value,
+                                              serialization_buffer *out,
+                                              int level, bool is_pretty,
+                                              char *num_buf) {
+  if (value != nullptr &&
+      (value->type == JSONObject || value->type == JSONArray) &&
+      (out->in_cached_tree ||
+       (value->flags & (value_flag_cache_text | value_flag_serialized)) !=
+           0U)) {
+    return json_serialize_cached(value, out, level, is_pretty, num_buf);
+  }
+  return json_serialize_plain_r(value, out, level, is_pretty, num_buf);
+}
+
+/* Splices the kept text of a container in a cached tree when it is still
+   valid, or serializes the container and keeps its text. Only the text that
+   lands in one contiguous buffer can be kept, not the text passed to a
+   write_fun; frozen containers are shared, so they are never written to. */
+static JSON_Status json_serialize_cached(const JSON_Value *value,
+                                         serialization_buffer *out, int level,
+                                         bool is_pretty, char *num_buf) {
+  const int fragment_level = is_pretty ? level : 0;
+  const serialized_fragment *fragment = json_value_fragments(value);
+  if (fragment != nullptr && (value->flags & value_flag_serialized) != 0U) {
+    fragment += is_pretty ? 1 : 0;
+    if (fragment->valid && fragment->level == fragment_level &&
+        fragment->generation == out->context->generation) {
+      append_bytes(out, fragment->text, fragment->len);
+      return out->failed ? JSONFailure : JSONSuccess;
+    }
+  }
+  if (out->concurrent || (value->flags & value_flag_frozen) != 0U) {
+    return json_serialize_plain_r(value, out, level, is_pretty, num_buf);
+  }
+  const bool in_cached_tree = out->in_cached_tree;
+  const size_t start = out->written_total;
+  out->in_cached_tree = true;
+  const JSON_Status status =
+      json_serialize_plain_r(value, out, level, is_pretty, num_buf);
+  out->in_cached_tree = in_cached_tree;
+  if (status != JSONSuccess) {
+    return status;
+  }
+  auto cached_value = (JSON_Value *)value;
+  cached_value->flags |= value_flag_serialized;
+  const size_t len = out->written_total - start;
+  if (len >= fragment_min_size && out->cursor != nullptr &&
+      out->write_fun == nullptr &&
+      (value->flags & (value_flag_arena | value_flag_lazy)) == 0U) {
+    json_value_keep_fragment(cached_value, is_pretty, fragment_level,
+                             out->cursor - len, len,
+                             out->context->generation);
+  }
+  return JSONSuccess;
+}
+
+/* Copies text into the fragment of value; without memory the text is simply
+   not kept. */
+static void json_value_keep_fragment(JSON_Value *value, bool is_pretty,
+                                     int level, const char *text, size_t len,
+                                     uint64_t generation) {
+  serialized_fragment **fragments = value->type == JSONObject
+                                        ? &value->value.object->fragments
+                                        : &value->value.array->fragments;
+  if (*fragments == nullptr) {
+    *fragments = (serialized_fragment *)parson_calloc(
+        2, sizeof(serialized_fragment));
+    if (*fragments == nullptr) {
+      return;
+    }
+  }
+  serialized_fragment *fragment = &(*fragments)[is_pretty ? 1 : 0];
+  fragment->valid = false;
+  if (fragment->capacity < len) {
+    auto new_text = (char *)parson_malloc(len);
+    if (new_text == nullptr) {
+      return;
+    }
+    parson_free(fragment->text);
+    fragment->text = new_text;
+    fragment->capacity = len;
+  }
+  memcpy(fragment->text, text, len);
+  fragment->len = len;
+  fragment->level = level;
+  fragment->generation = generation;
+  fragment->valid = true;
+}
+
+/* Frees the fragments of the containers in value, which stops caching. */
+static void json_value_drop_fragments(JSON_Value *value) {
+  if ((value->flags & value_flag_frozen) != 0U) {
+    return;
+  }
+  value->flags &= ~(value_flag_cache_text | value_flag_serialized);
+  if (value->type == JSONObject && (value->flags & value_flag_lazy) == 0U) {
+    JSON_Object *object = value->value.object;
+    json_fragments_free(object->fragments);
+    object->fragments = nullptr;
+    for (size_t i = 0; i < object->count; i++) {
+      json_value_drop_fragments(object->entries[i].value);
+    }
+  } else if (value->type == JSONArray &&
+             (value->flags & value_flag_lazy) == 0U) {
+    JSON_Array *array = value->value.array;
+    json_fragments_free(array->fragments);
+    array->fragments = nullptr;
+    for (size_t i = 0; i < array->count; i++) {
+      json_value_drop_fragments(array->items[i]);
+    }
+  }
+}
+
+static JSON_Status json_serialize_plain_r(const JSON_Value *value,
+                                          serialization_buffer *out,
+                                          int level, bool is_pretty,
+                                          char *num_buf) {
+  const char *key = nullptr, *string = nullptr;
+  JSON_Value *temp_value = nullptr;
+  JSON_Array *array = nullptr;
+  JSON_Object *object = nullptr;
+  size_t i = 0, count = 0;
+  double num = 0.0;
+  int written = -1;
+
+  if (value != nullptr && (value->flags & value_flag_lazy) != 0U) {
+    if (!is_pretty) {
+      const lazy_span span = value->value.lazy;
+      append_bytes(out, span.source->text + span.offset, span.len);
+      return JSONSuccess;
+    }
+    if (out->concurrent) {
+      return JSONFailure; /* serialize_weight failed to materialize it */
+    }
+  }
+  switch (json_value_get_type(value)) {
+  case JSONArray:
+    array = json_value_get_array(value);
+    if (array == nullptr) {
+      return JSONFailure; /* lazy text that failed to parse */
+    }
+    count = json_array_get_count(array);
+    append_literal(out, "[");
+    if (count > 0 && is_pretty) {
+      append_literal(out, "\n");
+    }
+    for (i = 0; i < count; i++) {
+      if (is_pretty) {
+        append_indent(out, level + 1);
+      }
+      temp_value = json_array_get_value(array, i);
+      if (json_serialize_to_buffer_r(temp_value, out, level + 1, is_pretty,
+                                     num_buf) != JSONSuccess) {
+        return JSONFailure;
+      }
+      if (i < (count - 1)) {
+        append_literal(out, ",");
+      }
+      if (is_pretty) {
+        append_literal(out, "\n");
+      }
+    }
+    if (count > 0 && is_pretty) {
+      append_indent(out, level);
+    }
+    append_literal(out, "]");
+    break;
+  case JSONObject:
+    object = json_value_get_object(value);
+    if (object == nullptr) {
+      return JSONFailure; /* lazy text that failed to parse */
+    }
+    count = json_object_get_count(object);
+    append_literal(out, "{");
+    if (count > 0 && is_pretty) {
+      append_literal(out, "\n");
+    }
+    for (i = 0; i < count; i++) {
+      key = json_object_get_name(object, i);
+      if (key == nullptr) {
+        return JSONFailure;
+      }
+      if (is_pretty) {
+        append_indent(out, level + 1);
+      }
+      json_serialize_string(key, json_object_get_name_len(object, i), out);
+      append_literal(out, ":");
+      if (is_pretty) {
+        append_literal(out, " ");
+      }
+      temp_value = json_object_get_value_at(object, i);
+      if (json_serialize_to_buffer_r(temp_value, out, level + 1, is_pretty,
+                                     num_buf) != JSONSuccess) {
+        return JSONFailure;
+      }
+      if (i < (count - 1)) {
+        append_literal(out, ",");
+      }
+      if (is_pretty) {
+        append_literal(out, "\n");
+      }
+    }
+    if (count > 0 && is_pretty) {
+      append_indent(out, level);
+    }
+    append_literal(out, "}");
+    break;
+  case JSONString:
+    string = json_value_get_string(value);
+    if (string == nullptr) {
+      return JSONFailure;
+    }
+    json_serialize_string(string, json_value_get_string_len(value), out);
+    break;
+  case JSONBoolean: {
+    const JSON_Boolean boolean_value = json_value_get_boolean(value);
+    if (boolean_value == JSONBooleanError) {
+      return JSONFailure;
+    }
+    append_literal(out, boolean_value == JSONBooleanTrue ? "true" : "false");
+    break;
+  }
+  case JSONNumber: {
+    num = json_value_get_number(value);
+    /* format straight into the output when there is room for any number */
+    char *num_out = num_buf;
+    if (out->cursor != nullptr &&
+        ((size_t)(out->end - out->cursor) >= parson_num_buf_size ||
+         ((out->serializer != nullptr || out->write_fun != nullptr) &&
+          serialization_buffer_grow(out, parson_num_buf_size)))) {
+      num_out = out->cursor;
+    }
+    const JSON_Context *context = out->context;
+    if ((value->flags & (value_flag_int64 | value_flag_uint64)) != 0U) {
+      written = json_serialize_integer(value, num_out);
+    } else if (context->number_serialization_function) {
+      written = context->number_serialization_function(num, num_out);
+    } else if (context->number_format_mode == JSONNumberFormatShortest) {
+      written = json_serialize_number_shortest(num, num_out);
+    } else {
+      const char *float_format = context->float_format
+                                     ? context->float_format
+                                     : parson_default_float_format;
+      written = parson_sprintf(num_out, parson_num_buf_size, float_format, num);
+    }
+    if (written < 0 || (size_t)written >= parson_num_buf_size) {
+      return JSONFailure;
+    }
+    if (num_out == num_buf) {
+      append_bytes(out, num_buf, (size_t)written);
+    } else {
+      out->cursor += written;
+      out->written_total += (size_t)written;
+    }
+    break;
+  }
+  case JSONNull:
+    append_literal(out, "null");
+    break;
+  case JSONError:
+    return JSONFailure;
+  default:
+    return JSONFailure;
+  }
+  return out->failed ? JSONFailure : JSONSuccess;
+}
+
+/* Serializes a whole value and null-terminates the output (the terminator is
+   not counted in written_total and not passed to write_fun). */
+static JSON_Status json_serialize_value(const JSON_Value *value,
+                                        serialization_buffer *out,
+                                        bool is_pretty) {
+  /* recursively allocating buffer on stack is a bad idea, so let's do it only
+     once */
+  char num_buf[parson_num_buf_size];
+  JSON_Stats *previous = stats_begin(out->context);
+  JSON_Status status =
+      json_serialize_to_buffer_r(value, out, 0, is_pretty, num_buf);
+  if (status == JSONSuccess && out->cursor != nullptr &&
+      out->write_fun == nullptr) {
+    if (serialization_buffer_reserve(out, 1)) {
+      *out->cursor = '\0';
+    } else {
+      status = JSONFailure;
+    }
+  }
+  JSON_Stats *stats = stats_active();
+  if (stats != nullptr && status == JSONSuccess &&
+      (out->cursor != nullptr || out->write_fun != nullptr)) {
+    stats->serializations++; /* a null cursor only measures */
+    stats->bytes_out += out->written_total;
+  }
+  stats_end(out->context, previous);
+  return status;
+}
+
+/* Parallel serialization
+   The calling thread estimates the output size of every container, splits
+   the large ones into tasks and hands each worker a contiguous run of them;
+   workers only read the tree and their context. */
+static size_t serialize_member_count(const JSON_Value *value) {
+  if (json_value_get_type(value) == JSONArray) {
+    return json_array_get_count(value->value.array);
+  }
+  return json_object_get_count(value->value.object);
+}
+
+static const JSON_Value *serialize_member(const JSON_Value *value, size_t i) {
+  if (json_value_get_type(value) == JSONArray) {
+    return json_array_get_value(value->value.array, i);
+  }
+  return json_object_get_value_at(value->value.object, i);
+}
+
+/* Rough size of the output for value; lazy containers are materialized when
+   pretty-printing, so that workers never do it. */
+static size_t serialize_weight(const JSON_Value *value, bool is_pretty) {
+  if (value != nullptr && (value->flags & value_flag_lazy) != 0U &&
+      !is_pretty) {
+    return value->value.lazy.len;
+  }
+  size_t weight = 2;
+  switch (json_value_get_type(value)) {
+  case JSONArray: {
+    const JSON_Array *array = json_value_get_array(value);
+    for (size_t i = 0; i < json_array_get_count(array); i++) {
+      weight += serialize_weight(json_array_get_value(array, i), is_pretty) + 2;
+    }
+    break;
+  }
+  case JSONObject: {
+    const JSON_Object *object = json_value_get_object(value);
+    for (size_t i = 0; i < json_object_get_count(object); i++) {
+      weight += serialize_weight(json_object_get_value_at(object, i),
+                                 is_pretty) +
+                json_object_get_name_len(object, i) + 4;
+    }
+    break;
+  }
+  case JSONString:
+    weight += json_value_get_string_len(value);
+    break;
+  default:
+    weight += 6;
+    break;
+  }
+  return weight;
+}
+
+static void serialize_plan_add(serialize_plan *plan, serialize_task task) {
+  if (plan->failed) {
+    return;
+  }
+  if (plan->count == plan->capacity) {
+    const size_t new_capacity = max_size(plan->capacity * 2, 16);
+    auto tasks = (serialize_task *)context_realloc(
+        plan->context, plan->tasks, plan->capacity * sizeof(serialize_task),
+        new_capacity * sizeof(serialize_task));
+    if (tasks == nullptr) {
+      plan->failed = true;
+      return;
+    }
+    plan->tasks = tasks;
+    plan->capacity = new_capacity;
+  }
+  plan->tasks[plan->count] = task;
+  plan->count++;
+}
+
+/* Adds the tasks for value, which weighs weight: the value itself, or for a
+   container heavier than a chunk its brackets and members in runs of about a
+   chunk each, splitting members that are heavier than a chunk on their own. */
+static void serialize_plan_value(serialize_plan *plan, const JSON_Value *value,
+                                 int level, size_t weight) {
+  const JSON_Value_Type type = json_value_get_type(value);
+  const bool is_raw = (value->flags & value_flag_lazy) != 0U &&
+                      !plan->is_pretty;
+  const size_t count = (type == JSONArray || type == JSONObject) && !is_raw
+                           ? serialize_member_count(value)
+                           : 0;
+  if (weight <= plan->chunk || count == 0) {
+    serialize_plan_add(plan, (serialize_task){.kind = serialize_task_value,
+                                              .value = value,
+                                              .level = level,
+                                              .weight = weight});
+    return;
+  }
+  const serialize_task container = {
+      .value = value, .level = level, .weight = 1};
+  serialize_task task = container;
+  task.kind = serialize_task_open;
+  serialize_plan_add(plan, task);
+  size_t first = 0, run = 0;
+  for (size_t i = 0; i < count; i++) {
+    const JSON_Value *member = serialize_member(value, i);
+    const size_t member_weight = serialize_weight(member, plan->is_pretty);
+    if (member_weight > plan->chunk) {
+      task = container;
+      if (first < i) {
+        task.kind = serialize_task_members;
+        task.first = first;
+        task.last = i;
+        task.weight = run;
+        serialize_plan_add(plan, task);
+        task = container;
+      }
+      task.kind = serialize_task_head;
+      task.first = i;
+      serialize_plan_add(plan, task);
+      serialize_plan_value(plan, member, level + 1, member_weight);
+      task.kind = serialize_task_tail;
+      serialize_plan_add(plan, task);
+      first = i + 1;
+      run = 0;
+      continue;
+    }
+    run += member_weight;
+    if (run >= plan->chunk || i + 1 == count) {
+      task = container;
+      task.kind = serialize_task_members;
+      task.first = first;
+      task.last = i + 1;
+      task.weight = run;
+      serialize_plan_add(plan, task);
+      first = i + 1;
+      run = 0;
+    }
+  }
+  task = container;
+  task.kind = serialize_task_close;
+  serialize_plan_add(plan, task);
+}
+
+/* Same as the member loop of json_serialize_to_buffer_r */
+static JSON_Status serialize_member_head(const JSON_Value *value, size_t i,
+                                         serialization_buffer *out, int level,
+                                         bool is_pretty) {
+  if (is_pretty) {
+    append_indent(out, level + 1);
+  }
+  if (json_value_get_type(value) == JSONObject) {
+    const JSON_Object *object = value->value.object;
+    const char *key = json_object_get_name(object, i);
+    if (key == nullptr) {
+      return JSONFailure;
+    }
+    json_serialize_string(key, json_object_get_name_len(object, i), out);
+    append_literal(out, ":");
+    if (is_pretty) {
+      append_literal(out, " ");
+    }
+  }
+  return JSONSuccess;
+}
+
+static void serialize_member_tail(const JSON_Value *value, size_t i,
+                                  serialization_buffer *out, bool is_pretty) {
+  if (i < serialize_member_count(value) - 1) {
+    append_literal(out, ",");
+  }
+  if (is_pretty) {
+    append_literal(out, "\n");
+  }
+}
+
+static JSON_Status serialize_task_run(const serialize_task *task,
+                                      serialization_buffer *out,
+                                      bool is_pretty, char *num_buf) {
+  const bool is_array = json_value_get_type(task->value) == JSONArray;
+  switch (task->kind) {
+  case serialize_task_value:
+    return json_serialize_to_buffer_r(task->value, out, task->level, is_pretty,
+                                      num_buf);
+  case serialize_task_open:
+    append_literal(out, is_array ? "[" : "{");
+    if (is_pretty) {
+      append_literal(out, "\n");
+    }
+    break;
+  case serialize_task_close:
+    if (is_pretty) {
+      append_indent(out, task->level);
+    }
+    append_literal(out, is_array ? "]" : "}");
+    break;
+  case serialize_task_members:
+    for (size_t i = task->first; i < task->last; i++) {
+      if (serialize_member_head(task->value, i, out, task->level,
+                                is_pretty) != JSONSuccess ||
+          json_serialize_to_buffer_r(serialize_member(task->value, i), out,
+                                     task->level + 1, is_pretty,
+                                     num_buf) != JSONSuccess) {
+        return JSONFailure;
+      }
+      serialize_member_tail(task->value, i, out, is_pretty);
+    }
+    break;
+  case serialize_task_head:
+    return serialize_member_head(task->value, task->first, out, task->level,
+                                 is_pretty);
+  case serialize_task_tail:
+    serialize_member_tail(task->value, task->first, out, is_pretty);
+    break;
+  }
+  return out->failed ? JSONFailure : JSONSuccess;
+}
+
+static void serialize_worker_run(serialize_worker *worker) {
+  char num_buf[parson_num_buf_size];
+  JSON_Serializer serializer = {.context = worker->context};
+  serialization_buffer out = {
+      .context = worker->context,
+      .serializer = &serializer,
+      .concurrent = true,
+  };
+  size_t weight = 0;
+  for (size_t i = 0; i < worker->count; i++) {
+    weight += worker->tasks[i].weight;
+  }
+  JSON_Status status = serialization_buffer_grow(&out, weight + weight / 8)
+                           ? JSONSuccess
+                           : JSONFailure;
+  for (size_t i = 0; i < worker->count && status == JSONSuccess; i++) {
+    status =
+        serialize_task_run(&worker->tasks[i], &out, worker->is_pretty, num_buf);
+  }
+  worker->buf = serializer.buf;
+  worker->capacity = serializer.capacity;
+  worker->len = out.written_total;
+  worker->status = status;
+}
+
+#if defined(PARSON_THREADS)
+static int serialize_thread_main(void *worker) {
+  serialize_worker_run((serialize_worker *)worker);
+  return 0;
+}
+#endif
+
+/* Like parallel_run, the calling thread takes the first worker. */
+static JSON_Status serialize_run(serialize_worker *workers, size_t count) {
+#if defined(PARSON_THREADS)
+  thrd_t threads[parallel_max_threads];
+  bool started[parallel_max_threads] = {false};
+  for (size_t i = 1; i < count; i++) {
+    started[i] = thrd_create(&threads[i], serialize_thread_main,
+                             &workers[i]) == thrd_success;
+  }
+  serialize_worker_run(&workers[0]);
+  for (size_t i = 1; i < count; i++) {
+    if (started[i]) {
+      thrd_join(threads[i], nullptr);
+    } else {
+      serialize_worker_run(&workers[i]);
+    }
+  }
+#else
+  for (size_t i = 0; i < count; i++) {
+    serialize_worker_run(&workers[i]);
+  }
+#endif
+  JSON_Status status = JSONSuccess;
+  for (size_t i = 0; i < count; i++) {
+    if (workers[i].status != JSONSuccess) {
+      status = JSONFailure;
+    }
+  }
+  return status;
+}
+
+/* Splits the tasks of plan among count workers by weight and joins their
+   output into one null-terminated string. */
+static char *serialize_parallel(const serialize_plan *plan,
+                                serialize_worker *workers, size_t count,
+                                size_t weight) {
+  size_t task = 0, done = 0;
+  for (size_t i = 0; i < count; i++) {
+    const size_t target = i + 1 == count ? SIZE_MAX : weight / count * (i + 1);
+    workers[i] = (serialize_worker){.context = plan->context,
+                                    .tasks = plan->tasks + task,
+                                    .is_pretty = plan->is_pretty};
+    while (task < plan->count && done < target) {
+      done += plan->tasks[task].weight;
+      task++;
+      workers[i].count++;
+    }
+  }
+  char *result = nullptr;
+  if (serialize_run(workers, count) == JSONSuccess) {
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+      len += workers[i].len;
+    }
+    result = (char *)context_malloc(plan->context, len + 1);
+    if (result != nullptr) {
+      char *cursor = result;
+      for (size_t i = 0; i < count; i++) {
+        if (workers[i].len > 0) {
+          memcpy(cursor, workers[i].buf, workers[i].len);
+          cursor += workers[i].len;
+        }
+      }
+      *cursor = '\0';
+      JSON_Stats *stats = stats_active();
+      if (stats != nullptr) {
+        stats->serializations++;
+        stats->bytes_out += len;
+      }
+    }
+  }
+  for (size_t i = 0; i < count; i++) {
+    context_free(plan->context, workers[i].buf, workers[i].capacity);
+  }
+  return result;
+}
+
+static void json_serialize_string(const char *string, size_t len,
+                                  serialization_buffer *out) {
+  static constexpr char hex_digits[] = "0123456789abcdef";
+  const char *ptr = string, *end = string + len;
+  char escape[6] = {'\\', 'u', '0', '0', '\0', '\0'};
+  const bool escape_slashes = out->context->escape_slashes;
+  append_literal(out, "\"");
+  while (ptr < end) {
+    const size_t run_len = scan_string_run(ptr, end, escape_slashes);
+    append_bytes(out, ptr, run_len);
+    ptr += run_len;
+    if (ptr == end) {
+      break;
+    }
+    const unsigned char c = (unsigned char)*ptr++;
+    switch (c) {
+    case '\"':
+      append_literal(out, "\\\"");
+      break;
+    case '\\':
+      append_literal(out, "\\\\");
+      break;
+    case '/':
+      append_literal(out, "\\/");
+      break;
+    case '\b':
+      append_literal(out, "\\b");
+      break;
+    case '\f':
+      append_literal(out, "\\f");
+      break;
+    case '\n':
+      append_literal(out, "\\n");
+      break;
+    case '\r':
+      append_literal(out, "\\r");
+      break;
+    case '\t':
+      append_literal(out, "\\t");
+      break;
+    default: /* remaining control characters */
+      escape[4] = hex_digits[c >> 4];
+      escape[5] = hex_digits[c & 0xF];
+      append_bytes(out, escape, sizeof(escape));
+      break;
+    }
+  }
+  append_literal(out, "\"");
+}
+
+/* Shortest round-trip number formatting
+   Finds the shortest decimal that parses back to the same double with Raffaello
+   Giulietti's Schubfach algorithm. It uses the parser's powers of ten, rounded
+   up by one unit as the algorithm requires. */
+static uint64_t round_to_odd(uint64_t g_hi, uint64_t g_lo, uint64_t cp) {
+  uint64_t x_hi = 0, y_hi = 0;
+  (void)multiply_u64(g_lo, cp, &x_hi);
+  const uint64_t y_lo = multiply_u64(g_hi, cp, &y_hi);
+  const uint64_t y0 = y_lo + x_hi;
+  const uint64_t y1 = y_hi + (y0 < x_hi);
+  return y1 | (y0 > 1);
+}
+
+/* Sets *digits and *exp10 so that digits * 10^exp10 is the shortest decimal
+   that rounds to num, which must be positive and finite. */
+static void shortest_decimal(double num, uint64_t *digits, int64_t *exp10) {
+  uint64_t bits = 0;
+  memcpy(&bits, &num, sizeof(bits));
+  const uint64_t ieee_significand = bits & 0x000F'FFFF'FFFF'FFFFULL;
+  const int64_t ieee_exponent = (int64_t)(bits >> 52);
+  uint64_t c = ieee_significand;
+  int64_t q = 1 - 1'075;
+  if (ieee_exponent != 0) {
+    c |= 1ULL << 52;
+    q = ieee_exponent - 1'075;
+  }
+  const bool is_even = (c & 1) == 0;
+  const bool lower_is_closer = ieee_significand == 0 && ieee_exponent > 1;
+  const uint64_t cbl = 4 * c - 2 + lower_is_closer;
+  const uint64_t cb = 4 * c;
+  const uint64_t cbr = 4 * c + 2;
+  /* floor(log10(2^q)), or floor(log10(3/4 * 2^q)) */
+  const int64_t k =
+      floor_div_pow2(q * 1'262'611 - (lower_is_closer ? 524'031 : 0), 22);
+  const int h = (int)(q + floor_log2_pow10(-k) + 1);
+  const uint64_t *power = power_of_ten_mantissas[-k - power_of_ten_min_exp10];
+  const uint64_t g_lo = power[1] + 1;
+  const uint64_t g_hi = power[0] + (g_lo == 0);
+  const uint64_t vbl = round_to_odd(g_hi, g_lo, cbl << h);
+  const uint64_t vb = round_to_odd(g_hi, g_lo, cb << h);
+  const uint64_t vbr = round_to_odd(g_hi, g_lo, cbr << h);
+  const uint64_t lower = vbl + !is_even;
+  const uint64_t upper = vbr - !is_even;
+  const uint64_t s = vb / 4;
+  if (s >= 10) {
+    const uint64_t sp = s / 10;
+    const bool up_inside = lower <= 40 * sp;
+    const bool wp_inside = 40 * sp + 40 <= upper;
+    if (up_inside != wp_inside) {
+      *digits = sp + wp_inside;
+      *exp10 = k + 1;
+      return;
+    }
+  }
+  const bool u_inside = lower <= 4 * s;
+  const bool w_inside = 4 * s + 4 <= upper;
+  if (u_inside != w_inside) {
+    *digits = s + w_inside;
+    *exp10 = k;
+    return;
+  }
+  const uint64_t mid = 4 * s + 2;
+  const bool round_up = vb > mid || (vb == mid && (s & 1) != 0);
+  *digits = s + round_up;
+  *exp10 = k;
+}
+
+/* Writes the decimal digits of value without a terminating null and returns
+   their count. */
+static int write_u64(char *buf, uint64_t value) {
+  char reversed[20];
+  int count = 0;
+  do {
+    reversed[count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  for (int i = 0; i < count; i++) {
+    buf[i] = reversed[count - 1 - i];
+  }
+  return count;
+}
+
+/* Writes the exact integer of a value_flag_int64 or value_flag_uint64 number
+   without a terminating null and returns its length. */
+static int json_serialize_integer(const JSON_Value *value, char *buf) {
+  if ((value->flags & value_flag_uint64) != 0U) {
+    return write_u64(buf, value->value.uint64);
+  }
+  const int64_t number = value->value.int64;
+  if (number >= 0) {
+    return write_u64(buf, (uint64_t)number);
+  }
+  buf[0] = '-';
+  return 1 + write_u64(buf + 1, int64_magnitude(number));
+}
+
+/* Same layout as printf's %.17g (exponent for values below 1e-4 or from 1e17
+   on), but with the fewest digits that round-trip. */
+static int json_serialize_number_shortest(double num, char *buf) {
+  char digit_buf[20];
+  char *ptr = buf;
+  uint64_t digits = 0;
+  int64_t exp10 = 0;
+  if (signbit(num)) {
+    *ptr++ = '-';
+    num = -num;
+  }
+  if (num < 9'007'199'254'740'992.0 && num == (double)(uint64_t)num) {
+    ptr += write_u64(ptr, (uint64_t)num); /* integers up to 2^53 */
+    *ptr = '\0';
+    return (int)(ptr - buf);
+  }
+  shortest_decimal(num, &digits, &exp10);
+  while (digits % 10 == 0) {
+    digits /= 10;
+    exp10++;
+  }
+  const int digit_count = write_u64(digit_buf, digits);
+  const int64_t sci_exp10 = exp10 + digit_count - 1;
+  if (sci_exp10 < -4 || sci_exp10 >= 17) {
+    *ptr++ = digit_buf[0];
+    if (digit_count > 1) {
+      *ptr++ = '.';
+      memcpy(ptr, digit_buf + 1, (size_t)digit_count - 1);
+      ptr += digit_count - 1;
+    }
+    *ptr++ = 'e';
+    *ptr++ = sci_exp10 < 0 ? '-' : '+';
+    const uint64_t abs_exp10 =
+        (uint64_t)(sci_exp10 < 0 ? -sci_exp10 : sci_exp10);
+    if (abs_exp10 < 10) {
+      *ptr++ = '0';
+    }
+    ptr += write_u64(ptr, abs_exp10);
+  } else if (exp10 >= 0) {
+    memcpy(ptr, digit_buf, (size_t)digit_count);
+    ptr += digit_count;
+    memset(ptr, '0', (size_t)exp10);
+    ptr += exp10;
+  } else if (sci_exp10 >= 0) {
+    const size_t int_len = (size_t)(sci_exp10 + 1);
+    memcpy(ptr, digit_buf, int_len);
+    ptr += int_len;
+    *ptr++ = '.';
+    memcpy(ptr, digit_buf + int_len, (size_t)digit_count - int_len);
+    ptr += (size_t)digit_count - int_len;
+  } else {
+    const size_t zeros = (size_t)(-sci_exp10 - 1);
+    *ptr++ = '0';
+    *ptr++ = '.';
+    memset(ptr, '0', zeros);
+    ptr += zeros;
+    memcpy(ptr, digit_buf, (size_t)digit_count);
+    ptr += digit_count;
+  }
+  *ptr = '\0';
+  return (int)(ptr - buf);
+}
+
+/* Parses len bytes of string (optionally preceded by a UTF-8 BOM) */
+static JSON_Value *parse_input(const char *string, size_t len,
+                               parse_context ctx, unsigned int options) {
+  structural_index index = {0};
+  JSON_Value *result = nullptr;
+  if (len >= 3 && string[0] == '\xEF' && string[1] == '\xBB' &&
+      string[2] == '\xBF') {
+    string = string + 3; /* Support for UTF-8 BOM */
+    len -= 3;
+  }
+  /* offsets are 32-bit, larger inputs are parsed without an index */
+  if ((options & JSONParseLazy) != 0 && len < UINT32_MAX) {
+    ctx.lazy = lazy_source_new(ctx.arena, string, len);
+    if (ctx.lazy == nullptr) {
+      return nullptr;
+    }
+    string = ctx.lazy->text;
+  }
+  const bool use_index = (options & JSONParseStructuralIndex) != 0 &&
+                         len < UINT32_MAX && ctx.lazy == nullptr;
+  if (use_index && structural_index_build(&index, string, len,
+                                          context_or_default(ctx.context)) !=
+                       JSONSuccess) {
+    return nullptr;
+  }
+  ctx.start = string;
+  ctx.end = string + len;
+  ctx.index = use_index ? &index : nullptr;
+  result = parse_value(&string, &ctx);
+  if (use_index) {
+    structural_index_free(&index);
+  }
+  if (ctx.lazy != nullptr) {
+    lazy_source_release(ctx.lazy);
+  }
+  return result;
+}
+
+/* parse_input, counted in the stats of ctx.context */
+static JSON_Value *parse_buffer(const char *string, size_t len,
+                                parse_context ctx, unsigned int options) {
+  JSON_Stats *previous = stats_begin(ctx.context);
+  JSON_Stats *stats = stats_active();
+  if (stats != nullptr) {
+    stats->parses++;
+    stats->bytes_in += len;
+  }
+  JSON_Value *result = parse_input(string, len, ctx, options);
+  stats_end(ctx.context, previous);
+  return result;
+}
+
+/* Removes comments from a mutable, null-terminated string and parses it */
+static JSON_Value *parse_string_with_comments_in_place(char *string) {
+  remove_comments(string, "/*", "*/");
+  remove_comments(string, "//", "\n");
+  const parse_context ctx = {
+      .arena = nullptr,
+      .start = string,
+      .end = string + strlen(string),
+      .index = nullptr,
+  };
+  const char *ptr = string;
+  return parse_value(&ptr, &ctx);
+}
+
+/* Binary encoding
+   CBOR (RFC 8949) and MessagePack items that have a JSON equivalent map one
+   to one onto values: strings are length-prefixed UTF-8 and copied without
+   escaping, numbers that are integers in the range of int64_t or uint64_t are
+   written as integers and other numbers as float32 when that holds them
+   exactly, float64 otherwise. */
+static void binary_append_be(serialization_buffer *out, unsigned char lead,
+                             uint64_t value, size_t width) {
+  char bytes[9];
+  bytes[0] = (char)lead;
+  for (size_t i = 0; i < width; i++) {
+    bytes[width - i] = (char)(value >> (8 * i));
+  }
+  append_bytes(out, bytes, width + 1);
+}
+
+/* Returns n for the narrowest of 2^n bytes that holds value. */
+static unsigned binary_width_log2(uint64_t value) {
+  return value <= UINT8_MAX    ? 0
+         : value <= UINT16_MAX ? 1
+         : value <= UINT32_MAX ? 2
+                               : 3;
+}
+
+static void cbor_append_head(serialization_buffer *out, unsigned major,
+                             uint64_t arg) {
+  const auto type = (unsigned char)(major << 5);
+  if (arg < 24) {
+    binary_append_be(out, type | (unsigned char)arg, 0, 0);
+    return;
+  }
+  const unsigned width_log2 = binary_width_log2(arg);
+  binary_append_be(out, type | (unsigned char)(24 + width_log2), arg,
+                   (size_t)1 << width_log2);
+}
+
+/* Writes the length of a MessagePack string, array or map: in fix_lead up to
+   fix_max, otherwise after lead8 (if not 0), lead16 or lead16 + 1. */
+static JSON_Status msgpack_append_len(serialization_buffer *out, size_t len,
+                                      unsigned char fix_lead, size_t fix_max,
+                                      unsigned char lead8,
+                                      unsigned char lead16) {
+  if (len <= fix_max) {
+    binary_append_be(out, fix_lead | (unsigned char)len, 0, 0);
+  } else if (lead8 != 0 && len <= UINT8_MAX) {
+    binary_append_be(out, lead8, len, 1);
+  } else if (len <= UINT16_MAX) {
+    binary_append_be(out, lead16, len, 2);
+  } else if (len <= UINT32_MAX) {
+    binary_append_be(out, lead16 + 1, len, 4);
+  } else {
+    return JSONFailure;
+  }
+  return JSONSuccess;
+}
+
+static JSON_Status binary_append_string(serialization_buffer *out,
+                                        const char *string, size_t len,
+                                        binary_format format) {
+  /* the decoders reject text strings that aren't, so don't write them */
+  if (!is_valid_utf8(string, len)) {
+    return JSONFailure;
+  }
+  if (format == binary_cbor) {
+    cbor_append_head(out, 3, len);
+  } else if (msgpack_append_len(out, len, 0xA0, 31, 0xD9, 0xDA) !=
+             JSONSuccess) {
+    return JSONFailure;
+  }
+  append_bytes(out, string, len);
+  return JSONSuccess;
+}
+
+static void binary_append_uint(serialization_buffer *out, uint64_t value,
+                               binary_format format) {
+  if (format == binary_cbor) {
+    cbor_append_head(out, 0, value);
+  } else if (value <= 0x7F) {
+    binary_append_be(out, (unsigned char)value, 0, 0);
+  } else {
+    const unsigned width_log2 = binary_width_log2(value);
+    binary_append_be(out, (unsigned char)(0xCC + width_log2), value,
+                     (size_t)1 << width_log2);
+  }
+}
+
+static void binary_append_negative(serialization_buffer *out, int64_t value,
+                                   binary_format format) {
+  if (format == binary_cbor) {
+    cbor_append_head(out, 1, (uint64_t)(-1 - value));
+  } else if (value >= -32) {
+    binary_append_be(out, (unsigned char)(value & 0xFF), 0, 0);
+  } else {
+    /* -1 - value must fit in the bits below the sign bit */
+    const unsigned width_log2 = binary_width_log2((uint64_t)(-1 - value) * 2);
+    binary_append_be(out, (unsigned char)(0xD0 + width_log2), (uint64_t)value,
+                     (size_t)1 << width_log2);
+  }
+}
+
+static void binary_append_number(serialization_buffer *out,
+                                 const JSON_Value *value,
+                                 binary_format format) {
+  const bool cbor = format == binary_cbor;
+  if ((value->flags & value_flag_uint64) != 0U) {
+    binary_append_uint(out, value->value.uint64, format);
+    return;
+  }
+  if ((value->flags & value_flag_int64) != 0U) {
+    if (value->value.int64 >= 0) {
+      binary_append_uint(out, (uint64_t)value->value.int64, format);
+    } else {
+      binary_append_negative(out, value->value.int64, format);
+    }
+    return;
+  }
+  const double num = value->value.number;
+  if (num >= 0.0 && num < 0x1p64 && !signbit(num) &&
+      (double)(uint64_t)num == num) {
+    binary_append_uint(out, (uint64_t)num, format);
+    return;
+  }
+  if (num < 0.0 && num >= -0x1p63 && (double)(int64_t)num == num) {
+    binary_append_negative(out, (int64_t)num, format);
+    return;
+  }
+  const auto single = (float)(fabs(num) <= FLT_MAX ? num : 0.0);
+  if ((double)single == num) {
+    uint32_t bits = 0;
+    memcpy(&bits, &single, sizeof(bits));
+    binary_append_be(out, cbor ? 0xFA : 0xCA, bits, 4);
+  } else {
+    uint64_t bits = 0;
+    memcpy(&bits, &num, sizeof(bits));
+    binary_append_be(out, cbor ? 0xFB : 0xCB, bits, 8);
+  }
+}
+
+static JSON_Status binary_serialize_r(const JSON_Value *value,
+                                      serialization_buffer *out,
+                                      binary_format format) {
+  const bool cbor = format == binary_cbor;
+  switch (json_value_get_type(value)) {
+  case JSONArray: {
+    const JSON_Array *array = json_value_get_array(value);
+    if (array == nullptr) {
+      return JSONFailure;
+    }
+    const size_t count = json_array_get_count(array);
+    if (cbor) {
+      cbor_append_head(out, 4, count);
+    } else if (msgpack_append_len(out, count, 0x90, 15, 0, 0xDC) !=
+               JSONSuccess) {
+      return JSONFailure;
+    }
+    for (size_t i = 0; i < count; i++) {
+      if (binary_serialize_r(json_array_get_value(array, i), out, format) !=
+          JSONSuccess) {
+        return JSONFailure;
+      }
+    }
+    return JSONSuccess;
+  }
+  case JSONObject: {
+    const JSON_Object *object = json_value_get_object(value);
+    if (object == nullptr) {
+      return JSONFailure;
+    }
+    const size_t count = json_object_get_count(object);
+    if (cbor) {
+      cbor_append_head(out, 5, count);
+    } else if (msgpack_append_len(out, count, 0x80, 15, 0, 0xDE) !=
+               JSONSuccess) {
+      return JSONFailure;
+    }
+    for (size_t i = 0; i < count; i++) {
+      const object_entry *entry = &object->entries[i];
+      if (binary_append_string(out, entry->key, entry->key_len, format) !=
+              JSONSuccess ||
+          binary_serialize_r(entry->value, out, format) != JSONSuccess) {
+        return JSONFailure;
+      }
+    }
+    return JSONSuccess;
+  }
+  case JSONString: {
+    const JSON_String string = json_value_get_string_desc(value);
+    return binary_append_string(out, string.chars, string.length, format);
+  }
+  case JSONNumber:
+    binary_append_number(out, value, format);
+    return JSONSuccess;
+  case JSONBoolean:
+    binary_append_be(out,
+                     cbor ? (value->value.boolean ? 0xF5 : 0xF4)
+                          : (value->value.boolean ? 0xC3 : 0xC2),
+                     0, 0);
+    return JSONSuccess;
+  case JSONNull:
+    binary_append_be(out, cbor ? 0xF6 : 0xC0, 0, 0);
+    return JSONSuccess;
+  default:
+    return JSONFailure;
+  }
+}
+
+/* Measures value, then writes it into a buffer of exactly that size. */
+static char *binary_serialize(const JSON_Value *value, size_t *len,
+                              binary_format format) {
+  serialization_buffer out = {.context = context_or_default(nullptr)};
+  if (binary_serialize_r(value, &out, format) != JSONSuccess) {
+    return nullptr;
+  }
+  const size_t size = out.written_total;
+  auto buf = (char *)parson_malloc(size);
+  if (buf == nullptr) {
+    return nullptr;
+  }
+  out = (serialization_buffer){
+      .context = out.context,
+      .cursor = buf,
+      .end = buf + size,
+  };
+  if (binary_serialize_r(value, &out, format) != JSONSuccess) {
+    parson_free(buf);
+    return nullptr;
+  }
+  if (len != nullptr) {
+    *len = size;
+  }
+  return buf;
+}
+
+static bool binary_read_be(binary_reader *reader, size_t width,
+                           uint64_t *value) {
+  if ((size_t)(reader->end - reader->ptr) < width) {
+    return false;
+  }
+  uint64_t result = 0;
+  for (size_t i = 0; i < width; i++) {
+    result = result << 8 | reader->ptr[i];
+  }
+  reader->ptr += width;
+  *value = result;
+  return true;
+}
+
+static double cbor_half_to_double(uint64_t half) {
+  const int exponent = (int)((half >> 10) & 0x1F);
+  const double mantissa = (double)(half & 0x3FF);
+  double result = 0.0;
+  if (exponent == 0) {
+    result = ldexp(mantissa, -24);
+  } else if (exponent != 31) {
+    result = ldexp(mantissa + 1'024, exponent - 25);
+  } else {
+    result = mantissa == 0 ? HUGE_VAL : NAN; /* rejected as numbers later */
+  }
+  return (half & 0x8000) != 0 ? -result : result;
+}
+
+static void binary_head_integer(binary_head *head, bool negative,
+                                uint64_t magnitude) {
+  head->type = JSONNumber;
+  head->number = negative ? -(double)magnitude : (double)magnitude;
+  head->integer = true;
+  head->negative = negative;
+  head->magnitude = magnitude;
+}
+
+static bool cbor_read_head(binary_reader *reader, binary_head *head) {
+  unsigned major = 6;
+  uint64_t arg = 0;
+  unsigned info = 0;
+  head->integer = false;
+  while (major == 6) { /* tags only annotate the item that follows */
+    if (reader->ptr == reader->end) {
+      return false;
+    }
+    const unsigned char lead = *reader->ptr++;
+    major = lead >> 5;
+    info = lead & 0x1F;
+    head->indefinite = info == 31;
+    if (info < 24) {
+      arg = info;
+    } else if (info < 28) {
+      if (!binary_read_be(reader, (size_t)1 << (info - 24), &arg)) {
+        return false;
+      }
+    } else if (!head->indefinite || (major != 4 && major != 5)) {
+      return false; /* reserved, break or an indefinite string */
+    } else {
+      arg = 0;
+    }
+  }
+  head->len = arg;
+  switch (major) {
+  case 0:
+    binary_head_integer(head, false, arg);
+    return true;
+  case 1:
+    if (arg == UINT64_MAX) { /* -2^64 */
+      head->type = JSONNumber;
+      head->number = -0x1p64;
+    } else {
+      binary_head_integer(head, true, arg + 1);
+    }
+    return true;
+  case 3:
+    head->type = JSONString;
+    return true;
+  case 4:
+    head->type = JSONArray;
+    return true;
+  case 5:
+    head->type = JSONObject;
+    return true;
+  case 7:
+    break;
+  default: /* byte strings */
+    return false;
+  }
+  head->type = JSONNumber;
+  if (info == 20 || info == 21) {
+    head->type = JSONBoolean;
+    head->boolean = info == 21;
+  } else if (info == 22 || info == 23) {
+    head->type = JSONNull; /* undefined is read as null */
+  } else if (info == 25) {
+    head->number = cbor_half_to_double(arg);
+  } else if (info == 26) {
+    const auto bits = (uint32_t)arg;
+    float single = 0.0F;
+    memcpy(&single, &bits, sizeof(single));
+    head->number = (double)single;
+  } else if (info == 27) {
+    memcpy(&head->number, &arg, sizeof(head->number));
+  } else {
+    return false; /* other simple values */
+  }
+  return true;
+}
+
+static bool msgpack_read_head(binary_reader *reader, binary_head *head) {
+  uint64_t arg = 0;
+  if (reader->ptr == reader->end) {
+    return false;
+  }
+  const unsigned char lead = *reader->ptr++;
+  head->indefinite = false;
+  head->integer = false;
+  if (lead <= 0x7F || lead >= 0xE0) {
+    head->type = JSONNumber;
+    head->number = lead <= 0x7F ? (double)lead : (double)lead - 256;
+    return true;
+  }
+  if (lead <= 0xBF) {
+    head->type = lead >= 0xA0 ? JSONString
+                 : lead >= 0x90 ? JSONArray
+                                : JSONObject;
+    head->len = lead & (lead >= 0xA0 ? 0x1F : 0x0F);
+    return true;
+  }
+  switch (lead) {
+  case 0xC0:
+    head->type = JSONNull;
+    return true;
+  case 0xC2:
+  case 0xC3:
+    head->type = JSONBoolean;
+    head->boolean = lead == 0xC3;
+    return true;
+  case 0xCA: {
+    if (!binary_read_be(reader, 4, &arg)) {
+      return false;
+    }
+    const auto bits = (uint32_t)arg;
+    float single = 0.0F;
+    memcpy(&single, &bits, sizeof(single));
+    head->type = JSONNumber;
+    head->number = (double)single;
+    return true;
+  }
+  case 0xCB:
+    if (!binary_read_be(reader, 8, &arg)) {
+      return false;
+    }
+    head->type = JSONNumber;
+    memcpy(&head->number, &arg, sizeof(head->number));
+    return true;
+  case 0xCC:
+  case 0xCD:
+  case 0xCE:
+  case 0xCF:
+    if (!binary_read_be(reader, (size_t)1 << (lead - 0xCC), &arg)) {
+      return false;
+    }
+    binary_head_integer(head, false, arg);
+    return true;
+  case 0xD0:
+  case 0xD1:
+  case 0xD2:
+  case 0xD3: {
+    const size_t width = (size_t)1 << (lead - 0xD0);
+    if (!binary_read_be(reader, width, &arg)) {
+      return false;
+    }
+    const uint64_t sign = 1ULL << (8 * width - 1);
+    const uint64_t magnitude_mask = sign * 2 - 1; /* all ones for int64 */
+    const bool negative = (arg & sign) != 0;
+    binary_head_integer(head, negative,
+                        negative ? (~arg & magnitude_mask) + 1 : arg);
+    return true;
+  }
+  case 0xD9:
+  case 0xDA:
+  case 0xDB:
+    head->type = JSONString;
+    return binary_read_be(reader, (size_t)1 << (lead - 0xD9), &head->len);
+  case 0xDC:
+  case 0xDD:
+    head->type = JSONArray;
+    return binary_read_be(reader, lead == 0xDC ? 2 : 4, &head->len);
+  case 0xDE:
+  case 0xDF:
+    head->type = JSONObject;
+    return binary_read_be(reader, lead == 0xDE ? 2 : 4, &head->len);
+  default: /* bin, ext and the unused 0xC1 */
+    return false;
+  }
+}
+
+static bool binary_read_head(binary_reader *reader, binary_head *head) {
+  return reader->format == binary_cbor ? cbor_read_head(reader, head)
+                                       : msgpack_read_head(reader, head);
+}
+
+/* Consumes the break byte closing an indefinite CBOR container. */
+static bool binary_read_break(binary_reader *reader) {
+  if (reader->ptr == reader->end || *reader->ptr != 0xFF) {
+    return false;
+  }
+  reader->ptr++;
+  return true;
+}
+
+static size_t binary_remaining(const binary_reader *reader) {
+  return (size_t)(reader->end - reader->ptr);
+}
+
+[[nodiscard]] static JSON_Value *binary_parse_array(binary_reader *reader,
+                                                    const binary_head *head) {
+  /* every element takes at least a byte, which bounds the preallocation */
+  if (!head->indefinite && head->len > binary_remaining(reader)) {
+    return nullptr;
+  }
+  JSON_Value *value = json_value_init_array_in(reader->arena);
+  if (value == nullptr) {
+    return nullptr;
+  }
+  JSON_Array *array = value->value.array;
+  if (!head->indefinite && head->len > 0 &&
+      json_array_resize(array, (size_t)head->len) != JSONSuccess) {
+    json_value_free(value);
+    return nullptr;
+  }
+  for (uint64_t i = 0; head->indefinite || i < head->len; i++) {
+    if (head->indefinite && binary_read_break(reader)) {
+      break;
+    }
+    JSON_Value *item = binary_parse_value(reader);
+    if (item == nullptr || json_array_add(array, item) != JSONSuccess) {
+      json_value_free(item);
+      json_value_free(value);
+      return nullptr;
+    }
+  }
+  return value;
+}
+
+[[nodiscard]] static JSON_Value *binary_parse_object(binary_reader *reader,
+                                                     const binary_head *head) {
+  if (!head->indefinite && head->len > binary_remaining(reader) / 2) {
+    return nullptr;
+  }
+  JSON_Value *value = json_value_init_object_in(reader->arena);
+  if (value == nullptr) {
+    return nullptr;
+  }
+  JSON_Object *object = value->value.object;
+  for (uint64_t i = 0; head->indefinite || i < head->len; i++) {
+    if (head->indefinite && binary_read_break(reader)) {
+      break;
+    }
+    binary_head key_head;
+    if (!binary_read_head(reader, &key_head) ||
+        key_head.type != JSONString ||
+        key_head.len > binary_remaining(reader) ||
+        !is_valid_utf8((const char *)reader->ptr, (size_t)key_head.len)) {
+      json_value_free(value);
+      return nullptr;
+    }
+    const auto key_len = (size_t)key_head.len;
+    char *key =
+        parson_strndup_in(reader->arena, (const char *)reader->ptr, key_len);
+    reader->ptr += key_len;
+    JSON_Value *item = key != nullptr ? binary_parse_value(reader) : nullptr;
+    if (item == nullptr ||
+        json_object_add(object, key, key_len, item) != JSONSuccess) {
+      parson_free_in(reader->arena, key);
+      json_value_free(item);
+      json_value_free(value);
+      return nullptr;
+    }
+  }
+  return value;
+}
+
+static JSON_Value *binary_parse_value(binary_reader *reader) {
+  binary_head head;
+  if (!binary_read_head(reader, &head)) {
+    return nullptr;
+  }
+  switch (head.type) {
+  case JSONNull:
+    return json_value_init_null_in(reader->arena);
+  case JSONBoolean:
+    return json_value_init_boolean_in(reader->arena, head.boolean);
+  case JSONNumber:
+    if (head.integer && integer_needs_exact(head.negative, head.magnitude)) {
+      return json_value_init_integer_in(reader->arena, head.negative,
+                                        head.magnitude);
+    }
+    return json_value_init_number_in(reader->arena, head.number);
+  case JSONString: {
+    if (head.len > binary_remaining(reader)) {
+      return nullptr;
+    }
+    const char *string = (const char *)reader->ptr;
+    reader->ptr += head.len;
+    return json_value_init_string_with_len_in(reader->arena, string,
+                                              (size_t)head.len);
+  }
+  case JSONArray:
+  case JSONObject: {
+    if (reader->depth >= max_nesting) {
+      return nullptr;
+    }
+    reader->depth++;
+    JSON_Value *value = head.type == JSONArray
+                            ? binary_parse_array(reader, &head)
+                            : binary_parse_object(reader, &head);
+    reader->depth--;
+    return value;
+  }
+  default:
+    return nullptr;
+  }
+}
+
+/* Parses one item that must span all len bytes of data. */
+static JSON_Value *binary_parse(const char *data, size_t len,
+                                JSON_Arena *arena, binary_format format) {
+  if (data == nullptr) {
+    return nullptr;
+  }
+  binary_reader reader = {
+      .ptr = (const unsigned char *)data,
+      .end = (const unsigned char *)data + len,
+      .format = format,
+      .arena = arena,
+  };
+  JSON_Value *value = binary_parse_value(&reader);
+  if (value != nullptr && reader.ptr != reader.end) {
+    json_value_free(value);
+    return nullptr;
+  }
+  return value;
+}
+
+/* Parser API */
+JSON_Value *json_parse_file(const char *filename) {
+  mapped_file file;
+  JSON_Value *output_value = nullptr;
+  if (map_file(filename, true, &file) == JSONSuccess) {
+    output_value =
+        parse_buffer(file.data, file.len, (parse_context){0}, JSONParseDefault);
+    unmap_file(&file);
+    return output_value;
+  }
+  /* no mapping on this platform, or not a regular file */
+  char *file_contents = read_file(filename, nullptr);
+  if (file_contents == nullptr) {
+    return nullptr;
+  }
+  output_value = json_parse_string(file_contents);
+  parson_free(file_contents);
+  return output_value;
+}
+
+JSON_Value *json_parse_file_with_comments(const char *filename) {
+  char *file_contents = read_file(filename, nullptr);
+  JSON_Value *output_value = nullptr;
+  if (file_contents == nullptr) {
+    return nullptr;
+  }
+  output_value = parse_string_with_comments_in_place(file_contents);
+  parson_free(file_contents);
+  return output_value;
+}
+
+JSON_Value *json_parse_string(const char *string) {
+  return json_parse_string_arena(string, nullptr);
+}
+
+JSON_Value *json_parse_buffer(const char *buffer, size_t len) {
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  return parse_buffer(buffer, len, (parse_context){0}, JSONParseDefault);
+}
+
+JSON_Value *json_parse_string_insitu(char *buffer, size_t len) {
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  return parse_buffer(buffer, len, (parse_context){.insitu = true},
+                      JSONParseDefault);
+}
+
+JSON_Value *json_parse_string_with_comments(const char *string) {
+  JSON_Value *result = nullptr;
+  char *string_mutable_copy = nullptr;
+  if (string == nullptr) {
+    return nullptr;
+  }
+  string_mutable_copy = parson_strdup(string);
+  if (string_mutable_copy == nullptr) {
+    return nullptr;
+  }
+  result = parse_string_with_comments_in_place(string_mutable_copy);
+  parson_free(string_mutable_copy);
+  return result;
+}
+
+JSON_Value *json_parse_string_arena(const char *string, JSON_Arena *arena) {
+  return json_parse_string_with_options(string, arena, JSONParseDefault);
+}
+
+JSON_Value *json_parse_string_with_options(const char *string,
+                                           JSON_Arena *arena,
+                                           unsigned int options) {
+  if (string == nullptr) {
+    return nullptr;
+  }
+  return parse_buffer(string, strlen(string), (parse_context){.arena = arena},
+                      options);
+}
+
+JSON_Value *json_parse_string_with_key_table(const char *string,
+                                             JSON_Key_Table *keys) {
+  if (string == nullptr) {
+    return nullptr;
+  }
+  return parse_buffer(string, strlen(string), (parse_context){.keys = keys},
+                      JSONParseDefault);
+}
+
+JSON_Value *json_parse_string_ex(const char *string, JSON_Arena *arena,
+                                 unsigned int options,
+                                 const JSON_Context *context) {
+  if (string == nullptr) {
+    return nullptr;
+  }
+  return json_parse_buffer_ex(string, strlen(string), arena, options, context);
+}
+
+JSON_Value *json_parse_buffer_ex(const char *buffer, size_t len,
+                                 JSON_Arena *arena, unsigned int options,
+                                 const JSON_Context *context) {
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  return parse_buffer(buffer, len,
+                      (parse_context){.context = context, .arena = arena},
+                      options);
+}
+
+JSON_Status json_parse_events(const char *buffer, size_t len,
+                              const JSON_Handler *handler, void *ctx) {
+  if (buffer == nullptr || handler == nullptr) {
+    return JSONFailure;
+  }
+  if (len >= 3 && buffer[0] == '\xEF' && buffer[1] == '\xBB' &&
+      buffer[2] == '\xBF') {
+    buffer = buffer + 3; /* Support for UTF-8 BOM */
+    len -= 3;
+  }
+  event_parser parser = {
+      .handler = handler,
+      .ctx = ctx,
+      .input = {.start = buffer, .end = buffer + len},
+      .expect = parse_expect_value,
+  };
+  const char *ptr = buffer;
+  const JSON_Status status = event_parse(&parser, &ptr);
+  parson_free(parser.scratch);
+  return status;
+}
+
+JSON_Value *json_parse_records_parallel(const char *buffer, size_t len,
+                                        JSON_Records_Format format,
+                                        size_t threads, JSON_Arena *arena) {
+  if (buffer == nullptr) {
+    return nullptr;
+  }
+  const char *string = buffer;
+  if (len >= 3 && memcmp(buffer, "\xEF\xBB\xBF", 3) == 0) {
+    string += 3; /* Support for UTF-8 BOM */
+    len -= 3;
+  }
+  const size_t allocated = parallel_thread_count(threads, len);
+  size_t count = allocated;
+  auto workers =
+      (parallel_worker *)parson_calloc(allocated, sizeof(parallel_worker));
+  if (workers == nullptr) {
+    return nullptr;
+  }
+  atomic_bool stop = false;
+  bool ready = true;
+  for (size_t i = 0; i < allocated; i++) {
+    workers[i] = (parallel_worker){
+        .buffer = buffer, .format = format, .stop = &stop};
+    if (arena != nullptr) {
+      workers[i].arena = json_arena_new_ex(arena->context);
+      ready = ready && workers[i].arena != nullptr;
+    }
+  }
+  JSON_Value *result = nullptr;
+  if (ready && parallel_run(string, len, workers, &count) == JSONSuccess) {
+    result = parallel_join(workers, count, arena);
+  }
+  for (size_t i = 0; i < allocated; i++) {
+    if (result == nullptr) {
+      for (size_t j = 0; j < workers[i].count; j++) {
+        json_value_free(workers[i].records[j]);
+      }
+    }
+    if (result != nullptr && arena != nullptr && i < count) {
+      /* the records' arena now lives as long as the caller's */
+      workers[i].arena->next_sibling = arena->children;
+      arena->children = workers[i].arena;
+    } else {
+      json_arena_free(workers[i].arena);
+    }
+    parson_free(workers[i].records);
+  }
+  parson_free(workers);
+  return result;
+}
+
+JSON_Value *json_parse_file_parallel(const char *filename,
+                                     JSON_Records_Format format,
+                                     size_t threads, JSON_Arena *arena) {
+  mapped_file file;
+  JSON_Value *output_value = nullptr;
+  /* not populated: every worker faults in the pages of its own chunk */
+  if (map_file(filename, false, &file) == JSONSuccess) {
+    output_value = json_parse_records_parallel(file.data, file.len, format,
+                                               threads, arena);
+    unmap_file(&file);
+    return output_value;
+  }
+  size_t len = 0;
+  char *file_contents = read_file(filename, &len);
+  if (file_contents == nullptr) {
+    return nullptr;
+  }
+  output_value = json_parse_records_parallel(file_contents, len, format,
+                                             threads, arena);
+  parson_free(file_contents);
+  return output_value;
+}
+
+JSON_Status json_parse_records_parallel_each(const char *buffer, size_t len,
+                                             JSON_Records_Format format,
+                                             size_t threads,
+                                             JSON_Record_Function record_fun,
+                                             void *ctx) {
+  if (buffer == nullptr || record_fun == nullptr) {
+    return JSONFailure;
+  }
+  const char *string = buffer;
+  if (len >= 3 && memcmp(buffer, "\xEF\xBB\xBF", 3) == 0) {
+    string += 3; /* Support for UTF-8 BOM */
+    len -= 3;
+  }
+  const size_t allocated = parallel_thread_count(threads, len);
+  size_t count = allocated;
+  auto workers =
+      (parallel_worker *)parson_calloc(allocated, sizeof(parallel_worker));
+  if (workers == nullptr) {
+    return JSONFailure;
+  }
+  atomic_bool stop = false;
+  bool ready = true;
+  for (size_t i = 0; i < allocated; i++) {
+    workers[i] = (parallel_worker){.buffer = buffer,
+                                   .format = format,
+                                   .arena = json_arena_new(),
+                                   .record_fun = record_fun,
+                                   .record_ctx = ctx,
+                                   .stop = &stop};
+    ready = ready && workers[i].arena != nullptr;
+  }
+  JSON_Status status = ready ? parallel_run(string, len, workers, &count)
+                             : JSONFailure;
+  for (size_t i = 0; i < allocated; i++) {
+    json_arena_free(workers[i].arena);
+  }
+  parson_free(workers);
+  return status;
+}
+
+JSON_Parser *json_parser_new() {
+  auto parser = (JSON_Parser *)parson_calloc(1, sizeof(JSON_Parser));
+  if (parser == nullptr) {
+    return nullptr;
+  }
+  parse_stack_init(&parser->stack, nullptr, false, nullptr);
+  return parser;
+}
+
+void json_parser_free(JSON_Parser *parser) {
+  if (parser == nullptr) {
+    return;
+  }
+  parse_stack_free(&parser->stack);
+  parson_free(parser->token);
+  parson_free(parser);
+}
+
+JSON_Status json_parser_feed(JSON_Parser *parser, const char *data,
+                             size_t len) {
+  if (parser == nullptr || (data == nullptr && len > 0) || parser->failed) {
+    return JSONFailure;
+  }
+  const char *ptr = data;
+  const char *end = data + len;
+  while (ptr < end) {
+    if (parser->stack.expect == parse_expect_nothing &&
+        parser->lexer == push_lexer_between) {
+      break; /* like json_parse_string, input after the value is ignored */
+    }
+    const JSON_Status status = parser->lexer == push_lexer_between
+                                   ? push_lex_token(parser, &ptr, end)
+                                   : push_lex_continue(parser, &ptr, end);
+    if (status != JSONSuccess) {
+      parser->failed = true;
+      return JSONFailure;
+    }
+  }
+  return JSONSuccess;
+}
+
+JSON_Value *json_parser_finish(JSON_Parser *parser) {
+  JSON_Value *result = nullptr;
+  if (parser == nullptr) {
+    return nullptr;
+  }
+  if (!parser->failed && parser->lexer == push_lexer_number &&
+      push_finish_number(parser) != JSONSuccess) {
+    parser->failed = true;
+  }
+  if (!parser->failed && parser->lexer == push_lexer_between &&
+      parser->stack.expect == parse_expect_nothing) {
+    result = parse_stack_release(&parser->stack);
+  }
+  parse_stack_free(&parser->stack);
+  parser->lexer = push_lexer_between;
+  parser->token_len = 0;
+  parser->escape_pending = false;
+  parser->started = false;
+  parser->failed = false;
+  return result;
+}
+
+/* Arena API */
+JSON_Arena *json_arena_new() { return json_arena_new_ex(nullptr); }
+
+JSON_Arena *json_arena_new_ex(const JSON_Context *context) {
+  context = context_or_default(context);
+  auto arena = (JSON_Arena *)context_malloc(context, sizeof(JSON_Arena));
+  if (arena == nullptr) {
+    return nullptr;
+  }
+  *arena = (JSON_Arena){.context = context};
+  return arena;
+}
+
+void json_arena_reset(JSON_Arena *arena) {
+  arena_chunk *chunk = nullptr, *next = nullptr, *kept = nullptr;
+  if (arena == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < arena->adopted_count; i++) {
+    json_value_free(arena->adopted[i]);
+  }
+  arena->adopted_count = 0;
+  while (arena->children != nullptr) {
+    JSON_Arena *child = arena->children;
+    arena->children = child->next_sibling;
+    json_arena_free(child);
+  }
+  /* Keep one regular chunk around so that parsing a similar document again
+     doesn't have to go back to the allocator for small inputs. */
+  for (chunk = arena->chunks; chunk != nullptr; chunk = next) {
+    next = chunk->next;
+    if (kept == nullptr && chunk->capacity == arena_chunk_size) {
+      kept = chunk;
+      continue;
+    }
+    context_free(arena->context, chunk, sizeof(arena_chunk) + chunk->capacity);
+  }
+  if (kept != nullptr) {
+    kept->next = nullptr;
+    kept->used = 0;
+  }
+  arena->chunks = kept;
+}
+
+void json_arena_free(JSON_Arena *arena) {
+  if (arena == nullptr) {
+    return;
+  }
+  json_arena_reset(arena);
+  const JSON_Context *context = arena->context;
+  if (arena->chunks != nullptr) {
+    context_free(context, arena->chunks,
+                 sizeof(arena_chunk) + arena->chunks->capacity);
+  }
+  context_free(context, arena->adopted,
+               arena->adopted_capacity * sizeof(JSON_Value *));
+  context_free(context, arena, sizeof(JSON_Arena));
+}
+
+/* Key table API */
+JSON_Key_Table *json_key_table_new() {
+  return (JSON_Key_Table *)parson_calloc(1, sizeof(JSON_Key_Table));
+}
+
+void json_key_table_free(JSON_Key_Table *table) {
+  if (table == nullptr) {
+    return;
+  }
+  for (size_t i = 0; i < table->capacity; i++) {
+    parson_free(table->slots[i]);
+  }
+  parson_free(table->slots);
+  parson_free(table);
+}
+
+size_t json_key_table_get_count(const JSON_Key_Table *table) {
+  return table == nullptr ? 0 : table->count;
+}
+
+/* JSON Object API */
+
+JSON_Value *json_object_get_value(const JSON_Object *object, const char *name) {
+  if (object == nullptr || name == nullptr) {
+    return nullptr;
+  }
+  return json_object_get_value_with_len(object, name, strlen(name));
+}
+
+const char *json_object_get_string(const JSON_Object *object,
+                                   const char *name) {
+  return json_value_get_string(json_object_get_value(object, name));
+}
+
+size_t json_object_get_string_len(const JSON_Object *object, const char *name) {
+  return json_value_get_string_len(json_object_get_value(object, name));
+}
+
+double json_object_get_number(const JSON_Object *object, const char *name) {
+  return json_value_get_number(json_object_get_value(object, name));
+}
+
+int64_t json_object_get_int64(const JSON_Object *object, const char *name) {
+  return json_value_get_int64(json_object_get_value(object, name));
+}
+
+JSON_Object *json_object_get_object(const JSON_Object *object,
+                                    const char *name) {
+  return json_value_get_object(json_object_get_value(object, name));
+}
+
+JSON_Array *json_object_get_array(const JSON_Object *object, const char *name) {
+  return json_value_get_array(json_object_get_value(object, name));
+}
+
+JSON_Boolean json_object_get_boolean(const JSON_Object *object,
+                                     const char *name) {
+  return json_value_get_boolean(json_object_get_value(object, name));
+}
+
+JSON_Value *json_object_dotget_value(const JSON_Object *object,
+                                     const char *name) {
+  if (object == nullptr || name == nullptr) {
+    return nullptr;
+  }
+  const char *dot_position = strchr(name, '.');
+  if (dot_position == nullptr) {
+    return json_object_get_value(object, name);
+  }
+  object = json_value_get_object(
+      json_object_get_value_with_len(object, name, dot_position - name));
+  return json_object_dotget_value(object, dot_position + 1);
+}
+
+const char *json_object_dotget_string(const JSON_Object *object,
+                                      const char *name) {
+  return json_value_get_string(json_object_dotget_value(object, name));
+}
+
+size_t json_object_dotget_string_len(const JSON_Object *object,
+                                     const char *name) {
+  return json_value_get_string_len(json_object_dotget_value(object, name));
+}
+
+double json_object_dotget_number(const JSON_Object *object, const char *name) {
+  return json_value_get_number(json_object_dotget_value(object, name));
+}
+
+JSON_Object *json_object_dotget_object(const JSON_Object *object,
+                                       const char *name) {
+  return json_value_get_object(json_object_dotget_value(object, name));
+}
+
+JSON_Array *json_object_dotget_array(const JSON_Object *object,
+                                     const char *name) {
+  return json_value_get_array(json_object_dotget_value(object, name));
+}
+
+JSON_Boolean json_object_dotget_boolean(const JSON_Object *object,
+                                        const char *name) {
+  return json_value_get_boolean(json_object_dotget_value(object, name));
+}
+
+size_t json_object_get_count(const JSON_Object *object) {
+  return object == nullptr ? 0 : object->count;
+}
+
+const char *json_object_get_name(const JSON_Object *object, size_t index) {
+  if (object == nullptr || index >= json_object_get_count(object)) {
+    return nullptr;
+  }
+  return object->entries[index].key;
+}
+
+size_t json_object_get_name_len(const JSON_Object *object, size_t index) {
+  if (object == nullptr || index >= json_object_get_count(object)) {
+    return 0;
+  }
+  return object->entries[index].key_len;
+}
+
+JSON_Value *json_object_get_value_at(const JSON_Object *object, size_t index) {
+  if (object == nullptr || index >= json_object_get_count(object)) {
+    return nullptr;
+  }
+  return object->entries[index].value;
 }
 
 JSON_Value *json_object_get_wrapping_value(const JSON_Object *object) {
   if (object == nullptr) {
     return nullptr;
   }
-  return object->wrapping_value;
+  return object->wrapping_value;
+}
+
+bool json_object_has_value(const JSON_Object *object, const char *name) {
+  return json_object_get_value(object, name) != nullptr;
+}
+
+bool json_object_has_value_of_type(const JSON_Object *object, const char *name,
+                                   JSON_Value_Type type) {
+  JSON_Value *val = json_object_get_value(object, name);
+  return val != nullptr && json_value_get_type(val) == type;
+}
+
+bool json_object_dothas_value(const JSON_Object *object, const char *name) {
+  return json_object_dotget_value(object, name) != nullptr;
+}
+
+bool json_object_dothas_value_of_type(const JSON_Object *object,
+                                      const char *name, JSON_Value_Type type) {
+  JSON_Value *val = json_object_dotget_value(object, name);
+  return val != nullptr && json_value_get_type(val) == type;
+}
+
+/* JSON Array API */
+JSON_Value *json_array_get_value(const JSON_Array *array, size_t index) {
+  if (array == nullptr || index >= json_array_get_count(array)) {
+    return nullptr;
+  }
+  return array->items[index];
+}
+
+const char *json_array_get_string(const JSON_Array *array, size_t index) {
+  return json_value_get_string(json_array_get_value(array, index));
+}
+
+size_t json_array_get_string_len(const JSON_Array *array, size_t index) {
+  return json_value_get_string_len(json_array_get_value(array, index));
+}
+
+int64_t json_array_get_int64(const JSON_Array *array, size_t index) {
+  return json_value_get_int64(json_array_get_value(array, index));
+}
+
+double json_array_get_number(const JSON_Array *array, size_t index) {
+  return json_value_get_number(json_array_get_value(array, index));
+}
+
+JSON_Object *json_array_get_object(const JSON_Array *array, size_t index) {
+  return json_value_get_object(json_array_get_value(array, index));
+}
+
+JSON_Array *json_array_get_array(const JSON_Array *array, size_t index) {
+  return json_value_get_array(json_array_get_value(array, index));
+}
+
+JSON_Boolean json_array_get_boolean(const JSON_Array *array, size_t index) {
+  return json_value_get_boolean(json_array_get_value(array, index));
+}
+
+size_t json_array_get_count(const JSON_Array *array) {
+  return array == nullptr ? 0 : array->count;
+}
+
+JSON_Value *json_array_get_wrapping_value(const JSON_Array *array) {
+  if (array == nullptr) {
+    return nullptr;
+  }
+  return array->wrapping_value;
+}
+
+/* JSON Value API */
+JSON_Value_Type json_value_get_type(const JSON_Value *value) {
+  return value == nullptr ? JSONError : value->type;
+}
+
+JSON_Object *json_value_get_object(const JSON_Value *value) {
+  if (json_value_get_type(value) != JSONObject ||
+      ((value->flags & value_flag_lazy) != 0U &&
+       json_value_materialize((JSON_Value *)value) != JSONSuccess)) {
+    return nullptr;
+  }
+  return value->value.object;
+}
+
+JSON_Array *json_value_get_array(const JSON_Value *value) {
+  if (json_value_get_type(value) != JSONArray ||
+      ((value->flags & value_flag_lazy) != 0U &&
+       json_value_materialize((JSON_Value *)value) != JSONSuccess)) {
+    return nullptr;
+  }
+  return value->value.array;
+}
+
+/* chars is null if value is not a string */
+static JSON_String json_value_get_string_desc(const JSON_Value *value) {
+  if (json_value_get_type(value) != JSONString) {
+    return (JSON_String){.chars = nullptr};
+  }
+  if ((value->flags & value_flag_small_string) != 0U) {
+    return (JSON_String){.chars = (char *)value->value.small.chars,
+                         .length = value->value.small.length};
+  }
+  return value->value.string;
+}
+
+const char *json_value_get_string(const JSON_Value *value) {
+  return json_value_get_string_desc(value).chars;
+}
+
+size_t json_value_get_string_len(const JSON_Value *value) {
+  return json_value_get_string_desc(value).length;
+}
+
+double json_value_get_number(const JSON_Value *value) {
+  if (json_value_get_type(value) != JSONNumber) {
+    return 0;
+  }
+  if ((value->flags & value_flag_int64) != 0U) {
+    return (double)value->value.int64;
+  }
+  if ((value->flags & value_flag_uint64) != 0U) {
+    return (double)value->value.uint64;
+  }
+  return value->value.number;
+}
+
+int64_t json_value_get_int64(const JSON_Value *value) {
+  if (json_value_get_type(value) != JSONNumber ||
+      (value->flags & value_flag_uint64) != 0U) {
+    return 0;
+  }
+  if ((value->flags & value_flag_int64) != 0U) {
+    return value->value.int64;
+  }
+  const double number = value->value.number;
+  return number >= -0x1p63 && number < 0x1p63 && number == trunc(number)
+             ? (int64_t)number
+             : 0;
+}
+
+uint64_t json_value_get_uint64(const JSON_Value *value) {
+  if (json_value_get_type(value) != JSONNumber) {
+    return 0;
+  }
+  if ((value->flags & value_flag_uint64) != 0U) {
+    return value->value.uint64;
+  }
+  if ((value->flags & value_flag_int64) != 0U) {
+    return value->value.int64 >= 0 ? (uint64_t)value->value.int64 : 0;
+  }
+  const double number = value->value.number;
+  return number >= 0 && number < 0x1p64 && number == trunc(number)
+             ? (uint64_t)number
+             : 0;
+}
+
+JSON_Boolean json_value_get_boolean(const JSON_Value *value) {
+  if (json_value_get_type(value) != JSONBoolean) {
+    return JSONBooleanError;
+  }
+  return value->value.boolean ? JSONBooleanTrue : JSONBooleanFalse;
+}
+
+JSON_Value *json_value_get_parent(const JSON_Value *value) {
+  return value == nullptr ? nullptr : value->parent;
+}
+
+void json_value_free(JSON_Value *value) {
+  if (value != nullptr && (value->flags & value_flag_arena) != 0U) {
+    return; /* released together with the arena */
+  }
+  if (json_value_is_shared(value) &&
+      atomic_fetch_sub_explicit(json_value_refs(value), 1,
+                                memory_order_acq_rel) != 1) {
+    return; /* other holders remain */
+  }
+  if (value != nullptr && (value->flags & value_flag_lazy) != 0U) {
+    lazy_source_release(value->value.lazy.source);
+    parson_free(value);
+    return;
+  }
+  switch (json_value_get_type(value)) {
+  case JSONObject:
+    json_object_free(value->value.object);
+    break;
+  case JSONString:
+    if ((value->flags & (value_flag_borrowed | value_flag_small_string)) ==
+        0U) {
+      parson_free(value->value.string.chars);
+    }
+    break;
+  case JSONArray:
+    json_array_free(value->value.array);
+    break;
+  default:
+    break;
+  }
+  parson_free(value);
+}
+
+JSON_Value *json_value_init_object_with_capacity(size_t capacity) {
+  JSON_Value *value = json_value_init_object_in(nullptr);
+  if (value != nullptr &&
+      json_object_reserve(value->value.object, capacity) != JSONSuccess) {
+    json_value_free(value);
+    return nullptr;
+  }
+  return value;
+}
+
+JSON_Value *json_value_init_array_with_capacity(size_t capacity) {
+  JSON_Value *value = json_value_init_array_in(nullptr);
+  if (value != nullptr &&
+      json_array_reserve(value->value.array, capacity) != JSONSuccess) {
+    json_value_free(value);
+    return nullptr;
+  }
+  return value;
+}
+
+JSON_Value *json_value_init_object() {
+  return json_value_init_object_in(nullptr);
+}
+
+JSON_Value *json_value_init_array() {
+  return json_value_init_array_in(nullptr);
+}
+
+JSON_Value *json_value_init_string(const char *string) {
+  if (string == nullptr) {
+    return nullptr;
+  }
+  return json_value_init_string_with_len(string, strlen(string));
+}
+
+JSON_Value *json_value_init_string_with_len(const char *string, size_t length) {
+  return json_value_init_string_with_len_in(nullptr, string, length);
+}
+
+JSON_Value *json_value_init_int64(int64_t number) {
+  return json_value_init_integer_in(nullptr, number < 0,
+                                    int64_magnitude(number));
+}
+
+JSON_Value *json_value_init_uint64(uint64_t number) {
+  return json_value_init_integer_in(nullptr, false, number);
+}
+
+JSON_Value *json_value_init_number(double number) {
+  return json_value_init_number_in(nullptr, number);
+}
+
+JSON_Value *json_value_init_boolean(bool boolean) {
+  return json_value_init_boolean_in(nullptr, boolean);
+}
+
+JSON_Value *json_value_init_null() { return json_value_init_null_in(nullptr); }
+
+JSON_Status json_value_freeze(JSON_Value *value) {
+  const JSON_Value_Type type = json_value_get_type(value);
+  if ((type != JSONObject && type != JSONArray) || value->parent != nullptr) {
+    return JSONFailure;
+  }
+  if (json_value_freeze_check(value) != JSONSuccess) {
+    return JSONFailure;
+  }
+  json_value_freeze_mark(value);
+  /* hashed now, as hashing later would write to a shared tree */
+  (void)json_value_hash(value);
+  return JSONSuccess;
+}
+
+bool json_value_is_frozen(const JSON_Value *value) {
+  return value != nullptr && (value->flags & value_flag_frozen) != 0U;
+}
+
+JSON_Value *json_value_thaw(JSON_Value *value) {
+  if (!json_value_is_shared(value)) {
+    return value;
+  }
+  JSON_Value *copy = json_value_copy_contents(value);
+  if (copy != nullptr) {
+    json_value_free(value);
+  }
+  return copy;
+}
+
+JSON_Status json_value_cache_serialization(JSON_Value *value, bool enabled) {
+  const JSON_Value_Type type = json_value_get_type(value);
+  if ((type != JSONObject && type != JSONArray) ||
+      (value->flags & (value_flag_arena | value_flag_frozen)) != 0U) {
+    return JSONFailure;
+  }
+  if (enabled) {
+    value->flags |= value_flag_cache_text;
+  } else {
+    /* the containers above keep text that changes below value would no
+       longer invalidate */
+    json_value_forget_cached(value);
+    json_value_drop_fragments(value);
+  }
+  return JSONSuccess;
+}
+
+JSON_Value *json_value_deep_copy(const JSON_Value *value) {
+  if (json_value_is_shared(value)) {
+    atomic_fetch_add_explicit(json_value_refs(value), 1,
+                              memory_order_relaxed);
+    return (JSON_Value *)value;
+  }
+  return json_value_copy_contents(value);
+}
+
+/* Copies value and its members, except for frozen members, which are
+   shared. */
+static JSON_Value *json_value_copy_contents(const JSON_Value *value) {
+  size_t i = 0;
+  JSON_Value *return_value = nullptr, *temp_value_copy = nullptr,
+             *temp_value = nullptr;
+  JSON_String temp_string = {0};
+  const char *temp_key = nullptr;
+  size_t temp_key_len = 0;
+  char *temp_string_copy = nullptr;
+  JSON_Array *temp_array = nullptr, *temp_array_copy = nullptr;
+  JSON_Object *temp_object = nullptr, *temp_object_copy = nullptr;
+  JSON_Status res = JSONFailure;
+  char *key_copy = nullptr;
+
+  switch (json_value_get_type(value)) {
+  case JSONArray:
+    temp_array = json_value_get_array(value);
+    return_value = json_value_init_array();
+    if (return_value == nullptr) {
+      return nullptr;
+    }
+    temp_array_copy = json_value_get_array(return_value);
+    for (i = 0; i < json_array_get_count(temp_array); i++) {
+      temp_value = json_array_get_value(temp_array, i);
+      temp_value_copy = json_value_deep_copy(temp_value);
+      if (temp_value_copy == nullptr) {
+        json_value_free(return_value);
+        return nullptr;
+      }
+      if (json_array_add(temp_array_copy, temp_value_copy) != JSONSuccess) {
+        json_value_free(return_value);
+        json_value_free(temp_value_copy);
+        return nullptr;
+      }
+    }
+    return return_value;
+  case JSONObject:
+    temp_object = json_value_get_object(value);
+    return_value = json_value_init_object();
+    if (return_value == nullptr) {
+      return nullptr;
+    }
+    temp_object_copy = json_value_get_object(return_value);
+    for (i = 0; i < json_object_get_count(temp_object); i++) {
+      temp_key = json_object_get_name(temp_object, i);
+      temp_key_len = json_object_get_name_len(temp_object, i);
+      temp_value = json_object_get_value_at(temp_object, i);
+      temp_value_copy = json_value_deep_copy(temp_value);
+      if (temp_value_copy == nullptr) {
+        json_value_free(return_value);
+        return nullptr;
+      }
+      key_copy = parson_strndup(temp_key, temp_key_len);
+      if (key_copy == nullptr) {
+        json_value_free(temp_value_copy);
+        json_value_free(return_value);
+        return nullptr;
+      }
+      res = json_object_add(temp_object_copy, key_copy, temp_key_len,
+                            temp_value_copy);
+      if (res != JSONSuccess) {
+        parson_free(key_copy);
+        json_value_free(temp_value_copy);
+        json_value_free(return_value);
+        return nullptr;
+      }
+    }
+    return return_value;
+  case JSONBoolean:
+    return json_value_init_boolean(json_value_get_boolean(value));
+  case JSONNumber:
+    if ((value->flags & value_flag_int64) != 0U) {
+      return json_value_init_int64(value->value.int64);
+    }
+    if ((value->flags & value_flag_uint64) != 0U) {
+      return json_value_init_uint64(value->value.uint64);
+    }
+    return json_value_init_number(json_value_get_number(value));
+  case JSONString:
+    temp_string = json_value_get_string_desc(value);
+    if ((value->flags & value_flag_small_string) != 0U) {
+      return json_value_init_small_string(nullptr, temp_string.chars,
+                                          temp_string.length);
+    }
+    temp_string_copy = parson_strndup(temp_string.chars, temp_string.length);
+    if (temp_string_copy == nullptr) {
+      return nullptr;
+    }
+    return_value = json_value_init_string_no_copy(nullptr, temp_string_copy,
+                                                  temp_string.length);
+    if (return_value == nullptr) {
+      parson_free(temp_string_copy);
+    }
+    return return_value;
+  case JSONNull:
+    return json_value_init_null();
+  case JSONError:
+    return nullptr;
+  default:
+    return nullptr;
+  }
 }
 
-bool json_object_has_value(const JSON_Object *object, const char *name) {
-  return json_object_get_value(object, name) != nullptr;
+size_t json_serialization_size_ex(const JSON_Value *value, unsigned int flags,
+                                  const JSON_Context *context) {
+  serialization_buffer out = {.context = context_or_default(context)};
+  if (json_serialize_value(value, &out, (flags & JSONSerializePretty) != 0) !=
+      JSONSuccess) {
+    return 0;
+  }
+  return out.written_total + 1;
 }
 
-bool json_object_has_value_of_type(const JSON_Object *object, const char *name,
-                                   JSON_Value_Type type) {
-  JSON_Value *val = json_object_get_value(object, name);
-  return val != nullptr && json_value_get_type(val) == type;
+JSON_Status json_serialize_to_buffer_ex(const JSON_Value *value, char *buf,
+                                        size_t buf_size_in_bytes,
+                                        unsigned int flags,
+                                        const JSON_Context *context) {
+  size_t needed_size_in_bytes =
+      json_serialization_size_ex(value, flags, context);
+  if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
+    return JSONFailure;
+  }
+  serialization_buffer out = {
+      .context = context_or_default(context),
+      .cursor = buf,
+      .end = buf + buf_size_in_bytes,
+  };
+  return json_serialize_value(value, &out, (flags & JSONSerializePretty) != 0);
 }
 
-bool json_object_dothas_value(const JSON_Object *object, const char *name) {
-  return json_object_dotget_value(object, name) != nullptr;
+static const char *json_serializer_serialize_impl(JSON_Serializer *serializer,
+                                                  const JSON_Value *value,
+                                                  size_t *len,
+                                                  bool is_pretty) {
+  if (serializer == nullptr) {
+    return nullptr;
+  }
+  serialization_buffer out = {
+      .context = serializer->context,
+      .cursor = serializer->buf,
+      .end = serializer->buf + serializer->capacity,
+      .serializer = serializer,
+  };
+  /* a null cursor would only measure, so allocate the buffer up front */
+  if (serializer->buf == nullptr &&
+      !serialization_buffer_grow(&out, serializer_initial_capacity)) {
+    return nullptr;
+  }
+  if (json_serialize_value(value, &out, is_pretty) != JSONSuccess) {
+    return nullptr;
+  }
+  if (len != nullptr) {
+    *len = out.written_total;
+  }
+  return serializer->buf;
 }
 
-bool json_object_dothas_value_of_type(const JSON_Object *object,
-                                      const char *name, JSON_Value_Type type) {
-  JSON_Value *val = json_object_dotget_value(object, name);
-  return val != nullptr && json_value_get_type(val) == type;
+static JSON_Status write_to_file(void *ctx, const char *data, size_t len) {
+  return fwrite(data, 1, len, (FILE *)ctx) == len ? JSONSuccess : JSONFailure;
 }
 
-/* JSON Array API */
-JSON_Value *json_array_get_value(const JSON_Array *array, size_t index) {
-  if (array == nullptr || index >= json_array_get_count(array)) {
+JSON_Status json_serialize_to_file_ex(const JSON_Value *value,
+                                      const char *filename, unsigned int flags,
+                                      const JSON_Context *context) {
+  JSON_Status return_code = JSONSuccess;
+  FILE *fp = nullptr;
+  if (value == nullptr) {
+    return JSONFailure;
+  }
+  fp = fopen(filename, "w");
+  if (fp == nullptr) {
+    return JSONFailure;
+  }
+  return_code =
+      json_serialize_to_writer_ex(value, write_to_file, fp, flags, context);
+  if (fclose(fp) == EOF) {
+    return_code = JSONFailure;
+  }
+  return return_code;
+}
+
+char *json_serialize_to_string_ex(const JSON_Value *value, unsigned int flags,
+                                  const JSON_Context *context) {
+  context = context_or_default(context);
+  const size_t buf_size_bytes =
+      json_serialization_size_ex(value, flags, context);
+  if (buf_size_bytes == 0) {
     return nullptr;
   }
-  return array->items[index];
+  auto buf = (char *)context_malloc(context, buf_size_bytes);
+  if (buf == nullptr) {
+    return nullptr;
+  }
+  /* already measured, so write straight into the exact-size buffer */
+  serialization_buffer out = {
+      .context = context,
+      .cursor = buf,
+      .end = buf + buf_size_bytes,
+  };
+  if (json_serialize_value(value, &out, (flags & JSONSerializePretty) != 0) !=
+      JSONSuccess) {
+    context_free(context, buf, buf_size_bytes);
+    return nullptr;
+  }
+  return buf;
 }
 
-const char *json_array_get_string(const JSON_Array *array, size_t index) {
-  return json_value_get_string(json_array_get_value(array, index));
+char *json_serialize_to_string_parallel_ex(const JSON_Value *value,
+                                           unsigned int flags, size_t threads,
+                                           const JSON_Context *context) {
+  context = context_or_default(context);
+  if (value == nullptr) {
+    return nullptr;
+  }
+  JSON_Stats *previous = stats_begin(context);
+  const bool is_pretty = (flags & JSONSerializePretty) != 0;
+  const size_t weight = serialize_weight(value, is_pretty);
+  const size_t count = parallel_thread_count(threads, weight);
+  if (count == 1) {
+    stats_end(context, previous);
+    return json_serialize_to_string_ex(value, flags, context);
+  }
+  /* a few tasks per thread so that uneven ones even out */
+  serialize_plan plan = {
+      .context = context,
+      .chunk = max_size(weight / (count * 8), 1),
+      .is_pretty = is_pretty,
+  };
+  serialize_plan_value(&plan, value, 0, weight);
+  char *result = nullptr;
+  auto workers = (serialize_worker *)context_malloc(
+      context, count * sizeof(serialize_worker));
+  if (!plan.failed && workers != nullptr) {
+    result = serialize_parallel(&plan, workers, count, weight);
+  }
+  context_free(context, workers, count * sizeof(serialize_worker));
+  context_free(context, plan.tasks, plan.capacity * sizeof(serialize_task));
+  stats_end(context, previous);
+  return result;
 }
 
-size_t json_array_get_string_len(const JSON_Array *array, size_t index) {
-  return json_value_get_string_len(json_array_get_value(array, index));
+void json_free_serialized_string_ex(char *string,
+                                    const JSON_Context *context) {
+  if (string != nullptr) {
+    context_free(context_or_default(context), string, strlen(string) + 1);
+  }
 }
 
-double json_array_get_number(const JSON_Array *array, size_t index) {
-  return json_value_get_number(json_array_get_value(array, index));
+size_t json_serialization_size(const JSON_Value *value) {
+  return json_serialization_size_ex(value, JSONSerializeDefault, nullptr);
 }
 
-JSON_Object *json_array_get_object(const JSON_Array *array, size_t index) {
-  return json_value_get_object(json_array_get_value(array, index));
+JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf,
+                                     size_t buf_size_in_bytes) {
+  return json_serialize_to_buffer_ex(value, buf, buf_size_in_bytes,
+                                     JSONSerializeDefault, nullptr);
 }
 
-JSON_Array *json_array_get_array(const JSON_Array *array, size_t index) {
-  return json_value_get_array(json_array_get_value(array, index));
+JSON_Status json_serialize_to_file(const JSON_Value *value,
+                                   const char *filename) {
+  return json_serialize_to_file_ex(value, filename, JSONSerializeDefault,
+                                   nullptr);
 }
 
-JSON_Boolean json_array_get_boolean(const JSON_Array *array, size_t index) {
-  return json_value_get_boolean(json_array_get_value(array, index));
+char *json_serialize_to_string(const JSON_Value *value) {
+  return json_serialize_to_string_ex(value, JSONSerializeDefault, nullptr);
 }
 
-size_t json_array_get_count(const JSON_Array *array) {
-  return array == nullptr ? 0 : array->count;
+size_t json_serialization_size_pretty(const JSON_Value *value) {
+  return json_serialization_size_ex(value, JSONSerializePretty, nullptr);
 }
 
-JSON_Value *json_array_get_wrapping_value(const JSON_Array *array) {
-  if (array == nullptr) {
+JSON_Status json_serialize_to_buffer_pretty(const JSON_Value *value, char *buf,
+                                            size_t buf_size_in_bytes) {
+  return json_serialize_to_buffer_ex(value, buf, buf_size_in_bytes,
+                                     JSONSerializePretty, nullptr);
+}
+
+JSON_Status json_serialize_to_file_pretty(const JSON_Value *value,
+                                          const char *filename) {
+  return json_serialize_to_file_ex(value, filename, JSONSerializePretty,
+                                   nullptr);
+}
+
+char *json_serialize_to_string_pretty(const JSON_Value *value) {
+  return json_serialize_to_string_ex(value, JSONSerializePretty, nullptr);
+}
+
+char *json_serialize_to_string_parallel(const JSON_Value *value,
+                                        unsigned int flags, size_t threads) {
+  return json_serialize_to_string_parallel_ex(value, flags, threads, nullptr);
+}
+
+void json_free_serialized_string(char *string) { parson_free(string); }
+
+char *json_serialize_to_cbor(const JSON_Value *value, size_t *len) {
+  return binary_serialize(value, len, binary_cbor);
+}
+
+char *json_serialize_to_msgpack(const JSON_Value *value, size_t *len) {
+  return binary_serialize(value, len, binary_msgpack);
+}
+
+JSON_Value *json_parse_cbor(const char *data, size_t len, JSON_Arena *arena) {
+  return binary_parse(data, len, arena, binary_cbor);
+}
+
+JSON_Value *json_parse_msgpack(const char *data, size_t len,
+                               JSON_Arena *arena) {
+  return binary_parse(data, len, arena, binary_msgpack);
+}
+
+JSON_Status json_serialize_to_writer(const JSON_Value *value,
+                                     JSON_Write_Function write_fun, void *ctx,
+                                     unsigned int flags) {
+  return json_serialize_to_writer_ex(value, write_fun, ctx, flags, nullptr);
+}
+
+JSON_Status json_serialize_to_writer_ex(const JSON_Value *value,
+                                        JSON_Write_Function write_fun,
+                                        void *ctx, unsigned int flags,
+                                        const JSON_Context *context) {
+  if (write_fun == nullptr) {
+    return JSONFailure;
+  }
+  context = context_or_default(context);
+  char *chunk = (char *)context_malloc(context, serialization_chunk_size);
+  if (chunk == nullptr) {
+    return JSONFailure;
+  }
+  serialization_buffer out = {
+      .context = context,
+      .cursor = chunk,
+      .end = chunk + serialization_chunk_size,
+      .start = chunk,
+      .write_fun = write_fun,
+      .write_ctx = ctx,
+  };
+  JSON_Status status = json_serialize_value(
+      value, &out, (flags & JSONSerializePretty) != 0);
+  if (status == JSONSuccess && !serialization_buffer_flush(&out)) {
+    status = JSONFailure;
+  }
+  context_free(context, chunk, serialization_chunk_size);
+  return status;
+}
+
+JSON_Serializer *json_serializer_new() {
+  return json_serializer_new_ex(nullptr);
+}
+
+JSON_Serializer *json_serializer_new_ex(const JSON_Context *context) {
+  context = context_or_default(context);
+  auto serializer =
+      (JSON_Serializer *)context_malloc(context, sizeof(JSON_Serializer));
+  if (serializer == nullptr) {
     return nullptr;
   }
-  return array->wrapping_value;
+  *serializer = (JSON_Serializer){.context = context};
+  return serializer;
 }
 
-/* JSON Value API */
-JSON_Value_Type json_value_get_type(const JSON_Value *value) {
-  return value == nullptr ? JSONError : value->type;
+void json_serializer_free(JSON_Serializer *serializer) {
+  if (serializer == nullptr) {
+    return;
+  }
+  context_free(serializer->context, serializer->buf, serializer->capacity);
+  context_free(serializer->context, serializer, sizeof(JSON_Serializer));
 }
 
-JSON_Object *json_value_get_object(const JSON_Value *value) {
-  return json_value_get_type(value) == JSONObject ? value->value.object
-                                                  : nullptr;
+const char *json_serializer_serialize(JSON_Serializer *serializer,
+                                      const JSON_Value *value, size_t *len) {
+  return json_serializer_serialize_impl(serializer, value, len, false);
 }
 
-JSON_Array *json_value_get_array(const JSON_Value *value) {
-  return json_value_get_type(value) == JSONArray ? value->value.array : nullptr;
+const char *json_serializer_serialize_pretty(JSON_Serializer *serializer,
+                                             const JSON_Value *value,
+                                             size_t *len) {
+  return json_serializer_serialize_impl(serializer, value, len, true);
 }
 
-static const JSON_String *json_value_get_string_desc(const JSON_Value *value) {
-  return json_value_get_type(value) == JSONString ? &value->value.string
-                                                  : nullptr;
+JSON_Status json_array_remove(JSON_Array *array, size_t ix) {
+  size_t to_move_bytes = 0;
+  if (array == nullptr || json_value_is_frozen(array->wrapping_value) ||
+      ix >= json_array_get_count(array)) {
+    return JSONFailure;
+  }
+  json_value_forget_cached(array->wrapping_value);
+  json_value_free_child(array->arena, json_array_get_value(array, ix));
+  to_move_bytes = (json_array_get_count(array) - 1 - ix) * sizeof(JSON_Value *);
+  memmove(array->items + ix, array->items + ix + 1, to_move_bytes);
+  array->count -= 1;
+  return JSONSuccess;
 }
 
-const char *json_value_get_string(const JSON_Value *value) {
-  const JSON_String *str = json_value_get_string_desc(value);
-  return str ? str->chars : nullptr;
+JSON_Status json_array_replace_value(JSON_Array *array, size_t ix,
+                                     JSON_Value *value) {
+  if (array == nullptr || value == nullptr || value->parent != nullptr ||
+      json_value_is_frozen(array->wrapping_value) ||
+      ix >= json_array_get_count(array)) {
+    return JSONFailure;
+  }
+  if (json_arena_adopt(array->arena, value) != JSONSuccess) {
+    return JSONFailure;
+  }
+  json_value_forget_cached(array->wrapping_value);
+  json_value_free_child(array->arena, json_array_get_value(array, ix));
+  json_value_set_parent(value, json_array_get_wrapping_value(array));
+  array->items[ix] = value;
+  return JSONSuccess;
 }
 
-size_t json_value_get_string_len(const JSON_Value *value) {
-  const JSON_String *str = json_value_get_string_desc(value);
-  return str ? str->length : 0;
+JSON_Status json_array_replace_string(JSON_Array *array, size_t i,
+                                      const char *string) {
+  JSON_Value *value = json_value_init_string_in(json_array_get_arena(array),
+                                                string);
+  if (value == nullptr) {
+    return JSONFailure;
+  }
+  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
 }
 
-double json_value_get_number(const JSON_Value *value) {
-  return json_value_get_type(value) == JSONNumber ? value->value.number : 0;
+JSON_Status json_array_replace_string_with_len(JSON_Array *array, size_t i,
+                                               const char *string, size_t len) {
+  JSON_Value *value = json_value_init_string_with_len_in(
+      json_array_get_arena(array), string, len);
+  if (value == nullptr) {
+    return JSONFailure;
+  }
+  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
 }
 
-JSON_Boolean json_value_get_boolean(const JSON_Value *value) {
-  if (json_value_get_type(value) != JSONBoolean) {
-    return JSONBooleanError;
+JSON_Status json_array_replace_number(JSON_Array *array, size_t i,
+                                      double number) {
+  JSON_Value *value =
+      json_value_init_number_in(json_array_get_arena(array), number);
+  if (value == nullptr) {
+    return JSONFailure;
   }
-  return value->value.boolean ? JSONBooleanTrue : JSONBooleanFalse;
+  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
 }
 
-JSON_Value *json_value_get_parent(const JSON_Value *value) {
-  return value == nullptr ? nullptr : value->parent;
+JSON_Status json_array_replace_boolean(JSON_Array *array, size_t i,
+                                       bool boolean) {
+  JSON_Value *value =
+      json_value_init_boolean_in(json_array_get_arena(array), boolean);
+  if (value == nullptr) {
+    return JSONFailure;
+  }
+  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
 }
 
-void json_value_free(JSON_Value *value) {
-  switch (json_value_get_type(value)) {
-  case JSONObject:
-    json_object_free(value->value.object);
-    break;
-  case JSONString:
-    parson_free(value->value.string.chars);
-    break;
-  case JSONArray:
-    json_array_free(value->value.array);
-    break;
-  default:
-    break;
+JSON_Status json_array_replace_null(JSON_Array *array, size_t i) {
+  JSON_Value *value = json_value_init_null_in(json_array_get_arena(array));
+  if (value == nullptr) {
+    return JSONFailure;
+  }
+  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
+}
+
+JSON_Status json_array_clear(JSON_Array *array) {
+  size_t i = 0;
+  if (array == nullptr || json_value_is_frozen(array->wrapping_value)) {
+    return JSONFailure;
   }
-  parson_free(value);
+  json_value_forget_cached(array->wrapping_value);
+  for (i = 0; i < json_array_get_count(array); i++) {
+    json_value_free_child(array->arena, json_array_get_value(array, i));
+  }
+  array->count = 0;
+  return JSONSuccess;
 }
 
-JSON_Value *json_value_init_object() {
-  auto new_value = (JSON_Value *)parson_calloc(1, sizeof(JSON_Value));
-  if (new_value == nullptr) {
-    return nullptr;
+JSON_Status json_array_reserve(JSON_Array *array, size_t capacity) {
+  if (array == nullptr || json_value_is_frozen(array->wrapping_value) ||
+      capacity > SIZE_MAX / sizeof(JSON_Value *)) {
+    return JSONFailure;
   }
-  new_value->parent = nullptr;
-  new_value->type = JSONObject;
-  new_value->value.object = json_object_make(new_value);
-  if (new_value->value.object == nullptr) {
-    parson_free(new_value);
-    return nullptr;
+  if (capacity <= array->capacity) {
+    return JSONSuccess;
   }
-  return new_value;
+  return json_array_resize(array, capacity);
 }
 
-JSON_Value *json_value_init_array() {
-  auto new_value = (JSON_Value *)parson_calloc(1, sizeof(JSON_Value));
-  if (new_value == nullptr) {
-    return nullptr;
+JSON_Status json_array_append_value(JSON_Array *array, JSON_Value *value) {
+  if (array == nullptr || value == nullptr || value->parent != nullptr) {
+    return JSONFailure;
   }
-  new_value->parent = nullptr;
-  new_value->type = JSONArray;
-  new_value->value.array = json_array_make(new_value);
-  if (new_value->value.array == nullptr) {
-    parson_free(new_value);
-    return nullptr;
+  if (json_arena_adopt(array->arena, value) != JSONSuccess) {
+    return JSONFailure;
   }
-  return new_value;
+  if (json_array_add(array, value) != JSONSuccess) {
+    json_arena_forget(array->arena, value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
 }
 
-JSON_Value *json_value_init_string(const char *string) {
-  if (string == nullptr) {
-    return nullptr;
+JSON_Status json_array_append_string(JSON_Array *array, const char *string) {
+  JSON_Value *value = json_value_init_string_in(json_array_get_arena(array),
+                                                string);
+  if (value == nullptr) {
+    return JSONFailure;
   }
-  return json_value_init_string_with_len(string, strlen(string));
+  if (json_array_append_value(array, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
 }
 
-JSON_Value *json_value_init_string_with_len(const char *string, size_t length) {
-  char *copy = nullptr;
-  JSON_Value *value;
-  if (string == nullptr) {
-    return nullptr;
-  }
-  if (!is_valid_utf8(string, length)) {
-    return nullptr;
+JSON_Status json_array_append_string_with_len(JSON_Array *array,
+                                              const char *string, size_t len) {
+  JSON_Value *value = json_value_init_string_with_len_in(
+      json_array_get_arena(array), string, len);
+  if (value == nullptr) {
+    return JSONFailure;
   }
-  copy = parson_strndup(string, length);
-  if (copy == nullptr) {
-    return nullptr;
+  if (json_array_append_value(array, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
   }
-  value = json_value_init_string_no_copy(copy, length);
+  return JSONSuccess;
+}
+
+JSON_Status json_array_append_number(JSON_Array *array, double number) {
+  JSON_Value *value =
+      json_value_init_number_in(json_array_get_arena(array), number);
   if (value == nullptr) {
-    parson_free(copy);
+    return JSONFailure;
   }
-  return value;
+  if (json_array_append_value(array, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
 }
 
-JSON_Value *json_value_init_number(double number) {
-  JSON_Value *new_value = nullptr;
-  if (is_number_invalid(number)) {
-    return nullptr;
+JSON_Status json_array_append_int64(JSON_Array *array, int64_t number) {
+  JSON_Value *value = json_value_init_integer_in(
+      json_array_get_arena(array), number < 0, int64_magnitude(number));
+  if (value == nullptr) {
+    return JSONFailure;
   }
-  new_value = (JSON_Value *)parson_calloc(1, sizeof(JSON_Value));
-  if (new_value == nullptr) {
-    return nullptr;
+  if (json_array_append_value(array, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
   }
-  new_value->parent = nullptr;
-  new_value->type = JSONNumber;
-  new_value->value.number = number;
-  return new_value;
+  return JSONSuccess;
 }
 
-JSON_Value *json_value_init_boolean(bool boolean) {
-  auto new_value = (JSON_Value *)parson_calloc(1, sizeof(JSON_Value));
-  if (new_value == nullptr) {
-    return nullptr;
+JSON_Status json_array_append_boolean(JSON_Array *array, bool boolean) {
+  JSON_Value *value =
+      json_value_init_boolean_in(json_array_get_arena(array), boolean);
+  if (value == nullptr) {
+    return JSONFailure;
   }
-  new_value->parent = nullptr;
-  new_value->type = JSONBoolean;
-  new_value->value.boolean = boolean;
-  return new_value;
+  if (json_array_append_value(array, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
 }
 
-JSON_Value *json_value_init_null() {
-  auto new_value = (JSON_Value *)parson_calloc(1, sizeof(JSON_Value));
-  if (new_value == nullptr) {
-    return nullptr;
+JSON_Status json_array_append_null(JSON_Array *array) {
+  JSON_Value *value = json_value_init_null_in(json_array_get_arena(array));
+  if (value == nullptr) {
+    return JSONFailure;
   }
-  new_value->parent = nullptr;
-  new_value->type = JSONNull;
-  return new_value;
+  if (json_array_append_value(array, value) != JSONSuccess) {
+    json_value_free(value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
 }
 
-JSON_Value *json_value_deep_copy(const JSON_Value *value) {
-  size_t i = 0;
-  JSON_Value *return_value = nullptr, *temp_value_copy = nullptr,
-             *temp_value = nullptr;
-  const JSON_String *temp_string = nullptr;
-  const char *temp_key = nullptr;
-  char *temp_string_copy = nullptr;
-  JSON_Array *temp_array = nullptr, *temp_array_copy = nullptr;
-  JSON_Object *temp_object = nullptr, *temp_object_copy = nullptr;
-  JSON_Status res = JSONFailure;
-  char *key_copy = nullptr;
-
-  switch (json_value_get_type(value)) {
-  case JSONArray:
-    temp_array = json_value_get_array(value);
-    return_value = json_value_init_array();
-    if (return_value == nullptr) {
-      return nullptr;
-    }
-    temp_array_copy = json_value_get_array(return_value);
-    for (i = 0; i < json_array_get_count(temp_array); i++) {
-      temp_value = json_array_get_value(temp_array, i);
-      temp_value_copy = json_value_deep_copy(temp_value);
-      if (temp_value_copy == nullptr) {
-        json_value_free(return_value);
-        return nullptr;
-      }
-      if (json_array_add(temp_array_copy, temp_value_copy) != JSONSuccess) {
-        json_value_free(return_value);
-        json_value_free(temp_value_copy);
-        return nullptr;
-      }
-    }
-    return return_value;
-  case JSONObject:
-    temp_object = json_value_get_object(value);
-    return_value = json_value_init_object();
-    if (return_value == nullptr) {
-      return nullptr;
-    }
-    temp_object_copy = json_value_get_object(return_value);
-    for (i = 0; i < json_object_get_count(temp_object); i++) {
-      temp_key = json_object_get_name(temp_object, i);
-      temp_value = json_object_get_value(temp_object, temp_key);
-      temp_value_copy = json_value_deep_copy(temp_value);
-      if (temp_value_copy == nullptr) {
-        json_value_free(return_value);
-        return nullptr;
-      }
-      key_copy = parson_strdup(temp_key);
-      if (key_copy == nullptr) {
-        json_value_free(temp_value_copy);
-        json_value_free(return_value);
-        return nullptr;
-      }
-      res = json_object_add(temp_object_copy, key_copy, temp_value_copy);
-      if (res != JSONSuccess) {
-        parson_free(key_copy);
-        json_value_free(temp_value_copy);
-        json_value_free(return_value);
-        return nullptr;
-      }
-    }
-    return return_value;
-  case JSONBoolean:
-    return json_value_init_boolean(json_value_get_boolean(value));
-  case JSONNumber:
-    return json_value_init_number(json_value_get_number(value));
-  case JSONString:
-    temp_string = json_value_get_string_desc(value);
-    if (temp_string == nullptr) {
-      return nullptr;
-    }
-    temp_string_copy = parson_strndup(temp_string->chars, temp_string->length);
-    if (temp_string_copy == nullptr) {
-      return nullptr;
-    }
-    return_value =
-        json_value_init_string_no_copy(temp_string_copy, temp_string->length);
-    if (return_value == nullptr) {
-      parson_free(temp_string_copy);
+JSON_Status json_array_append_numbers(JSON_Array *array,
+                                      const double *numbers, size_t count) {
+  if (array == nullptr || (numbers == nullptr && count > 0) ||
+      count > SIZE_MAX - array->count ||
+      json_array_reserve(array, array->count + count) != JSONSuccess) {
+    return JSONFailure;
+  }
+  const size_t old_count = array->count;
+  for (size_t i = 0; i < count; i++) {
+    JSON_Value *value = json_value_init_number_in(array->arena, numbers[i]);
+    if (value == nullptr) {
+      json_array_truncate(array, old_count);
+      return JSONFailure;
     }
-    return return_value;
-  case JSONNull:
-    return json_value_init_null();
-  case JSONError:
-    return nullptr;
-  default:
-    return nullptr;
+    (void)json_array_add(array, value); /* can't fail after the reserve */
   }
+  return JSONSuccess;
 }
 
-size_t json_serialization_size(const JSON_Value *value) {
-  char
-      num_buf[parson_num_buf_size]; /* recursively allocating buffer on stack is
-                                       a bad idea, so let's do it only once */
-  int res = json_serialize_to_buffer_r(value, nullptr, 0, false, num_buf);
-  return res < 0 ? 0 : (size_t)(res) + 1;
+JSON_Status json_array_append_strings(JSON_Array *array,
+                                      const char *const *strings,
+                                      size_t count) {
+  if (array == nullptr || (strings == nullptr && count > 0) ||
+      count > SIZE_MAX - array->count ||
+      json_array_reserve(array, array->count + count) != JSONSuccess) {
+    return JSONFailure;
+  }
+  const size_t old_count = array->count;
+  for (size_t i = 0; i < count; i++) {
+    JSON_Value *value = json_value_init_string_in(array->arena, strings[i]);
+    if (value == nullptr) {
+      json_array_truncate(array, old_count);
+      return JSONFailure;
+    }
+    (void)json_array_add(array, value);
+  }
+  return JSONSuccess;
 }
 
-JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf,
-                                     size_t buf_size_in_bytes) {
-  int written = -1;
-  size_t needed_size_in_bytes = json_serialization_size(value);
-  if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
+JSON_Status json_object_set_value(JSON_Object *object, const char *name,
+                                  JSON_Value *value) {
+  if (name == nullptr) {
     return JSONFailure;
   }
-  written = json_serialize_to_buffer_r(value, buf, 0, false, nullptr);
-  if (written < 0) {
+  return json_object_set_value_with_len(object, name, strlen(name), value);
+}
+
+JSON_Status json_object_set_value_with_len(JSON_Object *object,
+                                           const char *name, size_t name_len,
+                                           JSON_Value *value) {
+  if (name == nullptr) {
     return JSONFailure;
   }
-  return JSONSuccess;
+  return json_object_set_hashed(object, name, name_len,
+                                hash_string(name, name_len), value);
 }
 
-JSON_Status json_serialize_to_file(const JSON_Value *value,
-                                   const char *filename) {
-  JSON_Status return_code = JSONSuccess;
-  FILE *fp = nullptr;
-  char *serialized_string = json_serialize_to_string(value);
-  if (serialized_string == nullptr) {
+static JSON_Status json_object_set_hashed(JSON_Object *object,
+                                          const char *name, size_t name_len,
+                                          uint64_t hash, JSON_Value *value) {
+  size_t entry_ix = 0;
+  char *key_copy = nullptr;
+
+  if (object == nullptr || value == nullptr || value->parent != nullptr ||
+      json_value_is_frozen(object->wrapping_value)) {
     return JSONFailure;
   }
-  fp = fopen(filename, "w");
-  if (fp == nullptr) {
-    json_free_serialized_string(serialized_string);
+  entry_ix = json_object_find(object, name, name_len, hash);
+  if (json_arena_adopt(object->arena, value) != JSONSuccess) {
     return JSONFailure;
   }
-  if (fputs(serialized_string, fp) == EOF) {
-    return_code = JSONFailure;
+  if (entry_ix != object_invalid_ix) {
+    json_value_forget_cached(object->wrapping_value);
+    json_value_free_child(object->arena, object->entries[entry_ix].value);
+    object->entries[entry_ix].value = value;
+    json_value_set_parent(value, json_object_get_wrapping_value(object));
+    return JSONSuccess;
   }
-  if (fclose(fp) == EOF) {
-    return_code = JSONFailure;
+  key_copy = parson_strndup_in(object->arena, name, name_len);
+  if (key_copy == nullptr) {
+    json_arena_forget(object->arena, value);
+    return JSONFailure;
   }
-  json_free_serialized_string(serialized_string);
-  return return_code;
+  if (json_object_append(object, key_copy, name_len, hash, value) !=
+      JSONSuccess) {
+    parson_free_in(object->arena, key_copy);
+    json_arena_forget(object->arena, value);
+    return JSONFailure;
+  }
+  return JSONSuccess;
+}
+
+JSON_Status json_object_set_string(JSON_Object *object, const char *name,
+                                   const char *string) {
+  JSON_Value *value =
+      json_value_init_string_in(json_object_get_arena(object), string);
+  JSON_Status status = json_object_set_value(object, name, value);
+  if (status != JSONSuccess) {
+    json_value_free(value);
+  }
+  return status;
+}
+
+JSON_Status json_object_set_string_with_len(JSON_Object *object,
+                                            const char *name,
+                                            const char *string, size_t len) {
+  JSON_Value *value = json_value_init_string_with_len_in(
+      json_object_get_arena(object), string, len);
+  JSON_Status status = json_object_set_value(object, name, value);
+  if (status != JSONSuccess) {
+    json_value_free(value);
+  }
+  return status;
+}
+
+JSON_Status json_object_set_number(JSON_Object *object, const char *name,
+                                   double number) {
+  JSON_Value *value =
+      json_value_init_number_in(json_object_get_arena(object), number);
+  JSON_Status status = json_object_set_value(object, name, value);
+  if (status != JSONSuccess) {
+    json_value_free(value);
+  }
+  return status;
 }
 
-char *json_serialize_to_string(const JSON_Value *value) {
-  JSON_Status serialization_result = JSONFailure;
-  const size_t buf_size_bytes = json_serialization_size(value);
-  char *buf = nullptr;
-  if (buf_size_bytes == 0) {
-    return nullptr;
-  }
-  buf = (char *)parson_calloc(buf_size_bytes, sizeof(char));
-  if (buf == nullptr) {
-    return nullptr;
-  }
-  serialization_result = json_serialize_to_buffer(value, buf, buf_size_bytes);
-  if (serialization_result != JSONSuccess) {
-    json_free_serialized_string(buf);
-    return nullptr;
+JSON_Status json_object_set_int64(JSON_Object *object, const char *name,
+                                  int64_t number) {
+  JSON_Value *value = json_value_init_integer_in(
+      json_object_get_arena(object), number < 0, int64_magnitude(number));
+  JSON_Status status = json_object_set_value(object, name, value);
+  if (status != JSONSuccess) {
+    json_value_free(value);
   }
-  return buf;
+  return status;
 }
 
-size_t json_serialization_size_pretty(const JSON_Value *value) {
-  char
-      num_buf[parson_num_buf_size]; /* recursively allocating buffer on stack is
-                                       a bad idea, so let's do it only once */
-  int res = json_serialize_to_buffer_r(value, nullptr, 0, true, num_buf);
-  return res < 0 ? 0 : (size_t)(res) + 1;
+JSON_Status json_object_set_boolean(JSON_Object *object, const char *name,
+                                    bool boolean) {
+  JSON_Value *value =
+      json_value_init_boolean_in(json_object_get_arena(object), boolean);
+  JSON_Status status = json_object_set_value(object, name, value);
+  if (status != JSONSuccess) {
+    json_value_free(value);
+  }
+  return status;
 }
 
-JSON_Status json_serialize_to_buffer_pretty(const JSON_Value *value, char *buf,
-                                            size_t buf_size_in_bytes) {
-  int written = -1;
-  size_t needed_size_in_bytes = json_serialization_size_pretty(value);
-  if (needed_size_in_bytes == 0 || buf_size_in_bytes < needed_size_in_bytes) {
-    return JSONFailure;
-  }
-  written = json_serialize_to_buffer_r(value, buf, 0, true, nullptr);
-  if (written < 0) {
-    return JSONFailure;
+JSON_Status json_object_set_null(JSON_Object *object, const char *name) {
+  JSON_Value *value = json_value_init_null_in(json_object_get_arena(object));
+  JSON_Status status = json_object_set_value(object, name, value);
+  if (status != JSONSuccess) {
+    json_value_free(value);
   }
-  return JSONSuccess;
+  return status;
 }
 
-JSON_Status json_serialize_to_file_pretty(const JSON_Value *value,
-                                          const char *filename) {
-  JSON_Status return_code = JSONSuccess;
-  FILE *fp = nullptr;
-  char *serialized_string = json_serialize_to_string_pretty(value);
-  if (serialized_string == nullptr) {
-    return JSONFailure;
-  }
-  fp = fopen(filename, "w");
-  if (fp == nullptr) {
-    json_free_serialized_string(serialized_string);
+JSON_Status json_object_dotset_value(JSON_Object *object, const char *name,
+                                     JSON_Value *value) {
+  const char *dot_pos = nullptr;
+  JSON_Value *temp_value = nullptr, *new_value = nullptr;
+  JSON_Object *temp_object = nullptr, *new_object = nullptr;
+  JSON_Status status = JSONFailure;
+  size_t name_len = 0;
+  char *name_copy = nullptr;
+
+  if (object == nullptr || name == nullptr || value == nullptr ||
+      value->parent != nullptr) {
     return JSONFailure;
   }
-  if (fputs(serialized_string, fp) == EOF) {
-    return_code = JSONFailure;
-  }
-  if (fclose(fp) == EOF) {
-    return_code = JSONFailure;
+  dot_pos = strchr(name, '.');
+  if (dot_pos == nullptr) {
+    return json_object_set_value(object, name, value);
   }
-  json_free_serialized_string(serialized_string);
-  return return_code;
-}
-
-char *json_serialize_to_string_pretty(const JSON_Value *value) {
-  JSON_Status serialization_result = JSONFailure;
-  const size_t buf_size_bytes = json_serialization_size_pretty(value);
-  char *buf = nullptr;
-  if (buf_size_bytes == 0) {
-    return nullptr;
+  name_len = dot_pos - name;
+  temp_value = json_object_get_value_with_len(object, name, name_len);
+  if (temp_value != nullptr) {
+    /* Don't overwrite existing non-object (unlike json_object_set_value, but it
+     * shouldn't be changed at this point) */
+    if (json_value_get_type(temp_value) != JSONObject) {
+      return JSONFailure;
+    }
+    temp_value = json_value_thaw_child(json_object_get_wrapping_value(object),
+                                       name, name_len,
+                                       hash_string(name, name_len), 0,
+                                       temp_value);
+    temp_object = json_value_get_object(temp_value);
+    return json_object_dotset_value(temp_object, dot_pos + 1, value);
   }
-  buf = (char *)parson_calloc(buf_size_bytes, sizeof(char));
-  if (buf == nullptr) {
-    return nullptr;
+  new_value = json_value_init_object_in(object->arena);
+  if (new_value == nullptr) {
+    return JSONFailure;
   }
-  serialization_result =
-      json_serialize_to_buffer_pretty(value, buf, buf_size_bytes);
-  if (serialization_result != JSONSuccess) {
-    json_free_serialized_string(buf);
-    return nullptr;
+  new_object = json_value_get_object(new_value);
+  status = json_object_dotset_value(new_object, dot_pos + 1, value);
+  if (status != JSONSuccess) {
+    json_value_free(new_value);
+    return JSONFailure;
   }
-  return buf;
-}
-
-void json_free_serialized_string(char *string) { parson_free(string); }
-
-JSON_Status json_array_remove(JSON_Array *array, size_t ix) {
-  size_t to_move_bytes = 0;
-  if (array == nullptr || ix >= json_array_get_count(array)) {
+  name_copy = parson_strndup_in(object->arena, name, name_len);
+  if (name_copy == nullptr) {
+    json_object_dotremove_internal(new_object, dot_pos + 1, false);
+    json_value_free(new_value);
     return JSONFailure;
   }
-  json_value_free(json_array_get_value(array, ix));
-  to_move_bytes = (json_array_get_count(array) - 1 - ix) * sizeof(JSON_Value *);
-  memmove(array->items + ix, array->items + ix + 1, to_move_bytes);
-  array->count -= 1;
-  return JSONSuccess;
-}
-
-JSON_Status json_array_replace_value(JSON_Array *array, size_t ix,
-                                     JSON_Value *value) {
-  if (array == nullptr || value == nullptr || value->parent != nullptr ||
-      ix >= json_array_get_count(array)) {
+  status = json_object_add(object, name_copy, name_len, new_value);
+  if (status != JSONSuccess) {
+    parson_free_in(object->arena, name_copy);
+    json_object_dotremove_internal(new_object, dot_pos + 1, false);
+    json_value_free(new_value);
     return JSONFailure;
   }
-  json_value_free(json_array_get_value(array, ix));
-  value->parent = json_array_get_wrapping_value(array);
-  array->items[ix] = value;
   return JSONSuccess;
 }
 
-JSON_Status json_array_replace_string(JSON_Array *array, size_t i,
+JSON_Status json_object_dotset_string(JSON_Object *object, const char *name,
                                       const char *string) {
-  JSON_Value *value = json_value_init_string(string);
+  JSON_Value *value =
+      json_value_init_string_in(json_object_get_arena(object), string);
   if (value == nullptr) {
     return JSONFailure;
   }
-  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
     json_value_free(value);
     return JSONFailure;
   }
   return JSONSuccess;
 }
 
-JSON_Status json_array_replace_string_with_len(JSON_Array *array, size_t i,
+JSON_Status json_object_dotset_string_with_len(JSON_Object *object,
+                                               const char *name,
                                                const char *string, size_t len) {
-  JSON_Value *value = json_value_init_string_with_len(string, len);
+  JSON_Value *value = json_value_init_string_with_len_in(
+      json_object_get_arena(object), string, len);
   if (value == nullptr) {
     return JSONFailure;
   }
-  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
     json_value_free(value);
     return JSONFailure;
   }
   return JSONSuccess;
 }
 
-JSON_Status json_array_replace_number(JSON_Array *array, size_t i,
+JSON_Status json_object_dotset_number(JSON_Object *object, const char *name,
                                       double number) {
-  JSON_Value *value = json_value_init_number(number);
+  JSON_Value *value =
+      json_value_init_number_in(json_object_get_arena(object), number);
   if (value == nullptr) {
     return JSONFailure;
   }
-  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
     json_value_free(value);
     return JSONFailure;
   }
   return JSONSuccess;
 }
 
-JSON_Status json_array_replace_boolean(JSON_Array *array, size_t i,
+JSON_Status json_object_dotset_boolean(JSON_Object *object, const char *name,
                                        bool boolean) {
-  JSON_Value *value = json_value_init_boolean(boolean);
+  JSON_Value *value =
+      json_value_init_boolean_in(json_object_get_arena(object), boolean);
   if (value == nullptr) {
     return JSONFailure;
   }
-  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
     json_value_free(value);
     return JSONFailure;
   }
   return JSONSuccess;
 }
 
-JSON_Status json_array_replace_null(JSON_Array *array, size_t i) {
-  JSON_Value *value = json_value_init_null();
+JSON_Status json_object_dotset_null(JSON_Object *object, const char *name) {
+  JSON_Value *value = json_value_init_null_in(json_object_get_arena(object));
   if (value == nullptr) {
     return JSONFailure;
   }
-  if (json_array_replace_value(array, i, value) != JSONSuccess) {
+  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
     json_value_free(value);
     return JSONFailure;
   }
   return JSONSuccess;
 }
 
-JSON_Status json_array_clear(JSON_Array *array) {
-  size_t i = 0;
-  if (array == nullptr) {
-    return JSONFailure;
-  }
-  for (i = 0; i < json_array_get_count(array); i++) {
-    json_value_free(json_array_get_value(array, i));
-  }
-  array->count = 0;
-  return JSONSuccess;
+JSON_Status json_object_remove(JSON_Object *object, const char *name) {
+  return json_object_remove_internal(object, name, true);
 }
 
-JSON_Status json_array_append_value(JSON_Array *array, JSON_Value *value) {
-  if (array == nullptr || value == nullptr || value->parent != nullptr) {
-    return JSONFailure;
-  }
-  return json_array_add(array, value);
+JSON_Status json_object_dotremove(JSON_Object *object, const char *name) {
+  return json_object_dotremove_internal(object, name, true);
 }
 
-JSON_Status json_array_append_string(JSON_Array *array, const char *string) {
-  JSON_Value *value = json_value_init_string(string);
-  if (value == nullptr) {
+JSON_Status json_object_reserve(JSON_Object *object, size_t capacity) {
+  if (object == nullptr || json_value_is_frozen(object->wrapping_value) ||
+      capacity > object_index_max) {
     return JSONFailure;
   }
-  if (json_array_append_value(array, value) != JSONSuccess) {
-    json_value_free(value);
-    return JSONFailure;
+  if (capacity <= object->capacity) {
+    return JSONSuccess;
   }
-  return JSONSuccess;
+  return json_object_resize(object, capacity);
 }
 
-JSON_Status json_array_append_string_with_len(JSON_Array *array,
-                                              const char *string, size_t len) {
-  JSON_Value *value = json_value_init_string_with_len(string, len);
-  if (value == nullptr) {
+JSON_Status json_object_clear(JSON_Object *object) {
+  size_t i = 0;
+  if (object == nullptr || json_value_is_frozen(object->wrapping_value)) {
     return JSONFailure;
   }
-  if (json_array_append_value(array, value) != JSONSuccess) {
-    json_value_free(value);
-    return JSONFailure;
+  json_value_forget_cached(object->wrapping_value);
+  for (i = 0; i < json_object_get_count(object); i++) {
+    json_object_free_name(object, &object->entries[i]);
+    json_value_free_child(object->arena, object->entries[i].value);
+  }
+  object->count = 0;
+  if (object->slot_capacity > 0) {
+    memset(json_object_slots(object), 0,
+           object->slot_capacity * sizeof(uint32_t));
   }
   return JSONSuccess;
 }
 
-JSON_Status json_array_append_number(JSON_Array *array, double number) {
-  JSON_Value *value = json_value_init_number(number);
-  if (value == nullptr) {
-    return JSONFailure;
-  }
-  if (json_array_append_value(array, value) != JSONSuccess) {
-    json_value_free(value);
-    return JSONFailure;
-  }
-  return JSONSuccess;
+/* Stream API */
+static JSON_Status read_from_file(void *ctx, char *buf, size_t size,
+                                  size_t *read) {
+  *read = fread(buf, 1, size, (FILE *)ctx);
+  return *read == 0 && ferror((FILE *)ctx) ? JSONFailure : JSONSuccess;
 }
 
-JSON_Status json_array_append_boolean(JSON_Array *array, bool boolean) {
-  JSON_Value *value = json_value_init_boolean(boolean);
-  if (value == nullptr) {
-    return JSONFailure;
+/* Moves the unread input to the front of the buffer and appends what read_fun
+   delivers, growing the buffer when a single line fills it. */
+static JSON_Status json_stream_fill(JSON_Stream *stream) {
+  const size_t pending = stream->len - stream->pos;
+  if (stream->pos > 0) {
+    memmove(stream->buffer, stream->buffer + stream->pos, pending);
+    stream->consumed += stream->pos;
+    stream->pos = 0;
+    stream->len = pending;
   }
-  if (json_array_append_value(array, value) != JSONSuccess) {
-    json_value_free(value);
+  if (stream->len == stream->buffer_capacity) {
+    if (stream->buffer_capacity > SIZE_MAX / 2) {
+      return JSONFailure;
+    }
+    const size_t new_capacity =
+        max_size(stream->buffer_capacity * 2, stream_buffer_initial_capacity);
+    char *new_buffer = (char *)parson_malloc(new_capacity);
+    if (new_buffer == nullptr) {
+      return JSONFailure;
+    }
+    if (stream->len > 0) {
+      memcpy(new_buffer, stream->buffer, stream->len);
+    }
+    parson_free(stream->buffer);
+    stream->buffer = new_buffer;
+    stream->buffer_capacity = new_capacity;
+  }
+  size_t read = 0;
+  if (stream->read_fun(stream->read_ctx, stream->buffer + stream->len,
+                       stream->buffer_capacity - stream->len,
+                       &read) != JSONSuccess) {
     return JSONFailure;
   }
+  stream->data = stream->buffer;
+  stream->len += read;
+  stream->read_done = read == 0;
   return JSONSuccess;
 }
 
-JSON_Status json_array_append_null(JSON_Array *array) {
-  JSON_Value *value = json_value_init_null();
-  if (value == nullptr) {
-    return JSONFailure;
+JSON_Stream *json_stream_open_buffer(const char *buffer, size_t len) {
+  if (buffer == nullptr) {
+    return nullptr;
   }
-  if (json_array_append_value(array, value) != JSONSuccess) {
-    json_value_free(value);
-    return JSONFailure;
+  auto stream = (JSON_Stream *)parson_calloc(1, sizeof(JSON_Stream));
+  if (stream == nullptr) {
+    return nullptr;
   }
-  return JSONSuccess;
+  stream->data = buffer;
+  stream->len = len;
+  stream->read_done = true;
+  stream->line = 1;
+  return stream;
 }
 
-JSON_Status json_object_set_value(JSON_Object *object, const char *name,
-                                  JSON_Value *value) {
-  unsigned long hash = 0;
-  bool found = false;
-  size_t cell_ix = 0;
-  size_t item_ix = 0;
-  JSON_Value *old_value = nullptr;
-  char *key_copy = nullptr;
-
-  if (object == nullptr || name == nullptr || value == nullptr ||
-      value->parent != nullptr) {
-    return JSONFailure;
-  }
-  hash = hash_string(name, strlen(name));
-  found = false;
-  cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
-  if (found) {
-    item_ix = object->cells[cell_ix];
-    old_value = object->values[item_ix];
-    json_value_free(old_value);
-    object->values[item_ix] = value;
-    value->parent = json_object_get_wrapping_value(object);
-    return JSONSuccess;
+JSON_Stream *json_stream_open_file(const char *filename) {
+  mapped_file mapping;
+  if (filename == nullptr) {
+    return nullptr;
   }
-  if (object->count >= object->item_capacity) {
-    JSON_Status res = json_object_grow_and_rehash(object);
-    if (res != JSONSuccess) {
-      return JSONFailure;
+  /* pages are faulted in as the stream advances, the file may be huge */
+  if (map_file(filename, false, &mapping) == JSONSuccess) {
+    JSON_Stream *stream = json_stream_open_buffer(mapping.data, mapping.len);
+    if (stream == nullptr) {
+      unmap_file(&mapping);
+      return nullptr;
     }
-    cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
+    stream->mapping = mapping;
+    stream->mapped = true;
+    return stream;
   }
-  key_copy = parson_strdup(name);
-  if (key_copy == nullptr) {
-    return JSONFailure;
+  FILE *fp = fopen(filename, "rb");
+  if (fp == nullptr) {
+    return nullptr;
   }
-  object->names[object->count] = key_copy;
-  object->cells[cell_ix] = object->count;
-  object->values[object->count] = value;
-  object->cell_ixs[object->count] = cell_ix;
-  object->hashes[object->count] = hash;
-  object->count++;
-  value->parent = json_object_get_wrapping_value(object);
-  return JSONSuccess;
+  JSON_Stream *stream = json_stream_open_reader(read_from_file, fp);
+  if (stream == nullptr) {
+    fclose(fp);
+    return nullptr;
+  }
+  stream->file = fp;
+  return stream;
 }
 
-JSON_Status json_object_set_string(JSON_Object *object, const char *name,
-                                   const char *string) {
-  JSON_Value *value = json_value_init_string(string);
-  JSON_Status status = json_object_set_value(object, name, value);
-  if (status != JSONSuccess) {
-    json_value_free(value);
+JSON_Stream *json_stream_open_reader(JSON_Read_Function read_fun, void *ctx) {
+  if (read_fun == nullptr) {
+    return nullptr;
   }
-  return status;
+  auto stream = (JSON_Stream *)parson_calloc(1, sizeof(JSON_Stream));
+  if (stream == nullptr) {
+    return nullptr;
+  }
+  stream->read_fun = read_fun;
+  stream->read_ctx = ctx;
+  stream->line = 1;
+  return stream;
 }
 
-JSON_Status json_object_set_string_with_len(JSON_Object *object,
-                                            const char *name,
-                                            const char *string, size_t len) {
-  JSON_Value *value = json_value_init_string_with_len(string, len);
-  JSON_Status status = json_object_set_value(object, name, value);
-  if (status != JSONSuccess) {
-    json_value_free(value);
+void json_stream_set_arena(JSON_Stream *stream, JSON_Arena *arena) {
+  if (stream != nullptr) {
+    stream->arena = arena;
   }
-  return status;
 }
 
-JSON_Status json_object_set_number(JSON_Object *object, const char *name,
-                                   double number) {
-  JSON_Value *value = json_value_init_number(number);
-  JSON_Status status = json_object_set_value(object, name, value);
-  if (status != JSONSuccess) {
-    json_value_free(value);
+JSON_Value *json_stream_next(JSON_Stream *stream) {
+  if (stream == nullptr) {
+    return nullptr;
+  }
+  json_arena_reset(stream->arena);
+  while (true) {
+    const size_t unscanned = stream->len - stream->pos - stream->scanned;
+    const char *newline =
+        unscanned > 0 ? (const char *)memchr(stream->data + stream->pos +
+                                                 stream->scanned,
+                                             '\n', unscanned)
+                      : nullptr;
+    if (newline == nullptr && !stream->read_done) {
+      stream->scanned = stream->len - stream->pos;
+      if (json_stream_fill(stream) != JSONSuccess) {
+        stream->read_done = true; /* a failed read ends the stream */
+        stream->pos = stream->len;
+        return nullptr;
+      }
+      continue;
+    }
+    if (newline == nullptr && stream->pos == stream->len) {
+      return nullptr; /* end of input */
+    }
+    const char *line = stream->data + stream->pos;
+    const char *line_end =
+        newline != nullptr ? newline : stream->data + stream->len;
+    stream->record_offset = stream->consumed + stream->pos;
+    stream->record_line = stream->line;
+    stream->pos = (size_t)(line_end - stream->data) + (newline != nullptr);
+    stream->scanned = 0;
+    stream->line++;
+    const parse_context ctx = {
+        .arena = stream->arena,
+        .start = line,
+        .end = line_end,
+    };
+    const char *ptr = line;
+    skip_whitespaces(&ptr, &ctx);
+    if (ptr == line_end) {
+      continue; /* blank line */
+    }
+    JSON_Value *value = parse_value(&ptr, &ctx);
+    skip_whitespaces(&ptr, &ctx);
+    if (value != nullptr && ptr != line_end) {
+      json_value_free(value); /* more than one value on the line */
+      value = nullptr;
+    }
+    return value;
   }
-  return status;
 }
 
-JSON_Status json_object_set_boolean(JSON_Object *object, const char *name,
-                                    bool boolean) {
-  JSON_Value *value = json_value_init_boolean(boolean);
-  JSON_Status status = json_object_set_value(object, name, value);
-  if (status != JSONSuccess) {
-    json_value_free(value);
-  }
-  return status;
+bool json_stream_at_end(const JSON_Stream *stream) {
+  return stream == nullptr ||
+         (stream->read_done && stream->pos == stream->len);
+}
+
+size_t json_stream_record_offset(const JSON_Stream *stream) {
+  return stream == nullptr ? 0 : stream->record_offset;
+}
+
+size_t json_stream_record_line(const JSON_Stream *stream) {
+  return stream == nullptr ? 0 : stream->record_line;
 }
 
-JSON_Status json_object_set_null(JSON_Object *object, const char *name) {
-  JSON_Value *value = json_value_init_null();
-  JSON_Status status = json_object_set_value(object, name, value);
-  if (status != JSONSuccess) {
-    json_value_free(value);
+void json_stream_close(JSON_Stream *stream) {
+  if (stream == nullptr) {
+    return;
   }
-  return status;
+  if (stream->mapped) {
+    unmap_file(&stream->mapping);
+  }
+  if (stream->file != nullptr) {
+    fclose(stream->file);
+  }
+  parson_free(stream->buffer);
+  parson_free(stream);
 }
 
-JSON_Status json_object_dotset_value(JSON_Object *object, const char *name,
-                                     JSON_Value *value) {
-  const char *dot_pos = nullptr;
-  JSON_Value *temp_value = nullptr, *new_value = nullptr;
-  JSON_Object *temp_object = nullptr, *new_object = nullptr;
-  JSON_Status status = JSONFailure;
-  size_t name_len = 0;
-  char *name_copy = nullptr;
+JSON_Stream_Writer *json_stream_writer_new(JSON_Write_Function write_fun,
+                                           void *ctx) {
+  if (write_fun == nullptr) {
+    return nullptr;
+  }
+  auto writer =
+      (JSON_Stream_Writer *)parson_calloc(1, sizeof(JSON_Stream_Writer));
+  if (writer == nullptr) {
+    return nullptr;
+  }
+  writer->chunk = (char *)parson_malloc(serialization_chunk_size);
+  if (writer->chunk == nullptr) {
+    parson_free(writer);
+    return nullptr;
+  }
+  writer->write_fun = write_fun;
+  writer->write_ctx = ctx;
+  return writer;
+}
 
-  if (object == nullptr || name == nullptr || value == nullptr ||
-      value->parent != nullptr) {
-    return JSONFailure;
+JSON_Stream_Writer *json_stream_writer_open_file(const char *filename) {
+  if (filename == nullptr) {
+    return nullptr;
   }
-  dot_pos = strchr(name, '.');
-  if (dot_pos == nullptr) {
-    return json_object_set_value(object, name, value);
+  FILE *fp = fopen(filename, "wb");
+  if (fp == nullptr) {
+    return nullptr;
   }
-  name_len = dot_pos - name;
-  temp_value = json_object_getn_value(object, name, name_len);
-  if (temp_value != nullptr) {
-    /* Don't overwrite existing non-object (unlike json_object_set_value, but it
-     * shouldn't be changed at this point) */
-    if (json_value_get_type(temp_value) != JSONObject) {
-      return JSONFailure;
-    }
-    temp_object = json_value_get_object(temp_value);
-    return json_object_dotset_value(temp_object, dot_pos + 1, value);
+  JSON_Stream_Writer *writer = json_stream_writer_new(write_to_file, fp);
+  if (writer == nullptr) {
+    fclose(fp);
+    return nullptr;
   }
-  new_value = json_value_init_object();
-  if (new_value == nullptr) {
+  writer->file = fp;
+  return writer;
+}
+
+JSON_Status json_stream_write(JSON_Stream_Writer *writer,
+                              const JSON_Value *value) {
+  if (writer == nullptr || writer->failed || value == nullptr) {
     return JSONFailure;
   }
-  new_object = json_value_get_object(new_value);
-  status = json_object_dotset_value(new_object, dot_pos + 1, value);
-  if (status != JSONSuccess) {
-    json_value_free(new_value);
-    return JSONFailure;
+  serialization_buffer out = {
+      .context = &parson_default_context,
+      .cursor = writer->chunk + writer->used,
+      .end = writer->chunk + serialization_chunk_size,
+      .start = writer->chunk,
+      .write_fun = writer->write_fun,
+      .write_ctx = writer->write_ctx,
+  };
+  JSON_Status status = json_serialize_value(value, &out, false);
+  if (status == JSONSuccess) {
+    append_literal(&out, "\n");
   }
-  name_copy = parson_strndup(name, name_len);
-  if (name_copy == nullptr) {
-    json_object_dotremove_internal(new_object, dot_pos + 1, false);
-    json_value_free(new_value);
-    return JSONFailure;
+  if (status == JSONSuccess && !out.failed) {
+    writer->used = (size_t)(out.cursor - writer->chunk);
+    return JSONSuccess;
   }
-  status = json_object_add(object, name_copy, new_value);
-  if (status != JSONSuccess) {
-    parson_free(name_copy);
-    json_object_dotremove_internal(new_object, dot_pos + 1, false);
-    json_value_free(new_value);
-    return JSONFailure;
+  /* a partial record must not reach the sink, so drop it if nothing of it has
+     been passed on yet and give up otherwise */
+  if (out.failed ||
+      out.cursor != writer->chunk + writer->used + out.written_total) {
+    writer->failed = true;
   }
-  return JSONSuccess;
+  return JSONFailure;
 }
 
-JSON_Status json_object_dotset_string(JSON_Object *object, const char *name,
-                                      const char *string) {
-  JSON_Value *value = json_value_init_string(string);
-  if (value == nullptr) {
+JSON_Status json_stream_writer_flush(JSON_Stream_Writer *writer) {
+  if (writer == nullptr || writer->failed) {
     return JSONFailure;
   }
-  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
-    json_value_free(value);
+  if (writer->used > 0 &&
+      writer->write_fun(writer->write_ctx, writer->chunk, writer->used) !=
+          JSONSuccess) {
+    writer->failed = true;
+    return JSONFailure;
+  }
+  writer->used = 0;
+  if (writer->file != nullptr && fflush(writer->file) != 0) {
+    writer->failed = true;
     return JSONFailure;
   }
   return JSONSuccess;
 }
 
-JSON_Status json_object_dotset_string_with_len(JSON_Object *object,
-                                               const char *name,
-                                               const char *string, size_t len) {
-  JSON_Value *value = json_value_init_string_with_len(string, len);
-  if (value == nullptr) {
+JSON_Status json_stream_writer_close(JSON_Stream_Writer *writer) {
+  if (writer == nullptr) {
     return JSONFailure;
   }
-  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
-    json_value_free(value);
-    return JSONFailure;
+  JSON_Status status = json_stream_writer_flush(writer);
+  if (writer->file != nullptr && fclose(writer->file) == EOF) {
+    status = JSONFailure;
   }
-  return JSONSuccess;
+  parson_free(writer->chunk);
+  parson_free(writer);
+  return status;
 }
 
-JSON_Status json_object_dotset_number(JSON_Object *object, const char *name,
-                                      double number) {
-  JSON_Value *value = json_value_init_number(number);
-  if (value == nullptr) {
-    return JSONFailure;
-  }
-  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
-    json_value_free(value);
-    return JSONFailure;
+/* Path API */
+JSON_Path *json_path_compile(const char *path) {
+  return json_path_make(path, false);
+}
+
+JSON_Path *json_path_compile_pointer(const char *pointer) {
+  return json_path_make(pointer, true);
+}
+
+void json_path_free(JSON_Path *path) { parson_free(path); }
+
+JSON_Value *json_path_get(const JSON_Value *value, const JSON_Path *path) {
+  if (path == nullptr) {
+    return nullptr;
   }
-  return JSONSuccess;
+  return json_path_walk(value, path, path->count);
 }
 
-JSON_Status json_object_dotset_boolean(JSON_Object *object, const char *name,
-                                       bool boolean) {
-  JSON_Value *value = json_value_init_boolean(boolean);
-  if (value == nullptr) {
+JSON_Status json_path_set(JSON_Value *root, const JSON_Path *path,
+                          JSON_Value *value) {
+  JSON_Value *parent = nullptr;
+  JSON_Value *next = nullptr;
+  JSON_Value *chain = nullptr;
+  JSON_Object *object = nullptr;
+  JSON_Object *chain_parent = nullptr;
+  JSON_Array *array = nullptr;
+  const path_segment *segment = nullptr;
+  size_t i = 0;
+
+  if (root == nullptr || path == nullptr || path->count == 0 ||
+      value == nullptr || value->parent != nullptr) {
     return JSONFailure;
   }
-  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
-    json_value_free(value);
-    return JSONFailure;
+  /* Follow the existing containers as far as they go. */
+  parent = root;
+  for (i = 0; i + 1 < path->count; i++) {
+    next = json_path_step(parent, &path->segments[i]);
+    if (next == nullptr) {
+      break;
+    }
+    parent = json_path_thaw_step(parent, &path->segments[i], next);
+    if (parent == nullptr) {
+      return JSONFailure;
+    }
   }
-  return JSONSuccess;
-}
+  segment = &path->segments[i];
 
-JSON_Status json_object_dotset_null(JSON_Object *object, const char *name) {
-  JSON_Value *value = json_value_init_null();
-  if (value == nullptr) {
+  if (json_value_get_type(parent) == JSONArray) {
+    if (i + 1 < path->count) {
+      return JSONFailure; /* missing elements are not created */
+    }
+    array = json_value_get_array(parent);
+    if (segment->index < json_array_get_count(array)) {
+      return json_array_replace_value(array, segment->index, value);
+    }
+    if (segment->index == path_end_index ||
+        segment->index == json_array_get_count(array)) {
+      return json_array_append_value(array, value);
+    }
     return JSONFailure;
   }
-  if (json_object_dotset_value(object, name, value) != JSONSuccess) {
-    json_value_free(value);
+
+  /* Missing object members are created like json_object_dotset_value does.
+     value is attached last, so undoing a failure never frees it. */
+  object = json_value_get_object(parent);
+  if (object == nullptr) {
     return JSONFailure;
   }
+  chain_parent = object;
+  const path_segment *chain_segment = segment;
+  for (; i + 1 < path->count; i++) {
+    segment = &path->segments[i];
+    chain = json_value_init_object_in(object->arena);
+    if (chain == nullptr ||
+        json_object_set_hashed(object, segment->name, segment->name_len,
+                               segment->hash, chain) != JSONSuccess) {
+      json_value_free(chain);
+      goto error;
+    }
+    object = json_value_get_object(chain);
+  }
+  segment = &path->segments[path->count - 1];
+  if (json_object_set_hashed(object, segment->name, segment->name_len,
+                             segment->hash, value) != JSONSuccess) {
+    goto error;
+  }
   return JSONSuccess;
+error:
+  if (chain_parent != object) {
+    json_object_remove_at(
+        chain_parent,
+        json_object_find(chain_parent, chain_segment->name,
+                         chain_segment->name_len, chain_segment->hash),
+        true);
+  }
+  return JSONFailure;
 }
 
-JSON_Status json_object_remove(JSON_Object *object, const char *name) {
-  return json_object_remove_internal(object, name, true);
-}
-
-JSON_Status json_object_dotremove(JSON_Object *object, const char *name) {
-  return json_object_dotremove_internal(object, name, true);
-}
+JSON_Status json_path_remove(JSON_Value *root, const JSON_Path *path) {
+  JSON_Value *parent = nullptr;
+  JSON_Value *next = nullptr;
+  JSON_Object *object = nullptr;
+  const path_segment *segment = nullptr;
+  size_t entry_ix = 0;
 
-JSON_Status json_object_clear(JSON_Object *object) {
-  size_t i = 0;
-  if (object == nullptr) {
+  if (path == nullptr || path->count == 0) {
     return JSONFailure;
   }
-  for (i = 0; i < json_object_get_count(object); i++) {
-    parson_free(object->names[i]);
-    object->names[i] = nullptr;
-
-    json_value_free(object->values[i]);
-    object->values[i] = nullptr;
+  parent = root;
+  for (size_t i = 0; i + 1 < path->count && parent != nullptr; i++) {
+    next = json_path_step(parent, &path->segments[i]);
+    parent = next == nullptr
+                 ? nullptr
+                 : json_path_thaw_step(parent, &path->segments[i], next);
   }
-  object->count = 0;
-  for (i = 0; i < object->cell_capacity; i++) {
-    object->cells[i] = object_invalid_ix;
+  segment = &path->segments[path->count - 1];
+  switch (json_value_get_type(parent)) {
+  case JSONObject:
+    object = json_value_get_object(parent);
+    entry_ix = json_object_find(object, segment->name, segment->name_len,
+                                segment->hash);
+    if (entry_ix == object_invalid_ix ||
+        json_value_is_frozen(json_object_get_wrapping_value(object))) {
+      return JSONFailure;
+    }
+    json_object_remove_at(object, entry_ix, true);
+    return JSONSuccess;
+  case JSONArray:
+    return json_array_remove(json_value_get_array(parent), segment->index);
+  default:
+    return JSONFailure;
   }
-  return JSONSuccess;
 }
 
 JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value) {
@@ -2560,8 +9409,9 @@ JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value) {
     }
     for (i = 0; i < count; i++) {
       key = json_object_get_name(schema_object, i);
-      temp_schema_value = json_object_get_value(schema_object, key);
-      temp_value = json_object_get_value(value_object, key);
+      temp_schema_value = json_object_get_value_at(schema_object, i);
+      temp_value = json_object_get_value_with_len(
+          value_object, key, json_object_get_name_len(schema_object, i));
       if (temp_value == nullptr) {
         return JSONFailure;
       }
@@ -2581,22 +9431,179 @@ JSON_Status json_validate(const JSON_Value *schema, const JSON_Value *value) {
   }
 }
 
+JSON_Schema *json_schema_compile(const JSON_Value *schema) {
+  size_t count = 0;
+  size_t slot_count = 0;
+  size_t names_len = 0;
+  size_t depth = 0;
+
+  if (schema == nullptr) {
+    return nullptr;
+  }
+  json_schema_measure(schema, 0, &count, &slot_count, &names_len, &depth);
+  auto result = (JSON_Schema *)parson_malloc(
+      sizeof(JSON_Schema) + count * sizeof(schema_op) +
+      slot_count * sizeof(size_t) + names_len);
+  if (result == nullptr) {
+    return nullptr;
+  }
+  result->count = count;
+  result->depth = depth;
+  size_t *slots = (size_t *)(result->ops + count);
+  char *names = (char *)(slots + slot_count);
+  json_schema_emit(result, schema, 0, &slots, &names);
+  return result;
+}
+
+void json_schema_free(JSON_Schema *schema) { parson_free(schema); }
+
+JSON_Status json_schema_validate(const JSON_Schema *schema,
+                                 const JSON_Value *value) {
+  if (schema == nullptr || value == nullptr) {
+    return JSONFailure;
+  }
+  return json_schema_check(schema, 0, value);
+}
+
+JSON_Status json_schema_validate_buffer(const JSON_Schema *schema,
+                                        const char *buffer, size_t len) {
+  static const JSON_Handler handler = {
+      .on_object_begin = schema_on_object_begin,
+      .on_object_end = schema_on_end,
+      .on_array_begin = schema_on_array_begin,
+      .on_array_end = schema_on_end,
+      .on_key = schema_on_key,
+      .on_string = schema_on_string,
+      .on_number = schema_on_number,
+      .on_boolean = schema_on_boolean,
+      .on_null = schema_on_null,
+  };
+  if (schema == nullptr || buffer == nullptr) {
+    return JSONFailure;
+  }
+  auto scratch = (unsigned char *)parson_malloc(
+      schema->depth * sizeof(schema_frame) + schema->count);
+  if (scratch == nullptr) {
+    return JSONFailure;
+  }
+  schema_events events = {
+      .schema = schema,
+      .frames = (schema_frame *)scratch,
+      .seen = scratch + schema->depth * sizeof(schema_frame),
+      .expect = 0,
+  };
+  JSON_Status status = json_parse_events(buffer, len, &handler, &events);
+  parson_free(scratch);
+  return status == JSONSuccess && !events.failed ? JSONSuccess : JSONFailure;
+}
+
+/* Fails for lazy containers whose text fails to parse, so that no hash is
+   kept for the containers around them. */
+static JSON_Status json_value_hash_r(const JSON_Value *value, uint64_t *hash) {
+  const JSON_Object *object = nullptr;
+  const JSON_Array *array = nullptr;
+  JSON_String string = {0};
+  uint64_t member_hash = 0;
+  uint64_t members = 0;
+  size_t i = 0;
+  const JSON_Value_Type type = json_value_get_type(value);
+
+  switch (type) {
+  case JSONArray:
+    array = json_value_get_array(value);
+    if (array == nullptr) {
+      return JSONFailure; /* lazy text that failed to parse */
+    }
+    if ((value->flags & value_flag_hashed) != 0U) {
+      *hash = array->structure_hash;
+      return JSONSuccess;
+    }
+    *hash = structure_mix((uint64_t)type, array->count);
+    for (i = 0; i < array->count; i++) {
+      if (json_value_hash_r(array->items[i], &member_hash) != JSONSuccess) {
+        return JSONFailure;
+      }
+      *hash = structure_mix(*hash, member_hash);
+    }
+    ((JSON_Array *)array)->structure_hash = *hash;
+    ((JSON_Value *)value)->flags |= value_flag_hashed;
+    return JSONSuccess;
+  case JSONObject:
+    object = json_value_get_object(value);
+    if (object == nullptr) {
+      return JSONFailure; /* lazy text that failed to parse */
+    }
+    if ((value->flags & value_flag_hashed) != 0U) {
+      *hash = object->structure_hash;
+      return JSONSuccess;
+    }
+    /* a sum doesn't depend on the order of the members */
+    for (i = 0; i < object->count; i++) {
+      const object_entry *entry = &object->entries[i];
+      if (json_value_hash_r(entry->value, &member_hash) != JSONSuccess) {
+        return JSONFailure;
+      }
+      members += structure_mix(entry->hash, member_hash);
+    }
+    *hash = structure_mix(structure_mix((uint64_t)type, object->count),
+                          members);
+    ((JSON_Object *)object)->structure_hash = *hash;
+    ((JSON_Value *)value)->flags |= value_flag_hashed;
+    return JSONSuccess;
+  case JSONString:
+    string = json_value_get_string_desc(value);
+    *hash = structure_mix((uint64_t)type,
+                          hash_string(string.chars, string.length));
+    return JSONSuccess;
+  case JSONBoolean:
+    *hash = structure_mix((uint64_t)type, json_value_get_boolean(value));
+    return JSONSuccess;
+  case JSONNumber: /* compared with a tolerance, so the value can't count */
+  case JSONNull:
+    *hash = structure_mix((uint64_t)type, 0);
+    return JSONSuccess;
+  case JSONError:
+  default:
+    return JSONFailure;
+  }
+}
+
+uint64_t json_value_hash(const JSON_Value *value) {
+  uint64_t hash = 0;
+  if (json_value_hash_r(value, &hash) != JSONSuccess) {
+    return 0;
+  }
+  return hash;
+}
+
 bool json_value_equals(const JSON_Value *a, const JSON_Value *b) {
   JSON_Object *a_object = nullptr, *b_object = nullptr;
   JSON_Array *a_array = nullptr, *b_array = nullptr;
-  const JSON_String *a_string = nullptr, *b_string = nullptr;
-  const char *key = nullptr;
+  JSON_String a_string = {0}, b_string = {0};
   size_t a_count = 0, b_count = 0, i = 0;
   JSON_Value_Type a_type, b_type;
+  if (a == b) {
+    return true; /* e.g. the same frozen container */
+  }
   a_type = json_value_get_type(a);
   b_type = json_value_get_type(b);
   if (a_type != b_type) {
     return false;
   }
+  /* hashes differ only between unequal values, but computing them here
+     would make comparing write to both trees */
+  if ((a_type == JSONArray || a_type == JSONObject) &&
+      (a->flags & b->flags & value_flag_hashed) != 0U &&
+      json_value_hash(a) != json_value_hash(b)) {
+    return false;
+  }
   switch (a_type) {
   case JSONArray:
     a_array = json_value_get_array(a);
     b_array = json_value_get_array(b);
+    if (a_array == nullptr || b_array == nullptr) {
+      return false; /* lazy text that failed to parse */
+    }
     a_count = json_array_get_count(a_array);
     b_count = json_array_get_count(b_array);
     if (a_count != b_count) {
@@ -2612,15 +9619,21 @@ bool json_value_equals(const JSON_Value *a, const JSON_Value *b) {
   case JSONObject:
     a_object = json_value_get_object(a);
     b_object = json_value_get_object(b);
+    if (a_object == nullptr || b_object == nullptr) {
+      return false; /* lazy text that failed to parse */
+    }
     a_count = json_object_get_count(a_object);
     b_count = json_object_get_count(b_object);
     if (a_count != b_count) {
       return false;
     }
     for (i = 0; i < a_count; i++) {
-      key = json_object_get_name(a_object, i);
-      if (!json_value_equals(json_object_get_value(a_object, key),
-                             json_object_get_value(b_object, key))) {
+      /* the stored hash spares rehashing, interned names match by pointer */
+      const object_entry *entry = &a_object->entries[i];
+      const size_t b_ix = json_object_find(b_object, entry->key,
+                                           entry->key_len, entry->hash);
+      if (b_ix == object_invalid_ix ||
+          !json_value_equals(entry->value, b_object->entries[b_ix].value)) {
         return false;
       }
     }
@@ -2628,16 +9641,20 @@ bool json_value_equals(const JSON_Value *a, const JSON_Value *b) {
   case JSONString:
     a_string = json_value_get_string_desc(a);
     b_string = json_value_get_string_desc(b);
-    if (a_string == nullptr || b_string == nullptr) {
-      return false; /* shouldn't happen */
-    }
-    return a_string->length == b_string->length &&
-           memcmp(a_string->chars, b_string->chars, a_string->length) == 0;
+    return a_string.length == b_string.length &&
+           memcmp(a_string.chars, b_string.chars, a_string.length) == 0;
   case JSONBoolean:
     return json_value_get_boolean(a) == json_value_get_boolean(b);
-  case JSONNumber:
+  case JSONNumber: {
+    const uint32_t integer_flags = value_flag_int64 | value_flag_uint64;
+    if ((a->flags & integer_flags) != 0U && (b->flags & integer_flags) != 0U) {
+      /* both exact, and the two kinds never hold the same number */
+      return (a->flags & integer_flags) == (b->flags & integer_flags) &&
+             a->value.uint64 == b->value.uint64;
+    }
     return fabs(json_value_get_number(a) - json_value_get_number(b)) <
            json_number_epsilon;
+  }
   case JSONError:
     return true;
   case JSONNull:
@@ -2680,31 +9697,124 @@ void json_set_allocation_functions(JSON_Malloc_Function malloc_fun,
   if (malloc_fun == nullptr || free_fun == nullptr) {
     return;
   }
-  if (parson_float_format != nullptr) {
-    parson_free(parson_float_format);
-    parson_float_format = nullptr;
+  if (parson_default_context.float_format != nullptr) {
+    parson_free(parson_default_context.float_format);
+    parson_default_context.float_format = nullptr;
+    parson_default_context.generation = context_next_generation();
   }
-  parson_malloc = malloc_fun;
-  parson_free = free_fun;
+  parson_malloc_fun = malloc_fun;
+  parson_free_fun = free_fun;
 }
 
+void json_set_hash_seed(uint64_t seed) { parson_hash_seed = seed; }
+
 void json_set_escape_slashes(bool escape_slashes) {
-  parson_escape_slashes = escape_slashes;
+  json_context_set_escape_slashes(&parson_default_context, escape_slashes);
 }
 
 void json_set_float_serialization_format(const char *format) {
-  if (parson_float_format != nullptr) {
-    parson_free(parson_float_format);
-    parson_float_format = nullptr;
+  (void)json_context_set_float_serialization_format(&parson_default_context,
+                                                    format);
+}
+
+void json_set_number_serialization_function(
+    JSON_Number_Serialization_Function func) {
+  json_context_set_number_serialization_function(&parson_default_context,
+                                                 func);
+}
+
+void json_set_number_format_mode(JSON_Number_Format_Mode mode) {
+  json_context_set_number_format_mode(&parson_default_context, mode);
+}
+
+JSON_Context *json_context_new(const JSON_Allocator *allocator) {
+  const JSON_Allocator *source =
+      allocator != nullptr ? allocator : &parson_default_context.allocator;
+  if (source->malloc_fun == nullptr || source->free_fun == nullptr) {
+    return nullptr;
   }
-  if (format == nullptr) {
-    parson_float_format = nullptr;
+  auto context =
+      (JSON_Context *)source->malloc_fun(source->ctx, sizeof(JSON_Context));
+  if (context == nullptr) {
+    return nullptr;
+  }
+  *context = (JSON_Context){
+      .allocator = *source,
+      .escape_slashes = true,
+      .number_format_mode = JSONNumberFormatPrintf,
+  };
+  context->generation = context_next_generation();
+  return context;
+}
+
+void json_context_free(JSON_Context *context) {
+  if (context == nullptr || context == &parson_default_context) {
     return;
   }
-  parson_float_format = parson_strdup(format);
+  if (context->float_format != nullptr) {
+    context_free(context, context->float_format,
+                 strlen(context->float_format) + 1);
+  }
+  context_free(context, context, sizeof(JSON_Context));
 }
 
-void json_set_number_serialization_function(
-    JSON_Number_Serialization_Function func) {
-  parson_number_serialization_function = func;
+void json_context_set_escape_slashes(JSON_Context *context,
+                                     bool escape_slashes) {
+  if (context != nullptr) {
+    context->escape_slashes = escape_slashes;
+    context->generation = context_next_generation();
+  }
+}
+
+JSON_Status json_context_set_float_serialization_format(JSON_Context *context,
+                                                        const char *format) {
+  if (context == nullptr) {
+    return JSONFailure;
+  }
+  char *copy = nullptr;
+  if (format != nullptr) {
+    const size_t size = strlen(format) + 1;
+    copy = (char *)context_malloc(context, size);
+    if (copy == nullptr) {
+      return JSONFailure;
+    }
+    memcpy(copy, format, size);
+  }
+  if (context->float_format != nullptr) {
+    context_free(context, context->float_format,
+                 strlen(context->float_format) + 1);
+  }
+  context->float_format = copy;
+  context->generation = context_next_generation();
+  return JSONSuccess;
+}
+
+void json_context_set_number_serialization_function(
+    JSON_Context *context, JSON_Number_Serialization_Function fun) {
+  if (context != nullptr) {
+    context->number_serialization_function = fun;
+    context->generation = context_next_generation();
+  }
+}
+
+void json_context_set_number_format_mode(JSON_Context *context,
+                                         JSON_Number_Format_Mode mode) {
+  if (context != nullptr) {
+    context->number_format_mode = mode;
+    context->generation = context_next_generation();
+  }
+}
+
+void json_context_set_stats(JSON_Context *context, JSON_Stats *stats) {
+  if (context != nullptr) {
+    context->stats = stats;
+  }
+}
+
+void json_stats_reset(JSON_Stats *stats) {
+  if (stats == nullptr) {
+    return;
+  }
+  *stats = (JSON_Stats){.clock_fun = stats->clock_fun,
+                        .clock_ctx = stats->clock_ctx};
 }